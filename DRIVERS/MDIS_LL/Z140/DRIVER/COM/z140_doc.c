@@ -71,12 +71,199 @@
     <tr><td>M_close()</td>           <td>Close device</td>           <td>Z140_Exit()</td></tr>
     <tr><td>M_setstat()</td>         <td>Set device parameter</td>   <td>Z140_SetStat()</td></tr>
     <tr><td>M_getstat()</td>         <td>Get device parameter</td>   <td>Z140_GetStat()</td></tr>
+    <tr><td>M_getblock()</td>        <td>Read measurement records</td> <td>Z140_BlockRead()</td></tr>
     <tr><td>M_errstringTs()</td>     <td>Generate error message</td> <td>-</td></tr>
 	</table>
 
 
 	\n \section codes Z140 specific Getstat/Setstat codes
 	see \ref getstat_setstat_codes "Getstat/Setstat codes"
+	and \ref getstat_setstat_blk_codes "Getstat/Setstat block codes"
+
+	\n \subsection shadow Configuration shadow registers
+	The driver keeps a copy of the configuration registers, so the
+	configuration getstats (Z140_DEBOUNCET, Z140_MEAS_TOUT, Z140_ROLLINGT,
+	Z140_STANDSTILLT, Z140_DIRDET_TOUT, Z140_TPATTERN) do not access the
+	hardware. For verification, Z140_SHADOW_CHK compares the copy with the
+	hardware and returns the differing registers (Z140_SHD_xxx flags).
+
+	\n \subsection config Complete configuration and profiles
+	The Z140_BLK_CONFIG block setstat sets all configuration parameters and
+	the test pattern with one call (see Z140_CONFIG). All values are checked
+	before any register is written, so an illegal value leaves the
+	configuration unchanged. The block getstat returns the configuration.
+
+	Up to Z140_PROFILE_MAX named configurations can be defined in the
+	descriptor (directories PROFILE_0, PROFILE_1, ...). Z140_PROFILE applies
+	a profile the same way, Z140_BLK_PROFILES returns the profile table.
+
+	\n \subsection snapshot Measurement snapshot
+	The Z140_BLK_SNAPSHOT block getstat returns the period, distance and
+	status registers with a single driver call (see Z140_SNAPSHOT). The
+	distance counters and the status are read consistently; if the counters
+	keep changing during all re-reads, the driver sets Z140_ST_TORN in the
+	status. Reading the snapshot consumes the new period values of the calling
+	process like Z140_PERIOD_A/B (see \ref latch). The period values
+	include the raw NEW/VLD/LSTS flags, Z140_PER_ERR() converts them into the
+	error code that Z140_PERIOD_A/B would return.
+
+	\n \subsection tstamp Capture timestamps
+	The driver takes a monotonic timestamp [ns] when it reads the registers.
+	Under Linux it is the kernel monotonic clock, which applications read
+	with clock_gettime(CLOCK_MONOTONIC), otherwise the OSS tick counter.
+	Z140_BLK_SNAPSHOT, Z140_BLK_DISTANCE64 and the stream records contain
+	the timestamp. For single values, Z140_BLK_VALUE reads the value of
+	Z140_PERIOD_A/B, Z140_DISTANCE_FWD/BWD or Z140_STATUS together with its
+	timestamp (see Z140_VALUE). The error code of the value is returned in
+	the structure. Z140_BLK_TSTAMP returns the timestamp of the last of these
+	reads on the device, which may be from another thread.
+
+	For periods, the driver also returns the age: the time since it read
+	the value with NEW flag for the first time. The accuracy of the age
+	depends on how often the driver reads the period registers (sampler,
+	interrupt or getstat).
+
+	\n \subsection stream Sample stream
+	Each acquisition of the measurement registers is stored as timestamped
+	record (Z140_SAMPLE) in a ring buffer of the driver. M_getblock() returns
+	all records which have not been read yet, up to the buffer size.
+
+	Each process has its own read cursor (see \ref latch), so applications
+	which read the sample stream independently (e.g. a recorder and a live
+	consumer) all get every record.
+
+	With the descriptor key SAMPLE_RATE_HZ, the driver acquires the records
+	periodically from an OSS alarm, independent of the application timing.
+	RING_DEPTH sets the number of records in the ring buffer and
+	OVERFLOW_POLICY whether the oldest (drop-oldest) or the new record
+	(drop-newest) is lost when the slowest reader does not keep up.
+	Z140_RING_OVERRUN returns the number of such overruns. RING_DEPTH must
+	be a power of two. A reader which has not read for 10 seconds is
+	considered gone and no longer holds back the ring, the records it
+	loses are still counted as overruns. Z140_RD_RELEASE releases the
+	reader state of the calling process at once, call it before closing
+	the path. With the sampler or the interrupt, only these acquire the
+	stream records, Z140_BLK_SNAPSHOT and the speed getstats don't add
+	records.
+
+	\n \subsection dist64 64-bit distance counters
+	The driver extends the 32-bit distance registers to 64-bit on each access
+	and each sampler/interrupt acquisition, Z140_BLK_DISTANCE64 returns both
+	64-bit counters. A register wrap is only detected if the counter is read
+	at least once per wrap, so enable the sampler for long-running odometry.
+
+	By default, the driver resets the distance counters when the first path is
+	opened and when the last path is closed. With KEEP_DISTANCE=1 the
+	counters are kept: the driver keeps the 64-bit counters of up to 8
+	devices when the last path is closed, and continues them with the
+	register changes when the device is opened again. Only a wrap of a
+	register while the device is closed is not detected.
+
+	\n \subsection signal Status transition signal
+	Z140_SIG_SET installs a signal which the driver sends when one of the
+	status flags selected with Z140_SIG_MASK changes, e.g. rolling to
+	standstill or a direction change. Z140_SIG_EDGES returns the changed flags
+	since its last call. The driver detects transitions whenever it reads the
+	status, so enable the sampler or the interrupt mode for timely signals.
+
+	\n \subsection perstat Period statistics
+	The driver keeps min, max, mean and the sum of squared deviations
+	(integer Welford algorithm) over the valid period values of both signals.
+	Z140_BLK_PERSTAT returns the current and the last completed window of
+	Z140_PERSTAT_WIN (or PERSTAT_WINDOW) valid periods, Z140_PERSTAT_VAR()
+	calculates the variance. The windows of signal A and B complete
+	independently, windows[] counts them per signal. Without window
+	(Z140_PERSTAT_WIN=0) the driver halves count and sum of squared
+	deviations at 2^28 periods, so the statistics don't overflow.
+	Z140_PERSTAT_RST resets the statistics.
+	Period values are only seen by the driver when it reads the period
+	registers, so enable the sampler or the interrupt mode.
+
+	\n \subsection filter Period filter
+	Z140_FILTER_A/B (or FILTER_A/B) select a filter for the periods of
+	each signal: the median of the last 1..15 valid periods
+	(Z140_FLT_MEDIAN) or a fixed-point first-order IIR filter with the
+	coefficient 1/2^k (Z140_FLT_IIR). The filter is fed with every new
+	period the driver reads, Z140_PERIOD_FLT_A/B return the filtered
+	period next to the raw value of Z140_PERIOD_A/B. With interrupt driven
+	acquisition or the sampler, the filter sees all periods and the
+	application can poll the filtered value as seldom as it needs it.
+	Periods with phase length violation are skipped, a measurement timeout
+	restarts the filter (Z140_ERR_PER_INVALID until the next valid period).
+
+	\n \subsection speed Speed estimate
+	Z140_BLK_SPEED returns a speed estimate in pulses/s (Z140_SPEED_EST)
+	with Z140_SPEED_FRAC fractional bits, Z140_SPEED only the value. The
+	driver combines the last valid period (signal A, else B) with the
+	distance counter delta over an interval of at least one sample period
+	(descriptor key SPEED_INTERVAL, default 10ms, if the sampler is off),
+	extended up to 1s until it holds 16 pulses: with few pulses per
+	interval the period estimate dominates, from 16 pulses on the count
+	estimate is used alone. The sign follows the direction status, the
+	quality flags (Z140_SPD_xxx) tell which estimates contributed, standstill
+	or an unknown direction. Without the sampler (SAMPLE_RATE_HZ=0), the
+	estimate is updated on a call if SPEED_INTERVAL passed since the last
+	update, so calls in quick succession don't estimate from a few
+	microseconds.
+
+	\n \subsection hist Period histograms
+	In addition, the driver counts each valid period value of both signals
+	in a fixed-size histogram with log-scaled buckets: 16 linear sub-buckets
+	per power of two, so the bucket width is at most 1/16 of the value over
+	the whole 29-bit range. This shows the distribution and the tails (e.g.
+	jitter percentiles) over long runs without storing the values.
+	Z140_BLK_HIST returns the histograms (Z140_HIST), Z140_HIST_LOW() the
+	lower bound of a bucket. Z140_HIST_RST resets the histograms.
+
+	\n \subsection counters Driver counters
+	The driver always counts its getstat and setstat calls per code with
+	the number of errors and the min/max/sum of the call costs (cpu cycles
+	under Linux, otherwise ns), the register reads and writes, and the
+	Z140_ERR_NO_DATA, Z140_ERR_PH_VIOLATION and Z140_ERR_PER_INVALID errors
+	returned by Z140_PERIOD_A/B. Z140_BLK_COUNTERS returns the counters
+	(Z140_COUNTERS), Z140_CNT_IDX() the slot of a code. Z140_CNT_RST resets
+	them. Unlike DEBUG_LEVEL, the counters do not change the timing of the
+	application.
+
+	\n \subsection trace Call trace
+	For a detailed view, Z140_TRACE_MODE (or TRACE_MODE) enables a binary
+	trace of the getstat and/or setstat calls: the driver stores code,
+	channel, value, error and timestamp as fixed-size entry (Z140_TRACE_ENTRY)
+	in a ring of TRACE_DEPTH entries (a power of two), without formatting
+	text in the calls.
+	Z140_BLK_TRACE drains the entries, z140_trace decodes them.
+
+	\n \subsection irq Interrupt driven acquisition
+	With the MDIS descriptor key IRQ_ENABLE=1, the driver acquires a record
+	in its interrupt routine whenever a period register reports a new value,
+	so the applications do not have to poll. M_LL_IRQ_COUNT returns the number
+	of serviced interrupts. The sampler (SAMPLE_RATE_HZ or 1000Hz) keeps
+	running as fallback and only acquires if no interrupt occurred since its
+	last call, e.g. if no interrupt is connected to the IP core. The sampler
+	is a 1ms OSS alarm, so the fallback acquires at most 1000 records per
+	second; faster signals lose periods without the interrupt.
+	Without IRQ_ENABLE=1 the interrupt routine returns immediately without
+	accessing the IP core.
+
+	\n \subsection latch Period latch for multiple readers
+	Reading a period register clears its NEW flag in the IP core. Therefore
+	the driver latches each new period value with a sequence number
+	(Z140_PERIOD_SEQ_A/B) and remembers the last returned sequence number per
+	reader. Z140_PERIOD_A/B and Z140_BLK_SNAPSHOT report a new value once to
+	each reader, so several applications (e.g. a logger and a controller)
+	all see every new value.
+
+	MDIS does not pass the path to the low-level driver, so a reader is
+	identified by its process id (under Linux the id of the calling thread).
+	Paths of the same process share the NEW state and the stream read cursor.
+	The driver keeps 16 readers, if more processes read, the least recently
+	used reader state is taken over.
+
+	The driver does not request the MDIS call lock (LL_LOCK_NONE), so the
+	readers do not wait for each other's calls. The reader states, the
+	latch and all other state shared with the sampler and the interrupt
+	are only accessed with interrupts masked, for a few register accesses
+	or record copies at a time.
 
 
     \n \section programs Overview of provided programs
@@ -86,10 +273,93 @@
 
     \subsection z140_ctrl Control tool for Frequency Counter driver
     z140_ctrl.c (see example section)
+
+    In logging mode (-F=csv, -F=bin or -F=zrec), z140_ctrl writes timestamped
+    measurement snapshots with a fixed period (-T=<us>) through a large
+    buffer to a file or stdout, and reports the achieved rate and the
+    missed periods at exit.
+
+    The loops of z140_simp (flag d) and z140_ctrl (-D, always in logging
+    mode) can wait for absolute deadlines (clock_nanosleep() with
+    TIMER_ABSTIME) instead of a delay after each cycle, so the cycle
+    time does not drift with the work time. At exit, they print a
+    histogram of the wake-up lateness and the number of overruns. Other
+    operating systems than Linux wait with UOS_Delay() until the deadline
+    (ms resolution).
+
+    \subsection z140_bench Benchmark for Frequency Counter driver
+    z140_bench.c measures the latency (min, p50, p99, p99.9, max) of each
+    getstat/setstat code and of M_getblock() and the rate of the five-call
+    measurement cycle, optionally in several threads or processes on the same
+    device. The results are written as CSV to compare driver builds (see
+    example section).
+
+    \subsection z140_trace Call trace decoder for Frequency Counter driver
+    z140_trace.c enables and drains the call trace of the driver and prints
+    the entries as text, or writes them to a file for later decoding (see
+    example section).
+
+    \subsection z140_rec Two-thread recorder for Frequency Counter driver
+    z140_rec.c records the measurement snapshots with a pinned acquisition
+    thread and a separate writer thread, connected by a lock-free
+    single-producer/single-consumer queue. The acquisition does not wait
+    for the disk or terminal. The queue high-water mark and the dropped
+    records are reported at exit (see example section).
+
+    \n \section libraries Overview of provided libraries
+
+    \subsection z140_sync Synchronized sampling library
+    z140_sync.c captures the measurement snapshots of a group of Z140
+    devices (e.g. one per axle) within a bounded time window. The records
+    of one capture share a timestamp, the capture spread is measured
+    and returned (see Z140_SYNC_Capture()). A repeated capture keeps the
+    new periods of the earlier attempts, so only the counters and the
+    timestamps are re-aligned.
+
+    \subsection z140_uio Direct register access library
+    z140_uio.c maps the register window read-only into user space (e.g.
+    through UIO) and decodes the registers like the getstat codes, without
+    an MDIS call. Any regular file with the register values can be mapped
+    instead for tests without hardware. Reading a period register clears
+    its NEW flag, so the periods are only read if the application opens
+    the mapping with Z140_UIO_EXCL and does not read them through the
+    driver at the same time.
+
+    \subsection z140_zrec Compact recording library
+    z140_zrec.c writes and reads measurement snapshots in a compact file
+    format: each record stores only the changed fields as zigzag varints
+    of their deltas, and runs of equal records are merged. Sync records
+    with the complete values are written in a fixed interval, so a reader
+    can seek to any record (Z140_ZREC_Seek()) and continue at the next sync
+    point after a damaged record (Z140_ZREC_Resync()). The format is
+    described in z140_zrec.h. z140_ctrl -F=zrec writes this format.
+
+    \n \section sim Host simulation
+    The directory SIM contains a behavioral model of the 16Z140 register
+    block (z140_sim.c) and minimal MDIS, OSS, DESC and USR_OSS libraries to
+    run the unmodified driver and the programs as a
+    normal host process without hardware (GNU make, see SIM/Makefile).
+    The model generates the quadrature signals from the test pattern
+    generator or from a simulated sensor input, and emulates the period,
+    distance and status registers including measurement timeout, debounce
+    filter, NEW flag and interrupt. The descriptor file is selected with
+    the environment variable Z140_SIM_DESC (see SIM/z140_sim.dsc), without
+    it the driver defaults are used. Each process simulates its own device.
+
+    In replay mode (descriptor key SIM_REPLAY), the model reports the
+    register values of a recorded trace (z140_ctrl -F=bin or -F=zrec)
+    instead of the simulated signals, at the original speed or
+    accelerated (SIM_REPLAY_SPEED) and optionally in a loop
+    (SIM_REPLAY_LOOP). The driver decodes the recorded period flags
+    (NEW/LSTS/VLD) like on the vehicle, so field data can be used for
+    benchmarks and regression tests on a plain host.
 */
 
 /** \example z140_simp.c */
 /** \example z140_ctrl.c */
+/** \example z140_bench.c */
+/** \example z140_trace.c */
+/** \example z140_rec.c */
 
 /*! \page z140dummy MEN logo
 \menimages
@@ -45,6 +45,10 @@
 #include <MEN/ll_defs.h>     /* low-level driver definitions   */
 #include <MEN/z140_reg.h>    /* 16Z140 IP core reg definitions */
 #include <MEN/chameleon.h>   /* chameleon header               */
+#if defined(LINUX) && defined(__KERNEL__)
+#include <linux/ktime.h>     /* monotonic clock                */
+#include <linux/timex.h>     /* cpu cycle counter              */
+#endif
 
 /*-----------------------------------------+
 |  DEFINES                                 |
@@ -52,15 +56,31 @@
 
 /* general defines */
 #define CH_NUMBER          1          /**< number of device channels      */
-#define USE_IRQ			   FALSE      /**< interrupt required             */
+#define USE_IRQ			   TRUE       /**< irq routine, active with IRQ_ENABLE=1 */
 #define ADDRSPACE_COUNT    1          /**< nbr of required address spaces */
 #define ADDRSPACE_SIZE     0x2C       /**< size of address space          */
+#define SNAP_RETRY_MAX     3          /**< max. retries for consistent snapshot */
+#define RD_CHUNK           64         /**< records copied per locked section */
+#define RD_SLOTS           16         /**< number of reader slots (processes) */
+#define RD_IDLE_TOUT       10         /**< stream reader idle timeout [s] */
+#define DIST_KEEP_NUM      8          /**< devices with kept 64-bit distances */
 
 /* debug defines */
 #define DBG_MYLEVEL        llHdl->dbgLevel    /**< debug level  */
 #define DBH                llHdl->dbgHdl      /**< debug handle */
 #define OSH                llHdl->osHdl       /**< OS handle    */
 
+/* register access, counted for Z140_BLK_COUNTERS */
+#define REG_RD(offs)		(llHdl->mmioRead++, MREAD_D32(llHdl->ma, (offs)))
+#define REG_WR(offs,val)	(llHdl->mmioWrite++, MWRITE_D32(llHdl->ma, (offs), (val)))
+
+/* unit of the call costs */
+#if defined(LINUX) && defined(__KERNEL__)
+# define COST_UNIT			Z140_COST_CYCLES
+#else
+# define COST_UNIT			Z140_COST_NS
+#endif
+
 /* default defines (for internal pattern generator usage) */
 #define DEBOUNCE_TIME_DEF	  5		/**< debounce time [us] */
 #define MEAS_TOUT_DEF		100		/**< measurement timeout [ms] */
@@ -68,9 +88,74 @@
 #define STANDSTILL_TIME_DEF	 20		/**< standstill time period [ms] */
 #define DIRDET_TOUT_DEF		100		/**< direction detection timeout [ms] */
 
+/* sampler defines */
+#define SAMPLE_RATE_DEF		  0		/**< sample rate [Hz] (0=disabled) */
+#define SAMPLE_RATE_MAX		1000	/**< max. sample rate [Hz] (alarm resolution 1ms) */
+#define RING_DEPTH_DEF		512		/**< number of sample ring entries */
+#define RING_DEPTH_MIN		  2		/**< min. number of sample ring entries */
+#define RING_DEPTH_MAX	  65536		/**< max. number of sample ring entries */
+#define IRQ_FALLBACK_RATE	SAMPLE_RATE_MAX	/**< irq mode fallback rate [Hz] (1ms alarm) */
+
+/* signal defines */
+#define SIG_MASK_DEF	(Z140R_ST_STANDSTILL | Z140R_ST_DIR_FWD | \
+						 Z140R_ST_DIR_BWD | Z140R_ST_DIR_INVALID)	/**< default transition mask */
+#define SIG_MASK_ALL	(Z140R_ST_ROLLING | SIG_MASK_DEF)			/**< all status flags */
+
+/* period statistics defines */
+#define PERSTAT_WIN_MAX		65536	/**< max. statistics window [periods] */
+#define PERSTAT_FRAC		2		/**< fractional bits of the mean */
+#define PERSTAT_CNT_MAX	0x10000000	/**< count at which window 0 is halved */
+
+/* period filter */
+#define FLT_FRAC			16		/**< fractional bits of the IIR output */
+#define FLT_BUF_LEN			15		/**< median buffer (Z140_FLT_MEDIAN_MAX, z140_drv.h is included later) */
+
+/* speed estimate */
+#define SPD_BLEND_N			16		/**< pulses per interval from which the count estimate is used alone */
+#define SPD_BLEND_SHIFT		4		/**< log2(SPD_BLEND_N) */
+#define SPD_WIN_MAX		1000000000	/**< max. count estimate window [ns] */
+#define SPD_INT_DEF			10		/**< estimation interval [ms] without sampler */
+#define SPD_INT_MAX			1000	/**< max. estimation interval [ms] */
+
+/* call trace */
+#define TRACE_DEPTH_DEF		256		/**< number of trace ring entries */
+#define TRACE_DEPTH_MIN		  2		/**< min. number of trace ring entries */
+#define TRACE_DEPTH_MAX	  65536		/**< max. number of trace ring entries */
+
 /*-----------------------------------------+
 |  TYPEDEFS                                |
 +-----------------------------------------*/
+/** period statistics of one signal */
+typedef struct {
+	u_int32                 count;          /**< number of valid periods */
+	u_int32                 min;            /**< min. period */
+	u_int32                 max;            /**< max. period */
+	u_int32                 mean;           /**< mean period (PERSTAT_FRAC) */
+	int32                   rem;            /**< remainder: sum = count * mean + rem */
+	u_int64                 m2;             /**< sum of squared deviations (2*PERSTAT_FRAC) */
+} PER_STAT;
+
+/** period filter of one signal */
+typedef struct {
+	u_int32                 cfg;            /**< Z140_FLT_xxx type | parameter */
+	u_int32                 num;            /**< valid periods in buf (0=no output) */
+	u_int32                 pos;            /**< next buf entry */
+	u_int32                 buf[FLT_BUF_LEN]; /**< last valid periods */
+	u_int64                 iir;            /**< IIR output (FLT_FRAC) */
+	int32                   err;            /**< error code while there is no output */
+} PER_FLT;
+
+/** reader state of one process (see ReaderSlot()) */
+typedef struct {
+	u_int32                 inUse;          /**< slot assigned */
+	u_int32                 pid;            /**< process id of the reader */
+	u_int32                 used;           /**< rdUse at the last call (LRU) */
+	u_int32                 perSeen[2];     /**< last taken period sequence number A/B */
+	u_int32                 rdActive;       /**< reading the sample stream */
+	u_int32                 rdSeq;          /**< read cursor of the sample stream */
+	u_int64                 rdTs;           /**< time of the last stream read [ns] */
+} RD_SLOT;
+
 /** low-level handle */
 typedef struct {
 	/* general */
@@ -80,17 +165,142 @@ typedef struct {
 	DESC_HANDLE             *descHdl;       /**< desc handle */
 	MACCESS                 ma;             /**< hw access handle */
 	MDIS_IDENT_FUNCT_TBL    idFuncTbl;      /**< id function table */
+	/* configuration shadow registers */
+	u_int32                 shDebTime;      /**< DEB_TIME register */
+	u_int32                 shMeasTout;     /**< MEAS_TOUT register */
+	u_int32                 shRollingTime;  /**< ROLLING_TIME register */
+	u_int32                 shStandstillTime; /**< STANDSTILL_TIME register */
+	u_int32                 shDirDetTout;   /**< DIR_DET_TOUT register */
+	u_int32                 shCommand;      /**< COMMAND register (test pattern) */
+	/* descriptor profiles */
+	struct Z140_PROFILE_ENTRY *prof;        /**< profile table */
+	u_int32                 profAlloc;      /**< size allocated for the profiles */
+	u_int32                 profNum;        /**< number of profiles */
+	int32                   profAct;        /**< active profile (or Z140_PROFILE_NONE) */
+	/* sample stream */
+	struct Z140_SAMPLE      *ring;          /**< sample ring buffer */
+	u_int32                 ringAlloc;      /**< size allocated for the ring */
+	u_int32                 ringDepth;      /**< number of ring entries */
+	u_int32                 ringSeq;        /**< sequence number of next record */
+	u_int32                 ringFill;       /**< number of valid ring entries */
+	u_int32                 ovfPolicy;      /**< overflow policy (Z140_OVF_xxx) */
+	u_int32                 overrun;        /**< number of ring overruns */
+	/* readers */
+	RD_SLOT                 rd[RD_SLOTS];   /**< reader slots */
+	u_int32                 rdUse;          /**< reader slot use counter */
+	/* sampler */
+	OSS_ALARM_HANDLE        *alarmHdl;      /**< sampler alarm handle */
+	u_int32                 sampleRate;     /**< sample rate [Hz] (0=disabled) */
+	/* interrupt */
+	u_int32                 irqMode;        /**< interrupt driven acquisition */
+	u_int32                 irqEnabled;     /**< interrupt enabled by MDIS */
+	u_int32                 irqCount;       /**< interrupt counter */
+	u_int32                 irqCountAlarm;  /**< interrupt counter at last alarm */
+	/* period latch */
+	u_int32                 perLatch[2];    /**< last new period A/B (without NEW flag) */
+	u_int32                 perSeq[2];      /**< sequence number of perLatch */
+	u_int64                 perTs[2];       /**< time of perLatch [ns] */
+	/* capture time of the last measurement getstat on the device */
+	u_int32                 tsCode;         /**< getstat code */
+	u_int64                 tsTime;         /**< capture time [ns] */
+	u_int64                 tsAge;          /**< age of the period [ns] */
+	/* distance */
+	u_int32                 keepDist;       /**< keep distance counters on exit */
+	u_int64                 dist64[2];      /**< 64-bit distance fwd/bwd */
+	u_int32                 distLast[2];    /**< last distance register fwd/bwd */
+	/* status transitions */
+	OSS_SIG_HANDLE          *sigHdl;        /**< signal for status transitions */
+	u_int32                 sigMask;        /**< status flags sending the signal */
+	u_int32                 statusLast;     /**< last status register */
+	u_int32                 statusEdges;    /**< changed status flags */
+	/* period statistics */
+	u_int32                 statWin;        /**< statistics window (0=until reset) */
+	u_int32                 statWins[2];    /**< number of completed windows of signal A/B */
+	PER_STAT                statCur[2];     /**< current window of signal A/B */
+	PER_STAT                statLast[2];    /**< last completed window of signal A/B */
+	/* period filter */
+	PER_FLT                 flt[2];         /**< filter of signal A/B */
+	/* speed estimate */
+	u_int32                 spdIntNs;       /**< min. estimation interval [ns] */
+	u_int32                 spdRefValid;    /**< reference below is valid */
+	u_int32                 spdRefDist[2];  /**< distance fwd/bwd at reference */
+	u_int64                 spdRefTs;       /**< time of reference [ns] */
+	u_int64                 spdTs;          /**< time of the estimate [ns] */
+	int32                   spdPps;         /**< speed [pulses/s] (Z140_SPEED_FRAC) */
+	u_int32                 spdQuality;     /**< Z140_SPD_xxx flags */
+	u_int32                 spdPulses;      /**< pulses in the count estimate window */
+	u_int32                 spdInterval;    /**< count estimate window [ns] */
+	/* period histogram */
+	struct Z140_HIST        *hist;          /**< histograms of signal A/B */
+	u_int32                 histAlloc;      /**< size allocated for the histograms */
+	/* driver counters */
+	struct CNT_DATA         *cnt;           /**< call counters */
+	u_int32                 cntAlloc;       /**< size allocated for the call counters */
+	u_int64                 mmioRead;       /**< register reads */
+	u_int64                 mmioWrite;      /**< register writes */
+	/* call trace */
+	struct Z140_TRACE_ENTRY *trc;           /**< trace ring */
+	u_int32                 trcAlloc;       /**< size allocated for the trace ring */
+	u_int32                 trcDepth;       /**< number of trace ring entries */
+	u_int32                 trcMode;        /**< traced calls (Z140_TRC_xxx) */
+	u_int32                 trcSeq;         /**< sequence number of next entry */
+	u_int32                 trcRd;          /**< sequence number of next entry to drain */
+	/* timestamp */
+	u_int32                 tickNs;         /**< OSS tick length [ns] */
+	u_int32                 tickLast;       /**< last OSS tick count */
+	u_int32                 tickHigh;       /**< OSS tick count wraps */
 	/* debug */
 	u_int32                 dbgLevel;       /**< debug level  */
 	DBG_HANDLE              *dbgHdl;        /**< debug handle */
 } LL_HANDLE;
 
+/** 64-bit distances of a device kept over close/open (KEEP_DISTANCE) */
+typedef struct {
+	u_int32                 inUse;          /**< entry assigned */
+	MACCESS                 ma;             /**< device (hw access handle) */
+	u_int64                 dist64[2];      /**< 64-bit distance fwd/bwd */
+	u_int32                 distLast[2];    /**< last distance register fwd/bwd */
+} DIST_KEEP;
+
 /* include files which need LL_HANDLE */
 #include <MEN/ll_entry.h>       /* low-level driver jump table */
 #include <MEN/z140_drv.h>       /* Z140 driver header file      */
 
+#if Z140_FLT_MEDIAN_MAX > FLT_BUF_LEN
+#error "FLT_BUF_LEN too small for Z140_FLT_MEDIAN_MAX"
+#endif
+
+/** driver call counters (Z140_BLK_COUNTERS)
+ *
+ *  MDIS does not serialize the calls (LL_LOCK_NONE), so the counters are
+ *  updated with interrupts masked.
+ */
+typedef struct CNT_DATA {
+	u_int64                 since;          /**< time of the last reset [ns] */
+	u_int32                 perErr[3];      /**< Z140_ERR_xxx returns of Z140_PERIOD_A/B */
+	Z140_CNT_CALL           get[Z140_CNT_CODES]; /**< getstat calls */
+	Z140_CNT_CALL           set[Z140_CNT_CODES]; /**< setstat calls */
+} CNT_DATA;
+
 static const char IdentString[]=MENT_XSTR(MAK_REVISION);
 
+/**
+ * kept 64-bit distances, only accessed from Z140_Init()/Z140_Exit()
+ * (serialized by the MDIS kernel)
+ */
+static DIST_KEEP G_distKeep[DIST_KEEP_NUM];
+
+/** period register offsets of signal A/B */
+static const u_int32 PeriodReg[2] = { Z140R_PERIOD_A, Z140R_PERIOD_B };
+
+/** COMMAND register values of test pattern Z140_TP_xxx */
+static const u_int32 TpatternCmd[4] = {
+	0x0,
+	Z140R_CMD_EN_TEST | Z140R_CMD_PAT_CW,
+	Z140R_CMD_EN_TEST | Z140R_CMD_PAT_CCW,
+	Z140R_CMD_EN_TEST | Z140R_CMD_PAT_SILENT
+};
+
 /*-----------------------------------------+
 |  PROTOTYPES                              |
 +-----------------------------------------*/
@@ -112,11 +322,57 @@ static int32 Z140_BlockWrite(LL_HANDLE *llHdl, int32 ch, void *buf, int32 size,
 static int32 Z140_Info(int32 infoType, ...);
 static char* Ident(void);
 static int32 Cleanup(LL_HANDLE *llHdl, int32 retCode);
+static int32 CheckParam(LL_HANDLE *llHdl, int32 code, u_int32 value);
+static int32 CheckConfig(LL_HANDLE *llHdl, Z140_CONFIG *cfg);
+static int32 SetConfig(LL_HANDLE *llHdl, Z140_CONFIG *cfg, int32 prof);
+static void GetConfig(LL_HANDLE *llHdl, Z140_CONFIG *cfg);
+static int32 GetProfiles(LL_HANDLE *llHdl, Z140_CONFIG *base);
 static int32 SetDebounceTime(LL_HANDLE *llHdl, u_int32 value);
 static int32 SetMeasTout(LL_HANDLE *llHdl, u_int32 value);
 static int32 SetRollingTime(LL_HANDLE *llHdl, u_int32 value);
 static int32 SetStandstillTime(LL_HANDLE *llHdl, u_int32 value);
 static int32 SetDirdetTout(LL_HANDLE *llHdl, u_int32 value);
+static int32 SetTpattern(LL_HANDLE *llHdl, u_int32 value);
+static void SetCommand(LL_HANDLE *llHdl, u_int32 value);
+static u_int32 ShadowCheck(LL_HANDLE *llHdl);
+static void ReadSnapshot(LL_HANDLE *llHdl, Z140_SNAPSHOT *snap);
+static int32 ReadValue(LL_HANDLE *llHdl, Z140_VALUE *val);
+static u_int32 ReadPeriod(LL_HANDLE *llHdl, u_int32 idx, u_int64 tstamp);
+static u_int64 PeriodAge(LL_HANDLE *llHdl, u_int32 idx, u_int64 tstamp);
+static void ReadCounters(LL_HANDLE *llHdl, Z140_SNAPSHOT *snap);
+static void DistSave(LL_HANDLE *llHdl);
+static void DistRestore(LL_HANDLE *llHdl);
+static RD_SLOT* ReaderSlot(LL_HANDLE *llHdl, u_int32 alloc);
+static u_int32 TakePeriod(RD_SLOT *rd, LL_HANDLE *llHdl, u_int32 idx);
+static void UpdateDistance(LL_HANDLE *llHdl, u_int32 idx, u_int32 read);
+static void UpdateStatus(LL_HANDLE *llHdl, u_int32 read);
+static void NewPeriod(LL_HANDLE *llHdl, u_int32 idx, u_int32 read);
+static void PerStatUpdate(PER_STAT *stat, u_int32 period);
+static void PerStatReset(LL_HANDLE *llHdl);
+static void PerStatGet(PER_STAT *stat, Z140_PERSTAT_SIG *sig);
+static void HistUpdate(Z140_HIST_SIG *hist, u_int32 period);
+static void HistReset(LL_HANDLE *llHdl);
+static int32 FltCheck(u_int32 cfg);
+static void FltSet(PER_FLT *flt, u_int32 cfg);
+static void FltUpdate(PER_FLT *flt, u_int32 read);
+static int32 FltGet(PER_FLT *flt, u_int32 *periodP);
+static void SpeedUpdate(LL_HANDLE *llHdl, Z140_SNAPSHOT *snap);
+static u_int32 SpeedDiv(u_int64 num, u_int32 den);
+static u_int32 GetCycles(LL_HANDLE *llHdl);
+static u_int32 CostSince(LL_HANDLE *llHdl, u_int32 t0);
+static void CntCall(Z140_CNT_CALL *call, int32 error, u_int32 cost);
+static void CntGetStat(LL_HANDLE *llHdl, int32 code, int32 error, u_int32 t0);
+static void CntReset(LL_HANDLE *llHdl);
+static void CntGet(LL_HANDLE *llHdl, Z140_COUNTERS *cnt);
+static void TraceCall(LL_HANDLE *llHdl, u_int32 type, int32 ch, int32 code,
+					  int32 value, int32 error);
+static u_int32 TraceDrain(LL_HANDLE *llHdl, Z140_TRACE_ENTRY *buf, u_int32 nbr);
+static void Acquire(LL_HANDLE *llHdl, Z140_SNAPSHOT *snap);
+static void StoreSample(LL_HANDLE *llHdl, Z140_SNAPSHOT *snap);
+static void SampleAlarm(void *arg);
+static u_int64 GetTstamp(LL_HANDLE *llHdl);
+static void SetTstamp(LL_HANDLE *llHdl, int32 code, u_int64 tstamp,
+					  u_int64 age);
 
 /****************************** Z140_GetEntry ********************************/
 /** Initialize driver's jump table
@@ -152,6 +408,21 @@ static int32 SetDirdetTout(LL_HANDLE *llHdl, u_int32 value);
  * descriptor keys or default values, resets distance values and disables 
  * the test pattern generator.
  *
+ * With KEEP_DISTANCE, the distance values are not reset, the 64-bit
+ * distance counters continue with the values of the last Z140_Exit() plus
+ * the register changes since then (see DistRestore()).
+ *
+ * If SAMPLE_RATE_HZ is set, the driver acquires the measurement registers
+ * periodically into the sample ring (see Z140_BlockRead()). The sample
+ * period is a multiple of 1ms (OSS alarm resolution).
+ *
+ * If the MDIS key IRQ_ENABLE is set, the measurement registers are acquired
+ * in the interrupt routine (see Z140_Irq()). The sampler then only acquires
+ * if no interrupt occurred since its last call, so it takes over if no
+ * interrupt is connected. Without SAMPLE_RATE_HZ it runs with 1000Hz, the
+ * maximum rate of the 1ms OSS alarm. Signals with more than 1000 new periods
+ * per second therefore need the interrupt.
+ *
  * The following descriptor keys are used:
  *
  * \code
@@ -164,8 +435,31 @@ static int32 SetDirdetTout(LL_HANDLE *llHdl, u_int32 value);
  * ROLLING_TIME                           10..2550ms [10ms]
  * STANDSTILL_TIME                        10..2550ms [10ms]
  * DIRDET_TOUT                            10..2550ms [10ms]
+ * SAMPLE_RATE_HZ        0 (disabled)     0..1000Hz
+ * SPEED_INTERVAL        10               1..1000ms (without sampler)
+ * RING_DEPTH            512              2..65536 records (power of two)
+ * OVERFLOW_POLICY       0 (drop-oldest)  0=drop-oldest, 1=drop-newest
+ * IRQ_ENABLE            0 (polling)      0=polling, 1=interrupt driven
+ * KEEP_DISTANCE         0 (reset)        0=reset, 1=keep distance values
+ * PERSTAT_WINDOW        0 (until reset)  0..65536 valid periods
+ * FILTER_A              0 (off)          Z140_FLT_xxx type | parameter
+ * FILTER_B              0 (off)          Z140_FLT_xxx type | parameter
+ * TRACE_MODE            0 (off)          Z140_TRC_xxx flags
+ * TRACE_DEPTH           256              2..65536 entries (power of two)
+ * PROFILE_n/NAME                         profile name (max. 15 chars)
+ * PROFILE_n/DEBOUNCE_TIME   DEBOUNCE_TIME    see DEBOUNCE_TIME
+ * PROFILE_n/MEAS_TOUT       MEAS_TOUT        see MEAS_TOUT
+ * PROFILE_n/ROLLING_TIME    ROLLING_TIME     see ROLLING_TIME
+ * PROFILE_n/STANDSTILL_TIME STANDSTILL_TIME  see STANDSTILL_TIME
+ * PROFILE_n/DIRDET_TOUT     DIRDET_TOUT      see DIRDET_TOUT
+ * PROFILE_n/TPATTERN        0 (disabled)     Z140_TP_xxx
  * \endcode
  *
+ * The descriptor profiles PROFILE_0..PROFILE_7 (directories) are numbered
+ * consecutively, the first profile without NAME key ends the table. Keys
+ * missing in a profile default to the keys above. A profile is applied with
+ * the Z140_PROFILE setstat.
+ *
  *  \param descP      \IN  pointer to descriptor data
  *  \param osHdl      \IN  oss handle
  *  \param ma         \IN  hw access handle
@@ -193,6 +487,10 @@ static int32 Z140_Init(
 	u_int32 rollingTime;    
 	u_int32 standstillTime; 
 	u_int32 dirdetTout;     
+	u_int32 realMsec;
+	u_int32 spdInt;
+	u_int32 idx;
+	Z140_CONFIG base;
 
 	/*------------------------------+
 	|  prepare the handle           |
@@ -212,6 +510,7 @@ static int32 Z140_Init(
 	llHdl->osHdl       = osHdl;
 	llHdl->irqHdl      = irqHdl;
 	llHdl->ma          = *ma;
+	llHdl->profAct     = Z140_PROFILE_NONE;
 
 	/*------------------------------+
 	|  init id function table       |
@@ -280,6 +579,162 @@ static int32 Z140_Init(
 		error != ERR_DESC_KEY_NOTFOUND)
 		return (Cleanup(llHdl, error));
 
+	/* SAMPLE_RATE_HZ */
+	if ((error = DESC_GetUInt32(llHdl->descHdl, SAMPLE_RATE_DEF,
+		&llHdl->sampleRate, "SAMPLE_RATE_HZ")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return (Cleanup(llHdl, error));
+
+	if (llHdl->sampleRate > SAMPLE_RATE_MAX) {
+		DBGWRT_ERR((DBH, "*** LL - Z140_Init: illegal SAMPLE_RATE_HZ %d\n",
+					llHdl->sampleRate));
+		return (Cleanup(llHdl, ERR_LL_ILL_PARAM));
+	}
+
+	/* SPEED_INTERVAL */
+	if ((error = DESC_GetUInt32(llHdl->descHdl, SPD_INT_DEF,
+		&spdInt, "SPEED_INTERVAL")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return (Cleanup(llHdl, error));
+
+	if (!spdInt || spdInt > SPD_INT_MAX) {
+		DBGWRT_ERR((DBH, "*** LL - Z140_Init: illegal SPEED_INTERVAL %d\n",
+					spdInt));
+		return (Cleanup(llHdl, ERR_LL_ILL_PARAM));
+	}
+
+	/* RING_DEPTH */
+	if ((error = DESC_GetUInt32(llHdl->descHdl, RING_DEPTH_DEF,
+		&llHdl->ringDepth, "RING_DEPTH")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return (Cleanup(llHdl, error));
+
+	if (!IN_RANGE(llHdl->ringDepth, RING_DEPTH_MIN, RING_DEPTH_MAX) ||
+		(llHdl->ringDepth & (llHdl->ringDepth - 1))) {
+		DBGWRT_ERR((DBH, "*** LL - Z140_Init: illegal RING_DEPTH %d\n",
+					llHdl->ringDepth));
+		return (Cleanup(llHdl, ERR_LL_ILL_PARAM));
+	}
+
+	/* OVERFLOW_POLICY */
+	if ((error = DESC_GetUInt32(llHdl->descHdl, Z140_OVF_DROP_OLDEST,
+		&llHdl->ovfPolicy, "OVERFLOW_POLICY")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return (Cleanup(llHdl, error));
+
+	if (llHdl->ovfPolicy > Z140_OVF_DROP_NEWEST) {
+		DBGWRT_ERR((DBH, "*** LL - Z140_Init: illegal OVERFLOW_POLICY %d\n",
+					llHdl->ovfPolicy));
+		return (Cleanup(llHdl, ERR_LL_ILL_PARAM));
+	}
+
+	/* KEEP_DISTANCE */
+	if ((error = DESC_GetUInt32(llHdl->descHdl, FALSE,
+		&llHdl->keepDist, "KEEP_DISTANCE")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return (Cleanup(llHdl, error));
+
+	/* PERSTAT_WINDOW */
+	if ((error = DESC_GetUInt32(llHdl->descHdl, 0,
+		&llHdl->statWin, "PERSTAT_WINDOW")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return (Cleanup(llHdl, error));
+
+	if (llHdl->statWin > PERSTAT_WIN_MAX) {
+		DBGWRT_ERR((DBH, "*** LL - Z140_Init: illegal PERSTAT_WINDOW %d\n",
+					llHdl->statWin));
+		return (Cleanup(llHdl, ERR_LL_ILL_PARAM));
+	}
+
+	/* FILTER_A/B */
+	for (idx = 0; idx < 2; idx++) {
+		if ((error = DESC_GetUInt32(llHdl->descHdl, Z140_FLT_OFF,
+			&value, "FILTER_%c", 'A' + idx)) &&
+			error != ERR_DESC_KEY_NOTFOUND)
+			return (Cleanup(llHdl, error));
+
+		if (!FltCheck(value)) {
+			DBGWRT_ERR((DBH, "*** LL - Z140_Init: illegal FILTER_%c 0x%x\n",
+						'A' + idx, value));
+			return (Cleanup(llHdl, ERR_LL_ILL_PARAM));
+		}
+		FltSet(&llHdl->flt[idx], value);
+	}
+
+	/* TRACE_MODE */
+	if ((error = DESC_GetUInt32(llHdl->descHdl, 0,
+		&llHdl->trcMode, "TRACE_MODE")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return (Cleanup(llHdl, error));
+
+	llHdl->trcMode &= Z140_TRC_GET | Z140_TRC_SET;
+
+	/* TRACE_DEPTH */
+	if ((error = DESC_GetUInt32(llHdl->descHdl, TRACE_DEPTH_DEF,
+		&llHdl->trcDepth, "TRACE_DEPTH")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return (Cleanup(llHdl, error));
+
+	if (!IN_RANGE(llHdl->trcDepth, TRACE_DEPTH_MIN, TRACE_DEPTH_MAX) ||
+		(llHdl->trcDepth & (llHdl->trcDepth - 1))) {
+		DBGWRT_ERR((DBH, "*** LL - Z140_Init: illegal TRACE_DEPTH %d\n",
+					llHdl->trcDepth));
+		return (Cleanup(llHdl, ERR_LL_ILL_PARAM));
+	}
+
+	/* IRQ_ENABLE (MDIS kernel key) */
+	if ((error = DESC_GetUInt32(llHdl->descHdl, FALSE,
+		&llHdl->irqMode, "IRQ_ENABLE")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return (Cleanup(llHdl, error));
+
+	/* PROFILE_n */
+	base.debounceT   = debounceTime;
+	base.measTout    = measTout;
+	base.rollingT    = rollingTime;
+	base.standstillT = standstillTime;
+	base.dirdetTout  = dirdetTout;
+	base.tpattern    = Z140_TP_DISABLE;
+	if ((error = GetProfiles(llHdl, &base)))
+		return (Cleanup(llHdl, error));
+
+	/*------------------------------+
+	|  prepare sample stream        |
+	+------------------------------*/
+	if ((llHdl->ring = (Z140_SAMPLE*)OSS_MemGet(osHdl,
+					llHdl->ringDepth * sizeof(Z140_SAMPLE),
+					&llHdl->ringAlloc)) == NULL)
+		return (Cleanup(llHdl, ERR_OSS_MEM_ALLOC));
+
+	llHdl->tickNs = 1000000000 / OSS_TickRateGet(osHdl);
+	llHdl->tickLast = OSS_TickGet(osHdl);
+
+	/*------------------------------+
+	|  prepare period histograms    |
+	+------------------------------*/
+	if ((llHdl->hist = (Z140_HIST*)OSS_MemGet(osHdl, sizeof(Z140_HIST),
+					&llHdl->histAlloc)) == NULL)
+		return (Cleanup(llHdl, ERR_OSS_MEM_ALLOC));
+
+	HistReset(llHdl);
+
+	/*------------------------------+
+	|  prepare driver counters      |
+	+------------------------------*/
+	if ((llHdl->cnt = (CNT_DATA*)OSS_MemGet(osHdl, sizeof(CNT_DATA),
+					&llHdl->cntAlloc)) == NULL)
+		return (Cleanup(llHdl, ERR_OSS_MEM_ALLOC));
+
+	CntReset(llHdl);
+
+	/*------------------------------+
+	|  prepare call trace           |
+	+------------------------------*/
+	if ((llHdl->trc = (Z140_TRACE_ENTRY*)OSS_MemGet(osHdl,
+					llHdl->trcDepth * sizeof(Z140_TRACE_ENTRY),
+					&llHdl->trcAlloc)) == NULL)
+		return (Cleanup(llHdl, ERR_OSS_MEM_ALLOC));
+
 	/*------------------------------+
 	|  init hardware                |
 	+------------------------------*/
@@ -299,8 +754,47 @@ static int32 Z140_Init(
 	if ((error = SetDirdetTout(llHdl, dirdetTout)))
 		return (Cleanup(llHdl, error));
 
-	/* reset distance values, disable test pattern */
-	MWRITE_D32(llHdl->ma, Z140R_COMMAND, Z140R_CMD_RST_DIST);
+	/* reset distance values (or keep them), disable test pattern */
+	if (llHdl->keepDist) {
+		SetCommand(llHdl, 0x0);
+		DistRestore(llHdl);
+	}
+	else {
+		REG_WR(Z140R_COMMAND, Z140R_CMD_RST_DIST);
+		llHdl->shCommand = 0x0;
+	}
+
+	/* period statistics */
+	PerStatReset(llHdl);
+
+	/* status transitions */
+	llHdl->sigMask = SIG_MASK_DEF;
+	llHdl->statusLast = REG_RD(Z140R_STATUS);
+
+	/*------------------------------+
+	|  start sampler                |
+	+------------------------------*/
+	/* interrupt mode: sampler as fallback */
+	if (llHdl->irqMode && !llHdl->sampleRate)
+		llHdl->sampleRate = IRQ_FALLBACK_RATE;
+
+	/* speed estimate: at most once per sample period or SPEED_INTERVAL */
+	if (llHdl->sampleRate)
+		llHdl->spdIntNs = 1000000000 / llHdl->sampleRate;
+	else
+		llHdl->spdIntNs = spdInt * 1000000;
+
+	if (llHdl->sampleRate) {
+		if ((error = OSS_AlarmCreate(osHdl, SampleAlarm, llHdl,
+									 &llHdl->alarmHdl)))
+			return (Cleanup(llHdl, error));
+
+		if ((error = OSS_AlarmSet(osHdl, llHdl->alarmHdl,
+								  1000 / llHdl->sampleRate, TRUE, &realMsec)))
+			return (Cleanup(llHdl, error));
+
+		DBGWRT_2((DBH, " sampler started: %dms\n", realMsec));
+	}
 
 	*llHdlP = llHdl;		/* set low-level driver handle */
 
@@ -310,7 +804,9 @@ static int32 Z140_Init(
 /****************************** Z140_Exit ************************************/
 /** De-initialize hardware and clean up memory
  *
- * The function resets distance values and disables the test pattern generator.
+ * The function resets distance values (unless KEEP_DISTANCE is set, then
+ * the 64-bit distances are kept for the next Z140_Init()) and disables the
+ * test pattern generator.
  *
  *  \param llHdlP     \IN  pointer to low-level driver handle
  *
@@ -325,11 +821,17 @@ static int32 Z140_Exit(
 
 	DBGWRT_1((DBH, "LL - Z140_Exit\n"));
 
+	/* stop sampler */
+	if (llHdl->alarmHdl)
+		OSS_AlarmClear(llHdl->osHdl, llHdl->alarmHdl);
+
 	/*------------------------------+
 	|  de-init hardware             |
 	+------------------------------*/
-	/* reset distance values, disable test pattern */
-	MWRITE_D32(llHdl->ma, Z140R_COMMAND, Z140R_CMD_RST_DIST);
+	/* reset distance values (or keep them), disable test pattern */
+	if (llHdl->keepDist)
+		DistSave(llHdl);
+	SetCommand(llHdl, llHdl->keepDist ? 0x0 : Z140R_CMD_RST_DIST);
 
 	/*------------------------------+
 	|  clean up memory              |
@@ -405,13 +907,14 @@ static int32 Z140_SetStat(
 )
 {
 	int32 value = (int32)value32_or_64;		/* 32bit value */
-	MACCESS ma = llHdl->ma;
+	M_SG_BLOCK *blk = (M_SG_BLOCK*)value32_or_64;	/* block value */
+	u_int32 t0 = GetCycles(llHdl);
 	int32 error = ERR_SUCCESS;
+	OSS_IRQ_STATE irqState;
+	OSS_SIG_HANDLE *sigHdl;
+	RD_SLOT *rd;
 	DBGCMD( static const char func[] = "LL - Z140_SetStat" );
 
-	DBGWRT_1((DBH, "%s: ch=%d code=0x%04x value=0x%x\n",
-				func, ch, code, value));
-
 	switch (code) {
 		/*--------------------------+
 		|  debug level              |
@@ -420,6 +923,14 @@ static int32 Z140_SetStat(
 			llHdl->dbgLevel = value;
 			break;
 		/*--------------------------+
+		|  enable interrupts        |
+		+--------------------------*/
+		case M_LL_IRQ_ENABLE:
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			llHdl->irqEnabled = value ? TRUE : FALSE;
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+			break;
+		/*--------------------------+
 		|  channel direction        |
 		+--------------------------*/
 		case M_LL_CH_DIR:
@@ -431,52 +942,186 @@ static int32 Z140_SetStat(
 		|  config frequency counter |
 		+--------------------------*/
 		case Z140_DEBOUNCET:
-			error = SetDebounceTime(llHdl, value);
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			if ((error = SetDebounceTime(llHdl, value)) == ERR_SUCCESS)
+				llHdl->profAct = Z140_PROFILE_NONE;
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
 			break;
 
 		case Z140_MEAS_TOUT:
-			error = SetMeasTout(llHdl, value);
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			if ((error = SetMeasTout(llHdl, value)) == ERR_SUCCESS)
+				llHdl->profAct = Z140_PROFILE_NONE;
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
 			break;
 
 		case Z140_ROLLINGT:
-			error = SetRollingTime(llHdl, value);
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			if ((error = SetRollingTime(llHdl, value)) == ERR_SUCCESS)
+				llHdl->profAct = Z140_PROFILE_NONE;
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
 			break;
 
 		case Z140_STANDSTILLT:
-			error = SetStandstillTime(llHdl, value);
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			if ((error = SetStandstillTime(llHdl, value)) == ERR_SUCCESS)
+				llHdl->profAct = Z140_PROFILE_NONE;
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
 			break;
 
 		case Z140_DIRDET_TOUT:
-			error = SetDirdetTout(llHdl, value);
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			if ((error = SetDirdetTout(llHdl, value)) == ERR_SUCCESS)
+				llHdl->profAct = Z140_PROFILE_NONE;
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
 			break;
 		/*--------------------------+
 		|  reset distance counters  |
 		+--------------------------*/
 		case Z140_DISTRST:
-			MSETMASK_D32(ma, Z140R_COMMAND, Z140R_CMD_RST_DIST);
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			REG_WR(Z140R_COMMAND, llHdl->shCommand | Z140R_CMD_RST_DIST);
+			llHdl->dist64[0] = llHdl->dist64[1] = 0;
+			llHdl->distLast[0] = llHdl->distLast[1] = 0;
+			llHdl->spdRefValid = 0;
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
 			break;
 		/*--------------------------+
-		|  config test pattern gen  |
+		|  status transition signal |
 		+--------------------------*/
-		case Z140_TPATTERN:
-			switch (value) {
-			case Z140_TP_DISABLE:
-				MWRITE_D32(ma, Z140R_COMMAND, 0x0);
+		case Z140_SIG_SET:
+			if ((error = OSS_SigCreate(OSH, value, &sigHdl)))
+				break;
+
+			/* install, unless another call was faster */
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			if (!llHdl->sigHdl) {
+				llHdl->sigHdl = sigHdl;
+				sigHdl = NULL;
+			}
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+
+			if (sigHdl) {
+				DBGWRT_ERR((DBH, "*** %s(Z140_SIG_SET): signal already installed\n", func));
+				OSS_SigRemove(OSH, &sigHdl);
+				error = ERR_OSS_SIG_SET;
+			}
+			break;
+
+		case Z140_SIG_CLR:
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			sigHdl = llHdl->sigHdl;
+			llHdl->sigHdl = NULL;
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+
+			if (!sigHdl) {
+				DBGWRT_ERR((DBH, "*** %s(Z140_SIG_CLR): signal not installed\n", func));
+				error = ERR_OSS_SIG_CLR;
 				break;
-			case Z140_TP_FWD:
-				MWRITE_D32(ma, Z140R_COMMAND, Z140R_CMD_EN_TEST | Z140R_CMD_PAT_CW);
+			}
+			error = OSS_SigRemove(OSH, &sigHdl);
+			break;
+
+		case Z140_SIG_MASK:
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			llHdl->sigMask = value & SIG_MASK_ALL;
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+			break;
+		/*--------------------------+
+		|  release reader state     |
+		+--------------------------*/
+		case Z140_RD_RELEASE:
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			if ((rd = ReaderSlot(llHdl, FALSE)))
+				rd->inUse = FALSE;
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+			break;
+		/*--------------------------+
+		|  period statistics        |
+		+--------------------------*/
+		case Z140_PERSTAT_WIN:
+			if (!IN_RANGE(value, 0, PERSTAT_WIN_MAX)) {
+				DBGWRT_ERR((DBH, "*** %s(Z140_PERSTAT_WIN): illegal value %d\n", func, value));
+				error = ERR_LL_ILL_PARAM;
 				break;
-			case Z140_TP_BWD:
-				MWRITE_D32(ma, Z140R_COMMAND, Z140R_CMD_EN_TEST | Z140R_CMD_PAT_CCW);
+			}
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			llHdl->statWin = value;
+			PerStatReset(llHdl);
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+			break;
+
+		case Z140_PERSTAT_RST:
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			PerStatReset(llHdl);
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+			break;
+		/*--------------------------+
+		|  period filter            |
+		+--------------------------*/
+		case Z140_FILTER_A:
+		case Z140_FILTER_B:
+			if (!FltCheck(value)) {
+				DBGWRT_ERR((DBH, "*** %s(Z140_FILTER_x): illegal value 0x%x\n", func, value));
+				error = ERR_LL_ILL_PARAM;
 				break;
-			case Z140_TP_STANDSTILL:
-				MWRITE_D32(ma, Z140R_COMMAND, Z140R_CMD_EN_TEST | Z140R_CMD_PAT_SILENT);
+			}
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			FltSet(&llHdl->flt[(code == Z140_FILTER_A) ? 0 : 1], value);
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+			break;
+		/*--------------------------+
+		|  period histograms        |
+		+--------------------------*/
+		case Z140_HIST_RST:
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			HistReset(llHdl);
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+			break;
+		/*--------------------------+
+		|  driver counters          |
+		+--------------------------*/
+		case Z140_CNT_RST:
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			CntReset(llHdl);
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+			break;
+		/*--------------------------+
+		|  call trace               |
+		+--------------------------*/
+		case Z140_TRACE_MODE:
+			llHdl->trcMode = value & (Z140_TRC_GET | Z140_TRC_SET);
+			break;
+		/*--------------------------+
+		|  config test pattern gen  |
+		+--------------------------*/
+		case Z140_TPATTERN:
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			if ((error = SetTpattern(llHdl, value)) == ERR_SUCCESS)
+				llHdl->profAct = Z140_PROFILE_NONE;
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+			break;
+		/*--------------------------+
+		|  complete configuration   |
+		+--------------------------*/
+		case Z140_BLK_CONFIG:
+			if (blk->size < (int32)sizeof(Z140_CONFIG)) {
+				error = ERR_LL_USERBUF;
 				break;
-			default:
-				DBGWRT_ERR((DBH, "*** %s(Z140_TPATTERN): illegal value %d\n", func, value));
+			}
+			error = SetConfig(llHdl, (Z140_CONFIG*)blk->data,
+							  Z140_PROFILE_NONE);
+			break;
+
+		case Z140_PROFILE:
+			if (!IN_RANGE(value, 0, (int32)llHdl->profNum - 1)) {
+				DBGWRT_ERR((DBH, "*** %s(Z140_PROFILE): illegal profile %d\n", func, value));
 				error = ERR_LL_ILL_PARAM;
+				break;
 			}
-			break;			
+			DBGWRT_2((DBH, " profile %d: %s\n", value, llHdl->prof[value].name));
+			error = SetConfig(llHdl, &llHdl->prof[value].cfg, value);
+			break;
 		/*--------------------------+
 		|  (unknown)                |
 		+--------------------------*/
@@ -484,6 +1129,15 @@ static int32 Z140_SetStat(
 			error = ERR_LL_UNK_CODE;
 	}
 
+	irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+	CntCall(&llHdl->cnt->set[Z140_CNT_IDX(code)], error,
+			CostSince(llHdl, t0));
+	OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+
+	if (llHdl->trcMode & Z140_TRC_SET)
+		TraceCall(llHdl, Z140_TRC_SET, ch, code,
+				  (code >= M_MK_BLK_OF) ? blk->size : value, error);
+
 	return (error);
 }
 
@@ -512,13 +1166,21 @@ static int32 Z140_GetStat(
 {
 	int32 *valueP = (int32*)value32_or_64P;		/* pointer to 32bit value */
 	INT32_OR_64 *value64P = value32_or_64P;		/* stores 32/64bit pointer */
-	MACCESS ma = llHdl->ma;
+	M_SG_BLOCK *blk = (M_SG_BLOCK*)value32_or_64P;	/* block getstats */
+	u_int32 t0 = GetCycles(llHdl);
 	int32 error = ERR_SUCCESS;
-	u_int32 read;
+	u_int32 read, idx, num;
+	u_int64 tstamp;
+	Z140_TSTAMP *ts;
+	Z140_VALUE *val, valTmp;
+	Z140_SNAPSHOT *snap, snapTmp;
+	Z140_DISTANCE64 *dist;
+	Z140_PERSTAT *perStat;
+	Z140_SPEED_EST *spd;
+	RD_SLOT *rd;
+	OSS_IRQ_STATE irqState;
 	DBGCMD( static const char func[] = "LL - Z140_GetStat" );
 
-	DBGWRT_1((DBH, "%s: ch=%d code=0x%04x\n", func, ch, code));
-
 	switch (code) {
 		/*--------------------------+
 		|  debug level              |
@@ -551,6 +1213,12 @@ static int32 Z140_GetStat(
 			*valueP = M_CH_COUNTER;
 			break;
 		/*--------------------------+
+		|  irq counter              |
+		+--------------------------*/
+		case M_LL_IRQ_COUNT:
+			*valueP = llHdl->irqCount;
+			break;
+		/*--------------------------+
 		|  ident table pointer      |
 		|  (treat as non-block!)    |
 		+--------------------------*/
@@ -559,31 +1227,32 @@ static int32 Z140_GetStat(
 			break;
 		/*--------------------------+
 		|  frequency counter config |
+		|  (from shadow registers)  |
 		+--------------------------*/
 		case Z140_DEBOUNCET:
-			*valueP = MREAD_D32(ma, Z140R_DEB_TIME);
+			*valueP = llHdl->shDebTime;
 			break;
 
 		case Z140_MEAS_TOUT:
-			*valueP = 100 * MREAD_D32(ma, Z140R_MEAS_TOUT);
+			*valueP = 100 * llHdl->shMeasTout;
 			break;
 
 		case Z140_ROLLINGT:
-			*valueP = 10 * MREAD_D32(ma, Z140R_ROLLING_TIME);
+			*valueP = 10 * llHdl->shRollingTime;
 			break;
 
 		case Z140_STANDSTILLT:
-			*valueP = 10 * MREAD_D32(ma, Z140R_STANDSTILL_TIME);
+			*valueP = 10 * llHdl->shStandstillTime;
 			break;
 
 		case Z140_DIRDET_TOUT:
-			*valueP = 10 * MREAD_D32(ma, Z140R_DIR_DET_TOUT);
+			*valueP = 10 * llHdl->shDirDetTout;
 			break;
 		/*--------------------------+
 		|  test pattern gen config  |
 		+--------------------------*/
 		case Z140_TPATTERN:
-			read = MREAD_D32(ma, Z140R_COMMAND);
+			read = llHdl->shCommand;
 
 			/* enabled */
 			if ((read & Z140R_CMD_EN_TEST)) {
@@ -613,120 +1282,493 @@ static int32 Z140_GetStat(
 			}
 			break;
 		/*--------------------------+
+		|  complete configuration   |
+		+--------------------------*/
+		case Z140_BLK_CONFIG:
+			if (blk->size < (int32)sizeof(Z140_CONFIG)) {
+				error = ERR_LL_USERBUF;
+				break;
+			}
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			GetConfig(llHdl, (Z140_CONFIG*)blk->data);
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+			break;
+		/*--------------------------+
+		|  descriptor profiles      |
+		+--------------------------*/
+		case Z140_PROFILE:
+			*valueP = llHdl->profAct;
+			break;
+
+		case Z140_PROFILE_NUM:
+			*valueP = llHdl->profNum;
+			break;
+
+		case Z140_BLK_PROFILES:
+			num = blk->size / sizeof(Z140_PROFILE_ENTRY);
+			if (num > llHdl->profNum)
+				num = llHdl->profNum;
+			if (num)
+				OSS_MemCopy(OSH, num * sizeof(Z140_PROFILE_ENTRY),
+							(char*)llHdl->prof, (char*)blk->data);
+			blk->size = num * sizeof(Z140_PROFILE_ENTRY);
+			break;
+		/*--------------------------+
+		|  shadow register check    |
+		+--------------------------*/
+		case Z140_SHADOW_CHK:
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			*valueP = ShadowCheck(llHdl);
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+			break;
+		/*--------------------------+
 		|  period measurement       |
 		+--------------------------*/
 		case Z140_PERIOD_A:
 		case Z140_PERIOD_B:
-			if(code == Z140_PERIOD_A)
-				read = MREAD_D32(ma, Z140R_PERIOD_A);
-			else
-				read = MREAD_D32(ma, Z140R_PERIOD_B);
+			valTmp.code = code;
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			ReadValue(llHdl, &valTmp);
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
 
 			/* return always period value */
-			*valueP = read & Z140R_PERIOD_MASK;
+			*valueP = valTmp.value;
 
-			/* no new period value since last read? */
-			if(!(read & Z140R_PERIOD_NEW))
-				error = Z140_ERR_NO_DATA;
-			/* signal phase length violation? */
-			else if((read & Z140R_PERIOD_LSTS))
-				error = Z140_ERR_PH_VIOLATION;
-			/* signal period invalid? */
-			else if(!(read & Z140R_PERIOD_VLD))
-				error = Z140_ERR_PER_INVALID;
-			
+			/* no new period value, phase length violation or period invalid? */
+			error = valTmp.error;
+			break;
+		case Z140_PERIOD_SEQ_A:
+		case Z140_PERIOD_SEQ_B:
+			*valueP = llHdl->perSeq[(code == Z140_PERIOD_SEQ_A) ? 0 : 1];
 			break;
 		/*--------------------------+
 		|  distance pulses          |
 		+--------------------------*/
 		case Z140_DISTANCE_FWD:
-			*valueP = MREAD_D32(ma, Z140R_DISTANCE_FWD);
-			break;
 		case Z140_DISTANCE_BWD:
-			*valueP = MREAD_D32(ma, Z140R_DISTANCE_BWD);
+			valTmp.code = code;
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			ReadValue(llHdl, &valTmp);
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+
+			*valueP = valTmp.value;
 			break;
 		/*--------------------------+
 		|  status                   |
 		+--------------------------*/
 		case Z140_STATUS:
-			*valueP = MREAD_D32(ma, Z140R_STATUS);
+			valTmp.code = code;
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			ReadValue(llHdl, &valTmp);
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+
+			*valueP = valTmp.value;
 			break;
 		/*--------------------------+
-		|  (unknown)                |
+		|  status transitions       |
 		+--------------------------*/
-		default:
-			error = ERR_LL_UNK_CODE;
-	}
+		case Z140_SIG_MASK:
+			*valueP = llHdl->sigMask;
+			break;
 
-	return (error);
-}
+		case Z140_SIG_EDGES:
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			*valueP = llHdl->statusEdges;
+			llHdl->statusEdges = 0;
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+			break;
+		/*--------------------------+
+		|  period statistics        |
+		+--------------------------*/
+		case Z140_PERSTAT_WIN:
+			*valueP = llHdl->statWin;
+			break;
+		/*--------------------------+
+		|  period filter            |
+		+--------------------------*/
+		case Z140_FILTER_A:
+		case Z140_FILTER_B:
+			*valueP = llHdl->flt[(code == Z140_FILTER_A) ? 0 : 1].cfg;
+			break;
 
-/******************************* Z140_BlockRead ******************************/
-/** Read a data block from the device
-*
-*  The function is not supported and always returns an ERR_LL_ILL_FUNC error.
-*
-*  \param llHdl       \IN  low-level handle
- *  \param ch          \IN  current channel
- *  \param buf         \IN  data buffer
- *  \param size        \IN  data buffer size
- *  \param nbrRdBytesP \OUT number of read bytes
- *
- *  \return            \c 0 on success or error code
- */
-static int32 Z140_BlockRead(
-	LL_HANDLE *llHdl,
-	int32     ch,
-	void      *buf,
-	int32     size,
-	int32     *nbrRdBytesP
-)
-{
-	DBGWRT_1((DBH, "LL - Z140_BlockRead: ch=%d, size=%d\n", ch, size));
+		case Z140_PERIOD_FLT_A:
+		case Z140_PERIOD_FLT_B:
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			idx = (code == Z140_PERIOD_FLT_A) ? 0 : 1;
+			tstamp = GetTstamp(llHdl);
+			ReadPeriod(llHdl, idx, tstamp);
+			error = FltGet(&llHdl->flt[idx], &read);
+			SetTstamp(llHdl, code, tstamp, PeriodAge(llHdl, idx, tstamp));
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+
+			*valueP = read;
+			break;
+		/*--------------------------+
+		|  speed estimate           |
+		+--------------------------*/
+		case Z140_SPEED:
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
 
-	/* return number of read bytes */
-	*nbrRdBytesP = 0;
+			/* sampler disabled: estimate on demand */
+			if (!llHdl->sampleRate) {
+				ReadSnapshot(llHdl, &snapTmp);
+				SpeedUpdate(llHdl, &snapTmp);
+			}
 
-	return (ERR_LL_ILL_FUNC);
-}
+			*valueP = llHdl->spdPps;
+			if (!(llHdl->spdQuality & Z140_SPD_VALID))
+				error = Z140_ERR_NO_DATA;
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+			break;
 
-/****************************** Z140_BlockWrite *****************************/
-/** Write a data block from the device
-*
-*  The function is not supported and always returns an ERR_LL_ILL_FUNC error.
-*
-*  \param llHdl       \IN  low-level handle
- *  \param ch          \IN  current channel
- *  \param buf         \IN  data buffer
- *  \param size        \IN  data buffer size
- *  \param nbrWrBytesP \OUT number of written bytes
- *
- *  \return            \c 0 on success or error code
- */
-static int32 Z140_BlockWrite(
-	LL_HANDLE *llHdl,
-	int32     ch,
-	void      *buf,
-	int32     size,
-	int32     *nbrWrBytesP
-)
-{
-	DBGWRT_1((DBH, "LL - Z140_BlockWrite: ch=%d, size=%d\n", ch, size));
+		case Z140_BLK_SPEED:
+			if (blk->size < (int32)sizeof(Z140_SPEED_EST)) {
+				error = ERR_LL_USERBUF;
+				break;
+			}
+			spd = (Z140_SPEED_EST*)blk->data;
 
-	/* return number of written bytes */
-	*nbrWrBytesP = 0;
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
 
-	return (ERR_LL_ILL_FUNC);
-}
+			/* sampler disabled: estimate on demand */
+			if (!llHdl->sampleRate) {
+				ReadSnapshot(llHdl, &snapTmp);
+				SpeedUpdate(llHdl, &snapTmp);
+			}
 
-/****************************** Z140_Irq ************************************/
-/** Interrupt service routine - unused
- *
- *  If the driver can detect the interrupt's cause it returns
- *  LL_IRQ_DEVICE or LL_IRQ_DEV_NOT, otherwise LL_IRQ_UNKNOWN.
- *  
- *  For MSI(x) it is necessary to disable all IRQs and enable them again
- *  at the end of the ISR.
+			spd->pps      = llHdl->spdPps;
+			spd->quality  = llHdl->spdQuality;
+			spd->pulses   = llHdl->spdPulses;
+			spd->interval = llHdl->spdInterval;
+			spd->tstamp   = llHdl->spdTs;
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+
+			blk->size = sizeof(Z140_SPEED_EST);
+			break;
+		/*--------------------------+
+		|  call trace               |
+		+--------------------------*/
+		case Z140_TRACE_MODE:
+			*valueP = llHdl->trcMode;
+			break;
+		/*--------------------------+
+		|  sample ring overruns     |
+		+--------------------------*/
+		case Z140_RING_OVERRUN:
+			*valueP = llHdl->overrun;
+			break;
+		/*--------------------------+
+		|  measurement snapshot     |
+		+--------------------------*/
+		case Z140_BLK_SNAPSHOT:
+			if (blk->size < (int32)sizeof(Z140_SNAPSHOT)) {
+				error = ERR_LL_USERBUF;
+				break;
+			}
+			snap = (Z140_SNAPSHOT*)blk->data;
+
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			ReadSnapshot(llHdl, &snapTmp);
+
+			/* sampler disabled: each acquisition is a stream record */
+			if (!llHdl->sampleRate) {
+				StoreSample(llHdl, &snapTmp);
+				SpeedUpdate(llHdl, &snapTmp);
+			}
+
+			rd = ReaderSlot(llHdl, TRUE);
+			snapTmp.periodA = TakePeriod(rd, llHdl, 0);
+			snapTmp.periodB = TakePeriod(rd, llHdl, 1);
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+
+			*snap = snapTmp;
+			break;
+		/*--------------------------+
+		|  64-bit distance pulses   |
+		+--------------------------*/
+		case Z140_BLK_DISTANCE64:
+			if (blk->size < 2 * (int32)sizeof(u_int64)) {
+				error = ERR_LL_USERBUF;
+				break;
+			}
+			dist = (Z140_DISTANCE64*)blk->data;
+
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			tstamp = GetTstamp(llHdl);
+			ReadCounters(llHdl, &snapTmp);
+			dist->distFwd = llHdl->dist64[0];
+			dist->distBwd = llHdl->dist64[1];
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+
+			/* buffer without capture time? */
+			if (blk->size >= (int32)sizeof(Z140_DISTANCE64))
+				dist->tstamp = tstamp;
+			break;
+		/*--------------------------+
+		|  capture time of the last |
+		|  measurement getstat      |
+		+--------------------------*/
+		case Z140_BLK_TSTAMP:
+			if (blk->size < (int32)sizeof(Z140_TSTAMP)) {
+				error = ERR_LL_USERBUF;
+				break;
+			}
+			ts = (Z140_TSTAMP*)blk->data;
+
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			ts->code     = llHdl->tsCode;
+			ts->reserved = 0;
+			ts->tstamp   = llHdl->tsTime;
+			ts->age      = llHdl->tsAge;
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+			break;
+		/*--------------------------+
+		|  single value with        |
+		|  capture time             |
+		+--------------------------*/
+		case Z140_BLK_VALUE:
+			if (blk->size < (int32)sizeof(Z140_VALUE)) {
+				error = ERR_LL_USERBUF;
+				break;
+			}
+			val = (Z140_VALUE*)blk->data;
+
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			error = ReadValue(llHdl, val);
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+			break;
+		/*--------------------------+
+		|  period statistics        |
+		+--------------------------*/
+		case Z140_BLK_PERSTAT:
+			if (blk->size < (int32)sizeof(Z140_PERSTAT)) {
+				error = ERR_LL_USERBUF;
+				break;
+			}
+			perStat = (Z140_PERSTAT*)blk->data;
+
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			perStat->window  = llHdl->statWin;
+			perStat->windows[0] = llHdl->statWins[0];
+			perStat->windows[1] = llHdl->statWins[1];
+			perStat->reserved   = 0;
+			for (idx = 0; idx < 2; idx++) {
+				PerStatGet(&llHdl->statCur[idx], &perStat->cur[idx]);
+				PerStatGet(&llHdl->statLast[idx], &perStat->last[idx]);
+			}
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+			break;
+		/*--------------------------+
+		|  period histograms        |
+		+--------------------------*/
+		case Z140_BLK_HIST:
+			if (blk->size < (int32)sizeof(Z140_HIST)) {
+				error = ERR_LL_USERBUF;
+				break;
+			}
+			irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+			OSS_MemCopy(OSH, sizeof(Z140_HIST), (char*)llHdl->hist,
+						(char*)blk->data);
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+			break;
+		/*--------------------------+
+		|  driver counters          |
+		+--------------------------*/
+		case Z140_BLK_COUNTERS:
+			if (blk->size < (int32)sizeof(Z140_COUNTERS)) {
+				error = ERR_LL_USERBUF;
+				break;
+			}
+			CntGet(llHdl, (Z140_COUNTERS*)blk->data);
+			break;
+
+		case Z140_BLK_TRACE:
+			if (blk->size < (int32)sizeof(Z140_TRACE_ENTRY)) {
+				error = ERR_LL_USERBUF;
+				break;
+			}
+			blk->size = sizeof(Z140_TRACE_ENTRY) *
+				TraceDrain(llHdl, (Z140_TRACE_ENTRY*)blk->data,
+						   blk->size / sizeof(Z140_TRACE_ENTRY));
+			break;
+		/*--------------------------+
+		|  (unknown)                |
+		+--------------------------*/
+		default:
+			error = ERR_LL_UNK_CODE;
+	}
+
+	irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+	CntGetStat(llHdl, code, error, t0);
+	OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+
+	if ((llHdl->trcMode & Z140_TRC_GET) && (code != Z140_BLK_TRACE))
+		TraceCall(llHdl, Z140_TRC_GET, ch, code,
+				  (code == M_MK_BLK_REV_ID) ? 0 :
+				  (code >= M_MK_BLK_OF) ? blk->size : *valueP, error);
+
+	return (error);
+}
+
+/******************************* Z140_BlockRead ******************************/
+/** Read measurement records from the sample stream
+*
+*  The function copies as many measurement records (Z140_SAMPLE) as available
+*  and fitting into the buffer. Each process has its own read cursor (see
+*  ReaderSlot()), so several applications read the whole sample stream
+*  independently. A process starts reading with the oldest record in the
+*  ring on its first call.
+*
+*  If the sampler is disabled (SAMPLE_RATE_HZ=0) and no record is pending for
+*  the process, a new record is acquired. With the sampler enabled, the
+*  function returns 0 bytes if no record is pending.
+*
+*  With OVERFLOW_POLICY drop-oldest, records which were overwritten before
+*  the process has read them are lost, the reader continues with the oldest
+*  available record.
+*
+*  A process which has not read for RD_IDLE_TOUT is no longer considered by
+*  the overflow policy (see StoreSample()), and Z140_RD_RELEASE releases the
+*  reader state of the calling process, e.g. before it closes the path.
+*
+*  \param llHdl       \IN  low-level handle
+ *  \param ch          \IN  current channel
+ *  \param buf         \IN  data buffer
+ *  \param size        \IN  data buffer size
+ *  \param nbrRdBytesP \OUT number of read bytes
+ *
+ *  \return            \c 0 on success or error code
+ */
+static int32 Z140_BlockRead(
+	LL_HANDLE *llHdl,
+	int32     ch,
+	void      *buf,
+	int32     size,
+	int32     *nbrRdBytesP
+)
+{
+	Z140_SNAPSHOT snap;
+	OSS_IRQ_STATE irqState;
+	RD_SLOT *rd;
+	u_int32 avail, nbr, idx, part, done = 0;
+
+	DBGWRT_1((DBH, "LL - Z140_BlockRead: ch=%d, size=%d\n", ch, size));
+
+	/* return number of read bytes */
+	*nbrRdBytesP = 0;
+
+	if (size < (int32)sizeof(Z140_SAMPLE))
+		return (ERR_LL_USERBUF);
+
+	nbr = size / sizeof(Z140_SAMPLE);
+
+	/* copy in chunks to keep the sampler latency low */
+	while (done < nbr) {
+		irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+
+		/*
+		 * get the slot in each chunk, other processes may take it over
+		 * (see ReaderSlot()) between the chunks
+		 */
+		rd = ReaderSlot(llHdl, TRUE);
+
+		/* first read: start with oldest record */
+		if (!rd->rdActive) {
+			rd->rdActive = TRUE;
+			rd->rdSeq = llHdl->ringSeq - llHdl->ringFill;
+		}
+		rd->rdTs = GetTstamp(llHdl);
+
+		/* nothing pending for this process? (see Acquire()) */
+		if (!done && !llHdl->sampleRate && (rd->rdSeq == llHdl->ringSeq)) {
+			ReadSnapshot(llHdl, &snap);
+			StoreSample(llHdl, &snap);
+			SpeedUpdate(llHdl, &snap);
+		}
+
+		avail = llHdl->ringSeq - rd->rdSeq;
+
+		/* records overwritten before read? */
+		if (avail > llHdl->ringDepth) {
+			rd->rdSeq = llHdl->ringSeq - llHdl->ringDepth;
+			avail = llHdl->ringDepth;
+		}
+
+		if (!avail) {
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+			break;
+		}
+
+		/* up to ring end */
+		idx = rd->rdSeq & (llHdl->ringDepth - 1);
+		part = llHdl->ringDepth - idx;
+		if (part > avail)
+			part = avail;
+		if (part > nbr - done)
+			part = nbr - done;
+		if (part > RD_CHUNK)
+			part = RD_CHUNK;
+
+		OSS_MemCopy(OSH, part * sizeof(Z140_SAMPLE), (char*)&llHdl->ring[idx],
+					(char*)buf + done * sizeof(Z140_SAMPLE));
+
+		rd->rdSeq += part;
+		done += part;
+
+		OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+	}
+
+	*nbrRdBytesP = done * sizeof(Z140_SAMPLE);
+
+	return (ERR_SUCCESS);
+}
+
+/****************************** Z140_BlockWrite *****************************/
+/** Write a data block from the device
+*
+*  The function is not supported and always returns an ERR_LL_ILL_FUNC error.
+*
+*  \param llHdl       \IN  low-level handle
+ *  \param ch          \IN  current channel
+ *  \param buf         \IN  data buffer
+ *  \param size        \IN  data buffer size
+ *  \param nbrWrBytesP \OUT number of written bytes
+ *
+ *  \return            \c 0 on success or error code
+ */
+static int32 Z140_BlockWrite(
+	LL_HANDLE *llHdl,
+	int32     ch,
+	void      *buf,
+	int32     size,
+	int32     *nbrWrBytesP
+)
+{
+	DBGWRT_1((DBH, "LL - Z140_BlockWrite: ch=%d, size=%d\n", ch, size));
+
+	/* return number of written bytes */
+	*nbrWrBytesP = 0;
+
+	return (ERR_LL_ILL_FUNC);
+}
+
+/****************************** Z140_Irq ************************************/
+/** Interrupt service routine
+ *
+ *  The 16Z140 has no interrupt status register. The interrupt is assigned to
+ *  the device if a period register reports a new value, reading the period
+ *  registers acknowledges the interrupt. The new period values, the distance
+ *  counters and the status are latched as record into the sample stream.
+ *
+ *  If the driver can detect the interrupt's cause it returns
+ *  LL_IRQ_DEVICE or LL_IRQ_DEV_NOT, otherwise LL_IRQ_UNKNOWN.
+ *  
+ *  For MSI(x) it is necessary to disable all IRQs and enable them again
+ *  at the end of the ISR.
+ *
+ *  Without the descriptor key IRQ_ENABLE=1 or while the interrupt is
+ *  disabled (M_LL_IRQ_ENABLE), the routine returns LL_IRQ_DEV_NOT without
+ *  accessing the device, so a shared interrupt line is not affected.
  *
  *  \param llHdl       \IN  low-level handle
  *  \return LL_IRQ_DEVICE   irq caused by device
@@ -737,7 +1779,32 @@ static int32 Z140_Irq(
 	LL_HANDLE *llHdl
 )
 {
-	return (LL_IRQ_DEV_NOT);
+	Z140_SNAPSHOT snap;
+
+	/* interrupt mode off: don't touch the period registers */
+	if (!llHdl->irqMode || !llHdl->irqEnabled)
+		return (LL_IRQ_DEV_NOT);
+
+	snap.version = Z140_SNAPSHOT_VER;
+	snap.tstamp  = GetTstamp(llHdl);
+	snap.periodA = ReadPeriod(llHdl, 0, snap.tstamp);
+	snap.periodB = ReadPeriod(llHdl, 1, snap.tstamp);
+
+	/* not caused by device? */
+	if (!((snap.periodA | snap.periodB) & Z140R_PERIOD_NEW))
+		return (LL_IRQ_DEV_NOT);
+
+	IDBGWRT_1((DBH, ">>> Z140_Irq: period A=0x%08x B=0x%08x\n",
+			   snap.periodA, snap.periodB));
+
+	snap.ageA = PeriodAge(llHdl, 0, snap.tstamp);
+	snap.ageB = PeriodAge(llHdl, 1, snap.tstamp);
+	ReadCounters(llHdl, &snap);
+	StoreSample(llHdl, &snap);
+	SpeedUpdate(llHdl, &snap);
+	llHdl->irqCount++;
+
+	return (LL_IRQ_DEVICE);
 }
 
 /****************************** Z140_Info ***********************************/
@@ -768,7 +1835,9 @@ static int32 Z140_Irq(
  *  the driver.
  *
  *  The LL_INFO_IRQ code returns whether the driver supports an
- *  interrupt routine (TRUE or FALSE).
+ *  interrupt routine (TRUE or FALSE). The interrupt routine only
+ *  acquires with the descriptor key IRQ_ENABLE=1, otherwise it returns
+ *  LL_IRQ_DEV_NOT, see Z140_Irq().
  *
  *  The LL_INFO_LOCKMODE code returns which process locking
  *  mode the driver needs (LL_LOCK_xxx).
@@ -851,7 +1920,7 @@ static int32 Z140_Info(
 		{
 			u_int32 *lockModeP = va_arg(argptr, u_int32*);
 
-			*lockModeP = LL_LOCK_CALL;
+			*lockModeP = LL_LOCK_NONE;
 			break;
 		}
 		/*-------------------------------+
@@ -894,16 +1963,44 @@ static int32 Cleanup(
 	/*------------------------------+
 	|  close handles                |
 	+------------------------------*/
+	/* clean up alarm */
+	if (llHdl->alarmHdl)
+		OSS_AlarmRemove(llHdl->osHdl, &llHdl->alarmHdl);
+
+	/* clean up signal */
+	if (llHdl->sigHdl)
+		OSS_SigRemove(llHdl->osHdl, &llHdl->sigHdl);
+
 	/* clean up desc */
 	if (llHdl->descHdl)
 		DESC_Exit(&llHdl->descHdl);
 
-	/* clean up debug */
-	DBGEXIT((&DBH));
-
 	/*------------------------------+
 	|  free memory                  |
 	+------------------------------*/
+	/* free sample ring */
+	if (llHdl->ring)
+		OSS_MemFree(llHdl->osHdl, (int8*)llHdl->ring, llHdl->ringAlloc);
+
+	/* free histograms */
+	if (llHdl->hist)
+		OSS_MemFree(llHdl->osHdl, (int8*)llHdl->hist, llHdl->histAlloc);
+
+	/* free trace ring */
+	if (llHdl->trc)
+		OSS_MemFree(llHdl->osHdl, (int8*)llHdl->trc, llHdl->trcAlloc);
+
+	/* free driver counters */
+	if (llHdl->cnt)
+		OSS_MemFree(llHdl->osHdl, (int8*)llHdl->cnt, llHdl->cntAlloc);
+
+	/* free profiles */
+	if (llHdl->prof)
+		OSS_MemFree(llHdl->osHdl, (int8*)llHdl->prof, llHdl->profAlloc);
+
+	/* clean up debug */
+	DBGEXIT((&DBH));
+
 	/* free my handle */
 	OSS_MemFree(llHdl->osHdl, (int8*)llHdl, llHdl->memAlloc);
 
@@ -912,127 +2009,1718 @@ static int32 Cleanup(
 }
 
 /******************************************************************************/
-/** Set debounce time
+/** Check a configuration value
 *
 *  \param llHdl      \IN  low-level handle
-*  \param value      \IN  value [us]
+*  \param code       \IN  configuration status code (Z140_DEBOUNCET..Z140_TPATTERN)
+*  \param value      \IN  value
 *
-*  \return           \c 0 on success or error code
+*  \return           \c 0 on success or ERR_LL_ILL_PARAM
 */
-static int32 SetDebounceTime(
+static int32 CheckParam(
 	LL_HANDLE	*llHdl,
+	int32		code,
 	u_int32		value
 )
 {
-	/* check range */
-	if (!IN_RANGE((int32)value, 0, 255)) {
-		DBGWRT_ERR((DBH, "*** LL - SetDebounceTime(): illegal value %d\n", value));
+	int32 ok;
+
+	switch (code) {
+	case Z140_DEBOUNCET:
+		ok = IN_RANGE((int32)value, 0, 255);
+		break;
+	case Z140_MEAS_TOUT:
+		ok = IN_RANGE(value, 100, 10000) && !(value % 100);
+		break;
+	case Z140_ROLLINGT:
+	case Z140_STANDSTILLT:
+	case Z140_DIRDET_TOUT:
+		ok = IN_RANGE(value, 10, 2550) && !(value % 10);
+		break;
+	case Z140_TPATTERN:
+		ok = IN_RANGE((int32)value, Z140_TP_DISABLE, Z140_TP_STANDSTILL);
+		break;
+	default:
+		ok = FALSE;
+	}
+
+	if (!ok) {
+		DBGWRT_ERR((DBH, "*** LL - CheckParam(0x%04x): illegal value %d\n",
+					code, value));
 		return ERR_LL_ILL_PARAM;
 	}
 
-	DBGWRT_2((DBH, " SetDebounceTime %dus\n",value));
-	MWRITE_D32(llHdl->ma, Z140R_DEB_TIME, value);
+	return ERR_SUCCESS;
+}
+
+/******************************************************************************/
+/** Check a complete configuration
+*
+*  \param llHdl      \IN  low-level handle
+*  \param cfg        \IN  configuration
+*
+*  \return           \c 0 on success or ERR_LL_ILL_PARAM
+*/
+static int32 CheckConfig(
+	LL_HANDLE	*llHdl,
+	Z140_CONFIG	*cfg
+)
+{
+	int32 error;
+
+	if ((error = CheckParam(llHdl, Z140_DEBOUNCET, cfg->debounceT))		||
+		(error = CheckParam(llHdl, Z140_MEAS_TOUT, cfg->measTout))		||
+		(error = CheckParam(llHdl, Z140_ROLLINGT, cfg->rollingT))		||
+		(error = CheckParam(llHdl, Z140_STANDSTILLT, cfg->standstillT))	||
+		(error = CheckParam(llHdl, Z140_DIRDET_TOUT, cfg->dirdetTout))	||
+		(error = CheckParam(llHdl, Z140_TPATTERN, cfg->tpattern)))
+		return error;
 
 	return ERR_SUCCESS;
 }
 
 /******************************************************************************/
-/** Set measurement timeout
+/** Set a complete configuration
+*
+*  All values are checked first. The registers and the active profile are
+*  only written if all values are legal, with interrupts masked, so the
+*  interrupt routine, the sampler and other calls never see a partial
+*  configuration.
 *
 *  \param llHdl      \IN  low-level handle
-*  \param value      \IN  value [ms]
+*  \param cfg        \IN  configuration
+*  \param prof       \IN  profile of cfg (or Z140_PROFILE_NONE)
 *
 *  \return           \c 0 on success or error code
 */
-static int32 SetMeasTout(
+static int32 SetConfig(
 	LL_HANDLE	*llHdl,
-	u_int32		value
+	Z140_CONFIG	*cfg,
+	int32		prof
 )
 {
-	/* check range */
-	if (!IN_RANGE(value, 100, 10000) || (value % 100)) {
-		DBGWRT_ERR((DBH, "*** LL - SetMeasTout(): illegal value %d\n", value));
-		return ERR_LL_ILL_PARAM;
-	}
+	OSS_IRQ_STATE irqState;
+	int32 error;
 
-	DBGWRT_2((DBH, " SetMeasTout %dms\n", value));
-	MWRITE_D32(llHdl->ma, Z140R_MEAS_TOUT, value / 100);
+	if ((error = CheckConfig(llHdl, cfg)))
+		return error;
+
+	irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+	SetDebounceTime(llHdl, cfg->debounceT);
+	SetMeasTout(llHdl, cfg->measTout);
+	SetRollingTime(llHdl, cfg->rollingT);
+	SetStandstillTime(llHdl, cfg->standstillT);
+	SetDirdetTout(llHdl, cfg->dirdetTout);
+	SetTpattern(llHdl, cfg->tpattern);
+	llHdl->profAct = prof;
+	OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
 
 	return ERR_SUCCESS;
 }
 
 /******************************************************************************/
-/** Set rolling time period
+/** Get the complete configuration (from shadow registers)
 *
 *  \param llHdl      \IN  low-level handle
-*  \param value      \IN  value [ms]
+*  \param cfg        \OUT configuration
+*/
+static void GetConfig(
+	LL_HANDLE	*llHdl,
+	Z140_CONFIG	*cfg
+)
+{
+	u_int32 tp;
+
+	cfg->debounceT   = llHdl->shDebTime;
+	cfg->measTout    = 100 * llHdl->shMeasTout;
+	cfg->rollingT    = 10 * llHdl->shRollingTime;
+	cfg->standstillT = 10 * llHdl->shStandstillTime;
+	cfg->dirdetTout  = 10 * llHdl->shDirDetTout;
+
+	cfg->tpattern = Z140_TP_DISABLE;
+	for (tp = Z140_TP_FWD; tp <= Z140_TP_STANDSTILL; tp++) {
+		if (llHdl->shCommand == TpatternCmd[tp])
+			cfg->tpattern = tp;
+	}
+}
+
+/******************************************************************************/
+/** Read the descriptor profiles
+*
+*  \param llHdl      \IN  low-level handle
+*  \param base       \IN  defaults for keys missing in a profile
 *
 *  \return           \c 0 on success or error code
 */
-static int32 SetRollingTime(
+static int32 GetProfiles(
 	LL_HANDLE	*llHdl,
-	u_int32		value
+	Z140_CONFIG	*base
 )
 {
-	/* check range */
-	if (!IN_RANGE(value, 10, 2550) || (value % 10)) {
-		DBGWRT_ERR((DBH, "*** LL - SetRollingTime(): illegal value %d\n", value));
-		return ERR_LL_ILL_PARAM;
+	DESC_HANDLE *descHdl = llHdl->descHdl;
+	Z140_PROFILE_ENTRY *prof;
+	char name[Z140_PROFILE_NAMELEN];
+	u_int32 n, len;
+	int32 error;
+
+	for (n = 0; n < Z140_PROFILE_MAX; n++) {
+
+		/* profile exists? */
+		len = sizeof(name);
+		if ((error = DESC_GetString(descHdl, "", name, &len,
+									"PROFILE_%d/NAME", n))) {
+			if (error == ERR_DESC_KEY_NOTFOUND)
+				break;
+			DBGWRT_ERR((DBH, "*** LL - GetProfiles: PROFILE_%d/NAME error 0x%x\n",
+						n, error));
+			return error;
+		}
+
+		/* alloc table with first profile */
+		if (!llHdl->prof) {
+			if ((llHdl->prof = (Z140_PROFILE_ENTRY*)OSS_MemGet(OSH,
+							Z140_PROFILE_MAX * sizeof(Z140_PROFILE_ENTRY),
+							&llHdl->profAlloc)) == NULL)
+				return ERR_OSS_MEM_ALLOC;
+			OSS_MemFill(OSH, llHdl->profAlloc, (char*)llHdl->prof, 0x00);
+		}
+
+		prof = &llHdl->prof[n];
+		OSS_StrCpy(OSH, name, prof->name);
+		prof->cfg = *base;
+
+		if (((error = DESC_GetUInt32(descHdl, base->debounceT,
+				&prof->cfg.debounceT, "PROFILE_%d/DEBOUNCE_TIME", n)) &&
+				error != ERR_DESC_KEY_NOTFOUND) ||
+			((error = DESC_GetUInt32(descHdl, base->measTout,
+				&prof->cfg.measTout, "PROFILE_%d/MEAS_TOUT", n)) &&
+				error != ERR_DESC_KEY_NOTFOUND) ||
+			((error = DESC_GetUInt32(descHdl, base->rollingT,
+				&prof->cfg.rollingT, "PROFILE_%d/ROLLING_TIME", n)) &&
+				error != ERR_DESC_KEY_NOTFOUND) ||
+			((error = DESC_GetUInt32(descHdl, base->standstillT,
+				&prof->cfg.standstillT, "PROFILE_%d/STANDSTILL_TIME", n)) &&
+				error != ERR_DESC_KEY_NOTFOUND) ||
+			((error = DESC_GetUInt32(descHdl, base->dirdetTout,
+				&prof->cfg.dirdetTout, "PROFILE_%d/DIRDET_TOUT", n)) &&
+				error != ERR_DESC_KEY_NOTFOUND) ||
+			((error = DESC_GetUInt32(descHdl, base->tpattern,
+				&prof->cfg.tpattern, "PROFILE_%d/TPATTERN", n)) &&
+				error != ERR_DESC_KEY_NOTFOUND)) {
+			DBGWRT_ERR((DBH, "*** LL - GetProfiles: PROFILE_%d error 0x%x\n",
+						n, error));
+			return error;
+		}
+
+		if ((error = CheckConfig(llHdl, &prof->cfg))) {
+			DBGWRT_ERR((DBH, "*** LL - GetProfiles: illegal PROFILE_%d\n", n));
+			return error;
+		}
+
+		DBGWRT_2((DBH, " PROFILE_%d: %s\n", n, prof->name));
 	}
 
-	DBGWRT_2((DBH, " SetRollingTime %dms\n", value));
-	MWRITE_D32(llHdl->ma, Z140R_ROLLING_TIME, value / 10);
+	llHdl->profNum = n;
 
 	return ERR_SUCCESS;
 }
 
 /******************************************************************************/
-/** Set standstill time period
+/** Set debounce time
 *
 *  \param llHdl      \IN  low-level handle
-*  \param value      \IN  value [ms]
+*  \param value      \IN  value [us]
 *
 *  \return           \c 0 on success or error code
 */
-static int32 SetStandstillTime(
+static int32 SetDebounceTime(
 	LL_HANDLE	*llHdl,
 	u_int32		value
 )
 {
+	int32 error;
+
 	/* check range */
-	if (!IN_RANGE(value, 10, 2550) || (value % 10)) {
-		DBGWRT_ERR((DBH, "*** LL - SetStandstillTime(): illegal value %d\n", value));
-		return ERR_LL_ILL_PARAM;
-	}
+	if ((error = CheckParam(llHdl, Z140_DEBOUNCET, value)))
+		return error;
 
-	DBGWRT_2((DBH, " SetStandstillTime %dms\n", value));
-	MWRITE_D32(llHdl->ma, Z140R_STANDSTILL_TIME, value / 10);
+	DBGWRT_2((DBH, " SetDebounceTime %dus\n",value));
+	REG_WR(Z140R_DEB_TIME, value);
+	llHdl->shDebTime = value;
 
 	return ERR_SUCCESS;
 }
 
 /******************************************************************************/
-/** Set direction detection timeout
+/** Set measurement timeout
 *
 *  \param llHdl      \IN  low-level handle
 *  \param value      \IN  value [ms]
 *
 *  \return           \c 0 on success or error code
 */
-static int32 SetDirdetTout(
+static int32 SetMeasTout(
 	LL_HANDLE	*llHdl,
 	u_int32		value
 )
 {
+	int32 error;
+
 	/* check range */
-	if (!IN_RANGE(value, 10, 2550) || (value % 10)) {
-		DBGWRT_ERR((DBH, "*** LL - SetDirdetTout(): illegal value %d\n", value));
-		return ERR_LL_ILL_PARAM;
-	}
+	if ((error = CheckParam(llHdl, Z140_MEAS_TOUT, value)))
+		return error;
+
+	DBGWRT_2((DBH, " SetMeasTout %dms\n", value));
+	REG_WR(Z140R_MEAS_TOUT, value / 100);
+	llHdl->shMeasTout = value / 100;
+
+	return ERR_SUCCESS;
+}
+
+/******************************************************************************/
+/** Set rolling time period
+*
+*  \param llHdl      \IN  low-level handle
+*  \param value      \IN  value [ms]
+*
+*  \return           \c 0 on success or error code
+*/
+static int32 SetRollingTime(
+	LL_HANDLE	*llHdl,
+	u_int32		value
+)
+{
+	int32 error;
+
+	/* check range */
+	if ((error = CheckParam(llHdl, Z140_ROLLINGT, value)))
+		return error;
+
+	DBGWRT_2((DBH, " SetRollingTime %dms\n", value));
+	REG_WR(Z140R_ROLLING_TIME, value / 10);
+	llHdl->shRollingTime = value / 10;
+
+	return ERR_SUCCESS;
+}
+
+/******************************************************************************/
+/** Set standstill time period
+*
+*  \param llHdl      \IN  low-level handle
+*  \param value      \IN  value [ms]
+*
+*  \return           \c 0 on success or error code
+*/
+static int32 SetStandstillTime(
+	LL_HANDLE	*llHdl,
+	u_int32		value
+)
+{
+	int32 error;
+
+	/* check range */
+	if ((error = CheckParam(llHdl, Z140_STANDSTILLT, value)))
+		return error;
+
+	DBGWRT_2((DBH, " SetStandstillTime %dms\n", value));
+	REG_WR(Z140R_STANDSTILL_TIME, value / 10);
+	llHdl->shStandstillTime = value / 10;
+
+	return ERR_SUCCESS;
+}
+
+/******************************************************************************/
+/** Set direction detection timeout
+*
+*  \param llHdl      \IN  low-level handle
+*  \param value      \IN  value [ms]
+*
+*  \return           \c 0 on success or error code
+*/
+static int32 SetDirdetTout(
+	LL_HANDLE	*llHdl,
+	u_int32		value
+)
+{
+	int32 error;
+
+	/* check range */
+	if ((error = CheckParam(llHdl, Z140_DIRDET_TOUT, value)))
+		return error;
 
 	DBGWRT_2((DBH, " SetDirdetTout %dms\n", value));
-	MWRITE_D32(llHdl->ma, Z140R_DIR_DET_TOUT, value / 10);
+	REG_WR(Z140R_DIR_DET_TOUT, value / 10);
+	llHdl->shDirDetTout = value / 10;
+
+	return ERR_SUCCESS;
+}
+
+/******************************************************************************/
+/** Set test pattern
+*
+*  \param llHdl      \IN  low-level handle
+*  \param value      \IN  test pattern (Z140_TP_xxx)
+*
+*  \return           \c 0 on success or error code
+*/
+static int32 SetTpattern(
+	LL_HANDLE	*llHdl,
+	u_int32		value
+)
+{
+	int32 error;
+
+	/* check range */
+	if ((error = CheckParam(llHdl, Z140_TPATTERN, value)))
+		return error;
+
+	DBGWRT_2((DBH, " SetTpattern %d\n", value));
+	SetCommand(llHdl, TpatternCmd[value]);
 
 	return ERR_SUCCESS;
 }
 
+/******************************************************************************/
+/** Set command register
+*
+*  Only the test pattern bits are kept in the shadow register.
+*
+*  \param llHdl      \IN  low-level handle
+*  \param value      \IN  value
+*/
+static void SetCommand(
+	LL_HANDLE	*llHdl,
+	u_int32		value
+)
+{
+	DBGWRT_2((DBH, " SetCommand 0x%x\n", value));
+	REG_WR(Z140R_COMMAND, value);
+	llHdl->shCommand = value & (Z140R_CMD_EN_TEST | Z140R_CMD_PAT_MASK);
+}
+
+/******************************************************************************/
+/** Compare configuration shadow registers with hardware
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param llHdl      \IN  low-level handle
+*
+*  \return           Z140_SHD_xxx flags of differing registers
+*/
+static u_int32 ShadowCheck(
+	LL_HANDLE	*llHdl
+)
+{
+	u_int32 diff = 0;
+
+	if (REG_RD(Z140R_DEB_TIME) != llHdl->shDebTime)
+		diff |= Z140_SHD_DEBOUNCET;
+	if (REG_RD(Z140R_MEAS_TOUT) != llHdl->shMeasTout)
+		diff |= Z140_SHD_MEAS_TOUT;
+	if (REG_RD(Z140R_ROLLING_TIME) != llHdl->shRollingTime)
+		diff |= Z140_SHD_ROLLINGT;
+	if (REG_RD(Z140R_STANDSTILL_TIME) != llHdl->shStandstillTime)
+		diff |= Z140_SHD_STANDSTILLT;
+	if (REG_RD(Z140R_DIR_DET_TOUT) != llHdl->shDirDetTout)
+		diff |= Z140_SHD_DIRDET_TOUT;
+	if ((REG_RD(Z140R_COMMAND) & (Z140R_CMD_EN_TEST | Z140R_CMD_PAT_MASK))
+		!= llHdl->shCommand)
+		diff |= Z140_SHD_TPATTERN;
+
+	if (diff)
+		DBGWRT_ERR((DBH, "*** LL - ShadowCheck: registers differ 0x%x\n", diff));
+
+	return (diff);
+}
+
+/******************************************************************************/
+/** Read all measurement registers
+*
+*  The period registers are read first (reading clears their NEW flag). The
+*  distance counters and the status are read back-to-back and re-read if a
+*  distance counter changed in between, so the values are from one instant.
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param llHdl      \IN  low-level handle
+*  \param snap       \OUT measurement snapshot (raw period registers)
+*/
+static void ReadSnapshot(
+	LL_HANDLE		*llHdl,
+	Z140_SNAPSHOT	*snap
+)
+{
+
+	snap->version = Z140_SNAPSHOT_VER;
+	snap->tstamp  = GetTstamp(llHdl);
+	snap->periodA = ReadPeriod(llHdl, 0, snap->tstamp);
+	snap->periodB = ReadPeriod(llHdl, 1, snap->tstamp);
+	snap->ageA    = PeriodAge(llHdl, 0, snap->tstamp);
+	snap->ageB    = PeriodAge(llHdl, 1, snap->tstamp);
+
+	ReadCounters(llHdl, snap);
+}
+
+/******************************************************************************/
+/** Read a single measurement value with capture time
+*
+*  Reads Z140_PERIOD_A/B, Z140_DISTANCE_FWD/BWD or Z140_STATUS like the
+*  getstat of val->code and keeps the capture time for Z140_BLK_TSTAMP.
+*  The error code of the value is returned in val->error.
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param llHdl      \IN  low-level handle
+*  \param val        \IN  code of the value
+*                    \OUT value, error code, capture time and age
+*
+*  \return           success (0) or ERR_LL_ILL_PARAM for unsupported codes
+*/
+static int32 ReadValue(
+	LL_HANDLE	*llHdl,
+	Z140_VALUE	*val
+)
+{
+	u_int32 idx, read;
+
+	val->error    = ERR_SUCCESS;
+	val->reserved = 0;
+	val->tstamp   = GetTstamp(llHdl);
+	val->age      = Z140_AGE_NONE;
+
+	switch (val->code) {
+	case Z140_PERIOD_A:
+	case Z140_PERIOD_B:
+		idx = (val->code == Z140_PERIOD_A) ? 0 : 1;
+		ReadPeriod(llHdl, idx, val->tstamp);
+		read = TakePeriod(ReaderSlot(llHdl, TRUE), llHdl, idx);
+		val->value = read & Z140R_PERIOD_MASK;
+		val->error = Z140_PER_ERR(read);
+		val->age   = PeriodAge(llHdl, idx, val->tstamp);
+		break;
+	case Z140_DISTANCE_FWD:
+	case Z140_DISTANCE_BWD:
+		idx  = (val->code == Z140_DISTANCE_FWD) ? 0 : 1;
+		read = REG_RD(idx ? Z140R_DISTANCE_BWD : Z140R_DISTANCE_FWD);
+		UpdateDistance(llHdl, idx, read);
+		val->value = read;
+		break;
+	case Z140_STATUS:
+		read = REG_RD(Z140R_STATUS);
+		UpdateStatus(llHdl, read);
+		val->value = read;
+		break;
+	default:
+		val->value = 0;
+		val->error = ERR_LL_ILL_PARAM;
+		return (ERR_LL_ILL_PARAM);
+	}
+
+	SetTstamp(llHdl, val->code, val->tstamp, val->age);
+
+	return (ERR_SUCCESS);
+}
+
+/******************************************************************************/
+/** Read distance counters and status
+*
+*  The registers are read back-to-back and re-read if a distance counter
+*  changed in between. If the counters are not stable after SNAP_RETRY_MAX
+*  reads, Z140_ST_TORN is set in the snapshot status. The 64-bit distance
+*  counters and the status transitions are updated.
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param llHdl      \IN  low-level handle
+*  \param snap       \OUT measurement snapshot
+*/
+static void ReadCounters(
+	LL_HANDLE		*llHdl,
+	Z140_SNAPSHOT	*snap
+)
+{
+	u_int32 retry;
+
+	for (retry = 0; retry < SNAP_RETRY_MAX; retry++) {
+		snap->distFwd = REG_RD(Z140R_DISTANCE_FWD);
+		snap->distBwd = REG_RD(Z140R_DISTANCE_BWD);
+		snap->status  = REG_RD(Z140R_STATUS);
+
+		/* counters unchanged while status was read? */
+		if ((REG_RD(Z140R_DISTANCE_FWD) == snap->distFwd) &&
+			(REG_RD(Z140R_DISTANCE_BWD) == snap->distBwd))
+			break;
+	}
+
+	UpdateDistance(llHdl, 0, snap->distFwd);
+	UpdateDistance(llHdl, 1, snap->distBwd);
+	UpdateStatus(llHdl, snap->status);
+
+	/* counters still moving: signal torn snapshot */
+	if (retry == SNAP_RETRY_MAX)
+		snap->status |= Z140_ST_TORN;
+}
+
+/******************************************************************************/
+/** Keep the 64-bit distances for the next Z140_Init() of the device
+*
+*  The distance registers are read a last time, so the 64-bit distances
+*  are up to date. If all entries are assigned to other devices, the
+*  64-bit distances start with the register values again.
+*
+*  \param llHdl      \IN  low-level handle
+*/
+static void DistSave(
+	LL_HANDLE	*llHdl
+)
+{
+	OSS_IRQ_STATE irqState;
+	DIST_KEEP *keep = NULL;
+	u_int32 n;
+
+	for (n = 0; n < DIST_KEEP_NUM; n++) {
+		if (G_distKeep[n].inUse && G_distKeep[n].ma == llHdl->ma) {
+			keep = &G_distKeep[n];
+			break;
+		}
+		if (!keep && !G_distKeep[n].inUse)
+			keep = &G_distKeep[n];
+	}
+
+	if (!keep) {
+		DBGWRT_ERR((DBH, "*** LL - DistSave: no free entry, 64-bit distances lost\n"));
+		return;
+	}
+
+	irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+	UpdateDistance(llHdl, 0, REG_RD(Z140R_DISTANCE_FWD));
+	UpdateDistance(llHdl, 1, REG_RD(Z140R_DISTANCE_BWD));
+	keep->dist64[0]   = llHdl->dist64[0];
+	keep->dist64[1]   = llHdl->dist64[1];
+	keep->distLast[0] = llHdl->distLast[0];
+	keep->distLast[1] = llHdl->distLast[1];
+	OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+
+	keep->ma    = llHdl->ma;
+	keep->inUse = TRUE;
+}
+
+/******************************************************************************/
+/** Continue the 64-bit distances kept by DistSave()
+*
+*  The register changes while the device was closed are added modulo 2^32,
+*  like in UpdateDistance(). Without kept values, the 64-bit distances
+*  start with the register values.
+*
+*  \param llHdl      \IN  low-level handle
+*/
+static void DistRestore(
+	LL_HANDLE	*llHdl
+)
+{
+	u_int32 n, idx;
+
+	llHdl->distLast[0] = REG_RD(Z140R_DISTANCE_FWD);
+	llHdl->distLast[1] = REG_RD(Z140R_DISTANCE_BWD);
+	llHdl->dist64[0] = llHdl->distLast[0];
+	llHdl->dist64[1] = llHdl->distLast[1];
+
+	for (n = 0; n < DIST_KEEP_NUM; n++) {
+		if (!G_distKeep[n].inUse || G_distKeep[n].ma != llHdl->ma)
+			continue;
+
+		for (idx = 0; idx < 2; idx++)
+			llHdl->dist64[idx] = G_distKeep[n].dist64[idx] +
+				(u_int32)(llHdl->distLast[idx] - G_distKeep[n].distLast[idx]);
+
+		G_distKeep[n].inUse = FALSE;
+		break;
+	}
+}
+
+/******************************************************************************/
+/** Extend distance register to 64-bit
+*
+*  The difference to the last read value is added modulo 2^32, so a wrap
+*  of the register is not lost as long as it is read at least once per wrap.
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param llHdl      \IN  low-level handle
+*  \param idx        \IN  0=forward, 1=backward
+*  \param read       \IN  distance register value
+*/
+static void UpdateDistance(
+	LL_HANDLE	*llHdl,
+	u_int32		idx,
+	u_int32		read
+)
+{
+	llHdl->dist64[idx] += (u_int32)(read - llHdl->distLast[idx]);
+	llHdl->distLast[idx] = read;
+}
+
+/******************************************************************************/
+/** Detect status transitions
+*
+*  Collects the changed status flags and sends the installed signal if one
+*  of the flags in the transition mask changed.
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param llHdl      \IN  low-level handle
+*  \param read       \IN  status register value
+*/
+static void UpdateStatus(
+	LL_HANDLE	*llHdl,
+	u_int32		read
+)
+{
+	u_int32 edges = (read ^ llHdl->statusLast) & SIG_MASK_ALL;
+
+	llHdl->statusLast = read;
+
+	if (!edges)
+		return;
+
+	llHdl->statusEdges |= edges;
+
+	if ((edges & llHdl->sigMask) && llHdl->sigHdl)
+		OSS_SigSend(OSH, llHdl->sigHdl);
+}
+
+/******************************************************************************/
+/** Read period register
+*
+*  Reading the register clears the NEW flag of the hardware. Therefore a new
+*  period value is latched with a sequence number, so each reader process
+*  gets it once with NEW flag from TakePeriod().
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param llHdl      \IN  low-level handle
+*  \param idx        \IN  0=signal A, 1=signal B
+*  \param tstamp     \IN  capture time [ns]
+*
+*  \return           raw period register
+*/
+static u_int32 ReadPeriod(
+	LL_HANDLE	*llHdl,
+	u_int32		idx,
+	u_int64		tstamp
+)
+{
+	u_int32 read = REG_RD(PeriodReg[idx]);
+
+	if ((read & Z140R_PERIOD_NEW))
+		NewPeriod(llHdl, idx, read);
+
+	/* latch new value */
+	if ((read & Z140R_PERIOD_NEW)) {
+		llHdl->perLatch[idx] = read & ~Z140R_PERIOD_NEW;
+		llHdl->perTs[idx] = tstamp;
+		llHdl->perSeq[idx]++;
+	}
+
+	return (read);
+}
+
+/******************************************************************************/
+/** Get age of the latched period
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param llHdl      \IN  low-level handle
+*  \param idx        \IN  0=signal A, 1=signal B
+*  \param tstamp     \IN  capture time [ns]
+*
+*  \return           time since the period was new [ns] or Z140_AGE_NONE
+*/
+static u_int64 PeriodAge(
+	LL_HANDLE	*llHdl,
+	u_int32		idx,
+	u_int64		tstamp
+)
+{
+	if (!llHdl->perSeq[idx])
+		return (Z140_AGE_NONE);
+
+	return (tstamp - llHdl->perTs[idx]);
+}
+
+/******************************************************************************/
+/** Process new period value
+*
+*  Called for each period register read with NEW flag. Valid periods update
+*  the period statistics, all periods the period filter.
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param llHdl      \IN  low-level handle
+*  \param idx        \IN  0=signal A, 1=signal B
+*  \param read       \IN  raw period register
+*/
+static void NewPeriod(
+	LL_HANDLE	*llHdl,
+	u_int32		idx,
+	u_int32		read
+)
+{
+	u_int32 period = read & Z140R_PERIOD_MASK;
+
+	FltUpdate(&llHdl->flt[idx], read);
+
+	/* invalid or phase length violation? */
+	if (!(read & Z140R_PERIOD_VLD) || (read & Z140R_PERIOD_LSTS))
+		return;
+
+	PerStatUpdate(&llHdl->statCur[idx], period);
+	HistUpdate(&llHdl->hist->sig[idx], period);
+
+	/* window complete? */
+	if (llHdl->statWin && (llHdl->statCur[idx].count >= llHdl->statWin)) {
+		llHdl->statLast[idx] = llHdl->statCur[idx];
+		OSS_MemFill(OSH, sizeof(PER_STAT), (char*)&llHdl->statCur[idx], 0x00);
+		llHdl->statCur[idx].min = 0xffffffff;
+		llHdl->statWins[idx]++;
+	}
+}
+
+/******************************************************************************/
+/** Update period statistics
+*
+*  Integer Welford update, the mean is kept with PERSTAT_FRAC fractional bits
+*  and the division remainder, so it does not drift. Only 32-bit divisions
+*  are used: the accumulator is summed in 64-bit and clamped to 32-bit for
+*  the division, a clamped part stays in the remainder.
+*
+*  Without window (Z140_PERSTAT_WIN=0) the count would grow without bound.
+*  When it reaches PERSTAT_CNT_MAX, count, remainder and m2 are halved, so
+*  mean and variance are kept and older periods weigh half. m2 saturates.
+*
+*  \param stat       \IN  period statistics
+*  \param period     \IN  period value [1/32us]
+*/
+static void PerStatUpdate(
+	PER_STAT	*stat,
+	u_int32		period
+)
+{
+	int32 x = (int32)(period << PERSTAT_FRAC);
+	int32 delta, delta2, quot;
+	int64 acc, prod;
+
+	/* bound count (window 0), 32-bit division below needs count < 2^31 */
+	if (stat->count >= PERSTAT_CNT_MAX) {
+		stat->count >>= 1;
+		stat->rem   /= 2;
+		stat->m2   >>= 1;
+	}
+
+	stat->count++;
+
+	if (period < stat->min)
+		stat->min = period;
+	if (period > stat->max)
+		stat->max = period;
+
+	/* mean += delta / n, remainder carried to the next update */
+	delta = x - (int32)stat->mean;
+	acc = (int64)delta + stat->rem;
+	if (acc > 0x7fffffff)
+		quot = 0x7fffffff / (int32)stat->count;
+	else if (acc < -0x7fffffff)
+		quot = -0x7fffffff / (int32)stat->count;
+	else
+		quot = (int32)acc / (int32)stat->count;
+	acc -= (int64)quot * stat->count;
+	stat->rem = (int32)acc;
+	stat->mean += quot;
+
+	/* m2 += delta * (x - mean), both have the same sign except rounding */
+	delta2 = x - (int32)stat->mean;
+	prod = (int64)delta * delta2;
+	if (prod > 0) {
+		if (stat->m2 > ~(u_int64)0 - (u_int64)prod)
+			stat->m2 = ~(u_int64)0;
+		else
+			stat->m2 += (u_int64)prod;
+	}
+}
+
+/******************************************************************************/
+/** Reset period statistics
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param llHdl      \IN  low-level handle
+*/
+static void PerStatReset(
+	LL_HANDLE	*llHdl
+)
+{
+	u_int32 idx;
+
+	OSS_MemFill(OSH, sizeof(llHdl->statCur), (char*)llHdl->statCur, 0x00);
+	OSS_MemFill(OSH, sizeof(llHdl->statLast), (char*)llHdl->statLast, 0x00);
+
+	for (idx = 0; idx < 2; idx++)
+		llHdl->statCur[idx].min = 0xffffffff;
+
+	llHdl->statWins[0] = 0;
+	llHdl->statWins[1] = 0;
+}
+
+/******************************************************************************/
+/** Convert period statistics
+*
+*  \param stat       \IN  period statistics
+*  \param sig        \OUT period statistics for the application
+*/
+static void PerStatGet(
+	PER_STAT			*stat,
+	Z140_PERSTAT_SIG	*sig
+)
+{
+	sig->count = stat->count;
+	sig->min   = stat->count ? stat->min : 0;
+	sig->max   = stat->max;
+	sig->mean  = (stat->mean + (1 << (PERSTAT_FRAC - 1))) >> PERSTAT_FRAC;
+	sig->m2    = stat->m2 >> (2 * PERSTAT_FRAC);
+}
+
+/******************************************************************************/
+/** Count period in histogram
+*
+*  Bucket index: values below 16 directly, otherwise the position of the
+*  most significant bit (e) and the next 4 bits (m): ((e-3) << 4) | m.
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param hist       \IN  histogram
+*  \param period     \IN  valid period [1/32us]
+*/
+static void HistUpdate(
+	Z140_HIST_SIG	*hist,
+	u_int32			period
+)
+{
+	u_int32 idx, e = 0, v = period;
+
+	if (period < (1 << Z140_HIST_SUB_BITS)) {
+		idx = period;
+	}
+	else {
+		/* most significant bit */
+		if (v & 0xffff0000) { v >>= 16; e += 16; }
+		if (v & 0xff00)     { v >>= 8;  e += 8; }
+		if (v & 0xf0)       { v >>= 4;  e += 4; }
+		if (v & 0xc)        { v >>= 2;  e += 2; }
+		if (v & 0x2)        {           e += 1; }
+
+		idx = ((e - (Z140_HIST_SUB_BITS - 1)) << Z140_HIST_SUB_BITS) |
+			  ((period >> (e - Z140_HIST_SUB_BITS)) & ((1 << Z140_HIST_SUB_BITS) - 1));
+	}
+
+	if (hist->bucket[idx] == 0xffffffff) {
+		hist->saturated++;
+		return;
+	}
+
+	hist->bucket[idx]++;
+	hist->count++;
+}
+
+/******************************************************************************/
+/** Reset period histograms
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param llHdl      \IN  low-level handle
+*/
+static void HistReset(
+	LL_HANDLE	*llHdl
+)
+{
+	OSS_MemFill(OSH, sizeof(Z140_HIST), (char*)llHdl->hist, 0x00);
+	llHdl->hist->since = GetTstamp(llHdl);
+}
+
+/******************************************************************************/
+/** Check period filter configuration
+*
+*  \param cfg        \IN  Z140_FLT_xxx type | parameter
+*
+*  \return           TRUE if valid
+*/
+static int32 FltCheck(
+	u_int32		cfg
+)
+{
+	u_int32 param = cfg & Z140_FLT_PARAM_MASK;
+
+	switch (cfg & ~Z140_FLT_PARAM_MASK) {
+		case Z140_FLT_OFF:		return (param == 0);
+		case Z140_FLT_MEDIAN:	return (IN_RANGE(param, 1, Z140_FLT_MEDIAN_MAX));
+		case Z140_FLT_IIR:		return (IN_RANGE(param, 1, Z140_FLT_IIR_MAX));
+		default:				return (FALSE);
+	}
+}
+
+/******************************************************************************/
+/** Configure and restart period filter
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param flt        \IN  period filter
+*  \param cfg        \IN  valid Z140_FLT_xxx type | parameter
+*/
+static void FltSet(
+	PER_FLT		*flt,
+	u_int32		cfg
+)
+{
+	flt->cfg = cfg;
+	flt->num = 0;
+	flt->pos = 0;
+	flt->err = Z140_ERR_NO_DATA;
+}
+
+/******************************************************************************/
+/** Feed new period into period filter
+*
+*  Periods with phase length violation are skipped. An invalid period
+*  (measurement timeout) restarts the filter, so it does not report the
+*  speed from before a standstill.
+*
+*  The IIR output is kept with FLT_FRAC fractional bits and starts with the
+*  first period. The magnitude of the difference is shifted, so the output
+*  does not drift by rounding.
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param flt        \IN  period filter
+*  \param read       \IN  raw period register with NEW flag
+*/
+static void FltUpdate(
+	PER_FLT		*flt,
+	u_int32		read
+)
+{
+	u_int32 param = flt->cfg & Z140_FLT_PARAM_MASK;
+	u_int64 x = (u_int64)(read & Z140R_PERIOD_MASK) << FLT_FRAC;
+
+	if (!(read & Z140R_PERIOD_VLD)) {
+		FltSet(flt, flt->cfg);
+		flt->err = Z140_ERR_PER_INVALID;
+		return;
+	}
+	if (read & Z140R_PERIOD_LSTS)
+		return;
+
+	switch (flt->cfg & Z140_FLT_TYPE_MASK) {
+		case Z140_FLT_MEDIAN:
+			flt->buf[flt->pos] = read & Z140R_PERIOD_MASK;
+			if (++flt->pos >= param)
+				flt->pos = 0;
+			if (flt->num < param)
+				flt->num++;
+			break;
+
+		case Z140_FLT_IIR:
+			if (!flt->num)
+				flt->iir = x;
+			else if (x >= flt->iir)
+				flt->iir += (x - flt->iir) >> param;
+			else
+				flt->iir -= (flt->iir - x) >> param;
+			flt->num = 1;
+			break;
+
+		default:
+			flt->buf[0] = read & Z140R_PERIOD_MASK;
+			flt->num = 1;
+			break;
+	}
+}
+
+/******************************************************************************/
+/** Get period filter output
+*
+*  The median of an even number of periods is the rounded mean of the two
+*  middle values.
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param flt        \IN  period filter
+*  \param periodP    \OUT filtered period [1/32us] (0 on error)
+*
+*  \return           \c 0 on success, Z140_ERR_NO_DATA if no valid period
+*                    since configuration or Z140_ERR_PER_INVALID since
+*                    measurement timeout
+*/
+static int32 FltGet(
+	PER_FLT		*flt,
+	u_int32		*periodP
+)
+{
+	u_int32 v[FLT_BUF_LEN], i, j, x, n = flt->num;
+
+	if (!n) {
+		*periodP = 0;
+		return (flt->err);
+	}
+
+	switch (flt->cfg & Z140_FLT_TYPE_MASK) {
+		case Z140_FLT_MEDIAN:
+			/* insertion sort, at most Z140_FLT_MEDIAN_MAX entries */
+			for (i = 0; i < n; i++) {
+				x = flt->buf[i];
+				for (j = i; j > 0 && v[j - 1] > x; j--)
+					v[j] = v[j - 1];
+				v[j] = x;
+			}
+			*periodP = (n & 1) ? v[n / 2] :
+					   (v[n / 2 - 1] + v[n / 2] + 1) / 2;
+			break;
+
+		case Z140_FLT_IIR:
+			*periodP = (u_int32)((flt->iir + (1 << (FLT_FRAC - 1))) >> FLT_FRAC);
+			break;
+
+		default:
+			*periodP = flt->buf[0];
+			break;
+	}
+
+	return (ERR_SUCCESS);
+}
+
+/******************************************************************************/
+/** Update speed estimate from an acquired record
+*
+*  Two estimates are computed:
+*  - period estimate: 1 / last valid period of signal A (or B)
+*  - count estimate: distance pulses (forward + backward) / window
+*
+*  The count estimate is exact on average but coarse with few pulses, the
+*  period estimate has no quantization but reflects only one period. The
+*  result is blended with the weight n / SPD_BLEND_N of the count estimate
+*  for n < SPD_BLEND_N pulses in the window. The window starts at the last
+*  update and grows over further updates until it holds SPD_BLEND_N pulses
+*  or reaches SPD_WIN_MAX, so that slow movement is not estimated from
+*  single pulses in short windows. The sign is taken from the direction
+*  status.
+*
+*  Records following the last update within less than the sample period are
+*  ignored, so that interrupts do not update more often than the sampler.
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param llHdl      \IN  low-level handle
+*  \param snap       \IN  measurement snapshot
+*/
+static void SpeedUpdate(
+	LL_HANDLE		*llHdl,
+	Z140_SNAPSHOT	*snap
+)
+{
+	u_int64 dt = snap->tstamp - llHdl->spdRefTs;
+	u_int32 n, w, period = 0, ppsPer = 0, ppsCnt = 0, quality = 0;
+	u_int32 idx;
+
+	if (llHdl->spdRefValid &&
+		(snap->tstamp - llHdl->spdTs < llHdl->spdIntNs))
+		return;
+
+	/* pulses since reference (32-bit wrap) */
+	n = (snap->distFwd - llHdl->spdRefDist[0]) +
+		(snap->distBwd - llHdl->spdRefDist[1]);
+
+	/* count estimate (window < SPD_WIN_MAX except after long gaps) */
+	if (!llHdl->spdRefValid || !dt || (dt >> 32)) {
+		n = 0;
+		dt = 0;
+	}
+	else {
+		ppsCnt = (n >> 24) ? 0x7fffffff :
+				 SpeedDiv((u_int64)n * 1000000000, (u_int32)dt);
+		quality |= Z140_SPD_COUNT;
+	}
+
+	/* period estimate: last valid period, signal A preferred */
+	for (idx = 0; idx < 2 && !period; idx++) {
+		if (llHdl->perSeq[idx] &&
+			(llHdl->perLatch[idx] & Z140R_PERIOD_VLD) &&
+			!(llHdl->perLatch[idx] & Z140R_PERIOD_LSTS))
+			period = llHdl->perLatch[idx] & Z140R_PERIOD_MASK;
+	}
+	if (period) {
+		ppsPer = SpeedDiv(32000000, period);
+		quality |= Z140_SPD_PERIOD;
+	}
+
+	/* blend */
+	if (snap->status & Z140R_ST_STANDSTILL) {
+		llHdl->spdPps = 0;
+		quality = Z140_SPD_VALID | Z140_SPD_STANDSTILL;
+	}
+	else if (quality) {
+		w = n < SPD_BLEND_N ? n : SPD_BLEND_N;
+		if (!(quality & Z140_SPD_PERIOD))
+			w = SPD_BLEND_N;
+		else if (!(quality & Z140_SPD_COUNT))
+			w = 0;
+
+		llHdl->spdPps = (int32)(((u_int64)ppsCnt * w +
+								 (u_int64)ppsPer * (SPD_BLEND_N - w))
+								>> SPD_BLEND_SHIFT);
+		quality |= Z140_SPD_VALID;
+
+		if (snap->status & Z140R_ST_DIR_BWD)
+			llHdl->spdPps = -llHdl->spdPps;
+		else if (!(snap->status & Z140R_ST_DIR_FWD))
+			quality |= Z140_SPD_DIR_INVALID;
+	}
+	else
+		llHdl->spdPps = 0;
+
+	llHdl->spdQuality  = quality;
+	llHdl->spdPulses   = n;
+	llHdl->spdInterval = (u_int32)dt;
+	llHdl->spdTs       = snap->tstamp;
+
+	/* window complete: new reference */
+	if (dt && n < SPD_BLEND_N && dt < SPD_WIN_MAX &&
+		!(quality & Z140_SPD_STANDSTILL))
+		return;
+
+	llHdl->spdRefValid   = 1;
+	llHdl->spdRefDist[0] = snap->distFwd;
+	llHdl->spdRefDist[1] = snap->distBwd;
+	llHdl->spdRefTs      = snap->tstamp;
+}
+
+/******************************************************************************/
+/** Fixed point division for the speed estimate
+*
+*  Computes (num << Z140_SPEED_FRAC) / den by binary long division, so no
+*  64-bit division is required on 32-bit targets.
+*
+*  \param num        \IN  numerator (< 2^56)
+*  \param den        \IN  denominator (> 0)
+*
+*  \return           quotient, saturated to 0x7fffffff
+*/
+static u_int32 SpeedDiv(
+	u_int64		num,
+	u_int32		den
+)
+{
+	u_int64 rem = 0;
+	u_int32 quot = 0;
+	int32 i;
+
+	num <<= Z140_SPEED_FRAC;
+
+	for (i = 63; i >= 0; i--) {
+		rem = (rem << 1) | ((num >> i) & 1);
+		if (rem >= den) {
+			rem -= den;
+			/* overflow? */
+			if (i >= 31)
+				return (0x7fffffff);
+			quot |= (u_int32)1 << i;
+		}
+	}
+
+	return (quot);
+}
+
+/******************************************************************************/
+/** Get cycle counter for call costs
+*
+*  Under Linux, the cpu cycle counter (get_cycles()) is used. Otherwise the
+*  OSS tick counter, the cost is converted to ns by CostSince().
+*
+*  \param llHdl      \IN  low-level handle
+*
+*  \return           counter (lower 32 bits)
+*/
+static u_int32 GetCycles(
+	LL_HANDLE	*llHdl
+)
+{
+#if defined(LINUX) && defined(__KERNEL__)
+	return ((u_int32)get_cycles());
+#else
+	return (OSS_TickGet(OSH));
+#endif
+}
+
+/******************************************************************************/
+/** Get cost since a GetCycles() value
+*
+*  \param llHdl      \IN  low-level handle
+*  \param t0         \IN  GetCycles() at start
+*
+*  \return           cost [COST_UNIT]
+*/
+static u_int32 CostSince(
+	LL_HANDLE	*llHdl,
+	u_int32		t0
+)
+{
+	u_int32 cost = GetCycles(llHdl) - t0;
+
+#if !(defined(LINUX) && defined(__KERNEL__))
+	cost *= llHdl->tickNs;
+#endif
+	return (cost);
+}
+
+/******************************************************************************/
+/** Count a driver call
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param call       \IN  call counters
+*  \param error      \IN  error code returned by the call
+*  \param cost       \IN  cost of the call
+*/
+static void CntCall(
+	Z140_CNT_CALL	*call,
+	int32			error,
+	u_int32			cost
+)
+{
+	if (!call->calls || cost < call->costMin)
+		call->costMin = cost;
+	if (cost > call->costMax)
+		call->costMax = cost;
+
+	call->costSum += cost;
+	call->calls++;
+	if (error)
+		call->errors++;
+}
+
+/******************************************************************************/
+/** Count a getstat call
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param llHdl      \IN  low-level handle
+*  \param code       \IN  getstat code
+*  \param error      \IN  error code returned by the call
+*  \param t0         \IN  GetCycles() at entry
+*/
+static void CntGetStat(
+	LL_HANDLE	*llHdl,
+	int32		code,
+	int32		error,
+	u_int32		t0
+)
+{
+	CNT_DATA *cnt = llHdl->cnt;
+	u_int32 cost = CostSince(llHdl, t0);
+
+	if ((code == Z140_PERIOD_A || code == Z140_PERIOD_B) &&
+		IN_RANGE(error, Z140_ERR_PER_INVALID, Z140_ERR_NO_DATA))
+		cnt->perErr[error - Z140_ERR_PER_INVALID]++;
+
+	CntCall(&cnt->get[Z140_CNT_IDX(code)], error, cost);
+}
+
+/******************************************************************************/
+/** Reset driver counters
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param llHdl      \IN  low-level handle
+*/
+static void CntReset(
+	LL_HANDLE	*llHdl
+)
+{
+	CNT_DATA *cnt = llHdl->cnt;
+
+	OSS_MemFill(OSH, sizeof(CNT_DATA), (char*)cnt, 0x00);
+	llHdl->mmioRead  = 0;
+	llHdl->mmioWrite = 0;
+	cnt->since = GetTstamp(llHdl);
+}
+
+/******************************************************************************/
+/** Get driver counters
+*
+*  \param llHdl      \IN  low-level handle
+*  \param cnt        \OUT driver counters
+*/
+static void CntGet(
+	LL_HANDLE		*llHdl,
+	Z140_COUNTERS	*cnt
+)
+{
+	CNT_DATA *data = llHdl->cnt;
+	OSS_IRQ_STATE irqState;
+
+	OSS_MemFill(OSH, sizeof(Z140_COUNTERS), (char*)cnt, 0x00);
+
+	irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+	cnt->since     = data->since;
+	cnt->mmioRead  = llHdl->mmioRead;
+	cnt->mmioWrite = llHdl->mmioWrite;
+
+	cnt->costUnit = COST_UNIT;
+	OSS_MemCopy(OSH, sizeof(data->get), (char*)data->get, (char*)cnt->getStat);
+	OSS_MemCopy(OSH, sizeof(data->set), (char*)data->set, (char*)cnt->setStat);
+
+	cnt->errPerInvalid  = data->perErr[0];
+	cnt->errPhViolation = data->perErr[1];
+	cnt->errNoData      = data->perErr[2];
+	OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+}
+
+/******************************************************************************/
+/** Record a getstat/setstat call in the trace ring
+*
+*  \param llHdl      \IN  low-level handle
+*  \param type       \IN  Z140_TRC_GET or Z140_TRC_SET
+*  \param ch         \IN  channel of the calling path
+*  \param code       \IN  getstat/setstat code
+*  \param value      \IN  value set or returned
+*  \param error      \IN  returned error code
+*/
+static void TraceCall(
+	LL_HANDLE	*llHdl,
+	u_int32		type,
+	int32		ch,
+	int32		code,
+	int32		value,
+	int32		error
+)
+{
+	Z140_TRACE_ENTRY *e;
+	OSS_IRQ_STATE irqState;
+
+	irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+
+	e = &llHdl->trc[llHdl->trcSeq & (llHdl->trcDepth - 1)];
+	e->tstamp   = GetTstamp(llHdl);
+	e->seq      = llHdl->trcSeq++;
+	e->type     = (u_int16)type;
+	e->ch       = (u_int16)ch;
+	e->code     = code;
+	e->value    = value;
+	e->error    = error;
+	e->reserved = 0;
+
+	OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+}
+
+/******************************************************************************/
+/** Drain entries from the trace ring
+*
+*  Entries overwritten before they were drained are skipped.
+*
+*  \param llHdl      \IN  low-level handle
+*  \param buf        \OUT trace entries
+*  \param nbr        \IN  max. number of entries
+*
+*  \return           number of entries
+*/
+static u_int32 TraceDrain(
+	LL_HANDLE			*llHdl,
+	Z140_TRACE_ENTRY	*buf,
+	u_int32				nbr
+)
+{
+	OSS_IRQ_STATE irqState;
+	u_int32 avail, idx, part, done = 0;
+
+	/* copy in chunks to keep the interrupt latency low */
+	while (done < nbr) {
+		irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+
+		avail = llHdl->trcSeq - llHdl->trcRd;
+		if (avail > llHdl->trcDepth) {
+			llHdl->trcRd = llHdl->trcSeq - llHdl->trcDepth;
+			avail = llHdl->trcDepth;
+		}
+
+		if (!avail) {
+			OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+			break;
+		}
+
+		/* up to ring end */
+		idx = llHdl->trcRd & (llHdl->trcDepth - 1);
+		part = llHdl->trcDepth - idx;
+		if (part > avail)
+			part = avail;
+		if (part > nbr - done)
+			part = nbr - done;
+		if (part > RD_CHUNK)
+			part = RD_CHUNK;
+
+		OSS_MemCopy(OSH, part * sizeof(Z140_TRACE_ENTRY),
+					(char*)&llHdl->trc[idx], (char*)&buf[done]);
+
+		llHdl->trcRd += part;
+		done += part;
+
+		OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+	}
+
+	return (done);
+}
+
+/******************************************************************************/
+/** Get reader slot of the calling process
+*
+*  MDIS does not pass a path identifier to the low-level driver, so the
+*  reader state (period latch and stream read cursor) is kept per process.
+*  A process gets a free slot on its first call. If all slots are assigned,
+*  the least recently used slot is taken over, its previous process
+*  then starts again like a new reader.
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param llHdl      \IN  low-level handle
+*  \param alloc      \IN  assign a slot if the process has none
+*
+*  \return           reader slot or NULL (no slot and alloc=FALSE)
+*/
+static RD_SLOT* ReaderSlot(
+	LL_HANDLE	*llHdl,
+	u_int32		alloc
+)
+{
+	u_int32 pid = OSS_GetPid(OSH);
+	RD_SLOT *rd, *slot = NULL;
+	u_int32 n;
+
+	llHdl->rdUse++;
+
+	for (n = 0; n < RD_SLOTS; n++) {
+		rd = &llHdl->rd[n];
+
+		/* slot of the process */
+		if (rd->inUse && rd->pid == pid) {
+			rd->used = llHdl->rdUse;
+			return (rd);
+		}
+
+		/* free slot, else least recently used */
+		if (!slot || (slot->inUse && (!rd->inUse ||
+			llHdl->rdUse - rd->used > llHdl->rdUse - slot->used)))
+			slot = rd;
+	}
+
+	if (!alloc)
+		return (NULL);
+
+	DBGWRT_2((DBH, " reader slot %d: pid %d (was %d)\n",
+			  (int32)(slot - llHdl->rd), pid, slot->inUse ? slot->pid : 0));
+
+	OSS_MemFill(OSH, sizeof(RD_SLOT), (char*)slot, 0x00);
+	slot->inUse = TRUE;
+	slot->pid   = pid;
+	slot->used  = llHdl->rdUse;
+
+	return (slot);
+}
+
+/******************************************************************************/
+/** Take latched period
+*
+*  Returns the latched period value, with NEW flag if the reader has not
+*  taken it yet.
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param rd         \IN  reader slot of the calling process
+*  \param llHdl      \IN  low-level handle
+*  \param idx        \IN  0=signal A, 1=signal B
+*
+*  \return           raw period value (Z140R_PERIOD_xxx flags)
+*/
+static u_int32 TakePeriod(
+	RD_SLOT		*rd,
+	LL_HANDLE	*llHdl,
+	u_int32		idx
+)
+{
+	u_int32 latch = llHdl->perLatch[idx];
+
+	if (rd->perSeen[idx] != llHdl->perSeq[idx]) {
+		rd->perSeen[idx] = llHdl->perSeq[idx];
+		latch |= Z140R_PERIOD_NEW;
+	}
+
+	return (latch);
+}
+
+/******************************************************************************/
+/** Acquire measurement record
+*
+*  Reads all measurement registers and appends them as record to the sample
+*  stream. Called from the sampler, and from Z140_BlockRead() if the sampler
+*  is disabled.
+*
+*  \param llHdl      \IN  low-level handle
+*  \param snap       \OUT measurement snapshot
+*/
+static void Acquire(
+	LL_HANDLE		*llHdl,
+	Z140_SNAPSHOT	*snap
+)
+{
+	OSS_IRQ_STATE irqState;
+
+	irqState = OSS_IrqMaskR(OSH, llHdl->irqHdl);
+
+	ReadSnapshot(llHdl, snap);
+	StoreSample(llHdl, snap);
+	SpeedUpdate(llHdl, snap);
+
+	OSS_IrqRestore(OSH, llHdl->irqHdl, irqState);
+}
+
+/******************************************************************************/
+/** Append measurement record to the sample ring
+*
+*  The ring is full if a reader has not read the oldest record yet. Then
+*  the overrun counter is incremented and the record is discarded or
+*  overwrites the oldest one, according to the overflow policy. A reader
+*  which has not read for RD_IDLE_TOUT (e.g. a process which exited
+*  without Z140_RD_RELEASE) is idle: it no longer stalls the ring with
+*  drop-newest, but the records it loses are still counted as overrun.
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param llHdl      \IN  low-level handle
+*  \param snap       \IN  measurement snapshot
+*/
+static void StoreSample(
+	LL_HANDLE		*llHdl,
+	Z140_SNAPSHOT	*snap
+)
+{
+	Z140_SAMPLE *rec;
+	RD_SLOT *rd;
+	u_int32 full = FALSE, stall = FALSE;
+
+	/* fill level of the readers */
+	for (rd = llHdl->rd; rd < &llHdl->rd[RD_SLOTS]; rd++) {
+		if (!rd->inUse || !rd->rdActive ||
+			llHdl->ringSeq - rd->rdSeq < llHdl->ringDepth)
+			continue;
+
+		full = TRUE;
+
+		/* idle reader: keep its cursor at the oldest record */
+		if (snap->tstamp - rd->rdTs > (u_int64)RD_IDLE_TOUT * 1000000000)
+			rd->rdSeq = llHdl->ringSeq - llHdl->ringDepth;
+		else
+			stall = TRUE;
+	}
+
+	if (full) {
+		llHdl->overrun++;
+		if (stall && (llHdl->ovfPolicy == Z140_OVF_DROP_NEWEST))
+			return;
+	}
+
+	rec = &llHdl->ring[llHdl->ringSeq & (llHdl->ringDepth - 1)];
+	rec->tstamp  = snap->tstamp;
+	rec->seq     = llHdl->ringSeq++;
+	rec->periodA = snap->periodA;
+	rec->periodB = snap->periodB;
+	rec->distFwd = snap->distFwd;
+	rec->distBwd = snap->distBwd;
+	rec->status  = snap->status;
+	rec->ageA    = snap->ageA;
+	rec->ageB    = snap->ageB;
+
+	if (llHdl->ringFill < llHdl->ringDepth)
+		llHdl->ringFill++;
+}
+
+/******************************************************************************/
+/** Sampler alarm routine
+*
+*  Called periodically with SAMPLE_RATE_HZ. With enabled interrupt, a record
+*  is only acquired if no interrupt occurred since the last call.
+*
+*  \param arg        \IN  low-level handle
+*/
+static void SampleAlarm(
+	void	*arg
+)
+{
+	LL_HANDLE *llHdl = (LL_HANDLE*)arg;
+	Z140_SNAPSHOT snap;
+
+	/* interrupt driven acquisition active? */
+	if (llHdl->irqEnabled && (llHdl->irqCount != llHdl->irqCountAlarm)) {
+		llHdl->irqCountAlarm = llHdl->irqCount;
+		return;
+	}
+
+	Acquire(llHdl, &snap);
+}
+
+/******************************************************************************/
+/** Get monotonic timestamp
+*
+*  Under Linux, the timestamp is the kernel monotonic clock (CLOCK_MONOTONIC
+*  in user space). Otherwise it is derived from the OSS tick counter,
+*  extended to 64-bit.
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param llHdl      \IN  low-level handle
+*
+*  \return           timestamp [ns]
+*/
+static u_int64 GetTstamp(
+	LL_HANDLE	*llHdl
+)
+{
+#if defined(LINUX) && defined(__KERNEL__)
+	return (ktime_get_ns());
+#else
+	u_int32 tick = OSS_TickGet(OSH);
+
+	if (tick < llHdl->tickLast)
+		llHdl->tickHigh++;
+	llHdl->tickLast = tick;
+
+	return ((((u_int64)llHdl->tickHigh << 32) | tick) * llHdl->tickNs);
+#endif
+}
+
+/******************************************************************************/
+/** Store capture time of a measurement getstat
+*
+*  \warning Must be called with interrupts masked.
+*
+*  \param llHdl      \IN  low-level handle
+*  \param code       \IN  getstat code
+*  \param tstamp     \IN  capture time [ns]
+*  \param age        \IN  age of the period [ns] or Z140_AGE_NONE
+*/
+static void SetTstamp(
+	LL_HANDLE	*llHdl,
+	int32		code,
+	u_int64		tstamp,
+	u_int64		age
+)
+{
+	llHdl->tsCode = code;
+	llHdl->tsTime = tstamp;
+	llHdl->tsAge  = age;
+}
+
@@ -42,6 +42,10 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#ifdef LINUX
+#include <time.h>
+#include <errno.h>
+#endif
 #include <MEN/men_typs.h>
 #include <MEN/mdis_api.h>
 #include <MEN/mdis_err.h>
@@ -57,26 +61,49 @@ static const char IdentString[]=MENT_XSTR(MAK_REVISION);
 #define ERR_PARAM	1
 #define ERR_FUNC	2
 
+#define KEY_CHECK_NS	100000000	/**< keypress check interval [ns] */
+#define DL_HIST_NUM		18		/**< lateness buckets: <1us, 1..2us, ... >=65536us */
+
+/*--------------------------------------+
+|   TYPEDEFS                            |
++--------------------------------------*/
+/** loop on absolute deadlines */
+typedef struct {
+	u_int64	period;		/**< period [ns] */
+	u_int64	next;		/**< current deadline [ns] */
+	u_int32	cycles;		/**< number of waits */
+	u_int32	overruns;	/**< cycles which were not ready before the next deadline */
+	u_int32	missed;		/**< skipped deadlines */
+	u_int64	lateMax;	/**< max. wake-up lateness [ns] */
+	u_int32	hist[DL_HIST_NUM];	/**< wake-up lateness histogram */
+} DL_LOOP;
+
 /*--------------------------------------+
 |  PROTOTYPES                           |
 +--------------------------------------*/
 static void usage(void);
 static int PrintError(char *info);
-static int MeasStat(char *info, char **statStr);
+static int MeasStat(int32 err, char **statStr);
+static u_int64 TimeNs(void);
+static void DlInit(DL_LOOP *dl, u_int64 periodNs);
+static void DlWait(DL_LOOP *dl);
+static void DlPrint(DL_LOOP *dl);
 
 /********************************* usage ***********************************/
 /**  Print program usage
  */
 static void usage(void)
 {
-	printf("Usage:    z140_simp <device> [<delay> [<l>]]\n");
+	printf("Usage:    z140_simp <device> [<delay> [<flags>]]\n");
 	printf("Function: Example program for the Z140 Frequency Counter driver    \n");
 	printf("            Using configuration parameters from device descriptor  \n");
 	printf("            or defaults if no parameters set in descriptor.\n");
 	printf("Options:\n");
 	printf("    device   device name (e.g. freq_1)\n");
 	printf("    delay    delay between cycles in ms (default=100)\n");
-	printf("    l        print each output in a new line\n");
+	printf("    flags    l: print each output in a new line\n");
+	printf("             d: loop on absolute deadlines (cycle time = delay)\n");
+	printf("                and print the wake-up lateness at exit\n");
 	printf("\n");
 	printf("Copyright 2016-2019, MEN Mikro Elektronik GmbH\n%s\n", IdentString);
 }
@@ -92,12 +119,16 @@ static void usage(void)
 int main(int argc, char *argv[])
 {
 	char      *device;
-	int32     val, periodA, periodB, distFwd, distBwd;
+	int32     val, distFwd, distBwd;
+	Z140_SNAPSHOT snap;
+	M_SG_BLOCK blk;
 	char      *periodAStat, *periodBStat;
 	char      periodAVal[16], periodBVal[16], status[]="- - - - -";
 	char      *st = status;
 	MDIS_PATH path;
-	int		  ret, delay, newLine=0, blink=0;
+	int		  ret, delay, newLine=0, blink=0, deadline=0;
+	u_int64   keyCheck;
+	DL_LOOP   dl;
 
 	if (argc < 2 || strcmp(argv[1], "-?") == 0) {
 		usage();
@@ -111,8 +142,10 @@ int main(int argc, char *argv[])
 	else
 		delay = 100;
 
-	if (argc > 3)
-		newLine = (*argv[3] == 'l') ? 1 : 0;
+	if (argc > 3) {
+		newLine  = strchr(argv[3], 'l') ? 1 : 0;
+		deadline = strchr(argv[3], 'd') ? 1 : 0;
+	}
 
 	/*----------------------+
 	|  open path            |
@@ -173,46 +206,41 @@ int main(int argc, char *argv[])
 	printf("        [us]           [us]     [pulses]     [pulses]   I B F S R\n");
 	printf("    period-A       period-B     dist-fwd     dist-bwd      status\n");
 	
-	while (UOS_KeyPressed() == -1) {
+	blk.size = sizeof(snap);
+	blk.data = (void*)&snap;
+
+	keyCheck = TimeNs();
+	DlInit(&dl, (u_int64)delay * 1000000);
+
+	for (;;) {
 		/*--------------------------+
 		|  get measurement results  |
 		+--------------------------*/
-		/* period measurement for signal A */
-		if ((M_getstat(path, Z140_PERIOD_A, &periodA)) < 0) {
-			if ((ret = MeasStat("getstat Z140_PERIOD_A", &periodAStat)))
-				goto ABORT;
+		if ((M_getstat(path, Z140_BLK_SNAPSHOT, (int32*)&blk)) < 0) {
+			ret = PrintError("getstat Z140_BLK_SNAPSHOT");
+			goto ABORT;
 		}
-		else {
-			sprintf(periodAVal, "%8d.%03d", Z140_PER_US(periodA), Z140_PER_NS(periodA));
+
+		/* period measurement for signal A */
+		if (!MeasStat(Z140_PER_ERR(snap.periodA), &periodAStat)) {
+			sprintf(periodAVal, "%8d.%03d",
+				Z140_PER_US(snap.periodA & Z140_PER_MASK),
+				Z140_PER_NS(snap.periodA & Z140_PER_MASK));
 			periodAStat = periodAVal;
 		}
 
 		/* period measurement for signal B */
-		if ((M_getstat(path, Z140_PERIOD_B, &periodB)) < 0) {
-			if ((ret = MeasStat("getstat Z140_PERIOD_A", &periodBStat)))
-				goto ABORT;
-		}
-		else {
-			sprintf(periodBVal, "%8d.%03d", Z140_PER_US(periodB), Z140_PER_NS(periodB));
+		if (!MeasStat(Z140_PER_ERR(snap.periodB), &periodBStat)) {
+			sprintf(periodBVal, "%8d.%03d",
+				Z140_PER_US(snap.periodB & Z140_PER_MASK),
+				Z140_PER_NS(snap.periodB & Z140_PER_MASK));
 			periodBStat = periodBVal;
 		}
 
-		/* sensor pulses */
-		if ((M_getstat(path, Z140_DISTANCE_FWD, &distFwd)) < 0) {
-			ret = PrintError("getstat Z140_DISTANCE_FWD");
-			goto ABORT;
-		}
-
-		if ((M_getstat(path, Z140_DISTANCE_BWD, &distBwd)) < 0) {
-			ret = PrintError("getstat Z140_DISTANCE_BWD");
-			goto ABORT;
-		}
-
-		/* status */
-		if ((M_getstat(path, Z140_STATUS, &val)) < 0) {
-			ret = PrintError("getstat Z140_STATUS");
-			goto ABORT;
-		}
+		/* sensor pulses and status */
+		distFwd = snap.distFwd;
+		distBwd = snap.distBwd;
+		val = snap.status;
 
 		if (val & Z140_ST_DIR_INVALID) st[0]='I'; else st[0]='-';
 		if (val & Z140_ST_DIR_BWD)     st[2]='B'; else st[2]='-';
@@ -233,10 +261,22 @@ int main(int argc, char *argv[])
 			blink ^= 1;
 		}
 
-		UOS_Delay(delay);
+		if (deadline)
+			DlWait(&dl);
+		else
+			UOS_Delay(delay);
+
+		/* repeat until keypress */
+		if (TimeNs() - keyCheck >= KEY_CHECK_NS) {
+			keyCheck = TimeNs();
+			if (UOS_KeyPressed() != -1)
+				break;
+		}
 	}
 
 	printf("\n");
+	if (deadline)
+		DlPrint(&dl);
 	ret = ERR_OK;
 
 ABORT:
@@ -265,26 +305,132 @@ static int PrintError(char *info)
 /***************************************************************************/
 /** Measurement status helper function
 *
-*  \param info       \IN  info string
-*  \param statStr    \IN  status string
+*  \param err        \IN  Z140_ERR_xxx code of period value (see Z140_PER_ERR)
+*  \param statStr    \OUT status string
 *
-*  \return           success (0) for device specific error or error code
+*  \return           1 for period error or 0 for valid period value
 */
-static int MeasStat(char *info, char **statStr)
+static int MeasStat(int32 err, char **statStr)
 {
-	u_int32 stat;
 	static char *errStr[] = { "  period-err", "   phase-err", " no-new-data" };
 
-	stat = UOS_ErrnoGet();
-
-	switch (stat) {
+	switch (err) {
 	case Z140_ERR_PER_INVALID:  *statStr = errStr[0]; break;
 	case Z140_ERR_PH_VIOLATION:	*statStr = errStr[1]; break;
 	case Z140_ERR_NO_DATA:		*statStr = errStr[2]; break;
 	default:
-		printf("*** can't %s: %s\n", info, M_errstring(stat));
-		return ERR_FUNC;
+		return 0;
+	}
+
+	return 1;
+}
+
+/***************************************************************************/
+/** Get monotonic time
+*
+*  \return           time [ns] (ms resolution without LINUX)
+*/
+static u_int64 TimeNs(void)
+{
+#ifdef LINUX
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((u_int64)ts.tv_sec * 1000000000 + ts.tv_nsec);
+#else
+	return ((u_int64)UOS_MsecTimerGet() * 1000000);
+#endif
+}
+
+/***************************************************************************/
+/** Start a loop on absolute deadlines
+*
+*  \param dl         \OUT loop state
+*  \param periodNs   \IN  period [ns]
+*/
+static void DlInit(DL_LOOP *dl, u_int64 periodNs)
+{
+	memset(dl, 0, sizeof(*dl));
+	dl->period = periodNs;
+	dl->next   = TimeNs();
+}
+
+/***************************************************************************/
+/** Wait for the next deadline
+*
+*  Unlike UOS_Delay(), the work time of the cycle does not add to the
+*  period. Passed deadlines are skipped and counted. Without LINUX, the
+*  wait is a UOS_Delay() with ms resolution.
+*
+*  \param dl         \INOUT loop state
+*/
+static void DlWait(DL_LOOP *dl)
+{
+#ifdef LINUX
+	struct timespec ts;
+#endif
+	u_int64 now = TimeNs(), late, skip;
+	u_int32 b;
+
+	/* no period, don't wait */
+	if (!dl->period) {
+		dl->cycles++;
+		return;
+	}
+
+	dl->next += dl->period;
+	if (now >= dl->next) {
+		skip = (now - dl->next) / dl->period + 1;
+		dl->overruns++;
+		dl->missed += (u_int32)skip;
+		dl->next += skip * dl->period;
 	}
 
-	return ERR_OK;
+#ifdef LINUX
+	ts.tv_sec  = dl->next / 1000000000;
+	ts.tv_nsec = dl->next % 1000000000;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+#else
+	/* no absolute sleep: relative delay to the deadline */
+	now = TimeNs();
+	if (dl->next > now)
+		UOS_Delay((u_int32)((dl->next - now + 999999) / 1000000));
+#endif
+
+	/* lateness bucket: 0 for <1us, n for 2^(n-1)..2^n-1 us */
+	late = TimeNs() - dl->next;
+	if (late > dl->lateMax)
+		dl->lateMax = late;
+	for (b = 0, late /= 1000; late && b < DL_HIST_NUM - 1; late >>= 1)
+		b++;
+
+	dl->hist[b]++;
+	dl->cycles++;
+}
+
+/***************************************************************************/
+/** Print lateness histogram and overruns of a deadline loop
+*
+*  \param dl         \IN  loop state
+*/
+static void DlPrint(DL_LOOP *dl)
+{
+	u_int32 b;
+
+	printf("Deadline loop: %u cycles, %u overruns, %u missed periods, "
+		   "max. lateness %.1fus\n", dl->cycles, dl->overruns, dl->missed,
+		   (double)dl->lateMax / 1000.0);
+
+	for (b = 0; b < DL_HIST_NUM; b++) {
+		if (!dl->hist[b])
+			continue;
+		if (b == 0)
+			printf("  lateness          <1us : %u\n", dl->hist[b]);
+		else if (b == DL_HIST_NUM - 1)
+			printf("  lateness     >=%6uus : %u\n", 1U << (b - 1), dl->hist[b]);
+		else
+			printf("  lateness %6u..%6uus : %u\n", 1U << (b - 1),
+				   (1U << b) - 1, dl->hist[b]);
+	}
 }
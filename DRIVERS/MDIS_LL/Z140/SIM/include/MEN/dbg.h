@@ -0,0 +1,83 @@
+/***********************  I n c l u d e  -  F i l e  ************************/
+/*!
+ *        \file  dbg.h
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  Debug output (host simulation, written to stderr)
+ *
+ *               Host simulation subset of the MDIS header, only what the
+ *               Z140 driver, tools and libraries use (see SIM/Makefile).
+ *
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _DBG_H
+#define _DBG_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+typedef struct DBG_HANDLE	DBG_HANDLE;
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+/* debug levels */
+#define DBG_LEV1		0x00000001
+#define DBG_LEV2		0x00000002
+#define DBG_LEV3		0x00000004
+#define DBG_LEVERR		0x00000008
+#define DBG_NORM		0x40000000	/* normal (task) level */
+#define DBG_INTR		0x80000000	/* interrupt level */
+#define DBG_ALL			0xc000000f
+
+#define DBGINIT(x)		DBG_Init x
+#define DBGEXIT(x)		DBG_Exit x
+#define DBGCMD(x)		x
+
+/* DBG_MYLEVEL must be defined by the module */
+#define DBGWRT(lev,x)	do { if ((DBG_MYLEVEL & (lev)) == (lev)) DBG_Write x; } while (0)
+#define DBGWRT_1(x)		DBGWRT(DBG_NORM | DBG_LEV1, x)
+#define DBGWRT_2(x)		DBGWRT(DBG_NORM | DBG_LEV2, x)
+#define DBGWRT_3(x)		DBGWRT(DBG_NORM | DBG_LEV3, x)
+#define DBGWRT_ERR(x)	DBGWRT(DBG_LEVERR, x)
+#define IDBGWRT_1(x)	DBGWRT(DBG_INTR | DBG_LEV1, x)
+#define IDBGWRT_2(x)	DBGWRT(DBG_INTR | DBG_LEV2, x)
+#define IDBGWRT_3(x)	DBGWRT(DBG_INTR | DBG_LEV3, x)
+#define IDBGWRT_ERR(x)	DBGWRT(DBG_LEVERR, x)
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+int32 DBG_Init(char *name, DBG_HANDLE **dbgP);
+int32 DBG_Exit(DBG_HANDLE **dbgP);
+int32 DBG_Write(DBG_HANDLE *dbg, char *fmt, ...);
+
+#ifdef __cplusplus
+	}
+#endif
+
+#endif /* _DBG_H */
@@ -0,0 +1,73 @@
+/***********************  I n c l u d e  -  F i l e  ************************/
+/*!
+ *        \file  desc.h
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  Descriptor access (host simulation)
+ *
+ *               Host simulation subset of the MDIS header, only what the
+ *               Z140 driver, tools and libraries use (see SIM/Makefile).
+ *
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _DESC_H
+#define _DESC_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+typedef struct DESC_HANDLE	DESC_HANDLE;
+
+/** descriptor: list of keys (host simulation) */
+typedef struct DESC_SPEC {
+	struct DESC_SPEC	*next;		/**< next key */
+	char				*key;		/**< key with directories (e.g. PROFILE_0/NAME) */
+	char				*str;		/**< string value (or NULL) */
+	u_int32				val;		/**< numeric value */
+} DESC_SPEC;
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+int32 DESC_Init(DESC_SPEC *descSpec, OSS_HANDLE *osHdl, DESC_HANDLE **descHdlP);
+int32 DESC_Exit(DESC_HANDLE **descHdlP);
+int32 DESC_GetUInt32(DESC_HANDLE *descHdl, u_int32 defVal, u_int32 *valueP,
+					 char *keyFmt, ...);
+int32 DESC_GetString(DESC_HANDLE *descHdl, char *defVal, char *buf,
+					 u_int32 *lenP, char *keyFmt, ...);
+int32 DESC_DbgLevelSet(DESC_HANDLE *descHdl, u_int32 dbgLevel);
+char* DESC_Ident(void);
+
+/* host simulation only: descriptor file */
+int32 DESC_SIM_Load(char *file, const char *device, DESC_SPEC **descP);
+void DESC_SIM_Free(DESC_SPEC **descP);
+
+#ifdef __cplusplus
+	}
+#endif
+
+#endif /* _DESC_H */
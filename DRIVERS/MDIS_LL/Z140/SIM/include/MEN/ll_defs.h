@@ -0,0 +1,72 @@
+/***********************  I n c l u d e  -  F i l e  ************************/
+/*!
+ *        \file  ll_defs.h
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  Low-level driver definitions
+ *
+ *               Host simulation subset of the MDIS header, only what the
+ *               Z140 driver, tools and libraries use (see SIM/Makefile).
+ *
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _LL_DEFS_H
+#define _LL_DEFS_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/* interrupt return codes */
+#define LL_IRQ_DEV_NOT			0	/* not caused by device */
+#define LL_IRQ_DEVICE			1	/* caused by device */
+#define LL_IRQ_UNKNOWN			2	/* unknown */
+
+/* info codes */
+#define LL_INFO_HW_CHARACTER	0x01
+#define LL_INFO_ADDRSPACE_COUNT	0x02
+#define LL_INFO_ADDRSPACE		0x03
+#define LL_INFO_IRQ				0x04
+#define LL_INFO_LOCKMODE		0x05
+
+/* lock modes */
+#define LL_LOCK_NONE			0	/* no locking */
+#define LL_LOCK_CALL			1	/* lock each call */
+#define LL_LOCK_CHAN			2	/* lock each channel */
+
+/** ident function table */
+typedef struct {
+	struct {
+		char* (*identCall)(void);
+	} idCall[8];
+} MDIS_IDENT_FUNCT_TBL;
+
+#ifndef _NO_LL_HANDLE
+typedef void LL_HANDLE;
+#endif
+
+#ifdef __cplusplus
+	}
+#endif
+
+#endif /* _LL_DEFS_H */
@@ -0,0 +1,62 @@
+/***********************  I n c l u d e  -  F i l e  ************************/
+/*!
+ *        \file  maccess.h
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  Hardware access macros (simulated register block)
+ *
+ *               Host simulation subset of the MDIS header, only what the
+ *               Z140 driver, tools and libraries use (see SIM/Makefile).
+ *
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _MACCESS_H
+#define _MACCESS_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/** simulated register block
+ *
+ *  MACCESS points to a register block implementation (e.g. the 16Z140
+ *  model, see z140_sim.h). The kernel asks the block for its interrupt.
+ */
+typedef struct SIM_MA {
+	u_int32	(*read)(struct SIM_MA *ma, u_int32 offs);			/**< read register */
+	void	(*write)(struct SIM_MA *ma, u_int32 offs, u_int32 val);	/**< write register */
+	u_int64	(*irqTime)(struct SIM_MA *ma);	/**< time [ns] of next interrupt (0=pending) */
+} SIM_MA;
+
+typedef SIM_MA *MACCESS;
+
+#define MREAD_D32(ma,offs)			((ma)->read((ma), (offs)))
+#define MWRITE_D32(ma,offs,val)		((ma)->write((ma), (offs), (val)))
+#define MSETMASK_D32(ma,offs,mask)	MWRITE_D32(ma, offs, MREAD_D32(ma, offs) | (mask))
+#define MCLRMASK_D32(ma,offs,mask)	MWRITE_D32(ma, offs, MREAD_D32(ma, offs) & ~(mask))
+
+#ifdef __cplusplus
+	}
+#endif
+
+#endif /* _MACCESS_H */
@@ -0,0 +1,109 @@
+/***********************  I n c l u d e  -  F i l e  ************************/
+/*!
+ *        \file  mdis_api.h
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  MDIS user interface
+ *
+ *               Host simulation subset of the MDIS header, only what the
+ *               Z140 driver, tools and libraries use (see SIM/Makefile).
+ *
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _MDIS_API_H
+#define _MDIS_API_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+typedef INT32_OR_64 MDIS_PATH;
+
+/** block getstat/setstat data */
+typedef struct {
+	int32	size;		/**< size of data buffer */
+	void	*data;		/**< data buffer */
+} M_SG_BLOCK;
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+/* status code offsets */
+#define M_MK_OF				0x0000	/* kernel */
+#define M_LL_OF				0x0100	/* low-level driver */
+#define M_BB_OF				0x0200	/* board handler */
+#define M_DEV_OF			0x0300	/* device specific */
+#define M_MK_BLK_OF			0x1000	/* kernel block */
+#define M_LL_BLK_OF			0x1100	/* low-level driver block */
+#define M_BB_BLK_OF			0x1200	/* board handler block */
+#define M_DEV_BLK_OF		0x1300	/* device specific block */
+
+#define M_IS_BLK(code)		((code) >= M_MK_BLK_OF)
+
+/* kernel codes */
+#define M_MK_NBR_CHAN		(M_MK_OF+0x00)	/* G  : number of channels */
+#define M_MK_CH_CURRENT		(M_MK_OF+0x04)	/* G,S: current channel of the path */
+#define M_MK_IRQ_ENABLE		(M_MK_OF+0x07)	/* G,S: enable interrupt */
+#define M_MK_IRQ_COUNT		(M_MK_OF+0x08)	/* G  : interrupt counter */
+#define M_MK_BLK_REV_ID		(M_MK_BLK_OF+0x01)	/* G  : ident function table */
+
+/* low-level driver codes */
+#define M_LL_CH_NUMBER		(M_LL_OF+0x00)
+#define M_LL_CH_DIR			(M_LL_OF+0x01)
+#define M_LL_CH_LEN			(M_LL_OF+0x02)
+#define M_LL_CH_TYP			(M_LL_OF+0x03)
+#define M_LL_IRQ_COUNT		(M_LL_OF+0x04)
+#define M_LL_ID_CHECK		(M_LL_OF+0x05)
+#define M_LL_DEBUG_LEVEL	(M_LL_OF+0x06)
+#define M_LL_IRQ_ENABLE		(M_LL_OF+0x0b)
+
+/* channel directions and types */
+#define M_CH_IN				0
+#define M_CH_OUT			1
+#define M_CH_INOUT			2
+#define M_CH_BINARY			0
+#define M_CH_ANALOG			1
+#define M_CH_COUNTER		2
+#define M_CH_UNKNOWN		3
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+MDIS_PATH M_open(const char *device);
+int32 M_close(MDIS_PATH path);
+int32 M_read(MDIS_PATH path, int32 *valueP);
+int32 M_write(MDIS_PATH path, int32 value);
+int32 M_getstat(MDIS_PATH path, int32 code, int32 *dataP);
+int32 M_setstat(MDIS_PATH path, int32 code, INT32_OR_64 data);
+int32 M_getblock(MDIS_PATH path, u_int8 *buffer, int32 length);
+int32 M_setblock(MDIS_PATH path, const u_int8 *buffer, int32 length);
+char* M_errstring(int32 errCode);
+
+#ifdef __cplusplus
+	}
+#endif
+
+#endif /* _MDIS_API_H */
@@ -0,0 +1,56 @@
+/***********************  I n c l u d e  -  F i l e  ************************/
+/*!
+ *        \file  mdis_com.h
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  MDIS common definitions
+ *
+ *               Host simulation subset of the MDIS header, only what the
+ *               Z140 driver, tools and libraries use (see SIM/Makefile).
+ *
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _MDIS_COM_H
+#define _MDIS_COM_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/* address modes */
+#define MDIS_MA08			0x01
+#define MDIS_MA16			0x02
+#define MDIS_MA24			0x04
+#define MDIS_MA32			0x08
+
+/* data modes */
+#define MDIS_MD08			0x01
+#define MDIS_MD16			0x02
+#define MDIS_MD32			0x04
+#define MDIS_MD64			0x08
+
+#ifdef __cplusplus
+	}
+#endif
+
+#endif /* _MDIS_COM_H */
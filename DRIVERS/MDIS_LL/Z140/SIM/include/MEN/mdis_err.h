@@ -0,0 +1,82 @@
+/***********************  I n c l u d e  -  F i l e  ************************/
+/*!
+ *        \file  mdis_err.h
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  MDIS error codes
+ *
+ *               Host simulation subset of the MDIS header, only what the
+ *               Z140 driver, tools and libraries use (see SIM/Makefile).
+ *
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _MDIS_ERR_H
+#define _MDIS_ERR_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+#define ERR_SUCCESS				0
+
+#define ERR_OS					0x0000	/* 0x0001..0x0aff: operating system (errno) */
+
+#define ERR_OSS					0x0a00
+#define ERR_OSS_MEM_ALLOC		(ERR_OSS+0x02)
+#define ERR_OSS_ILL_PARAM		(ERR_OSS+0x03)
+#define ERR_OSS_TIMEOUT			(ERR_OSS+0x06)
+#define ERR_OSS_ALARM_CREATE	(ERR_OSS+0x10)
+#define ERR_OSS_SIG_SET			(ERR_OSS+0x20)
+#define ERR_OSS_SIG_CLR			(ERR_OSS+0x21)
+
+#define ERR_DESC				0x0b00
+#define ERR_DESC_KEY_NOTFOUND	(ERR_DESC+0x01)
+#define ERR_DESC_ILL_PARAM		(ERR_DESC+0x02)
+
+#define ERR_UOS					0x0c00
+#define ERR_UOS_MEM_ALLOC		(ERR_UOS+0x01)
+#define ERR_UOS_ILL_PARAM		(ERR_UOS+0x02)
+
+#define ERR_LL					0x0d00
+#define ERR_LL_ILL_FUNC			(ERR_LL+0x01)
+#define ERR_LL_ILL_PARAM		(ERR_LL+0x02)
+#define ERR_LL_UNK_CODE			(ERR_LL+0x03)
+#define ERR_LL_ILL_DIR			(ERR_LL+0x04)
+#define ERR_LL_ILL_CHAN			(ERR_LL+0x05)
+#define ERR_LL_USERBUF			(ERR_LL+0x06)
+#define ERR_LL_READ				(ERR_LL+0x08)
+#define ERR_LL_DEV_BUSY			(ERR_LL+0x0a)
+
+#define ERR_DEV					0x0e00	/* device specific errors */
+
+#define ERR_MK					0x0f00
+#define ERR_MK_ILL_PARAM		(ERR_MK+0x01)
+#define ERR_MK_NO_LLDESC		(ERR_MK+0x02)
+#define ERR_MK_UNK_CODE			(ERR_MK+0x03)
+#define ERR_MK_ILL_PATH			(ERR_MK+0x04)
+
+#ifdef __cplusplus
+	}
+#endif
+
+#endif /* _MDIS_ERR_H */
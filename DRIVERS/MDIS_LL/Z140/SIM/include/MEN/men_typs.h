@@ -0,0 +1,72 @@
+/***********************  I n c l u d e  -  F i l e  ************************/
+/*!
+ *        \file  men_typs.h
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  MEN type definitions
+ *
+ *               Host simulation subset of the MDIS header, only what the
+ *               Z140 driver, tools and libraries use (see SIM/Makefile).
+ *
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _MEN_TYPS_H
+#define _MEN_TYPS_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+typedef int8_t				int8;
+typedef uint8_t				u_int8;
+typedef int16_t				int16;
+typedef uint16_t			u_int16;
+typedef int32_t				int32;
+typedef uint32_t			u_int32;
+typedef int64_t				int64;
+typedef uint64_t			u_int64;
+
+#define INT32_OR_64			intptr_t
+#define U_INT32_OR_64		uintptr_t
+
+#ifndef TRUE
+# define TRUE				1
+#endif
+#ifndef FALSE
+# define FALSE				0
+#endif
+
+#define IN_RANGE(x,lo,hi)	(((x) >= (lo)) && ((x) <= (hi)))
+
+#define _MENT_STR(x)		#x
+#define MENT_XSTR(x)		_MENT_STR(x)
+
+#ifdef __cplusplus
+	}
+#endif
+
+#endif /* _MEN_TYPS_H */
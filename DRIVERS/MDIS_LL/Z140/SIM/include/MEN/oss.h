@@ -0,0 +1,95 @@
+/***********************  I n c l u d e  -  F i l e  ************************/
+/*!
+ *        \file  oss.h
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  Operating system services (host simulation)
+ *
+ *               Host simulation subset of the MDIS header, only what the
+ *               Z140 driver, tools and libraries use (see SIM/Makefile).
+ *
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _OSS_H
+#define _OSS_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+typedef struct OSS_HANDLE		OSS_HANDLE;
+typedef struct OSS_IRQ_HANDLE	OSS_IRQ_HANDLE;
+typedef struct OSS_SEM_HANDLE	OSS_SEM_HANDLE;
+typedef struct OSS_SIG_HANDLE	OSS_SIG_HANDLE;
+typedef struct OSS_ALARM_HANDLE	OSS_ALARM_HANDLE;
+typedef int32					OSS_IRQ_STATE;
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+#define OSS_DBG_DEFAULT			0x00000000	/* debug output off */
+#define OSS_SEM_WAITINFINITE	-1
+#define OSS_TICK_RATE			1000000		/* tick rate [Hz] */
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+char* OSS_Ident(void);
+void* OSS_MemGet(OSS_HANDLE *osHdl, u_int32 size, u_int32 *gotsizeP);
+int32 OSS_MemFree(OSS_HANDLE *osHdl, void *addr, u_int32 size);
+void OSS_MemFill(OSS_HANDLE *osHdl, u_int32 size, char *adr, int8 value);
+void OSS_MemCopy(OSS_HANDLE *osHdl, u_int32 size, char *src, char *dest);
+char* OSS_StrCpy(OSS_HANDLE *osHdl, char *from, char *to);
+u_int32 OSS_TickGet(OSS_HANDLE *osHdl);
+u_int32 OSS_TickRateGet(OSS_HANDLE *osHdl);
+u_int32 OSS_GetPid(OSS_HANDLE *osHdl);
+int32 OSS_AlarmCreate(OSS_HANDLE *osHdl, void (*funct)(void *arg), void *arg,
+					  OSS_ALARM_HANDLE **alarmP);
+int32 OSS_AlarmRemove(OSS_HANDLE *osHdl, OSS_ALARM_HANDLE **alarmP);
+int32 OSS_AlarmSet(OSS_HANDLE *osHdl, OSS_ALARM_HANDLE *alarm, u_int32 msec,
+				   u_int32 cyclic, u_int32 *realMsecP);
+int32 OSS_AlarmClear(OSS_HANDLE *osHdl, OSS_ALARM_HANDLE *alarm);
+int32 OSS_SigCreate(OSS_HANDLE *osHdl, int32 value, OSS_SIG_HANDLE **sigP);
+int32 OSS_SigSend(OSS_HANDLE *osHdl, OSS_SIG_HANDLE *sig);
+int32 OSS_SigRemove(OSS_HANDLE *osHdl, OSS_SIG_HANDLE **sigP);
+OSS_IRQ_STATE OSS_IrqMaskR(OSS_HANDLE *osHdl, OSS_IRQ_HANDLE *irqHdl);
+void OSS_IrqRestore(OSS_HANDLE *osHdl, OSS_IRQ_HANDLE *irqHdl,
+					OSS_IRQ_STATE oldState);
+int32 OSS_SemWait(OSS_HANDLE *osHdl, OSS_SEM_HANDLE *sem, int32 msec);
+int32 OSS_SemSignal(OSS_HANDLE *osHdl, OSS_SEM_HANDLE *sem);
+
+/* host simulation only: handles created by the MDIS kernel */
+int32 OSS_SIM_IrqCreate(OSS_IRQ_HANDLE **irqP);
+void OSS_SIM_IrqRemove(OSS_IRQ_HANDLE **irqP);
+int32 OSS_SIM_SemCreate(OSS_SEM_HANDLE **semP);
+void OSS_SIM_SemRemove(OSS_SEM_HANDLE **semP);
+u_int64 OSS_SIM_TimeNs(void);
+
+#ifdef __cplusplus
+	}
+#endif
+
+#endif /* _OSS_H */
@@ -0,0 +1,52 @@
+/***********************  I n c l u d e  -  F i l e  ************************/
+/*!
+ *        \file  usr_oss.h
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  User mode operating system services
+ *
+ *               Host simulation subset of the MDIS header, only what the
+ *               Z140 driver, tools and libraries use (see SIM/Makefile).
+ *
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _USR_OSS_H
+#define _USR_OSS_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+void UOS_Delay(u_int32 msec);
+int32 UOS_KeyPressed(void);
+int32 UOS_KeyWait(void);
+u_int32 UOS_ErrnoGet(void);
+u_int32 UOS_ErrnoSet(u_int32 errCode);
+u_int32 UOS_MsecTimerGet(void);
+char* UOS_ErrString(int32 errCode);
+
+#ifdef __cplusplus
+	}
+#endif
+
+#endif /* _USR_OSS_H */
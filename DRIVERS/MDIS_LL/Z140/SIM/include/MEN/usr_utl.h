@@ -0,0 +1,50 @@
+/***********************  I n c l u d e  -  F i l e  ************************/
+/*!
+ *        \file  usr_utl.h
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  User mode utility functions
+ *
+ *               Host simulation subset of the MDIS header, only what the
+ *               Z140 driver, tools and libraries use (see SIM/Makefile).
+ *
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _USR_UTL_H
+#define _USR_UTL_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+#define UTL_TSTOPT(opt)			UTL_Tstopt(argc, argv, opt, NULL)
+#define UTL_ILLIOPT(opts,buf)	UTL_Illiopt(argc, argv, opts, buf)
+
+char* UTL_Tstopt(int argc, char **argv, char *option, char *buf);
+char* UTL_Illiopt(int argc, char **argv, char *opts, char *buf);
+
+#ifdef __cplusplus
+	}
+#endif
+
+#endif /* _USR_UTL_H */
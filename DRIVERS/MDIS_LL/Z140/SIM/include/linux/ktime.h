@@ -0,0 +1,38 @@
+/***********************  I n c l u d e  -  F i l e  ************************/
+/*!
+ *        \file  ktime.h
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  Kernel monotonic clock (host simulation)
+ *
+ *               The driver is built with LINUX and __KERNEL__ like in the
+ *               kernel, its timestamps are CLOCK_MONOTONIC as on target.
+ *
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _LINUX_KTIME_H
+#define _LINUX_KTIME_H
+
+#define ktime_get_ns()	OSS_SIM_TimeNs()
+
+#endif /* _LINUX_KTIME_H */
@@ -0,0 +1,44 @@
+/***********************  I n c l u d e  -  F i l e  ************************/
+/*!
+ *        \file  timex.h
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  Host simulation subset of <linux/timex.h>
+ *
+ *               get_cycles() reads the time stamp counter on x86 and
+ *               falls back to the monotonic clock [ns] otherwise.
+ *
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _LINUX_TIMEX_H
+#define _LINUX_TIMEX_H
+
+typedef u_int64 cycles_t;
+
+#if defined(__x86_64__) || defined(__i386__)
+# define get_cycles()	((cycles_t)__builtin_ia32_rdtsc())
+#else
+# define get_cycles()	((cycles_t)OSS_SIM_TimeNs())
+#endif
+
+#endif /* _LINUX_TIMEX_H */
@@ -0,0 +1,409 @@
+/*********************  P r o g r a m  -  M o d u l e ***********************/
+/*!
+ *        \file  sim_desc.c
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  DESC and DBG libraries for the host simulation
+ *
+ *               The descriptor is read from a text file in MDIS descriptor
+ *               syntax (device block with "KEY = U_INT32 value" and
+ *               "KEY = STRING value" entries, nested blocks for
+ *               directories). Debug output is written to stderr.
+ *
+ *     Required: -
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*-----------------------------------------+
+|  INCLUDES                                |
++-----------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_err.h>
+#include <MEN/oss.h>
+#include <MEN/desc.h>
+#include <MEN/dbg.h>
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+#define KEY_MAX		128		/**< max. key length incl. directories */
+#define TOK_MAX		256		/**< max. token length */
+#define DEPTH_MAX	8		/**< max. directory depth */
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/** descriptor handle */
+struct DESC_HANDLE {
+	DESC_SPEC	*spec;		/**< key list */
+};
+
+/** debug handle */
+struct DBG_HANDLE {
+	int			dummy;		/**< (unused) */
+};
+
+/** descriptor file parser */
+typedef struct {
+	FILE		*fp;		/**< descriptor file */
+	int			line;		/**< current line */
+	char		tok[TOK_MAX];	/**< current token */
+} PARSER;
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+static int NextToken(PARSER *p);
+static DESC_SPEC* FindKey(DESC_SPEC *spec, char *keyFmt, va_list ap);
+static int32 AddKey(DESC_SPEC **descP, char *key, char *str, u_int32 val);
+
+static DBG_HANDLE G_dbgHdl;
+
+/*-----------------------------------------+
+|  DESC                                    |
++-----------------------------------------*/
+char* DESC_Ident(void)
+{
+	return ("DESC - host simulation");
+}
+
+int32 DESC_Init(DESC_SPEC *descSpec, OSS_HANDLE *osHdl, DESC_HANDLE **descHdlP)
+{
+	DESC_HANDLE *descHdl;
+
+	if ((descHdl = (DESC_HANDLE*)malloc(sizeof(*descHdl))) == NULL)
+		return (ERR_OSS_MEM_ALLOC);
+
+	descHdl->spec = descSpec;
+	*descHdlP = descHdl;
+
+	return (ERR_SUCCESS);
+}
+
+int32 DESC_Exit(DESC_HANDLE **descHdlP)
+{
+	free(*descHdlP);
+	*descHdlP = NULL;
+
+	return (ERR_SUCCESS);
+}
+
+int32 DESC_DbgLevelSet(DESC_HANDLE *descHdl, u_int32 dbgLevel)
+{
+	return (ERR_SUCCESS);
+}
+
+int32 DESC_GetUInt32(DESC_HANDLE *descHdl, u_int32 defVal, u_int32 *valueP,
+					 char *keyFmt, ...)
+{
+	DESC_SPEC *key;
+	va_list ap;
+
+	va_start(ap, keyFmt);
+	key = FindKey(descHdl->spec, keyFmt, ap);
+	va_end(ap);
+
+	*valueP = defVal;
+
+	if (!key)
+		return (ERR_DESC_KEY_NOTFOUND);
+	if (key->str)
+		return (ERR_DESC_ILL_PARAM);
+
+	*valueP = key->val;
+	return (ERR_SUCCESS);
+}
+
+int32 DESC_GetString(DESC_HANDLE *descHdl, char *defVal, char *buf,
+					 u_int32 *lenP, char *keyFmt, ...)
+{
+	DESC_SPEC *key;
+	char *str;
+	int32 error = ERR_SUCCESS;
+	va_list ap;
+
+	va_start(ap, keyFmt);
+	key = FindKey(descHdl->spec, keyFmt, ap);
+	va_end(ap);
+
+	if (!key) {
+		str = defVal;
+		error = ERR_DESC_KEY_NOTFOUND;
+	}
+	else if (!key->str)
+		return (ERR_DESC_ILL_PARAM);
+	else
+		str = key->str;
+
+	if (strlen(str) + 1 > *lenP)
+		return (ERR_DESC_ILL_PARAM);
+
+	strcpy(buf, str);
+	*lenP = strlen(str) + 1;
+
+	return (error);
+}
+
+/******************************* DESC_SIM_Load *****************************/
+/** Load the descriptor of a device from a descriptor file
+ *
+ *  \param file       \IN  descriptor file
+ *  \param device     \IN  device name (top-level block)
+ *  \param descP      \OUT key list (NULL if empty)
+ *
+ *  \return           \c 0 on success or error code
+ */
+int32 DESC_SIM_Load(char *file, const char *device, DESC_SPEC **descP)
+{
+	PARSER p;
+	char dir[DEPTH_MAX][KEY_MAX], key[KEY_MAX], name[TOK_MAX], type[TOK_MAX];
+	int depth = 0, found = FALSE, inDev = FALSE;
+	int32 error = ERR_SUCCESS;
+
+	*descP = NULL;
+
+	if ((p.fp = fopen(file, "r")) == NULL)
+		return (ERR_MK_NO_LLDESC);
+	p.line = 1;
+
+	while (!error && NextToken(&p)) {
+
+		/* end of block */
+		if (!strcmp(p.tok, "}")) {
+			if (depth == 0) {
+				error = ERR_DESC_ILL_PARAM;
+				break;
+			}
+			if (--depth == 0)
+				inDev = FALSE;
+			continue;
+		}
+
+		strcpy(name, p.tok);
+		if (!NextToken(&p)) {
+			error = ERR_DESC_ILL_PARAM;
+			break;
+		}
+
+		/* start of block (device or directory) */
+		if (!strcmp(p.tok, "{")) {
+			if (depth == DEPTH_MAX) {
+				error = ERR_DESC_ILL_PARAM;
+				break;
+			}
+			if (depth == 0 && !strcmp(name, device))
+				found = inDev = TRUE;
+			if (depth == 0)
+				dir[depth][0] = '\0';
+			else {
+				snprintf(key, KEY_MAX, "%s%s/", dir[depth - 1], name);
+				strcpy(dir[depth], key);
+			}
+			depth++;
+			continue;
+		}
+
+		/* KEY = TYPE value */
+		if (strcmp(p.tok, "=") || !NextToken(&p)) {
+			error = ERR_DESC_ILL_PARAM;
+			break;
+		}
+		strcpy(type, p.tok);
+		if (!NextToken(&p) || depth == 0) {
+			error = ERR_DESC_ILL_PARAM;
+			break;
+		}
+
+		if (!inDev)
+			continue;
+
+		snprintf(key, KEY_MAX, "%s%s", dir[depth - 1], name);
+		if (!strcmp(type, "U_INT32"))
+			error = AddKey(descP, key, NULL, strtoul(p.tok, NULL, 0));
+		else if (!strcmp(type, "STRING"))
+			error = AddKey(descP, key, p.tok, 0);
+		/* other types (e.g. BINARY) are not used */
+	}
+
+	if (!error && (depth || !found))
+		error = depth ? ERR_DESC_ILL_PARAM : ERR_MK_NO_LLDESC;
+
+	if (error) {
+		fprintf(stderr, "*** %s:%d: descriptor error 0x%04x\n",
+				file, p.line, error);
+		DESC_SIM_Free(descP);
+	}
+
+	fclose(p.fp);
+	return (error);
+}
+
+/******************************* DESC_SIM_Free *****************************/
+/** Free a key list
+ *
+ *  \param descP      \IN  key list
+ *                    \OUT NULL
+ */
+void DESC_SIM_Free(DESC_SPEC **descP)
+{
+	DESC_SPEC *key, *next;
+
+	for (key = *descP; key; key = next) {
+		next = key->next;
+		free(key->key);
+		free(key->str);
+		free(key);
+	}
+	*descP = NULL;
+}
+
+/******************************* NextToken *********************************/
+/** Read next token (word, quoted string, '{', '}' or '=')
+ *
+ *  \param p          \IN  parser
+ *
+ *  \return           1 if token read, 0 at end of file
+ */
+static int NextToken(PARSER *p)
+{
+	int c, n = 0;
+
+	/* skip white space and comments */
+	for (;;) {
+		if ((c = fgetc(p->fp)) == EOF)
+			return (0);
+		if (c == '\n')
+			p->line++;
+		else if (c == '#') {
+			while ((c = fgetc(p->fp)) != EOF && c != '\n')
+				;
+			p->line++;
+		}
+		else if (!isspace(c))
+			break;
+	}
+
+	if (c == '{' || c == '}' || c == '=') {
+		p->tok[n++] = (char)c;
+	}
+	else if (c == '"') {
+		while ((c = fgetc(p->fp)) != EOF && c != '"' && n < TOK_MAX - 1)
+			p->tok[n++] = (char)c;
+	}
+	else {
+		do {
+			p->tok[n++] = (char)c;
+			c = fgetc(p->fp);
+		} while (c != EOF && !isspace(c) && c != '{' && c != '}' &&
+				 c != '=' && c != '#' && n < TOK_MAX - 1);
+		if (c != EOF)
+			ungetc(c, p->fp);
+	}
+
+	p->tok[n] = '\0';
+	return (1);
+}
+
+/******************************* FindKey ***********************************/
+/** Find a key in the key list
+ *
+ *  \param spec       \IN  key list
+ *  \param keyFmt     \IN  key format
+ *  \param ap         \IN  key format arguments
+ *
+ *  \return           key or NULL
+ */
+static DESC_SPEC* FindKey(DESC_SPEC *spec, char *keyFmt, va_list ap)
+{
+	char key[KEY_MAX];
+
+	vsnprintf(key, sizeof(key), keyFmt, ap);
+
+	for (; spec; spec = spec->next) {
+		if (!strcmp(spec->key, key))
+			return (spec);
+	}
+
+	return (NULL);
+}
+
+/******************************* AddKey ************************************/
+/** Append a key to the key list
+ *
+ *  \param descP      \IN  key list
+ *  \param key        \IN  key with directories
+ *  \param str        \IN  string value or NULL
+ *  \param val        \IN  numeric value
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 AddKey(DESC_SPEC **descP, char *key, char *str, u_int32 val)
+{
+	DESC_SPEC *spec, **lastP;
+
+	if ((spec = (DESC_SPEC*)calloc(1, sizeof(*spec))) == NULL ||
+		(spec->key = strdup(key)) == NULL ||
+		(str && (spec->str = strdup(str)) == NULL)) {
+		if (spec) {
+			free(spec->key);
+			free(spec);
+		}
+		return (ERR_OSS_MEM_ALLOC);
+	}
+	spec->val = val;
+
+	for (lastP = descP; *lastP; lastP = &(*lastP)->next)
+		;
+	*lastP = spec;
+
+	return (ERR_SUCCESS);
+}
+
+/*-----------------------------------------+
+|  DBG                                     |
++-----------------------------------------*/
+int32 DBG_Init(char *name, DBG_HANDLE **dbgP)
+{
+	*dbgP = &G_dbgHdl;
+	return (ERR_SUCCESS);
+}
+
+int32 DBG_Exit(DBG_HANDLE **dbgP)
+{
+	*dbgP = NULL;
+	return (ERR_SUCCESS);
+}
+
+int32 DBG_Write(DBG_HANDLE *dbg, char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+
+	return (ERR_SUCCESS);
+}
@@ -0,0 +1,720 @@
+/*********************  P r o g r a m  -  M o d u l e ***********************/
+/*!
+ *        \file  sim_mdis.c
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  MDIS user API for the host simulation
+ *
+ *               Minimal MDIS kernel that runs the unmodified Z140 low-level
+ *               driver in the application process against the behavioral
+ *               model of z140_sim.c:
+ *
+ *               - The descriptor file is taken from the environment variable
+ *                 Z140_SIM_DESC. Without it, any device name is accepted and
+ *                 the driver runs with its default settings.
+ *               - A device is initialized on the first M_open() and
+ *                 de-initialized on the last M_close() of the process. Each
+ *                 process has its own simulated device; forked processes
+ *                 share nothing but the descriptor.
+ *               - Like the hardware, the model of a device keeps running
+ *                 after the last M_close(), the next M_open() of the device
+ *                 continues with its registers.
+ *               - Calls are locked according to the LL_INFO_LOCKMODE of the
+ *                 driver (per channel or per call).
+ *               - The interrupt is emulated by a thread that calls the
+ *                 driver's Irq routine with the interrupt masked whenever
+ *                 the model asserts it and the interrupt is enabled
+ *                 (IRQ_ENABLE descriptor key or M_MK_IRQ_ENABLE).
+ *               - SIM_MDIS_Model() gives tests access to the model of an
+ *                 open device, e.g. for torn reads (Z140_SIM_Tear()).
+ *
+ *               The model is configured with the optional descriptor keys:
+ *
+ *               SIM_TP_HZ      test pattern frequency [Hz] (default 1000)
+ *               SIM_INPUT_HZ   sensor input frequency [Hz] (default 0=none)
+ *               SIM_INPUT_DIR  sensor input direction (0=fwd, 1=bwd)
+ *               SIM_REPLAY     trace file to replay instead of the signal
+ *                              model (see Z140_SIM_Replay())
+ *               SIM_REPLAY_SPEED  replay speed factor (default 1)
+ *               SIM_REPLAY_LOOP   restart at the end of the trace (0/1)
+ *
+ *     Required: pthread
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*-----------------------------------------+
+|  INCLUDES                                |
++-----------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <MEN/men_typs.h>
+#include <MEN/maccess.h>
+#include <MEN/oss.h>
+#include <MEN/desc.h>
+#include <MEN/mdis_api.h>
+#include <MEN/mdis_err.h>
+#include <MEN/ll_defs.h>
+#include <MEN/ll_entry.h>
+#include <MEN/usr_oss.h>
+#include "z140_sim.h"
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+#define DEV_MAX			8		/**< max. number of devices */
+#define HW_MAX			32		/**< max. number of kept models */
+#define PATH_MAX_NBR	256		/**< max. number of open paths */
+#define NAME_MAX_LEN	64		/**< max. device name length */
+#define REPLAY_MAX_LEN	256		/**< max. replay file name length */
+#define IRQ_POLL_NS		10000000	/**< max. sleep of the interrupt thread [ns] */
+#define IRQ_STORM_NS	1000000		/**< back-off if the irq stays asserted [ns] */
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/** simulated device */
+typedef struct {
+	char				name[NAME_MAX_LEN];	/**< device name */
+	int32				openCnt;	/**< number of open paths */
+	DESC_SPEC			*desc;		/**< descriptor */
+	Z140_SIM			*sim;		/**< register block model */
+	u_int32				simKept;	/**< model kept in G_hw */
+	MACCESS				ma;			/**< hw access handle */
+	OSS_IRQ_HANDLE		*irqHdl;	/**< interrupt mask */
+	OSS_SEM_HANDLE		*devSem;	/**< device semaphore */
+	LL_ENTRY			entry;		/**< driver jump table */
+	LL_HANDLE			*llHdl;		/**< driver handle */
+	u_int32				lockMode;	/**< LL_LOCK_xxx */
+	u_int32				chNbr;		/**< number of channels */
+	pthread_mutex_t		callLock;	/**< lock for LL_LOCK_CALL */
+	pthread_mutex_t		*chLock;	/**< locks for LL_LOCK_CHAN */
+	u_int32				useIrq;		/**< driver uses interrupt */
+	pthread_t			irqThread;	/**< interrupt thread */
+	volatile int32		irqRun;		/**< interrupt thread running */
+	volatile u_int32	irqEnabled;	/**< interrupt enabled */
+	volatile u_int32	irqCount;	/**< interrupt counter */
+} SIM_DEV;
+
+/** model kept over the last M_close() */
+typedef struct {
+	char				name[NAME_MAX_LEN];	/**< device name */
+	Z140_SIM			*sim;		/**< register block model (NULL=unused) */
+} SIM_HW;
+
+/** open path */
+typedef struct {
+	SIM_DEV				*dev;		/**< device (NULL=unused) */
+	int32				ch;			/**< current channel */
+} SIM_PATH;
+
+/*-----------------------------------------+
+|  GLOBALS                                 |
++-----------------------------------------*/
+static pthread_mutex_t	G_lock = PTHREAD_MUTEX_INITIALIZER;	/**< device/path tables */
+static SIM_DEV			*G_dev[DEV_MAX];
+static SIM_PATH			G_path[PATH_MAX_NBR];
+static SIM_HW			G_hw[HW_MAX];
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+static int32 DevInit(const char *device, SIM_DEV **devP);
+static void DevExit(SIM_DEV *dev);
+static SIM_PATH* GetPath(MDIS_PATH path);
+static void Lock(SIM_DEV *dev, int32 ch);
+static void Unlock(SIM_DEV *dev, int32 ch);
+static void* IrqThread(void *arg);
+static int32 Fail(int32 error);
+
+/********************************** M_open **********************************/
+/** Open a path to a device
+ *
+ *  \param device     \IN  device name
+ *
+ *  \return           path number or -1 on error (errno set)
+ */
+MDIS_PATH M_open(const char *device)
+{
+	SIM_DEV *dev = NULL;
+	int32 error = ERR_SUCCESS, i, p, freeIdx = -1;
+
+	pthread_mutex_lock(&G_lock);
+
+	for (p = 0; p < PATH_MAX_NBR && G_path[p].dev; p++)
+		;
+	if (p == PATH_MAX_NBR) {
+		error = ERR_MK_ILL_PATH;
+		goto EXIT;
+	}
+
+	for (i = 0; i < DEV_MAX; i++) {
+		if (G_dev[i] && !strcmp(G_dev[i]->name, device))
+			dev = G_dev[i];
+		else if (!G_dev[i] && freeIdx < 0)
+			freeIdx = i;
+	}
+
+	/* first open: initialize device */
+	if (!dev) {
+		if (freeIdx < 0) {
+			error = ERR_MK_NO_LLDESC;
+			goto EXIT;
+		}
+		if ((error = DevInit(device, &dev)))
+			goto EXIT;
+		G_dev[freeIdx] = dev;
+	}
+
+	dev->openCnt++;
+	G_path[p].dev = dev;
+	G_path[p].ch  = 0;
+
+ EXIT:
+	pthread_mutex_unlock(&G_lock);
+
+	if (error)
+		return (Fail(error));
+
+	return (p);
+}
+
+/********************************** M_close *********************************/
+/** Close a path
+ *
+ *  \param path       \IN  path number
+ *
+ *  \return           0 or -1 on error (errno set)
+ */
+int32 M_close(MDIS_PATH path)
+{
+	SIM_PATH *pa;
+	SIM_DEV *dev;
+	int32 i;
+
+	pthread_mutex_lock(&G_lock);
+
+	if ((pa = GetPath(path)) == NULL) {
+		pthread_mutex_unlock(&G_lock);
+		return (Fail(ERR_MK_ILL_PATH));
+	}
+
+	dev = pa->dev;
+	pa->dev = NULL;
+
+	/* last close: de-initialize device */
+	if (--dev->openCnt == 0) {
+		for (i = 0; i < DEV_MAX; i++) {
+			if (G_dev[i] == dev)
+				G_dev[i] = NULL;
+		}
+		DevExit(dev);
+	}
+
+	pthread_mutex_unlock(&G_lock);
+	return (0);
+}
+
+/********************************** M_read **********************************/
+/** Read a value from the current channel
+ *
+ *  \param path       \IN  path number
+ *  \param valueP     \OUT value
+ *
+ *  \return           0 or -1 on error (errno set)
+ */
+int32 M_read(MDIS_PATH path, int32 *valueP)
+{
+	SIM_PATH *pa = GetPath(path);
+	int32 error;
+
+	if (!pa)
+		return (Fail(ERR_MK_ILL_PATH));
+
+	Lock(pa->dev, pa->ch);
+	error = pa->dev->entry.read(pa->dev->llHdl, pa->ch, valueP);
+	Unlock(pa->dev, pa->ch);
+
+	return (error ? Fail(error) : 0);
+}
+
+/********************************** M_write *********************************/
+/** Write a value to the current channel
+ *
+ *  \param path       \IN  path number
+ *  \param value      \IN  value
+ *
+ *  \return           0 or -1 on error (errno set)
+ */
+int32 M_write(MDIS_PATH path, int32 value)
+{
+	SIM_PATH *pa = GetPath(path);
+	int32 error;
+
+	if (!pa)
+		return (Fail(ERR_MK_ILL_PATH));
+
+	Lock(pa->dev, pa->ch);
+	error = pa->dev->entry.write(pa->dev->llHdl, pa->ch, value);
+	Unlock(pa->dev, pa->ch);
+
+	return (error ? Fail(error) : 0);
+}
+
+/********************************** M_getstat *******************************/
+/** Get a status code
+ *
+ *  For block codes, dataP points to an M_SG_BLOCK structure.
+ *
+ *  \param path       \IN  path number
+ *  \param code       \IN  status code
+ *  \param dataP      \OUT value (or \IN M_SG_BLOCK for block codes)
+ *
+ *  \return           0 or -1 on error (errno set)
+ */
+int32 M_getstat(MDIS_PATH path, int32 code, int32 *dataP)
+{
+	SIM_PATH *pa = GetPath(path);
+	SIM_DEV *dev;
+	INT32_OR_64 value;
+	int32 error = ERR_SUCCESS;
+
+	if (!pa)
+		return (Fail(ERR_MK_ILL_PATH));
+	dev = pa->dev;
+
+	switch (code) {
+	case M_MK_NBR_CHAN:		*dataP = dev->chNbr;		break;
+	case M_MK_CH_CURRENT:	*dataP = pa->ch;			break;
+	case M_MK_IRQ_ENABLE:	*dataP = dev->irqEnabled;	break;
+	case M_MK_IRQ_COUNT:	*dataP = dev->irqCount;		break;
+	default:
+		if (code < M_LL_OF && code != M_MK_BLK_REV_ID) {
+			error = ERR_MK_UNK_CODE;
+			break;
+		}
+
+		Lock(dev, pa->ch);
+		if (M_IS_BLK(code))
+			error = dev->entry.getStat(dev->llHdl, code, pa->ch,
+									   (INT32_OR_64*)dataP);
+		else {
+			error = dev->entry.getStat(dev->llHdl, code, pa->ch, &value);
+			if (!error)
+				*dataP = (int32)value;
+		}
+		Unlock(dev, pa->ch);
+	}
+
+	return (error ? Fail(error) : 0);
+}
+
+/********************************** M_setstat *******************************/
+/** Set a status code
+ *
+ *  For block codes, data points to an M_SG_BLOCK structure.
+ *
+ *  \param path       \IN  path number
+ *  \param code       \IN  status code
+ *  \param data       \IN  value (or M_SG_BLOCK pointer for block codes)
+ *
+ *  \return           0 or -1 on error (errno set)
+ */
+int32 M_setstat(MDIS_PATH path, int32 code, INT32_OR_64 data)
+{
+	SIM_PATH *pa = GetPath(path);
+	SIM_DEV *dev;
+	int32 error = ERR_SUCCESS;
+
+	if (!pa)
+		return (Fail(ERR_MK_ILL_PATH));
+	dev = pa->dev;
+
+	switch (code) {
+	case M_MK_CH_CURRENT:
+		if (data < 0 || data >= (INT32_OR_64)dev->chNbr)
+			error = ERR_MK_ILL_PARAM;
+		else
+			pa->ch = (int32)data;
+		break;
+	case M_MK_IRQ_ENABLE:
+		Lock(dev, pa->ch);
+		error = dev->entry.setStat(dev->llHdl, M_LL_IRQ_ENABLE, pa->ch,
+								   data ? TRUE : FALSE);
+		Unlock(dev, pa->ch);
+		if (!error)
+			dev->irqEnabled = data ? TRUE : FALSE;
+		break;
+	default:
+		if (code < M_LL_OF) {
+			error = ERR_MK_UNK_CODE;
+			break;
+		}
+
+		Lock(dev, pa->ch);
+		error = dev->entry.setStat(dev->llHdl, code, pa->ch, data);
+		Unlock(dev, pa->ch);
+	}
+
+	return (error ? Fail(error) : 0);
+}
+
+/********************************** M_getblock ******************************/
+/** Read a data block from the device
+ *
+ *  \param path       \IN  path number
+ *  \param buffer     \OUT data
+ *  \param length     \IN  buffer size [bytes]
+ *
+ *  \return           number of bytes read or -1 on error (errno set)
+ */
+int32 M_getblock(MDIS_PATH path, u_int8 *buffer, int32 length)
+{
+	SIM_PATH *pa = GetPath(path);
+	int32 error, n = 0;
+
+	if (!pa)
+		return (Fail(ERR_MK_ILL_PATH));
+
+	Lock(pa->dev, pa->ch);
+	error = pa->dev->entry.blockRead(pa->dev->llHdl, pa->ch, buffer, length,
+									 &n);
+	Unlock(pa->dev, pa->ch);
+
+	return (error ? Fail(error) : n);
+}
+
+/********************************** M_setblock ******************************/
+/** Write a data block to the device
+ *
+ *  \param path       \IN  path number
+ *  \param buffer     \IN  data
+ *  \param length     \IN  data size [bytes]
+ *
+ *  \return           number of bytes written or -1 on error (errno set)
+ */
+int32 M_setblock(MDIS_PATH path, const u_int8 *buffer, int32 length)
+{
+	SIM_PATH *pa = GetPath(path);
+	int32 error, n = 0;
+
+	if (!pa)
+		return (Fail(ERR_MK_ILL_PATH));
+
+	Lock(pa->dev, pa->ch);
+	error = pa->dev->entry.blockWrite(pa->dev->llHdl, pa->ch, (void*)buffer,
+									  length, &n);
+	Unlock(pa->dev, pa->ch);
+
+	return (error ? Fail(error) : n);
+}
+
+/********************************** M_errstring *****************************/
+/** Get the error message of an error code
+ *
+ *  \param errCode    \IN  error code
+ *
+ *  \return           error message
+ */
+char* M_errstring(int32 errCode)
+{
+	return (UOS_ErrString(errCode));
+}
+
+/********************************** SIM_MDIS_Model **************************/
+/** Get the register block model of an open device (for tests)
+ *
+ *  \param device     \IN  device name
+ *
+ *  \return           model handle or NULL if the device is not open
+ */
+Z140_SIM* SIM_MDIS_Model(const char *device)
+{
+	Z140_SIM *sim = NULL;
+	int32 i;
+
+	pthread_mutex_lock(&G_lock);
+	for (i = 0; i < DEV_MAX; i++) {
+		if (G_dev[i] && !strcmp(G_dev[i]->name, device))
+			sim = G_dev[i]->sim;
+	}
+	pthread_mutex_unlock(&G_lock);
+
+	return (sim);
+}
+
+/********************************** DevInit *********************************/
+/** Initialize a simulated device
+ *
+ *  \param device     \IN  device name
+ *  \param devP       \OUT device
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 DevInit(const char *device, SIM_DEV **devP)
+{
+	SIM_DEV *dev;
+	DESC_HANDLE *descHdl;
+	char *file = getenv("Z140_SIM_DESC");
+	u_int32 tpHz = 0, inHz = 0, inDir = 0, rpSpeed = 1, rpLoop = 0, ch, i;
+	char replay[REPLAY_MAX_LEN] = "";
+	u_int32 len = sizeof(replay);
+	INT32_OR_64 value;
+	int32 error;
+
+	if ((dev = (SIM_DEV*)calloc(1, sizeof(*dev))) == NULL)
+		return (ERR_OSS_MEM_ALLOC);
+
+	strncpy(dev->name, device, NAME_MAX_LEN - 1);
+	pthread_mutex_init(&dev->callLock, NULL);
+
+	/* descriptor */
+	if (file && (error = DESC_SIM_Load(file, device, &dev->desc)))
+		goto CLEANUP;
+
+	if ((error = DESC_Init(dev->desc, NULL, &descHdl)))
+		goto CLEANUP;
+	DESC_GetUInt32(descHdl, 0, &tpHz, "SIM_TP_HZ");
+	DESC_GetUInt32(descHdl, 0, &inHz, "SIM_INPUT_HZ");
+	DESC_GetUInt32(descHdl, 0, &inDir, "SIM_INPUT_DIR");
+	DESC_GetString(descHdl, "", replay, &len, "SIM_REPLAY");
+	DESC_GetUInt32(descHdl, 1, &rpSpeed, "SIM_REPLAY_SPEED");
+	DESC_GetUInt32(descHdl, 0, &rpLoop, "SIM_REPLAY_LOOP");
+	DESC_GetUInt32(descHdl, FALSE, (u_int32*)&dev->irqEnabled, "IRQ_ENABLE");
+	DESC_Exit(&descHdl);
+
+	/* model: kept from a previous open or new */
+	for (i = 0; i < HW_MAX; i++) {
+		if (G_hw[i].sim && !strcmp(G_hw[i].name, dev->name)) {
+			dev->sim = G_hw[i].sim;
+			dev->simKept = TRUE;
+			break;
+		}
+	}
+	if (!dev->sim) {
+		if ((dev->sim = Z140_SIM_Create(tpHz)) == NULL) {
+			error = ERR_OSS_MEM_ALLOC;
+			goto CLEANUP;
+		}
+		if (inHz)
+			Z140_SIM_Input(dev->sim, 1000000000 / inHz, inDir);
+		if (*replay &&
+			(error = Z140_SIM_Replay(dev->sim, replay, rpSpeed, rpLoop)))
+			goto CLEANUP;
+
+		for (i = 0; i < HW_MAX; i++) {
+			if (!G_hw[i].sim) {
+				strcpy(G_hw[i].name, dev->name);
+				G_hw[i].sim = dev->sim;
+				dev->simKept = TRUE;
+				break;
+			}
+		}
+	}
+	dev->ma = Z140_SIM_Ma(dev->sim);
+
+	if ((error = OSS_SIM_IrqCreate(&dev->irqHdl)) ||
+		(error = OSS_SIM_SemCreate(&dev->devSem)))
+		goto CLEANUP;
+
+	/* driver */
+	LL_GetEntry(&dev->entry);
+	dev->lockMode = LL_LOCK_CALL;
+	dev->entry.info(LL_INFO_LOCKMODE, &dev->lockMode);
+	dev->entry.info(LL_INFO_IRQ, &dev->useIrq);
+
+	if ((error = dev->entry.init(dev->desc, NULL, &dev->ma, dev->devSem,
+								 dev->irqHdl, &dev->llHdl)))
+		goto CLEANUP;
+
+	if ((error = dev->entry.getStat(dev->llHdl, M_LL_CH_NUMBER, 0, &value)))
+		goto CLEANUP;
+	dev->chNbr = (u_int32)value;
+
+	if ((dev->chLock = (pthread_mutex_t*)calloc(dev->chNbr,
+		sizeof(pthread_mutex_t))) == NULL) {
+		error = ERR_OSS_MEM_ALLOC;
+		goto CLEANUP;
+	}
+	for (ch = 0; ch < dev->chNbr; ch++)
+		pthread_mutex_init(&dev->chLock[ch], NULL);
+
+	/* interrupt */
+	if (dev->irqEnabled &&
+		(error = dev->entry.setStat(dev->llHdl, M_LL_IRQ_ENABLE, 0, TRUE)))
+		goto CLEANUP;
+
+	if (dev->useIrq) {
+		dev->irqRun = TRUE;
+		if (pthread_create(&dev->irqThread, NULL, IrqThread, dev)) {
+			dev->irqRun = FALSE;
+			error = ERR_OSS_MEM_ALLOC;
+			goto CLEANUP;
+		}
+	}
+
+	*devP = dev;
+	return (ERR_SUCCESS);
+
+ CLEANUP:
+	DevExit(dev);
+	return (error);
+}
+
+/********************************** DevExit *********************************/
+/** De-initialize a simulated device
+ *
+ *  \param dev        \IN  device
+ */
+static void DevExit(SIM_DEV *dev)
+{
+	u_int32 ch;
+
+	if (dev->irqRun) {
+		dev->irqRun = FALSE;
+		pthread_join(dev->irqThread, NULL);
+	}
+
+	if (dev->llHdl)
+		dev->entry.exit(&dev->llHdl);
+
+	if (dev->chLock) {
+		for (ch = 0; ch < dev->chNbr; ch++)
+			pthread_mutex_destroy(&dev->chLock[ch]);
+		free(dev->chLock);
+	}
+
+	if (dev->devSem)
+		OSS_SIM_SemRemove(&dev->devSem);
+	if (dev->irqHdl)
+		OSS_SIM_IrqRemove(&dev->irqHdl);
+
+	if (!dev->simKept)
+		Z140_SIM_Destroy(&dev->sim);
+	DESC_SIM_Free(&dev->desc);
+	pthread_mutex_destroy(&dev->callLock);
+	free(dev);
+}
+
+/********************************** GetPath *********************************/
+/** Get an open path
+ *
+ *  \param path       \IN  path number
+ *
+ *  \return           path or NULL
+ */
+static SIM_PATH* GetPath(MDIS_PATH path)
+{
+	if (path < 0 || path >= PATH_MAX_NBR || !G_path[path].dev)
+		return (NULL);
+
+	return (&G_path[path]);
+}
+
+/********************************** Lock ************************************/
+/** Lock a driver call according to the driver's lock mode
+ *
+ *  \param dev        \IN  device
+ *  \param ch         \IN  channel of the path
+ */
+static void Lock(SIM_DEV *dev, int32 ch)
+{
+	if (dev->lockMode == LL_LOCK_CHAN)
+		pthread_mutex_lock(&dev->chLock[ch]);
+	else if (dev->lockMode == LL_LOCK_CALL)
+		pthread_mutex_lock(&dev->callLock);
+}
+
+/********************************** Unlock **********************************/
+/** Unlock a driver call
+ *
+ *  \param dev        \IN  device
+ *  \param ch         \IN  channel of the path
+ */
+static void Unlock(SIM_DEV *dev, int32 ch)
+{
+	if (dev->lockMode == LL_LOCK_CHAN)
+		pthread_mutex_unlock(&dev->chLock[ch]);
+	else if (dev->lockMode == LL_LOCK_CALL)
+		pthread_mutex_unlock(&dev->callLock);
+}
+
+/********************************** IrqThread *******************************/
+/** Interrupt emulation
+ *
+ *  Sleeps until the model asserts the interrupt (at most IRQ_POLL_NS to
+ *  notice irqRun and irqEnabled changes) and calls the driver's Irq routine
+ *  with the interrupt masked.
+ *
+ *  \param arg        \IN  device
+ *
+ *  \return           NULL
+ */
+static void* IrqThread(void *arg)
+{
+	SIM_DEV *dev = (SIM_DEV*)arg;
+	OSS_IRQ_STATE state;
+	u_int64 now, next;
+	struct timespec ts;
+
+	while (dev->irqRun) {
+		now  = OSS_SIM_TimeNs();
+		next = dev->ma->irqTime(dev->ma);
+
+		if (next == 0 && dev->irqEnabled) {
+			state = OSS_IrqMaskR(NULL, dev->irqHdl);
+			if (dev->entry.irq(dev->llHdl) == LL_IRQ_DEVICE)
+				dev->irqCount++;
+			OSS_IrqRestore(NULL, dev->irqHdl, state);
+
+			/* still asserted: don't flood the cpu */
+			if (dev->ma->irqTime(dev->ma) != 0)
+				continue;
+			next = now + IRQ_STORM_NS;
+		}
+		else if (next == 0)
+			next = now + IRQ_POLL_NS;
+
+		if (next > now + IRQ_POLL_NS)
+			next = now + IRQ_POLL_NS;
+
+		ts.tv_sec  = (time_t)(next / 1000000000);
+		ts.tv_nsec = (long)(next % 1000000000);
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+	}
+
+	return (NULL);
+}
+
+/********************************** Fail ************************************/
+/** Set errno to an MDIS error code
+ *
+ *  \param error      \IN  error code
+ *
+ *  \return           -1
+ */
+static int32 Fail(int32 error)
+{
+	UOS_ErrnoSet(error);
+	return (-1);
+}
@@ -0,0 +1,431 @@
+/*********************  P r o g r a m  -  M o d u l e ***********************/
+/*!
+ *        \file  sim_oss.c
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  OSS library for the host simulation
+ *
+ *               Implements the OSS functions used by the Z140 driver with
+ *               POSIX threads:
+ *               - interrupt masking: recursive mutex per device, also held
+ *                 by the kernel while the interrupt routine runs
+ *               - alarms: one thread per alarm, absolute CLOCK_MONOTONIC
+ *                 deadlines
+ *               - signals: kill() to the own process
+ *               - ticks: 1us resolution from CLOCK_MONOTONIC
+ *
+ *     Required: pthread
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*-----------------------------------------+
+|  INCLUDES                                |
++-----------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_err.h>
+#include <MEN/oss.h>
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/** interrupt handle */
+struct OSS_IRQ_HANDLE {
+	pthread_mutex_t		lock;		/**< recursive mask lock */
+};
+
+/** semaphore handle */
+struct OSS_SEM_HANDLE {
+	sem_t				sem;		/**< binary semaphore */
+};
+
+/** signal handle */
+struct OSS_SIG_HANDLE {
+	pid_t				pid;		/**< process to signal */
+	int32				signo;		/**< signal number */
+};
+
+/** alarm handle */
+struct OSS_ALARM_HANDLE {
+	pthread_t			thread;		/**< alarm thread */
+	pthread_mutex_t		lock;		/**< protects the fields below */
+	pthread_cond_t		cond;		/**< wakes the alarm thread */
+	void				(*funct)(void *arg);	/**< alarm routine */
+	void				*arg;		/**< argument of the alarm routine */
+	u_int64				periodNs;	/**< alarm period [ns] */
+	u_int64				next;		/**< next expiration [ns] */
+	u_int32				cyclic;		/**< cyclic alarm */
+	u_int32				active;		/**< alarm set */
+	u_int32				quit;		/**< terminate thread */
+};
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+static void* AlarmThread(void *arg);
+static void NsToTs(u_int64 ns, struct timespec *ts);
+
+/******************************** OSS_Ident *********************************/
+/** Return ident string
+ *
+ *  \return           pointer to ident string
+ */
+char* OSS_Ident(void)
+{
+	return ("OSS - host simulation");
+}
+
+/******************************** OSS_SIM_TimeNs ****************************/
+/** Get monotonic time
+ *
+ *  \return           CLOCK_MONOTONIC [ns]
+ */
+u_int64 OSS_SIM_TimeNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((u_int64)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+/*-----------------------------------------+
+|  memory                                  |
++-----------------------------------------*/
+void* OSS_MemGet(OSS_HANDLE *osHdl, u_int32 size, u_int32 *gotsizeP)
+{
+	void *mem = malloc(size);
+
+	*gotsizeP = mem ? size : 0;
+	return (mem);
+}
+
+int32 OSS_MemFree(OSS_HANDLE *osHdl, void *addr, u_int32 size)
+{
+	free(addr);
+	return (ERR_SUCCESS);
+}
+
+void OSS_MemFill(OSS_HANDLE *osHdl, u_int32 size, char *adr, int8 value)
+{
+	memset(adr, value, size);
+}
+
+void OSS_MemCopy(OSS_HANDLE *osHdl, u_int32 size, char *src, char *dest)
+{
+	memcpy(dest, src, size);
+}
+
+char* OSS_StrCpy(OSS_HANDLE *osHdl, char *from, char *to)
+{
+	return (strcpy(to, from));
+}
+
+/*-----------------------------------------+
+|  ticks                                   |
++-----------------------------------------*/
+u_int32 OSS_TickGet(OSS_HANDLE *osHdl)
+{
+	return ((u_int32)(OSS_SIM_TimeNs() / (1000000000 / OSS_TICK_RATE)));
+}
+
+u_int32 OSS_TickRateGet(OSS_HANDLE *osHdl)
+{
+	return (OSS_TICK_RATE);
+}
+
+/*-----------------------------------------+
+|  process id                              |
++-----------------------------------------*/
+/* like the Linux kernel (current->pid): id of the calling thread */
+u_int32 OSS_GetPid(OSS_HANDLE *osHdl)
+{
+	return ((u_int32)syscall(SYS_gettid));
+}
+
+/*-----------------------------------------+
+|  interrupt masking                       |
++-----------------------------------------*/
+int32 OSS_SIM_IrqCreate(OSS_IRQ_HANDLE **irqP)
+{
+	OSS_IRQ_HANDLE *irq;
+	pthread_mutexattr_t attr;
+
+	if ((irq = (OSS_IRQ_HANDLE*)malloc(sizeof(*irq))) == NULL)
+		return (ERR_OSS_MEM_ALLOC);
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&irq->lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+
+	*irqP = irq;
+	return (ERR_SUCCESS);
+}
+
+void OSS_SIM_IrqRemove(OSS_IRQ_HANDLE **irqP)
+{
+	if (*irqP) {
+		pthread_mutex_destroy(&(*irqP)->lock);
+		free(*irqP);
+		*irqP = NULL;
+	}
+}
+
+OSS_IRQ_STATE OSS_IrqMaskR(OSS_HANDLE *osHdl, OSS_IRQ_HANDLE *irqHdl)
+{
+	pthread_mutex_lock(&irqHdl->lock);
+	return (0);
+}
+
+void OSS_IrqRestore(OSS_HANDLE *osHdl, OSS_IRQ_HANDLE *irqHdl,
+					OSS_IRQ_STATE oldState)
+{
+	pthread_mutex_unlock(&irqHdl->lock);
+}
+
+/*-----------------------------------------+
+|  semaphores                              |
++-----------------------------------------*/
+int32 OSS_SIM_SemCreate(OSS_SEM_HANDLE **semP)
+{
+	OSS_SEM_HANDLE *sem;
+
+	if ((sem = (OSS_SEM_HANDLE*)malloc(sizeof(*sem))) == NULL)
+		return (ERR_OSS_MEM_ALLOC);
+
+	sem_init(&sem->sem, 0, 1);
+
+	*semP = sem;
+	return (ERR_SUCCESS);
+}
+
+void OSS_SIM_SemRemove(OSS_SEM_HANDLE **semP)
+{
+	if (*semP) {
+		sem_destroy(&(*semP)->sem);
+		free(*semP);
+		*semP = NULL;
+	}
+}
+
+int32 OSS_SemWait(OSS_HANDLE *osHdl, OSS_SEM_HANDLE *sem, int32 msec)
+{
+	struct timespec ts;
+	int rv;
+
+	if (msec == OSS_SEM_WAITINFINITE) {
+		while ((rv = sem_wait(&sem->sem)) < 0 && errno == EINTR)
+			;
+	}
+	else {
+		clock_gettime(CLOCK_REALTIME, &ts);
+		NsToTs((u_int64)ts.tv_sec * 1000000000 + ts.tv_nsec +
+			   (u_int64)msec * 1000000, &ts);
+		while ((rv = sem_timedwait(&sem->sem, &ts)) < 0 && errno == EINTR)
+			;
+	}
+
+	return (rv < 0 ? ERR_OSS_TIMEOUT : ERR_SUCCESS);
+}
+
+int32 OSS_SemSignal(OSS_HANDLE *osHdl, OSS_SEM_HANDLE *sem)
+{
+	sem_post(&sem->sem);
+	return (ERR_SUCCESS);
+}
+
+/*-----------------------------------------+
+|  signals                                 |
++-----------------------------------------*/
+int32 OSS_SigCreate(OSS_HANDLE *osHdl, int32 value, OSS_SIG_HANDLE **sigP)
+{
+	OSS_SIG_HANDLE *sig;
+
+	if (!IN_RANGE(value, 1, SIGRTMAX))
+		return (ERR_OSS_ILL_PARAM);
+
+	if ((sig = (OSS_SIG_HANDLE*)malloc(sizeof(*sig))) == NULL)
+		return (ERR_OSS_MEM_ALLOC);
+
+	sig->pid = getpid();
+	sig->signo = value;
+
+	*sigP = sig;
+	return (ERR_SUCCESS);
+}
+
+int32 OSS_SigSend(OSS_HANDLE *osHdl, OSS_SIG_HANDLE *sig)
+{
+	return (kill(sig->pid, sig->signo) < 0 ? ERR_OSS_SIG_SET : ERR_SUCCESS);
+}
+
+int32 OSS_SigRemove(OSS_HANDLE *osHdl, OSS_SIG_HANDLE **sigP)
+{
+	free(*sigP);
+	*sigP = NULL;
+	return (ERR_SUCCESS);
+}
+
+/*-----------------------------------------+
+|  alarms                                  |
++-----------------------------------------*/
+int32 OSS_AlarmCreate(OSS_HANDLE *osHdl, void (*funct)(void *arg), void *arg,
+					  OSS_ALARM_HANDLE **alarmP)
+{
+	OSS_ALARM_HANDLE *alarm;
+	pthread_condattr_t attr;
+
+	if ((alarm = (OSS_ALARM_HANDLE*)calloc(1, sizeof(*alarm))) == NULL)
+		return (ERR_OSS_MEM_ALLOC);
+
+	alarm->funct = funct;
+	alarm->arg   = arg;
+
+	pthread_mutex_init(&alarm->lock, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&alarm->cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	if (pthread_create(&alarm->thread, NULL, AlarmThread, alarm)) {
+		pthread_cond_destroy(&alarm->cond);
+		pthread_mutex_destroy(&alarm->lock);
+		free(alarm);
+		return (ERR_OSS_ALARM_CREATE);
+	}
+
+	*alarmP = alarm;
+	return (ERR_SUCCESS);
+}
+
+int32 OSS_AlarmRemove(OSS_HANDLE *osHdl, OSS_ALARM_HANDLE **alarmP)
+{
+	OSS_ALARM_HANDLE *alarm = *alarmP;
+
+	pthread_mutex_lock(&alarm->lock);
+	alarm->quit = TRUE;
+	pthread_cond_signal(&alarm->cond);
+	pthread_mutex_unlock(&alarm->lock);
+
+	pthread_join(alarm->thread, NULL);
+	pthread_cond_destroy(&alarm->cond);
+	pthread_mutex_destroy(&alarm->lock);
+	free(alarm);
+
+	*alarmP = NULL;
+	return (ERR_SUCCESS);
+}
+
+int32 OSS_AlarmSet(OSS_HANDLE *osHdl, OSS_ALARM_HANDLE *alarm, u_int32 msec,
+				   u_int32 cyclic, u_int32 *realMsecP)
+{
+	if (!msec)
+		return (ERR_OSS_ILL_PARAM);
+
+	pthread_mutex_lock(&alarm->lock);
+	alarm->periodNs = (u_int64)msec * 1000000;
+	alarm->next     = OSS_SIM_TimeNs() + alarm->periodNs;
+	alarm->cyclic   = cyclic;
+	alarm->active   = TRUE;
+	pthread_cond_signal(&alarm->cond);
+	pthread_mutex_unlock(&alarm->lock);
+
+	*realMsecP = msec;
+	return (ERR_SUCCESS);
+}
+
+int32 OSS_AlarmClear(OSS_HANDLE *osHdl, OSS_ALARM_HANDLE *alarm)
+{
+	pthread_mutex_lock(&alarm->lock);
+	alarm->active = FALSE;
+	pthread_cond_signal(&alarm->cond);
+	pthread_mutex_unlock(&alarm->lock);
+
+	return (ERR_SUCCESS);
+}
+
+/******************************** AlarmThread *******************************/
+/** Alarm thread: call the alarm routine at the expiration times
+ *
+ *  \param arg        \IN  alarm handle
+ *
+ *  \return           NULL
+ */
+static void* AlarmThread(void *arg)
+{
+	OSS_ALARM_HANDLE *alarm = (OSS_ALARM_HANDLE*)arg;
+	struct timespec ts;
+	u_int64 now;
+
+	pthread_mutex_lock(&alarm->lock);
+
+	while (!alarm->quit) {
+		if (!alarm->active) {
+			pthread_cond_wait(&alarm->cond, &alarm->lock);
+			continue;
+		}
+
+		/* wait for expiration (or clear/remove) */
+		now = OSS_SIM_TimeNs();
+		if (now < alarm->next) {
+			NsToTs(alarm->next, &ts);
+			pthread_cond_timedwait(&alarm->cond, &alarm->lock, &ts);
+			continue;
+		}
+
+		if (alarm->cyclic) {
+			alarm->next += alarm->periodNs;
+			/* overrun: skip missed expirations */
+			if (alarm->next < now)
+				alarm->next = now + alarm->periodNs;
+		}
+		else
+			alarm->active = FALSE;
+
+		pthread_mutex_unlock(&alarm->lock);
+		alarm->funct(alarm->arg);
+		pthread_mutex_lock(&alarm->lock);
+	}
+
+	pthread_mutex_unlock(&alarm->lock);
+	return (NULL);
+}
+
+/******************************** NsToTs ************************************/
+/** Convert time [ns] to timespec
+ *
+ *  \param ns         \IN  time [ns]
+ *  \param ts         \OUT timespec
+ */
+static void NsToTs(u_int64 ns, struct timespec *ts)
+{
+	ts->tv_sec  = ns / 1000000000;
+	ts->tv_nsec = ns % 1000000000;
+}
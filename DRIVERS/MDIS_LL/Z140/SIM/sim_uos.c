@@ -0,0 +1,240 @@
+/*********************  P r o g r a m  -  M o d u l e ***********************/
+/*!
+ *        \file  sim_uos.c
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  USR_OSS and USR_UTL libraries for the host simulation
+ *
+ *     Required: -
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*-----------------------------------------+
+|  INCLUDES                                |
++-----------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <termios.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_err.h>
+#include <MEN/oss.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/** error message */
+typedef struct {
+	int32		code;		/**< error code */
+	const char	*msg;		/**< message */
+} ERR_MSG;
+
+/*-----------------------------------------+
+|  GLOBALS                                 |
++-----------------------------------------*/
+static const ERR_MSG G_errMsg[] = {
+	{ ERR_OSS_MEM_ALLOC,		"OSS: can't allocate memory" },
+	{ ERR_OSS_ILL_PARAM,		"OSS: illegal parameter" },
+	{ ERR_OSS_TIMEOUT,			"OSS: timeout" },
+	{ ERR_OSS_ALARM_CREATE,		"OSS: can't create alarm" },
+	{ ERR_OSS_SIG_SET,			"OSS: signal already installed" },
+	{ ERR_OSS_SIG_CLR,			"OSS: signal not installed" },
+	{ ERR_DESC_KEY_NOTFOUND,	"DESC: descriptor key not found" },
+	{ ERR_DESC_ILL_PARAM,		"DESC: illegal descriptor parameter" },
+	{ ERR_LL_ILL_PARAM,			"LL: illegal parameter" },
+	{ ERR_LL_ILL_CHAN,			"LL: illegal channel" },
+	{ ERR_LL_ILL_DIR,			"LL: illegal direction" },
+	{ ERR_LL_UNK_CODE,			"LL: unknown status code" },
+	{ ERR_LL_USERBUF,			"LL: user buffer too small" },
+	{ ERR_LL_ILL_FUNC,			"LL: function not supported" },
+	{ ERR_LL_READ,				"LL: read error" },
+	{ ERR_LL_DEV_BUSY,			"LL: device busy" },
+	{ ERR_MK_ILL_PARAM,			"MK: illegal parameter" },
+	{ ERR_MK_NO_LLDESC,			"MK: device not found in descriptor" },
+	{ ERR_MK_UNK_CODE,			"MK: unknown status code" },
+	{ ERR_MK_ILL_PATH,			"MK: illegal path" },
+	{ 0, NULL }
+};
+
+/*-----------------------------------------+
+|  USR_OSS                                 |
++-----------------------------------------*/
+void UOS_Delay(u_int32 msec)
+{
+	struct timespec ts;
+
+	ts.tv_sec  = msec / 1000;
+	ts.tv_nsec = (msec % 1000) * 1000000L;
+	while (nanosleep(&ts, &ts) && errno == EINTR)
+		;
+}
+
+int32 UOS_KeyPressed(void)
+{
+	struct termios old, raw;
+	unsigned char c;
+	int32 key = -1;
+
+	if (!isatty(STDIN_FILENO))
+		return (-1);
+
+	/* non-blocking, non-canonical read */
+	tcgetattr(STDIN_FILENO, &old);
+	raw = old;
+	raw.c_lflag &= ~(ICANON | ECHO);
+	raw.c_cc[VMIN]  = 0;
+	raw.c_cc[VTIME] = 0;
+	tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+
+	if (read(STDIN_FILENO, &c, 1) == 1)
+		key = c;
+
+	tcsetattr(STDIN_FILENO, TCSANOW, &old);
+	return (key);
+}
+
+int32 UOS_KeyWait(void)
+{
+	int c = getchar();
+
+	return (c == EOF ? -1 : c);
+}
+
+u_int32 UOS_ErrnoGet(void)
+{
+	return (errno);
+}
+
+u_int32 UOS_ErrnoSet(u_int32 errCode)
+{
+	errno = (int)errCode;
+	return (errCode);
+}
+
+u_int32 UOS_MsecTimerGet(void)
+{
+	return ((u_int32)(OSS_SIM_TimeNs() / 1000000));
+}
+
+char* UOS_ErrString(int32 errCode)
+{
+	static __thread char buf[80];
+	const ERR_MSG *e;
+
+	for (e = G_errMsg; e->msg; e++) {
+		if (e->code == errCode) {
+			snprintf(buf, sizeof(buf), "ERROR (0x%04x): %s", errCode, e->msg);
+			return (buf);
+		}
+	}
+
+	if (errCode > ERR_DEV && errCode < ERR_DEV + 0x100)
+		snprintf(buf, sizeof(buf), "ERROR (0x%04x): device specific error",
+				 errCode);
+	else if (errCode < ERR_OSS)
+		snprintf(buf, sizeof(buf), "ERROR (0x%04x): %s", errCode,
+				 strerror(errCode));
+	else
+		snprintf(buf, sizeof(buf), "ERROR (0x%04x): unknown error", errCode);
+
+	return (buf);
+}
+
+/*-----------------------------------------+
+|  USR_UTL                                 |
++-----------------------------------------*/
+/******************************* UTL_Tstopt *********************************/
+/** Test for an option "-x" or "-x=value"
+ *
+ *  \param argc       \IN  argument count
+ *  \param argv       \IN  arguments
+ *  \param option     \IN  option letter with '=' for value options ("x=")
+ *  \param buf        \OUT option value (or NULL)
+ *
+ *  \return           option value ("" for flags) or NULL if not set
+ */
+char* UTL_Tstopt(int argc, char **argv, char *option, char *buf)
+{
+	int i, hasVal = (option[1] == '=');
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] != '-' || argv[i][1] != option[0])
+			continue;
+
+		if (hasVal && argv[i][2] == '=') {
+			if (buf) {
+				strcpy(buf, argv[i] + 3);
+				return (buf);
+			}
+			return (argv[i] + 3);
+		}
+		if (!hasVal && argv[i][2] == '\0')
+			return ("");
+	}
+
+	return (NULL);
+}
+
+/******************************* UTL_Illiopt ********************************/
+/** Check for illegal options
+ *
+ *  \param argc       \IN  argument count
+ *  \param argv       \IN  arguments
+ *  \param opts       \IN  legal options (e.g. "ab=c=?")
+ *  \param buf        \OUT illegal option (or NULL)
+ *
+ *  \return           illegal option or NULL
+ */
+char* UTL_Illiopt(int argc, char **argv, char *opts, char *buf)
+{
+	char *o;
+	int i, ok;
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] != '-')
+			continue;
+
+		ok = FALSE;
+		for (o = opts; *o && !ok; o++) {
+			if (*o == '=' || *o != argv[i][1])
+				continue;
+			if (o[1] == '=')
+				ok = (argv[i][2] == '=');
+			else
+				ok = (argv[i][2] == '\0');
+		}
+
+		if (!ok) {
+			if (buf) {
+				strcpy(buf, argv[i]);
+				return (buf);
+			}
+			return (argv[i]);
+		}
+	}
+
+	return (NULL);
+}
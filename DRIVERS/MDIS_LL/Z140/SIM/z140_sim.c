@@ -0,0 +1,784 @@
+/*********************  P r o g r a m  -  M o d u l e ***********************/
+/*!
+ *        \file  z140_sim.c
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  Behavioral model of the 16Z140 register block
+ *
+ *               The model generates two quadrature signals (A leads B by
+ *               90 degrees in forward direction) either from the test
+ *               pattern generator (COMMAND register) or from the simulated
+ *               sensor input (Z140_SIM_Input()). The state is evaluated
+ *               lazily on each register access from CLOCK_MONOTONIC, so
+ *               the model needs no thread and no CPU while idle.
+ *
+ *               Modelled behavior:
+ *               - PERIOD_A/B: the period between two rising edges of the
+ *                 signal is reported with NEW and VLD. NEW is cleared when
+ *                 the register is read. Without rising edge within the
+ *                 measurement timeout, NEW is reported without VLD.
+ *                 LSTS is set if the phase between A and B is shorter
+ *                 than the debounce time. Signals with a phase length
+ *                 (half period) below the debounce time are filtered.
+ *               - DISTANCE_FWD/BWD: count the rising edges of signal A in
+ *                 the detected direction. COMMAND RST_DIST clears them.
+ *               - STATUS: ROLLING if an edge occurred within the rolling
+ *                 time, STANDSTILL if none within the standstill time,
+ *                 DIR_FWD/BWD if the direction was detected within the
+ *                 direction detection timeout, otherwise DIR_INVALID.
+ *               - COMMAND: test pattern generator CW (forward), CCW
+ *                 (backward) and SILENT (no edges) with a fixed frequency.
+ *               - Torn reads (Z140_SIM_Tear()): a forward pulse is counted
+ *                 right after each of the next reads of DISTANCE_FWD, as
+ *                 if the sensor moved between two register reads.
+ *
+ *               In replay mode (Z140_SIM_Replay()), the signal model is
+ *               replaced by a recorded trace: PERIOD_A/B, DISTANCE_FWD/BWD
+ *               and STATUS report the values of the record due at the
+ *               (optionally accelerated) replay time. A pending NEW flag
+ *               is kept until read, COMMAND RST_DIST clears the distances
+ *               relative to the trace, the test pattern has no effect.
+ *
+ *     Required: pthread
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*-----------------------------------------+
+|  INCLUDES                                |
++-----------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_err.h>
+#include <MEN/maccess.h>
+#include <MEN/oss.h>
+#include <MEN/z140_reg.h>
+#include <MEN/z140_drv.h>
+#include <MEN/z140_zrec.h>
+#include "z140_sim.h"
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+#define NS_NONE		((u_int64)-1)	/**< no time */
+#define RP_ALLOC	4096			/**< replay records allocation step */
+
+/* register value to [ns] */
+#define DEB_NS(sim)			((u_int64)(sim)->debTime * 1000)
+#define MEAS_TOUT_NS(sim)	((u_int64)(sim)->measTout * 100000000)
+#define TIME10_NS(reg)		((u_int64)(reg) * 10000000)
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/** replay record (register values at a trace time) */
+typedef struct {
+	u_int64			t;				/**< time since first record [ns] */
+	u_int32			period[2];		/**< PERIOD_A/B */
+	u_int32			dist[2];		/**< DISTANCE_FWD/BWD */
+	u_int32			status;			/**< STATUS */
+} SIM_RP_REC;
+
+/** model state */
+struct Z140_SIM {
+	SIM_MA			ma;				/**< register block interface (first) */
+	pthread_mutex_t	lock;			/**< serializes register accesses */
+	/* registers */
+	u_int32			debTime;		/**< DEB_TIME [us] */
+	u_int32			measTout;		/**< MEAS_TOUT [100ms] */
+	u_int32			rollingTime;	/**< ROLLING_TIME [10ms] */
+	u_int32			standstillTime;	/**< STANDSTILL_TIME [10ms] */
+	u_int32			dirDetTout;		/**< DIR_DET_TOUT [10ms] */
+	u_int32			command;		/**< COMMAND (without RST_DIST) */
+	u_int32			period[2];		/**< PERIOD_A/B */
+	u_int32			dist[2];		/**< DISTANCE_FWD/BWD */
+	u_int32			tear;			/**< DISTANCE_FWD reads followed by a pulse */
+	/* inputs */
+	u_int64			tpPeriod;		/**< test pattern period [ns] */
+	u_int64			inPeriod;		/**< sensor input period [ns] (0=none) */
+	u_int32			inBwd;			/**< sensor input direction backward */
+	/* active signal source */
+	u_int64			srcPeriod;		/**< period [ns] (0=no edges) */
+	u_int32			srcBwd;			/**< direction backward */
+	u_int64			origin;			/**< phase origin [ns] */
+	u_int64			t;				/**< model evaluated up to [ns] */
+	/* measurement state */
+	u_int64			measRef[2];		/**< last rising edge or measurement start */
+	u_int32			measValid[2];	/**< measRef is a rising edge */
+	u_int32			toutDone[2];	/**< timeout reported since measRef */
+	u_int64			lastEdge;		/**< last edge of A or B (NS_NONE: none) */
+	u_int64			dirTime;		/**< last direction detection (NS_NONE: none) */
+	u_int32			dirBwd;			/**< detected direction backward */
+	/* replay */
+	SIM_RP_REC		*rp;			/**< trace records (NULL=no replay) */
+	u_int32			rpNum;			/**< number of trace records */
+	u_int32			rpIdx;			/**< current record */
+	u_int32			rpSpeed;		/**< speed factor */
+	u_int32			rpLoop;			/**< restart at the end of the trace */
+	u_int64			rpLoopNs;		/**< replay time of one loop [ns] */
+	u_int64			rpStart;		/**< time of the first record [ns] */
+	u_int32			rpDistBase[2];	/**< trace distances at the last reset */
+	u_int32			rpStatus;		/**< STATUS of the current record */
+};
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+static u_int32 SimRead(SIM_MA *ma, u_int32 offs);
+static void SimWrite(SIM_MA *ma, u_int32 offs, u_int32 val);
+static u_int64 SimIrqTime(SIM_MA *ma);
+static u_int64 RiseOffs(Z140_SIM *sim, u_int32 s);
+static u_int64 Rises(Z140_SIM *sim, u_int32 s, u_int64 t);
+static void Advance(Z140_SIM *sim, u_int64 now);
+static void UpdateSource(Z140_SIM *sim, u_int64 now);
+static u_int32 Status(Z140_SIM *sim, u_int64 now);
+static int32 ReplayLoad(Z140_SIM *sim, const char *file);
+static int32 ReplayAdd(Z140_SIM *sim, const Z140_SNAPSHOT *snap, u_int64 *t0P);
+static void ReplayApply(Z140_SIM *sim, u_int32 idx);
+static void ReplayAdvance(Z140_SIM *sim, u_int64 now);
+static u_int64 ReplayNext(Z140_SIM *sim);
+
+/******************************* Z140_SIM_Create ****************************/
+/** Create a model instance
+ *
+ *  \param tpHz       \IN  test pattern frequency [Hz] (0=default)
+ *
+ *  \return           model handle or NULL
+ */
+Z140_SIM* Z140_SIM_Create(u_int32 tpHz)
+{
+	Z140_SIM *sim;
+	u_int64 now = OSS_SIM_TimeNs();
+
+	if ((sim = (Z140_SIM*)calloc(1, sizeof(*sim))) == NULL)
+		return (NULL);
+
+	sim->ma.read    = SimRead;
+	sim->ma.write   = SimWrite;
+	sim->ma.irqTime = SimIrqTime;
+	pthread_mutex_init(&sim->lock, NULL);
+
+	sim->tpPeriod   = 1000000000 / (tpHz ? tpHz : Z140_SIM_TP_HZ_DEF);
+	sim->origin     = now;
+	sim->t          = now;
+	sim->measRef[0] = now;
+	sim->measRef[1] = now;
+	sim->lastEdge   = NS_NONE;
+	sim->dirTime    = NS_NONE;
+
+	return (sim);
+}
+
+/******************************* Z140_SIM_Destroy ***************************/
+/** Destroy a model instance
+ *
+ *  \param simP       \IN  model handle
+ *                    \OUT NULL
+ */
+void Z140_SIM_Destroy(Z140_SIM **simP)
+{
+	if (*simP) {
+		pthread_mutex_destroy(&(*simP)->lock);
+		free((*simP)->rp);
+		free(*simP);
+		*simP = NULL;
+	}
+}
+
+/******************************* Z140_SIM_Ma ********************************/
+/** Get the hw access handle of a model instance
+ *
+ *  \param sim        \IN  model handle
+ *
+ *  \return           hw access handle for MREAD_D32/MWRITE_D32
+ */
+MACCESS Z140_SIM_Ma(Z140_SIM *sim)
+{
+	return (&sim->ma);
+}
+
+/******************************* Z140_SIM_Input *****************************/
+/** Set the simulated sensor input (used while the test pattern is off)
+ *
+ *  \param sim        \IN  model handle
+ *  \param periodNs   \IN  signal period [ns] (0=no edges)
+ *  \param bwd        \IN  0=forward, 1=backward
+ */
+void Z140_SIM_Input(Z140_SIM *sim, u_int32 periodNs, u_int32 bwd)
+{
+	pthread_mutex_lock(&sim->lock);
+	sim->inPeriod = periodNs;
+	sim->inBwd    = bwd ? TRUE : FALSE;
+	UpdateSource(sim, OSS_SIM_TimeNs());
+	pthread_mutex_unlock(&sim->lock);
+}
+
+/******************************* Z140_SIM_Replay ****************************/
+/** Replay a recorded trace instead of the signal model
+ *
+ *  The trace is a file of binary Z140_SNAPSHOT records of the current
+ *  Z140_SNAPSHOT_VER (e.g. z140_ctrl -F=bin) or a compact recording
+ *  (z140_zrec.h, e.g. z140_ctrl -F=zrec). It is loaded completely and the
+ *  replay starts immediately with the first record.
+ *
+ *  \param sim        \IN  model handle
+ *  \param file       \IN  trace file
+ *  \param speed      \IN  speed factor (0/1=original speed)
+ *  \param loop       \IN  restart at the end of the trace (otherwise the
+ *                         last record is kept)
+ *
+ *  \return           \c 0 on success or error code
+ */
+int32 Z140_SIM_Replay(Z140_SIM *sim, const char *file, u_int32 speed,
+					  u_int32 loop)
+{
+	int32 error;
+
+	pthread_mutex_lock(&sim->lock);
+
+	if ((error = ReplayLoad(sim, file)) == ERR_SUCCESS) {
+		sim->rpSpeed = speed ? speed : 1;
+		/* trace duration plus one mean record period */
+		if (sim->rpNum > 1)
+			sim->rpLoopNs = (sim->rp[sim->rpNum - 1].t +
+							 sim->rp[sim->rpNum - 1].t / (sim->rpNum - 1)) /
+							sim->rpSpeed;
+		else
+			sim->rpLoopNs = 0;
+		sim->rpLoop  = (loop && sim->rpLoopNs) ? TRUE : FALSE;
+		sim->rpStart = OSS_SIM_TimeNs();
+		sim->rpDistBase[0] = sim->rpDistBase[1] = 0;
+		sim->period[0] = sim->period[1] = 0;
+		ReplayApply(sim, 0);
+		sim->t = sim->rpStart;
+	}
+
+	pthread_mutex_unlock(&sim->lock);
+	return (error);
+}
+
+/******************************* Z140_SIM_Tear ******************************/
+/** Let the forward distance move between register reads
+ *
+ *  After each of the next reads of DISTANCE_FWD, the register counts one
+ *  forward pulse, so a re-read returns a different value.
+ *
+ *  \param sim        \IN  model handle
+ *  \param reads      \IN  number of torn reads (0=off)
+ */
+void Z140_SIM_Tear(Z140_SIM *sim, u_int32 reads)
+{
+	pthread_mutex_lock(&sim->lock);
+	sim->tear = reads;
+	pthread_mutex_unlock(&sim->lock);
+}
+
+/******************************* SimRead ************************************/
+/** Read a register
+ *
+ *  \param ma         \IN  hw access handle
+ *  \param offs       \IN  register offset
+ *
+ *  \return           register value
+ */
+static u_int32 SimRead(SIM_MA *ma, u_int32 offs)
+{
+	Z140_SIM *sim = (Z140_SIM*)ma;
+	u_int64 now;
+	u_int32 val;
+
+	pthread_mutex_lock(&sim->lock);
+	now = OSS_SIM_TimeNs();
+	Advance(sim, now);
+
+	switch (offs) {
+	case Z140R_DEB_TIME:		val = sim->debTime;			break;
+	case Z140R_MEAS_TOUT:		val = sim->measTout;		break;
+	case Z140R_ROLLING_TIME:	val = sim->rollingTime;		break;
+	case Z140R_STANDSTILL_TIME:	val = sim->standstillTime;	break;
+	case Z140R_DIR_DET_TOUT:	val = sim->dirDetTout;		break;
+	case Z140R_DISTANCE_FWD:
+		val = sim->dist[0];
+		if (sim->tear) {
+			sim->tear--;
+			sim->dist[0]++;
+		}
+		break;
+	case Z140R_DISTANCE_BWD:	val = sim->dist[1];			break;
+	case Z140R_STATUS:			val = Status(sim, now);		break;
+	case Z140R_COMMAND:			val = sim->command;			break;
+	case Z140R_PERIOD_A:
+	case Z140R_PERIOD_B:
+		/* reading clears NEW */
+		val = sim->period[offs == Z140R_PERIOD_B];
+		sim->period[offs == Z140R_PERIOD_B] &= ~Z140R_PERIOD_NEW;
+		break;
+	default:
+		val = 0xffffffff;
+	}
+
+	pthread_mutex_unlock(&sim->lock);
+	return (val);
+}
+
+/******************************* SimWrite ***********************************/
+/** Write a register
+ *
+ *  \param ma         \IN  hw access handle
+ *  \param offs       \IN  register offset
+ *  \param val        \IN  value
+ */
+static void SimWrite(SIM_MA *ma, u_int32 offs, u_int32 val)
+{
+	Z140_SIM *sim = (Z140_SIM*)ma;
+	u_int64 now;
+
+	pthread_mutex_lock(&sim->lock);
+	now = OSS_SIM_TimeNs();
+	Advance(sim, now);
+
+	switch (offs) {
+	case Z140R_DEB_TIME:
+		sim->debTime = val & 0xff;
+		UpdateSource(sim, now);
+		break;
+	case Z140R_MEAS_TOUT:		sim->measTout = val & 0xff;			break;
+	case Z140R_ROLLING_TIME:	sim->rollingTime = val & 0xff;		break;
+	case Z140R_STANDSTILL_TIME:	sim->standstillTime = val & 0xff;	break;
+	case Z140R_DIR_DET_TOUT:	sim->dirDetTout = val & 0xff;		break;
+	case Z140R_COMMAND:
+		if (val & Z140R_CMD_RST_DIST) {
+			sim->dist[0] = sim->dist[1] = 0;
+			if (sim->rp) {
+				sim->rpDistBase[0] = sim->rp[sim->rpIdx].dist[0];
+				sim->rpDistBase[1] = sim->rp[sim->rpIdx].dist[1];
+			}
+		}
+		sim->command = val & (Z140R_CMD_EN_TEST | Z140R_CMD_PAT_MASK);
+		UpdateSource(sim, now);
+		break;
+	default:
+		/* read-only */
+		break;
+	}
+
+	pthread_mutex_unlock(&sim->lock);
+}
+
+/******************************* SimIrqTime *********************************/
+/** Get the time of the next interrupt
+ *
+ *  The interrupt is asserted while a period register reports NEW.
+ *
+ *  \param ma         \IN  hw access handle
+ *
+ *  \return           0 if asserted, otherwise time of the next period
+ *                    event [ns] or NS_NONE
+ */
+static u_int64 SimIrqTime(SIM_MA *ma)
+{
+	Z140_SIM *sim = (Z140_SIM*)ma;
+	u_int64 next = NS_NONE, t;
+	u_int32 s;
+
+	pthread_mutex_lock(&sim->lock);
+	Advance(sim, OSS_SIM_TimeNs());
+
+	if ((sim->period[0] | sim->period[1]) & Z140R_PERIOD_NEW)
+		next = 0;
+	else if (sim->rp)
+		next = ReplayNext(sim);
+	else {
+		for (s = 0; s < 2; s++) {
+			/* next rising edge */
+			if (sim->srcPeriod) {
+				t = sim->origin + RiseOffs(sim, s) +
+					Rises(sim, s, sim->t) * sim->srcPeriod;
+				if (t < next)
+					next = t;
+			}
+			/* measurement timeout */
+			if (!sim->toutDone[s]) {
+				t = sim->measRef[s] + MEAS_TOUT_NS(sim) + 1;
+				if (t < next)
+					next = t;
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&sim->lock);
+	return (next);
+}
+
+/******************************* RiseOffs ***********************************/
+/** Time of the first rising edge of a signal after the phase origin
+ *
+ *  \param sim        \IN  model handle
+ *  \param s          \IN  0=signal A, 1=signal B
+ *
+ *  \return           offset [ns]
+ */
+static u_int64 RiseOffs(Z140_SIM *sim, u_int32 s)
+{
+	u_int64 p = sim->srcPeriod;
+
+	if (s == 0)
+		return (p);
+
+	/* forward: A leads B by 90 degrees */
+	return (sim->srcBwd ? p - p / 4 : p + p / 4);
+}
+
+/******************************* Rises **************************************/
+/** Number of rising edges of a signal from the phase origin up to t
+ *
+ *  \param sim        \IN  model handle
+ *  \param s          \IN  0=signal A, 1=signal B
+ *  \param t          \IN  time [ns]
+ *
+ *  \return           number of rising edges
+ */
+static u_int64 Rises(Z140_SIM *sim, u_int32 s, u_int64 t)
+{
+	u_int64 first = sim->origin + RiseOffs(sim, s);
+
+	if (!sim->srcPeriod || t < first)
+		return (0);
+
+	return ((t - first) / sim->srcPeriod + 1);
+}
+
+/******************************* Advance ************************************/
+/** Evaluate the model up to now
+ *
+ *  \param sim        \IN  model handle
+ *  \param now        \IN  current time [ns]
+ */
+static void Advance(Z140_SIM *sim, u_int64 now)
+{
+	u_int64 p = sim->srcPeriod, n0, n1, last, gap, q;
+	u_int32 s, lsts;
+
+	if (now <= sim->t)
+		return;
+
+	if (sim->rp) {
+		ReplayAdvance(sim, now);
+		sim->t = now;
+		return;
+	}
+
+	if (p) {
+		lsts = (p / 4 < DEB_NS(sim)) ? Z140R_PERIOD_LSTS : 0;
+
+		for (s = 0; s < 2; s++) {
+			n0 = Rises(sim, s, sim->t);
+			n1 = Rises(sim, s, now);
+			if (n1 == n0)
+				continue;
+
+			/* latest rising edge completes a period measurement */
+			last = sim->origin + RiseOffs(sim, s) + (n1 - 1) * p;
+			if (n1 >= 2)
+				gap = p;
+			else
+				gap = sim->measValid[s] ? last - sim->measRef[s] : NS_NONE;
+
+			if (gap <= MEAS_TOUT_NS(sim)) {
+				gap = gap * 32 / 1000;
+				sim->period[s] = Z140R_PERIOD_NEW | Z140R_PERIOD_VLD | lsts |
+					(gap > Z140R_PERIOD_MASK ? Z140R_PERIOD_MASK : (u_int32)gap);
+			}
+			else {
+				/* timed out in between */
+				sim->period[s] = Z140R_PERIOD_NEW;
+			}
+
+			sim->measRef[s]   = last;
+			sim->measValid[s] = TRUE;
+			sim->toutDone[s]  = FALSE;
+
+			/* signal A: count distance and detect direction */
+			if (s == 0) {
+				sim->dist[sim->srcBwd] += (u_int32)(n1 - n0);
+				sim->dirTime = last;
+				sim->dirBwd  = sim->srcBwd;
+			}
+		}
+
+		/* edges every quarter period */
+		q = p / 4;
+		if (now >= sim->origin + q)
+			sim->lastEdge = sim->origin + (now - sim->origin) / q * q;
+	}
+
+	/* measurement timeout */
+	for (s = 0; s < 2; s++) {
+		if (!sim->toutDone[s] && (now - sim->measRef[s] > MEAS_TOUT_NS(sim))) {
+			sim->period[s]    = Z140R_PERIOD_NEW;
+			sim->measValid[s] = FALSE;
+			sim->toutDone[s]  = TRUE;
+		}
+	}
+
+	sim->t = now;
+}
+
+/******************************* UpdateSource *******************************/
+/** Select the signal source after a COMMAND, DEB_TIME or input change
+ *
+ *  \param sim        \IN  model handle
+ *  \param now        \IN  current time [ns] (model evaluated up to now)
+ */
+static void UpdateSource(Z140_SIM *sim, u_int64 now)
+{
+	u_int64 p;
+	u_int32 bwd;
+
+	if (sim->command & Z140R_CMD_EN_TEST) {
+		switch (sim->command & Z140R_CMD_PAT_MASK) {
+		case Z140R_CMD_PAT_CW:		p = sim->tpPeriod;	bwd = FALSE;	break;
+		case Z140R_CMD_PAT_CCW:		p = sim->tpPeriod;	bwd = TRUE;		break;
+		default:					p = 0;				bwd = FALSE;	break;
+		}
+	}
+	else {
+		p   = sim->inPeriod;
+		bwd = sim->inBwd;
+	}
+
+	/* phases shorter than the debounce time are filtered */
+	if (p / 2 < DEB_NS(sim))
+		p = 0;
+
+	if ((p == sim->srcPeriod) && (bwd == sim->srcBwd))
+		return;
+
+	sim->srcPeriod = p;
+	sim->srcBwd    = bwd;
+	sim->origin    = now;
+}
+
+/******************************* Status *************************************/
+/** Get the STATUS register
+ *
+ *  \param sim        \IN  model handle
+ *  \param now        \IN  current time [ns] (model evaluated up to now)
+ *
+ *  \return           Z140R_ST_xxx flags
+ */
+static u_int32 Status(Z140_SIM *sim, u_int64 now)
+{
+	u_int32 st = 0;
+
+	if (sim->rp)
+		return (sim->rpStatus);
+
+	if ((sim->lastEdge != NS_NONE) &&
+		(now - sim->lastEdge < TIME10_NS(sim->rollingTime)))
+		st |= Z140R_ST_ROLLING;
+
+	if ((sim->lastEdge == NS_NONE) ||
+		(now - sim->lastEdge >= TIME10_NS(sim->standstillTime)))
+		st |= Z140R_ST_STANDSTILL;
+
+	if ((sim->dirTime != NS_NONE) &&
+		(now - sim->dirTime < TIME10_NS(sim->dirDetTout)))
+		st |= sim->dirBwd ? Z140R_ST_DIR_BWD : Z140R_ST_DIR_FWD;
+	else
+		st |= Z140R_ST_DIR_INVALID;
+
+	return (st);
+}
+
+/******************************* ReplayLoad *********************************/
+/** Load a trace file into the replay records
+ *
+ *  \param sim        \IN  model handle
+ *  \param file       \IN  trace file (Z140_SNAPSHOT records or zrec)
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 ReplayLoad(Z140_SIM *sim, const char *file)
+{
+	Z140_ZREC_HANDLE *zrec;
+	Z140_SNAPSHOT snap;
+	char magic[8];
+	u_int64 t0 = 0;
+	FILE *fp;
+	int32 error = ERR_SUCCESS;
+
+	free(sim->rp);
+	sim->rp    = NULL;
+	sim->rpNum = 0;
+	sim->rpIdx = 0;
+
+	if ((fp = fopen(file, "rb")) == NULL)
+		return (errno);
+
+	if ((fread(magic, 1, sizeof(magic), fp) == sizeof(magic)) &&
+		!memcmp(magic, "Z140ZREC", sizeof(magic))) {
+		/* compact recording */
+		fclose(fp);
+		if ((error = Z140_ZREC_Open((char*)file, &zrec)))
+			return (error);
+		while (!error && !(error = Z140_ZREC_Read(zrec, &snap)))
+			error = ReplayAdd(sim, &snap, &t0);
+		Z140_ZREC_Close(&zrec);
+		if (error == Z140_ZREC_END)
+			error = ERR_SUCCESS;
+	}
+	else {
+		/* Z140_SNAPSHOT records */
+		rewind(fp);
+		while (!error && fread(&snap, sizeof(snap), 1, fp) == 1) {
+			if (snap.version != Z140_SNAPSHOT_VER)
+				error = ERR_OSS_ILL_PARAM;	/* other layout */
+			else
+				error = ReplayAdd(sim, &snap, &t0);
+		}
+		if (!error && ferror(fp))
+			error = errno;
+		fclose(fp);
+	}
+
+	if (!error && !sim->rpNum)
+		error = ERR_OSS_ILL_PARAM;
+
+	if (error) {
+		free(sim->rp);
+		sim->rp    = NULL;
+		sim->rpNum = 0;
+	}
+	return (error);
+}
+
+/******************************* ReplayAdd **********************************/
+/** Append a snapshot to the replay records
+ *
+ *  \param sim        \IN  model handle
+ *  \param snap       \IN  snapshot
+ *  \param t0P        \IN  timestamp of the first snapshot (if rpNum > 0)
+ *                    \OUT timestamp of the first snapshot
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 ReplayAdd(Z140_SIM *sim, const Z140_SNAPSHOT *snap, u_int64 *t0P)
+{
+	SIM_RP_REC *rec;
+
+	if (!sim->rpNum)
+		*t0P = snap->tstamp;
+	else if (snap->tstamp < *t0P + sim->rp[sim->rpNum - 1].t)
+		return (ERR_OSS_ILL_PARAM);		/* not monotonic */
+
+	if (sim->rpNum % RP_ALLOC == 0) {
+		if ((rec = (SIM_RP_REC*)realloc(sim->rp,
+			(sim->rpNum + RP_ALLOC) * sizeof(*rec))) == NULL)
+			return (ERR_OSS_MEM_ALLOC);
+		sim->rp = rec;
+	}
+
+	rec = &sim->rp[sim->rpNum++];
+	rec->t         = snap->tstamp - *t0P;
+	rec->period[0] = snap->periodA;
+	rec->period[1] = snap->periodB;
+	rec->dist[0]   = snap->distFwd;
+	rec->dist[1]   = snap->distBwd;
+	rec->status    = snap->status;
+
+	return (ERR_SUCCESS);
+}
+
+/******************************* ReplayApply ********************************/
+/** Load the registers from a replay record
+ *
+ *  \param sim        \IN  model handle
+ *  \param idx        \IN  record index
+ */
+static void ReplayApply(Z140_SIM *sim, u_int32 idx)
+{
+	SIM_RP_REC *rec = &sim->rp[idx];
+	u_int32 s;
+
+	/* a pending NEW is kept until the register is read */
+	for (s = 0; s < 2; s++)
+		sim->period[s] = rec->period[s] | (sim->period[s] & Z140R_PERIOD_NEW);
+
+	sim->dist[0]  = rec->dist[0] - sim->rpDistBase[0];
+	sim->dist[1]  = rec->dist[1] - sim->rpDistBase[1];
+	sim->rpStatus = rec->status;
+	sim->rpIdx    = idx;
+}
+
+/******************************* ReplayAdvance ******************************/
+/** Apply all replay records due up to now
+ *
+ *  \param sim        \IN  model handle
+ *  \param now        \IN  current time [ns]
+ */
+static void ReplayAdvance(Z140_SIM *sim, u_int64 now)
+{
+	SIM_RP_REC *last = &sim->rp[sim->rpNum - 1];
+	u_int32 idx = sim->rpIdx, n;
+	u_int64 t;
+
+	/* restart: the distances continue from the end of the trace */
+	if (sim->rpLoop && (now - sim->rpStart >= sim->rpLoopNs)) {
+		n = (u_int32)((now - sim->rpStart) / sim->rpLoopNs);
+		sim->rpDistBase[0] += n * (sim->rp[0].dist[0] - last->dist[0]);
+		sim->rpDistBase[1] += n * (sim->rp[0].dist[1] - last->dist[1]);
+		sim->rpStart += n * sim->rpLoopNs;
+		idx = 0;
+		ReplayApply(sim, 0);
+	}
+	t = (now - sim->rpStart) * sim->rpSpeed;
+
+	/* intermediate records only matter for NEW */
+	while (idx + 1 < sim->rpNum && sim->rp[idx + 1].t <= t) {
+		idx++;
+		sim->period[0] |= sim->rp[idx].period[0] & Z140R_PERIOD_NEW;
+		sim->period[1] |= sim->rp[idx].period[1] & Z140R_PERIOD_NEW;
+	}
+
+	if (idx != sim->rpIdx)
+		ReplayApply(sim, idx);
+}
+
+/******************************* ReplayNext *********************************/
+/** Time of the next replay record
+ *
+ *  \param sim        \IN  model handle
+ *
+ *  \return           time [ns] or NS_NONE at the end of the trace
+ */
+static u_int64 ReplayNext(Z140_SIM *sim)
+{
+	if (sim->rpIdx + 1 < sim->rpNum)
+		return (sim->rpStart + (sim->rp[sim->rpIdx + 1].t + sim->rpSpeed - 1) /
+				sim->rpSpeed);
+
+	return (sim->rpLoop ? sim->rpStart + sim->rpLoopNs : NS_NONE);
+}
@@ -0,0 +1,69 @@
+/***********************  I n c l u d e  -  F i l e  ************************/
+/*!
+ *        \file  z140_sim.h
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  Behavioral model of the 16Z140 register block
+ *
+ *               The model is accessed through MACCESS (see maccess.h of
+ *               the host simulation). Requires men_typs.h and maccess.h.
+ *
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _Z140_SIM_H
+#define _Z140_SIM_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+#define Z140_SIM_TP_HZ_DEF		1000	/**< default test pattern frequency [Hz] */
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/** model handle (opaque) */
+typedef struct Z140_SIM Z140_SIM;
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+Z140_SIM* Z140_SIM_Create(u_int32 tpHz);
+void Z140_SIM_Destroy(Z140_SIM **simP);
+MACCESS Z140_SIM_Ma(Z140_SIM *sim);
+void Z140_SIM_Input(Z140_SIM *sim, u_int32 periodNs, u_int32 bwd);
+int32 Z140_SIM_Replay(Z140_SIM *sim, const char *file, u_int32 speed,
+					  u_int32 loop);
+void Z140_SIM_Tear(Z140_SIM *sim, u_int32 reads);
+
+/* sim_mdis.c */
+Z140_SIM* SIM_MDIS_Model(const char *device);
+
+#ifdef __cplusplus
+	}
+#endif
+
+#endif /* _Z140_SIM_H */
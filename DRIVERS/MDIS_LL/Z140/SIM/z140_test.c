@@ -0,0 +1,1658 @@
+/*********************  P r o g r a m  -  M o d u l e ***********************/
+/*!
+ *        \file  z140_test.c
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  Scenario tests of the Z140 driver and libraries on the host
+ *               simulation
+ *
+ *               Each scenario opens a device of z140_test.dsc (environment
+ *               variable Z140_SIM_DESC), lets the driver run against the
+ *               model or a replay trace and compares the results with the
+ *               expected values:
+ *               - sample ring overflow policies with slow, paused and
+ *                 released reader
+ *               - complete configuration and descriptor profiles: an
+ *                 illegal value leaves the configuration unchanged
+ *               - shadow registers: configuration getstats without
+ *                 register reads, Z140_SHADOW_CHK finds changed registers
+ *               - snapshot of consistent distance counters: re-read of
+ *                 a torn read, Z140_ST_TORN if all re-reads are torn
+ *               - period latch: two reader threads (processes) see each
+ *                 new period once, without MDIS call lock
+ *               - status transition signal: delivery for the flags of
+ *                 the mask only, none after Z140_SIG_CLR
+ *               - 32-bit wrap of the distance registers, replayed from a
+ *                 binary and a zrec trace (zrec codec), 64-bit distances
+ *                 kept over close and open (KEEP_DISTANCE)
+ *               - period statistics windows and histograms
+ *               - driver counters of the Z140_PERIOD_A errors and reset
+ *               - median and IIR period filter
+ *               - speed estimate with and without sampler
+ *               - call trace ring: entries, overwrite and drain
+ *               - Z140_UIO library against a mock file of UIO maps
+ *               - zrec codec round trip: write, read and seek 20000 random
+ *                 records
+ *
+ *               The replay traces, the mock file and the zrec round-trip
+ *               file are written to obj/.
+ *               Run with "make test", the exit code is 1 if a check failed.
+ *
+ *     Required: libz140sim.a, pthread
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*-----------------------------------------+
+|  INCLUDES                                |
++-----------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <endian.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_api.h>
+#include <MEN/mdis_err.h>
+#include <MEN/usr_oss.h>
+#include <MEN/z140_reg.h>
+#include <MEN/z140_drv.h>
+#include <MEN/z140_zrec.h>
+#include <MEN/z140_uio.h>
+#include <MEN/maccess.h>
+#include "z140_sim.h"
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+#define TRACE_WRAP		"obj/z140_test_wrap"	/**< wrap trace (.bin/.zrec) */
+#define TRACE_STAT		"obj/z140_test_stat.bin"	/**< statistics trace */
+#define TRACE_FLT		"obj/z140_test_flt.bin"	/**< filter trace */
+#define TRACE_LATCH		"obj/z140_test_latch.bin"	/**< latch trace */
+#define TRACE_CNT		"obj/z140_test_cnt.bin"	/**< counter trace */
+#define TRACE_SIG		"obj/z140_test_sig.bin"	/**< signal trace */
+#define UIO_MOCK		"obj/z140_test_uio.mock"	/**< UIO mock file */
+#define TRACE_ZREC		"obj/z140_test_rt.zrec"	/**< zrec round-trip file */
+#define TRACE_ZREC_BAD	"obj/z140_test_bad.zrec"	/**< damaged zrec file */
+
+#define WRAP_NUM		50			/**< records of the wrap trace */
+#define WRAP_FWD		0xffffff00	/**< first forward distance */
+#define WRAP_FWD_INC	16			/**< forward pulses per record */
+#define WRAP_BWD		0xfffffffa	/**< first backward distance */
+
+#define STAT_NUM		60			/**< records of the statistics trace */
+#define STAT_WIN		10			/**< PERSTAT_WINDOW of t_stat */
+
+#define FLT_NUM			40			/**< records of the filter trace */
+#define FLT_STEP		20			/**< first record of the IIR step */
+#define FLT_IIR_K		2			/**< IIR shift of t_flt (FILTER_B) */
+#define FLT_IIR_FRAC	16			/**< fractional bits of the driver IIR */
+
+#define TORN_READS		6			/**< DISTANCE_FWD reads of all snapshot
+										 retries (SNAP_RETRY_MAX 3) */
+
+#define LATCH_NUM		20			/**< records of the latch trace */
+#define LATCH_PER		1000		/**< first period of the latch trace */
+
+#define SIG_NUM			30			/**< records of the signal trace */
+
+#define CNT_NUM			12			/**< records of the counter trace */
+#define CNT_POLLS		300			/**< Z140_PERIOD_A polls of TestCnt() */
+
+#define SPD_HZ			250			/**< SIM_INPUT_HZ of the speed devices */
+#define SPD_TOL			(SPD_HZ / 16 + 1)	/**< speed tolerance [pulses/s]:
+											 +-1 pulse of a 16 pulse count */
+
+#define TRC_DEPTH		8			/**< TRACE_DEPTH of t_trace */
+
+#define ZREC_NUM		20000		/**< records of the zrec round trip */
+#define ZREC_SYNC		1000		/**< sync interval of the zrec round trip */
+#define ZREC_SEEKS		50			/**< random seeks of the zrec round trip */
+#define ZREC_DAMAGE		16			/**< bytes overwritten in the damaged zrec file */
+
+#define PER_NEW_VLD		(Z140_PER_NEW | Z140_PER_VLD)	/**< valid new period */
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/** reader thread of the latch scenario */
+typedef struct {
+	MDIS_PATH	path;		/**< shared path */
+	u_int32		news;		/**< number of new periods */
+	u_int32		dup;		/**< new periods not above the last one */
+	int32		last;		/**< last new period */
+} LATCH_RD;
+
+/*-----------------------------------------+
+|  GLOBALS                                 |
++-----------------------------------------*/
+static u_int32 G_checks;	/**< number of checks */
+static u_int32 G_failed;	/**< number of failed checks */
+static u_int32 G_rand = 1;	/**< state of Rand() */
+static volatile sig_atomic_t G_sigCnt;	/**< signals received */
+static Z140_SNAPSHOT G_zrec[ZREC_NUM];	/**< records of the zrec round trip */
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+static void Check(int ok, const char *fmt, ...);
+static MDIS_PATH Open(const char *device);
+static void Close(MDIS_PATH path);
+static int32 TraceWrite(const char *file, u_int32 zrec,
+						const Z140_SNAPSHOT *snap, u_int32 num);
+static void TestRing(const char *device, u_int32 policy);
+static void TestConfig(void);
+static int CfgEqual(const Z140_CONFIG *a, const Z140_CONFIG *b);
+static void TestShadow(void);
+static void TestTorn(void);
+static void TestLatch(void);
+static void *LatchReader(void *arg);
+static void TestSig(void);
+static void SigHandler(int sig);
+static void TestWrap(const char *device);
+static void TestStat(void);
+static void TestCnt(void);
+static void TestFilter(void);
+static void TestSpeed(const char *device, int32 dir, u_int32 poll);
+static void TestTrace(void);
+static void TestUio(void);
+static void TestZrec(void);
+static void ZrecDamaged(const u_int8 *data, long size, u_int32 sync);
+static int SnapEqual(const Z140_SNAPSHOT *a, const Z140_SNAPSHOT *b);
+static u_int32 Rand(u_int32 range);
+static u_int32 HistIdx(u_int32 period);
+static u_int32 IirRef(u_int32 x0, u_int32 x1, u_int32 steps);
+
+/********************************* main ************************************/
+/** Program main function
+ *
+ *  \return	          0 if all checks passed, 1 otherwise
+ */
+int main(void)
+{
+	Z140_SNAPSHOT snap[STAT_NUM];
+	u_int32 n, per;
+
+	setvbuf(stdout, NULL, _IONBF, 0);
+
+	/*--------------------------+
+	|  replay traces            |
+	+--------------------------*/
+	/* distance registers wrap after 16 records, 2ms per record */
+	memset(snap, 0, sizeof(snap));
+	for (n = 0; n < WRAP_NUM; n++) {
+		snap[n].version = Z140_SNAPSHOT_VER;
+		snap[n].tstamp  = (u_int64)n * 2000000;
+		snap[n].distFwd = WRAP_FWD + n * WRAP_FWD_INC;
+		snap[n].distBwd = WRAP_BWD + n;
+		snap[n].status  = Z140_ST_ROLLING | Z140_ST_DIR_FWD;
+	}
+	if (TraceWrite(TRACE_WRAP ".bin", FALSE, snap, WRAP_NUM) ||
+		TraceWrite(TRACE_WRAP ".zrec", TRUE, snap, WRAP_NUM))
+		return (1);
+
+	/* period A alternates 1000/3000, period B 2000, 20ms per record */
+	for (n = 0; n < STAT_NUM; n++) {
+		snap[n].version = Z140_SNAPSHOT_VER;
+		snap[n].tstamp  = (u_int64)n * 20000000;
+		snap[n].periodA = PER_NEW_VLD | ((n & 1) ? 3000 : 1000);
+		snap[n].periodB = PER_NEW_VLD | 2000;
+		snap[n].distFwd = n;
+		snap[n].distBwd = 0;
+		snap[n].status  = Z140_ST_ROLLING | Z140_ST_DIR_FWD;
+	}
+	if (TraceWrite(TRACE_STAT, FALSE, snap, STAT_NUM))
+		return (1);
+
+	/*
+	 * period A 1000 with single spikes of 9000, ends with 1200, 9000, 1100,
+	 * period B steps from 1000 to 2000 at FLT_STEP, 10ms per record
+	 */
+	for (n = 0; n < FLT_NUM; n++) {
+		per = (n % 5 == 2) ? 9000 : 1000;
+		if (n == FLT_NUM - 3)
+			per = 1200;
+		if (n == FLT_NUM - 2)
+			per = 9000;
+		if (n == FLT_NUM - 1)
+			per = 1100;
+		snap[n].version = Z140_SNAPSHOT_VER;
+		snap[n].tstamp  = (u_int64)n * 10000000;
+		snap[n].periodA = PER_NEW_VLD | per;
+		snap[n].periodB = PER_NEW_VLD | (n < FLT_STEP ? 1000 : 2000);
+	}
+	if (TraceWrite(TRACE_FLT, FALSE, snap, FLT_NUM))
+		return (1);
+
+	/* period A rises by 1 with each record, 20ms per record */
+	memset(snap, 0, sizeof(snap));
+	for (n = 0; n < LATCH_NUM; n++) {
+		snap[n].version = Z140_SNAPSHOT_VER;
+		snap[n].tstamp  = (u_int64)n * 20000000;
+		snap[n].periodA = PER_NEW_VLD | (LATCH_PER + n);
+		snap[n].periodB = PER_NEW_VLD | LATCH_PER;
+		snap[n].status  = Z140_ST_ROLLING | Z140_ST_DIR_FWD;
+	}
+	if (TraceWrite(TRACE_LATCH, FALSE, snap, LATCH_NUM))
+		return (1);
+
+	/* period A valid, phase violation, invalid in turn, 20ms per record */
+	for (n = 0; n < CNT_NUM; n++) {
+		snap[n].version = Z140_SNAPSHOT_VER;
+		snap[n].tstamp  = (u_int64)n * 20000000;
+		snap[n].periodA = Z140_PER_NEW | (1000 + n);
+		if (n % 3 == 0)
+			snap[n].periodA |= Z140_PER_VLD;
+		if (n % 3 == 1)
+			snap[n].periodA |= Z140_PER_VLD | Z140_PER_LSTS;
+		snap[n].periodB = PER_NEW_VLD | 1000;
+		snap[n].status  = Z140_ST_ROLLING | Z140_ST_DIR_FWD;
+	}
+	if (TraceWrite(TRACE_CNT, FALSE, snap, CNT_NUM))
+		return (1);
+
+	/*
+	 * rolling toggles with each record, standstill at 200..300ms and from
+	 * 500ms, 20ms per record
+	 */
+	memset(snap, 0, sizeof(snap));
+	for (n = 0; n < SIG_NUM; n++) {
+		snap[n].version = Z140_SNAPSHOT_VER;
+		snap[n].tstamp  = (u_int64)n * 20000000;
+		snap[n].status  = Z140_ST_DIR_FWD | ((n & 1) ? Z140_ST_ROLLING : 0);
+		if ((n >= 10 && n < 15) || n >= 25)
+			snap[n].status |= Z140_ST_STANDSTILL;
+	}
+	if (TraceWrite(TRACE_SIG, FALSE, snap, SIG_NUM))
+		return (1);
+
+	/*--------------------------+
+	|  scenarios                |
+	+--------------------------*/
+	TestRing("t_ring_old", Z140_OVF_DROP_OLDEST);
+	TestRing("t_ring_new", Z140_OVF_DROP_NEWEST);
+	TestConfig();
+	TestShadow();
+	TestTorn();
+	TestLatch();
+	TestSig();
+	TestWrap("t_wrap_bin");
+	TestWrap("t_wrap_zrec");
+	TestStat();
+	TestCnt();
+	TestFilter();
+	TestSpeed("t_spd_fwd", 1, FALSE);
+	TestSpeed("t_spd_bwd", -1, FALSE);
+	TestSpeed("t_spd_poll", 1, TRUE);
+	TestSpeed("t_spd_still", 0, FALSE);
+	TestTrace();
+	TestUio();
+	TestZrec();
+
+	printf("%u checks, %u failed\n", G_checks, G_failed);
+
+	return (G_failed ? 1 : 0);
+}
+
+/********************************* Check ***********************************/
+/** Count a check and print it if it failed
+ *
+ *  \param ok         \IN  check passed
+ *  \param fmt        \IN  printf format of the check description
+ */
+static void Check(int ok, const char *fmt, ...)
+{
+	va_list ap;
+
+	G_checks++;
+	if (ok)
+		return;
+
+	G_failed++;
+	printf("  *** FAILED: ");
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	printf("\n");
+}
+
+/********************************* Open ************************************/
+/** Open a test device
+ *
+ *  \param device     \IN  device name (z140_test.dsc)
+ *
+ *  \return           path or -1
+ */
+static MDIS_PATH Open(const char *device)
+{
+	MDIS_PATH path;
+
+	printf("%s\n", device);
+
+	if ((path = M_open((char*)device)) < 0)
+		Check(FALSE, "M_open: %s", M_errstring(UOS_ErrnoGet()));
+
+	return (path);
+}
+
+/********************************* Close ***********************************/
+/** Release the reader state and close a test device
+ *
+ *  \param path       \IN  path
+ */
+static void Close(MDIS_PATH path)
+{
+	M_setstat(path, Z140_RD_RELEASE, 0);
+	M_close(path);
+}
+
+/********************************* TraceWrite ******************************/
+/** Write a replay trace
+ *
+ *  \param file       \IN  trace file
+ *  \param zrec       \IN  TRUE: compact recording, FALSE: Z140_SNAPSHOT records
+ *  \param snap       \IN  records
+ *  \param num        \IN  number of records
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 TraceWrite(
+	const char			*file,
+	u_int32				zrec,
+	const Z140_SNAPSHOT	*snap,
+	u_int32				num)
+{
+	Z140_ZREC_HANDLE *hdl;
+	FILE *fp;
+	u_int32 n;
+	int32 error = ERR_SUCCESS;
+
+	if (zrec) {
+		if ((error = Z140_ZREC_Create((char*)file, 16, &hdl)) == ERR_SUCCESS) {
+			for (n = 0; n < num && !error; n++)
+				error = Z140_ZREC_Write(hdl, &snap[n]);
+			if (!error)
+				error = Z140_ZREC_Close(&hdl);
+			else
+				Z140_ZREC_Close(&hdl);
+		}
+	}
+	else {
+		if ((fp = fopen(file, "wb")) == NULL)
+			error = ERR_UOS_ILL_PARAM;
+		else {
+			if (fwrite(snap, sizeof(*snap), num, fp) != num)
+				error = ERR_UOS_ILL_PARAM;
+			if (fclose(fp))
+				error = ERR_UOS_ILL_PARAM;
+		}
+	}
+
+	if (error)
+		printf("*** can't write %s: 0x%x\n", file, error);
+
+	return (error);
+}
+
+/********************************* TestRing ********************************/
+/** Sample ring overflow policy
+ *
+ *  A slow reader (1 record per 10ms at 1000Hz, ring of 32) sees gaps with
+ *  Z140_OVF_DROP_OLDEST and a gapless, delayed stream with
+ *  Z140_OVF_DROP_NEWEST. After a pause (below the idle timeout), the
+ *  reader gets the latest ring content with drop-oldest and continues
+ *  without gap with drop-newest, the lost records are counted as overruns.
+ *  After Z140_RD_RELEASE, the ring is no longer stalled by the reader.
+ *
+ *  \param device     \IN  device name
+ *  \param policy     \IN  OVERFLOW_POLICY of the device
+ */
+static void TestRing(const char *device, u_int32 policy)
+{
+	Z140_SAMPLE rec[64];
+	MDIS_PATH path;
+	int32 n, num, overrun = 0, overrun2 = 0, gaps = 0;
+	u_int32 seq, i, seqValid;
+
+	if ((path = Open(device)) < 0)
+		return;
+
+	/* first read activates the reader */
+	num = M_getblock(path, (u_int8*)rec, sizeof(Z140_SAMPLE));
+	Check(num >= 0, "M_getblock");
+	seqValid = (num > 0);
+	seq = seqValid ? rec[0].seq : 0;
+
+	/* slow reader */
+	for (n = 0; n < 20; n++) {
+		UOS_Delay(10);
+		num = M_getblock(path, (u_int8*)rec, sizeof(Z140_SAMPLE));
+		if (num != sizeof(Z140_SAMPLE)) {
+			Check(FALSE, "slow reader: read %d bytes", num);
+			break;
+		}
+		if (seqValid && (rec[0].seq != seq + 1))
+			gaps++;
+		seq = rec[0].seq;
+		seqValid = TRUE;
+	}
+	M_getstat(path, Z140_RING_OVERRUN, &overrun);
+
+	Check(overrun > 0, "slow reader: overruns %d", overrun);
+	if (policy == Z140_OVF_DROP_OLDEST)
+		Check(gaps > 0, "drop-oldest: no gap in the sequence numbers");
+	else
+		Check(gaps == 0, "drop-newest: %d gaps in the sequence numbers", gaps);
+
+	/* paused reader */
+	UOS_Delay(200);
+	num = M_getblock(path, (u_int8*)rec, sizeof(rec)) / sizeof(Z140_SAMPLE);
+	M_getstat(path, Z140_RING_OVERRUN, &overrun2);
+	Check(num == 32, "paused reader: %d records, expected 32", num);
+	for (i = 1; i < (u_int32)num; i++) {
+		if (rec[i].seq != rec[i - 1].seq + 1) {
+			Check(FALSE, "paused reader: gap at record %u", i);
+			break;
+		}
+	}
+	Check(overrun2 - overrun >= 150, "paused reader: overruns %d after %d",
+		  overrun2, overrun);
+	if (num > 0) {
+		if (policy == Z140_OVF_DROP_OLDEST)
+			Check(rec[num - 1].seq - seq >= 150,
+				  "drop-oldest: ring stalled (seq %u after %u)",
+				  rec[num - 1].seq, seq);
+		else
+			Check(rec[0].seq == seq + 1,
+				  "drop-newest: seq %u after %u", rec[0].seq, seq);
+		seq = rec[num - 1].seq;
+	}
+
+	/* released reader */
+	M_setstat(path, Z140_RD_RELEASE, 0);
+	UOS_Delay(100);
+	num = M_getblock(path, (u_int8*)rec, sizeof(rec)) / sizeof(Z140_SAMPLE);
+	Check(num == 32, "released reader: %d records, expected 32", num);
+	if (num > 0)
+		Check(rec[num - 1].seq - seq >= 64,
+			  "released reader: ring stalled (seq %u after %u)",
+			  rec[num - 1].seq, seq);
+
+	Close(path);
+}
+
+/********************************* TestConfig ******************************/
+/** Complete configuration and descriptor profiles
+ *
+ *  Z140_PROFILE and Z140_BLK_CONFIG apply all values at once. A
+ *  configuration with one illegal value, an unknown profile or a too
+ *  small buffer is rejected and leaves the configuration and the active
+ *  profile unchanged. A single setstat deactivates the profile. A device
+ *  with an illegal descriptor profile can't be opened.
+ */
+static void TestConfig(void)
+{
+	static Z140_PROFILE_ENTRY prof[Z140_PROFILE_MAX];
+	Z140_CONFIG cfg, bad, get;
+	M_SG_BLOCK blk;
+	MDIS_PATH path;
+	int32 val = 0, error;
+
+	if ((path = Open("t_cfg")) < 0)
+		return;
+
+	/* descriptor profiles */
+	M_getstat(path, Z140_PROFILE_NUM, &val);
+	Check(val == 2, "%d profiles, expected 2", val);
+	blk.size = sizeof(prof);
+	blk.data = (void*)prof;
+	error = M_getstat(path, Z140_BLK_PROFILES, (int32*)&blk);
+	Check(!error && blk.size == 2 * sizeof(Z140_PROFILE_ENTRY),
+		  "getstat Z140_BLK_PROFILES: size %d", blk.size);
+	Check(!strcmp(prof[0].name, "fast") && !strcmp(prof[1].name, "slow"),
+		  "profile names '%s', '%s'", prof[0].name, prof[1].name);
+	Check(prof[1].cfg.debounceT == prof[0].cfg.debounceT &&
+		  prof[1].cfg.measTout == 5000,
+		  "profile 1: debounce %u, timeout %u", prof[1].cfg.debounceT,
+		  prof[1].cfg.measTout);
+
+	blk.size = sizeof(get);
+	blk.data = (void*)&get;
+	Check(M_setstat(path, Z140_PROFILE, 0) == 0, "setstat Z140_PROFILE 0");
+	M_getstat(path, Z140_PROFILE, &val);
+	Check(val == 0, "active profile %d, expected 0", val);
+	Check(M_getstat(path, Z140_BLK_CONFIG, (int32*)&blk) == 0 &&
+		  CfgEqual(&get, &prof[0].cfg), "profile 0: configuration differs");
+	M_getstat(path, Z140_DEBOUNCET, &val);
+	Check(val == (int32)prof[0].cfg.debounceT, "profile 0: debounce %d", val);
+
+	Check(M_setstat(path, Z140_PROFILE, 2) != 0 &&
+		  UOS_ErrnoGet() == ERR_LL_ILL_PARAM, "setstat Z140_PROFILE 2");
+	M_getstat(path, Z140_PROFILE, &val);
+	Check(val == 0, "unknown profile: active profile %d", val);
+
+	/* complete configuration */
+	cfg.debounceT   = 200;
+	cfg.measTout    = 300;
+	cfg.rollingT    = 40;
+	cfg.standstillT = 500;
+	cfg.dirdetTout  = 60;
+	cfg.tpattern    = Z140_TP_DISABLE;
+	blk.size = sizeof(cfg);
+	blk.data = (void*)&cfg;
+	Check(M_setstat(path, Z140_BLK_CONFIG, (INT32_OR_64)&blk) == 0,
+		  "setstat Z140_BLK_CONFIG");
+	M_getstat(path, Z140_PROFILE, &val);
+	Check(val == Z140_PROFILE_NONE, "configuration: active profile %d", val);
+	blk.size = sizeof(get);
+	blk.data = (void*)&get;
+	Check(M_getstat(path, Z140_BLK_CONFIG, (int32*)&blk) == 0 &&
+		  CfgEqual(&get, &cfg), "configuration differs");
+
+	/* illegal last value: nothing applied */
+	Check(M_setstat(path, Z140_PROFILE, 1) == 0, "setstat Z140_PROFILE 1");
+	bad = cfg;
+	bad.tpattern = Z140_TP_STANDSTILL + 1;
+	blk.size = sizeof(bad);
+	blk.data = (void*)&bad;
+	Check(M_setstat(path, Z140_BLK_CONFIG, (INT32_OR_64)&blk) != 0 &&
+		  UOS_ErrnoGet() == ERR_LL_ILL_PARAM,
+		  "setstat Z140_BLK_CONFIG with illegal test pattern");
+	bad = cfg;
+	bad.measTout = 150;
+	Check(M_setstat(path, Z140_BLK_CONFIG, (INT32_OR_64)&blk) != 0 &&
+		  UOS_ErrnoGet() == ERR_LL_ILL_PARAM,
+		  "setstat Z140_BLK_CONFIG with illegal timeout");
+	blk.size = sizeof(bad) - 1;
+	Check(M_setstat(path, Z140_BLK_CONFIG, (INT32_OR_64)&blk) != 0 &&
+		  UOS_ErrnoGet() == ERR_LL_USERBUF,
+		  "setstat Z140_BLK_CONFIG with short buffer");
+	M_getstat(path, Z140_PROFILE, &val);
+	Check(val == 1, "rejected configuration: active profile %d", val);
+	blk.size = sizeof(get);
+	blk.data = (void*)&get;
+	Check(M_getstat(path, Z140_BLK_CONFIG, (int32*)&blk) == 0 &&
+		  CfgEqual(&get, &prof[1].cfg),
+		  "rejected configuration: configuration changed");
+
+	/* single value */
+	Check(M_setstat(path, Z140_DEBOUNCET, 7) == 0, "setstat Z140_DEBOUNCET");
+	M_getstat(path, Z140_PROFILE, &val);
+	Check(val == Z140_PROFILE_NONE, "single value: active profile %d", val);
+
+	Close(path);
+
+	/* illegal descriptor profile */
+	printf("t_cfg_bad\n");
+	if ((path = M_open("t_cfg_bad")) >= 0) {
+		Check(FALSE, "t_cfg_bad: M_open succeeded");
+		M_close(path);
+	}
+}
+
+/********************************* TestShadow ******************************/
+/** Shadow registers
+ *
+ *  The configuration getstats are served from the shadow registers
+ *  without register read. Z140_SHADOW_CHK reports the registers changed
+ *  behind the driver's back, the getstats still return the configured
+ *  values until the value is set again.
+ */
+static void TestShadow(void)
+{
+	static const int32 code[] = { Z140_DEBOUNCET, Z140_MEAS_TOUT,
+		Z140_ROLLINGT, Z140_STANDSTILLT, Z140_DIRDET_TOUT, Z140_TPATTERN };
+	static const int32 value[] = { 33, 700, 80, 900, 120, Z140_TP_BWD };
+	Z140_COUNTERS cnt;
+	M_SG_BLOCK blk;
+	MDIS_PATH path;
+	Z140_SIM *sim;
+	MACCESS ma;
+	int32 val = 0, error;
+	u_int32 n;
+
+	if ((path = Open("t_shadow")) < 0)
+		return;
+	if ((sim = SIM_MDIS_Model("t_shadow")) == NULL) {
+		Check(FALSE, "no model");
+		Close(path);
+		return;
+	}
+	ma = Z140_SIM_Ma(sim);
+
+	for (n = 0; n < sizeof(code) / sizeof(code[0]); n++)
+		Check(M_setstat(path, code[n], value[n]) == 0,
+			  "setstat 0x%x = %d", code[n], value[n]);
+	M_getstat(path, Z140_SHADOW_CHK, &val);
+	Check(val == 0, "shadow differs: 0x%x", val);
+
+	/* getstats without register read */
+	M_setstat(path, Z140_CNT_RST, 0);
+	for (n = 0; n < sizeof(code) / sizeof(code[0]); n++) {
+		M_getstat(path, code[n], &val);
+		Check(val == value[n], "getstat 0x%x: %d, expected %d",
+			  code[n], val, value[n]);
+	}
+	blk.size = sizeof(cnt);
+	blk.data = (void*)&cnt;
+	error = M_getstat(path, Z140_BLK_COUNTERS, (int32*)&blk);
+	Check(!error && cnt.mmioRead == 0, "%llu register reads",
+		  (unsigned long long)cnt.mmioRead);
+
+	/* registers changed behind the driver's back */
+	MWRITE_D32(ma, Z140R_DEB_TIME, 5);
+	MWRITE_D32(ma, Z140R_ROLLING_TIME, 1);
+	M_getstat(path, Z140_SHADOW_CHK, &val);
+	Check(val == (Z140_SHD_DEBOUNCET | Z140_SHD_ROLLINGT),
+		  "changed registers: 0x%x", val);
+	M_getstat(path, Z140_DEBOUNCET, &val);
+	Check(val == value[0], "changed registers: debounce %d", val);
+
+	M_setstat(path, Z140_DEBOUNCET, value[0]);
+	M_getstat(path, Z140_SHADOW_CHK, &val);
+	Check(val == Z140_SHD_ROLLINGT, "debounce set again: 0x%x", val);
+
+	Close(path);
+}
+
+/********************************* TestTorn ********************************/
+/** Snapshot of consistent distance counters
+ *
+ *  The model counts a forward pulse right after DISTANCE_FWD was read
+ *  (Z140_SIM_Tear()). After one torn read, the driver re-reads the
+ *  counters and returns the new value without Z140_ST_TORN. If the
+ *  counter moves during all re-reads, Z140_ST_TORN is set.
+ */
+static void TestTorn(void)
+{
+	Z140_SNAPSHOT snap;
+	M_SG_BLOCK blk;
+	MDIS_PATH path;
+	Z140_SIM *sim;
+	int32 error;
+	u_int32 dist;
+
+	if ((path = Open("t_torn")) < 0)
+		return;
+	if ((sim = SIM_MDIS_Model("t_torn")) == NULL) {
+		Check(FALSE, "no model");
+		Close(path);
+		return;
+	}
+
+	blk.size = sizeof(snap);
+	blk.data = (void*)&snap;
+	error = M_getstat(path, Z140_BLK_SNAPSHOT, (int32*)&blk);
+	Check(!error && !(snap.status & Z140_ST_TORN),
+		  "stable counters: status 0x%x", snap.status);
+	dist = snap.distFwd;
+
+	/* one torn read: re-read */
+	Z140_SIM_Tear(sim, 1);
+	error = M_getstat(path, Z140_BLK_SNAPSHOT, (int32*)&blk);
+	Check(!error && !(snap.status & Z140_ST_TORN) && snap.distFwd == dist + 1,
+		  "one torn read: status 0x%x, forward %u after %u",
+		  snap.status, snap.distFwd, dist);
+
+	/* all re-reads torn */
+	Z140_SIM_Tear(sim, TORN_READS);
+	error = M_getstat(path, Z140_BLK_SNAPSHOT, (int32*)&blk);
+	Check(!error && (snap.status & Z140_ST_TORN),
+		  "torn reads: status 0x%x", snap.status);
+	Z140_SIM_Tear(sim, 0);
+
+	error = M_getstat(path, Z140_BLK_SNAPSHOT, (int32*)&blk);
+	Check(!error && !(snap.status & Z140_ST_TORN),
+		  "stable again: status 0x%x", snap.status);
+
+	Close(path);
+}
+
+/********************************* TestLatch *******************************/
+/** Period latch for multiple readers
+ *
+ *  Two threads (separate readers, see OSS_GetPid()) poll Z140_PERIOD_A on
+ *  the same path while a new period is replayed every 20ms, without
+ *  sampler. Each reader gets every new period exactly once, so both count
+ *  as many new periods as the driver latched (Z140_PERIOD_SEQ_A).
+ */
+static void TestLatch(void)
+{
+	LATCH_RD rd[2];
+	pthread_t tid[2];
+	MDIS_PATH path;
+	int32 seq0 = 0, seq1 = 0;
+	u_int32 n;
+
+	if ((path = Open("t_latch")) < 0)
+		return;
+
+	M_getstat(path, Z140_PERIOD_SEQ_A, &seq0);
+
+	memset(rd, 0, sizeof(rd));
+	for (n = 0; n < 2; n++) {
+		rd[n].path = path;
+		if (pthread_create(&tid[n], NULL, LatchReader, &rd[n])) {
+			Check(FALSE, "pthread_create");
+			Close(path);
+			return;
+		}
+	}
+	for (n = 0; n < 2; n++)
+		pthread_join(tid[n], NULL);
+
+	M_getstat(path, Z140_PERIOD_SEQ_A, &seq1);
+	Check(seq1 - seq0 >= LATCH_NUM - 1, "%d periods latched, expected %d",
+		  seq1 - seq0, LATCH_NUM);
+
+	for (n = 0; n < 2; n++) {
+		Check(rd[n].news == (u_int32)(seq1 - seq0),
+			  "reader %u: %u new periods, expected %d",
+			  n, rd[n].news, seq1 - seq0);
+		Check(!rd[n].dup, "reader %u: %u new periods repeated", n, rd[n].dup);
+		Check(rd[n].last == LATCH_PER + LATCH_NUM - 1,
+			  "reader %u: last period %d", n, rd[n].last);
+	}
+
+	Close(path);
+}
+
+/********************************* LatchReader *****************************/
+/** Reader thread of TestLatch(): poll Z140_PERIOD_A every 1ms for 600ms
+ *
+ *  \param arg        \IN  reader (LATCH_RD)
+ *
+ *  \return           NULL
+ */
+static void *LatchReader(void *arg)
+{
+	LATCH_RD *rd = (LATCH_RD*)arg;
+	int32 val, error;
+	u_int32 n;
+
+	for (n = 0; n < 600; n++) {
+		error = M_getstat(rd->path, Z140_PERIOD_A, &val);
+		if (error == 0) {
+			rd->news++;
+			if (val <= rd->last)
+				rd->dup++;
+			rd->last = val;
+		}
+		UOS_Delay(1);
+	}
+
+	M_setstat(rd->path, Z140_RD_RELEASE, 0);
+
+	return (NULL);
+}
+
+/********************************* TestSig *********************************/
+/** Status transition signal
+ *
+ *  The sampler detects the transitions of the replayed status. With the
+ *  mask Z140_ST_STANDSTILL, only the two standstill transitions until
+ *  400ms send the signal, the rolling transitions don't. A second
+ *  Z140_SIG_SET fails. After Z140_SIG_CLR, the standstill transition at
+ *  500ms sends no signal but is reported by Z140_SIG_EDGES.
+ */
+static void TestSig(void)
+{
+	struct sigaction sa;
+	MDIS_PATH path;
+	int32 val = 0, error;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = SigHandler;
+	sigaction(SIGUSR1, &sa, NULL);
+	G_sigCnt = 0;
+
+	if ((path = Open("t_sig")) < 0)
+		return;
+
+	Check(M_setstat(path, Z140_SIG_MASK, Z140_ST_STANDSTILL) == 0,
+		  "setstat Z140_SIG_MASK");
+	Check(M_setstat(path, Z140_SIG_SET, SIGUSR1) == 0, "setstat Z140_SIG_SET");
+	error = M_setstat(path, Z140_SIG_SET, SIGUSR1);
+	Check(error && UOS_ErrnoGet() == ERR_OSS_SIG_SET,
+		  "second setstat Z140_SIG_SET");
+	M_getstat(path, Z140_SIG_MASK, &val);
+	Check(val == Z140_ST_STANDSTILL, "mask 0x%x", val);
+	M_getstat(path, Z140_SIG_EDGES, &val);
+
+	/* standstill at 200ms and rolling again at 300ms */
+	UOS_Delay(400);
+	Check(G_sigCnt == 2, "%d signals, expected 2", (int)G_sigCnt);
+
+	Check(M_setstat(path, Z140_SIG_CLR, 0) == 0, "setstat Z140_SIG_CLR");
+	M_getstat(path, Z140_SIG_EDGES, &val);
+
+	/* standstill at 500ms */
+	UOS_Delay(200);
+	Check(G_sigCnt == 2, "removed: %d signals, expected 2", (int)G_sigCnt);
+	M_getstat(path, Z140_SIG_EDGES, &val);
+	Check(val & Z140_ST_STANDSTILL, "removed: edges 0x%x", val);
+
+	error = M_setstat(path, Z140_SIG_CLR, 0);
+	Check(error && UOS_ErrnoGet() == ERR_OSS_SIG_CLR,
+		  "second setstat Z140_SIG_CLR");
+
+	Close(path);
+	signal(SIGUSR1, SIG_DFL);
+}
+
+/********************************* SigHandler ******************************/
+/** Signal handler of TestSig()
+ *
+ *  \param sig        \IN  signal number
+ */
+static void SigHandler(int sig)
+{
+	G_sigCnt++;
+}
+
+/********************************* TestWrap ********************************/
+/** 32-bit wrap of the distance registers
+ *
+ *  With KEEP_DISTANCE, the 64-bit distances start with the register values
+ *  of the first record and continue over the wrap. After close and open,
+ *  they continue with the kept 64-bit values.
+ *
+ *  \param device     \IN  device name
+ */
+static void TestWrap(const char *device)
+{
+	Z140_DISTANCE64 dist;
+	M_SG_BLOCK blk;
+	MDIS_PATH path;
+	int32 val = 0;
+	u_int32 n;
+	u_int64 fwd = (u_int64)WRAP_FWD + (WRAP_NUM - 1) * WRAP_FWD_INC;
+	u_int64 bwd = (u_int64)WRAP_BWD + (WRAP_NUM - 1);
+
+	if ((path = Open(device)) < 0)
+		return;
+
+	/* trace duration 100ms */
+	UOS_Delay(200);
+
+	for (n = 0; n < 2; n++) {
+		blk.size = sizeof(dist);
+		blk.data = (void*)&dist;
+		Check(M_getstat(path, Z140_BLK_DISTANCE64, (int32*)&blk) == 0,
+			  "getstat Z140_BLK_DISTANCE64");
+		Check(dist.distFwd == fwd, "%s64-bit forward 0x%llx, expected 0x%llx",
+			  n ? "reopen: " : "",
+			  (unsigned long long)dist.distFwd, (unsigned long long)fwd);
+		Check(dist.distBwd == bwd, "%s64-bit backward 0x%llx, expected 0x%llx",
+			  n ? "reopen: " : "",
+			  (unsigned long long)dist.distBwd, (unsigned long long)bwd);
+
+		M_getstat(path, Z140_DISTANCE_FWD, &val);
+		Check((u_int32)val == (u_int32)fwd, "forward register 0x%x", val);
+
+		/* reopen: the 64-bit distances are kept */
+		Close(path);
+		if (!n && (path = M_open((char*)device)) < 0) {
+			Check(FALSE, "reopen: M_open: %s", M_errstring(UOS_ErrnoGet()));
+			return;
+		}
+	}
+}
+
+/********************************* TestStat ********************************/
+/** Period statistics windows and histograms
+ *
+ *  Period A alternates between 1000 and 3000, so each window of 10 periods
+ *  has mean 2000 and the sum of squared deviations 10 * 1000^2. Period B
+ *  is constant. Both signals complete their windows independently.
+ */
+static void TestStat(void)
+{
+	Z140_PERSTAT stat;
+	static Z140_HIST hist;
+	M_SG_BLOCK blk;
+	MDIS_PATH path;
+	Z140_PERSTAT_SIG *a = &stat.last[0], *b = &stat.last[1];
+	u_int32 lo, hi, n;
+
+	if ((path = Open("t_stat")) < 0)
+		return;
+
+	/* trace duration 1.2s */
+	UOS_Delay(1500);
+
+	blk.size = sizeof(stat);
+	blk.data = (void*)&stat;
+	Check(M_getstat(path, Z140_BLK_PERSTAT, (int32*)&blk) == 0,
+		  "getstat Z140_BLK_PERSTAT");
+	blk.size = sizeof(hist);
+	blk.data = (void*)&hist;
+	Check(M_getstat(path, Z140_BLK_HIST, (int32*)&blk) == 0,
+		  "getstat Z140_BLK_HIST");
+
+	/* windows */
+	Check(stat.window == STAT_WIN, "window %u", stat.window);
+	Check(stat.windows[0] >= STAT_NUM / STAT_WIN - 1 &&
+		  stat.windows[0] <= STAT_NUM / STAT_WIN,
+		  "signal A: %u windows", stat.windows[0]);
+	Check(stat.windows[1] == stat.windows[0],
+		  "signal B: %u windows, signal A %u", stat.windows[1], stat.windows[0]);
+
+	Check(a->count == STAT_WIN && a->min == 1000 && a->max == 3000 &&
+		  a->mean == 2000 && a->m2 == 10000000,
+		  "signal A: count %u min %u max %u mean %u m2 %llu", a->count,
+		  a->min, a->max, a->mean, (unsigned long long)a->m2);
+	Check(Z140_PERSTAT_VAR(*a) == 10000000 / (STAT_WIN - 1),
+		  "signal A: variance %llu", (unsigned long long)Z140_PERSTAT_VAR(*a));
+	Check(b->count == STAT_WIN && b->min == 2000 && b->max == 2000 &&
+		  b->mean == 2000 && b->m2 == 0,
+		  "signal B: count %u min %u max %u mean %u m2 %llu", b->count,
+		  b->min, b->max, b->mean, (unsigned long long)b->m2);
+
+	/* histograms: all periods in their buckets */
+	n  = stat.windows[0] * STAT_WIN + stat.cur[0].count;
+	lo = hist.sig[0].bucket[HistIdx(1000)];
+	hi = hist.sig[0].bucket[HistIdx(3000)];
+	Check(hist.sig[0].count == n, "histogram A: count %llu, expected %u",
+		  (unsigned long long)hist.sig[0].count, n);
+	Check(lo && hi && lo + hi == n,
+		  "histogram A: buckets 1000: %u, 3000: %u", lo, hi);
+	Check(hist.sig[1].bucket[HistIdx(2000)] == hist.sig[1].count,
+		  "histogram B: bucket 2000: %u, count %llu",
+		  hist.sig[1].bucket[HistIdx(2000)],
+		  (unsigned long long)hist.sig[1].count);
+
+	Close(path);
+}
+
+/********************************* TestCnt *********************************/
+/** Driver counters of the period errors
+ *
+ *  Z140_PERIOD_A is polled every 1ms while valid, phase violation and
+ *  invalid periods are replayed every 20ms. The counters match the errors
+ *  returned to the caller. The Z140_ERR_NO_DATA of a Z140_BLK_VALUE is
+ *  returned in the structure and not counted. Z140_CNT_RST clears all
+ *  counters.
+ */
+static void TestCnt(void)
+{
+	Z140_COUNTERS cnt;
+	Z140_CNT_CALL *call = &cnt.getStat[Z140_CNT_IDX(Z140_PERIOD_A)];
+	Z140_VALUE val;
+	M_SG_BLOCK blk;
+	MDIS_PATH path;
+	u_int32 n, noData = 0, phViol = 0, perInv = 0, errors = 0;
+	int32 value, error;
+
+	if ((path = Open("t_cnt")) < 0)
+		return;
+
+	Check(M_setstat(path, Z140_CNT_RST, 0) == 0, "setstat Z140_CNT_RST");
+
+	for (n = 0; n < CNT_POLLS; n++) {
+		error = M_getstat(path, Z140_PERIOD_A, &value);
+		if (error) {
+			errors++;
+			switch (UOS_ErrnoGet()) {
+				case Z140_ERR_NO_DATA:		noData++; break;
+				case Z140_ERR_PH_VIOLATION:	phViol++; break;
+				case Z140_ERR_PER_INVALID:	perInv++; break;
+			}
+		}
+		UOS_Delay(1);
+	}
+	Check(noData && phViol && perInv,
+		  "errors: no data %u, phase violation %u, invalid %u",
+		  noData, phViol, perInv);
+
+	/* no new period: error in the structure only */
+	val.code = Z140_PERIOD_A;
+	blk.size = sizeof(val);
+	blk.data = (void*)&val;
+	error = M_getstat(path, Z140_BLK_VALUE, (int32*)&blk);
+	Check(!error && val.error == Z140_ERR_NO_DATA,
+		  "getstat Z140_BLK_VALUE: error 0x%x", val.error);
+
+	blk.size = sizeof(cnt);
+	blk.data = (void*)&cnt;
+	Check(M_getstat(path, Z140_BLK_COUNTERS, (int32*)&blk) == 0,
+		  "getstat Z140_BLK_COUNTERS");
+	Check(cnt.errNoData == noData && cnt.errPhViolation == phViol &&
+		  cnt.errPerInvalid == perInv,
+		  "counted no data %u, phase violation %u, invalid %u, "
+		  "expected %u, %u, %u", cnt.errNoData, cnt.errPhViolation,
+		  cnt.errPerInvalid, noData, phViol, perInv);
+	Check(call->calls == CNT_POLLS && call->errors == errors,
+		  "Z140_PERIOD_A: %u calls, %u errors, expected %u, %u",
+		  call->calls, call->errors, CNT_POLLS, errors);
+
+	/* reset */
+	Check(M_setstat(path, Z140_CNT_RST, 0) == 0, "setstat Z140_CNT_RST");
+	Check(M_getstat(path, Z140_BLK_COUNTERS, (int32*)&blk) == 0,
+		  "getstat Z140_BLK_COUNTERS");
+	Check(!cnt.errNoData && !cnt.errPhViolation && !cnt.errPerInvalid &&
+		  !call->calls,
+		  "reset: no data %u, phase violation %u, invalid %u, %u calls",
+		  cnt.errNoData, cnt.errPhViolation, cnt.errPerInvalid, call->calls);
+
+	Close(path);
+}
+
+/********************************* TestFilter ******************************/
+/** Median and IIR period filter
+ *
+ *  The median of 3 (signal A) never passes a single spike and ends with the
+ *  median of the last three periods. The IIR output (signal B) rises
+ *  monotonically after the step and ends with the value of the reference
+ *  calculation.
+ */
+static void TestFilter(void)
+{
+	MDIS_PATH path;
+	int32 fltA = 0, fltB = 0, lastB = 0;
+	u_int32 n, spike = FALSE, fall = FALSE;
+	u_int32 iir = IirRef(1000, 2000, FLT_NUM - FLT_STEP);
+
+	if ((path = Open("t_flt")) < 0)
+		return;
+
+	/* poll during the trace (400ms) */
+	for (n = 0; n < 250; n++) {
+		if (M_getstat(path, Z140_PERIOD_FLT_A, &fltA) == 0 && fltA == 9000)
+			spike = TRUE;
+		if (M_getstat(path, Z140_PERIOD_FLT_B, &fltB) == 0) {
+			if (fltB < lastB)
+				fall = TRUE;
+			lastB = fltB;
+		}
+		UOS_Delay(2);
+	}
+
+	Check(!spike, "median: spike passed the filter");
+	Check(!fall, "IIR: output not monotonic");
+
+	M_getstat(path, Z140_PERIOD_FLT_A, &fltA);
+	M_getstat(path, Z140_PERIOD_FLT_B, &fltB);
+	Check(fltA == 1200, "median: %d, expected 1200", fltA);
+	Check((u_int32)fltB == iir, "IIR: %d, expected %u", fltB, iir);
+
+	Close(path);
+}
+
+/********************************* TestSpeed *******************************/
+/** Speed estimate
+ *
+ *  \param device     \IN  device name
+ *  \param dir        \IN  expected direction (1=forward, -1=backward,
+ *                         0=standstill)
+ *  \param poll       \IN  TRUE: no sampler, estimate on Z140_SPEED calls
+ */
+static void TestSpeed(const char *device, int32 dir, u_int32 poll)
+{
+	Z140_SPEED_EST spd;
+	M_SG_BLOCK blk;
+	MDIS_PATH path;
+	int32 pps, val, n;
+
+	if ((path = Open(device)) < 0)
+		return;
+
+	if (poll) {
+		for (n = 0; n < 25; n++) {
+			M_getstat(path, Z140_SPEED, &val);
+			UOS_Delay(20);
+		}
+	}
+	else
+		UOS_Delay(500);
+
+	blk.size = sizeof(spd);
+	blk.data = (void*)&spd;
+	Check(M_getstat(path, Z140_BLK_SPEED, (int32*)&blk) == 0,
+		  "getstat Z140_BLK_SPEED");
+	pps = spd.pps / (1 << Z140_SPEED_FRAC);
+
+	if (dir) {
+		Check((spd.quality & Z140_SPD_VALID) &&
+			  !(spd.quality & Z140_SPD_STANDSTILL),
+			  "quality 0x%x", spd.quality);
+		Check(pps >= dir * SPD_HZ - SPD_TOL && pps <= dir * SPD_HZ + SPD_TOL,
+			  "speed %d pulses/s, expected %d", pps, dir * SPD_HZ);
+	}
+	else {
+		Check((spd.quality & Z140_SPD_VALID) &&
+			  (spd.quality & Z140_SPD_STANDSTILL),
+			  "quality 0x%x", spd.quality);
+		Check(spd.pps == 0, "speed %d, expected 0", spd.pps);
+	}
+
+	Close(path);
+}
+
+/********************************* TestTrace *******************************/
+/** Call trace ring
+ *
+ *  The trace records setstat and getstat calls with code, value and error
+ *  in call order. With more calls than TRACE_DEPTH, the oldest entries are
+ *  overwritten and the drain returns the last TRACE_DEPTH entries. A drain
+ *  removes the entries. A TRACE_DEPTH which is not a power of two is
+ *  rejected.
+ */
+static void TestTrace(void)
+{
+	Z140_TRACE_ENTRY e[2 * TRC_DEPTH];
+	M_SG_BLOCK blk;
+	MDIS_PATH path;
+	int32 val = 0, num, n;
+	u_int32 seq;
+
+	if ((path = Open("t_trace")) < 0)
+		return;
+
+	blk.data = (void*)e;
+
+	/* discard calls of the open */
+	blk.size = sizeof(e);
+	M_getstat(path, Z140_BLK_TRACE, (int32*)&blk);
+
+	/* traced calls */
+	M_setstat(path, Z140_PERSTAT_WIN, 5);
+	M_setstat(path, Z140_PERSTAT_WIN, 70000);
+	M_getstat(path, Z140_PERSTAT_WIN, &val);
+
+	blk.size = sizeof(e);
+	Check(M_getstat(path, Z140_BLK_TRACE, (int32*)&blk) == 0,
+		  "getstat Z140_BLK_TRACE");
+	num = blk.size / sizeof(Z140_TRACE_ENTRY);
+	Check(num == 3, "%d entries, expected 3", num);
+	if (num == 3) {
+		Check(e[0].type == Z140_TRC_SET && e[0].code == Z140_PERSTAT_WIN &&
+			  e[0].value == 5 && e[0].error == 0,
+			  "entry 0: type %u code 0x%x value %d error 0x%x",
+			  e[0].type, e[0].code, e[0].value, e[0].error);
+		Check(e[1].type == Z140_TRC_SET && e[1].value == 70000 &&
+			  e[1].error == ERR_LL_ILL_PARAM,
+			  "entry 1: type %u value %d error 0x%x",
+			  e[1].type, e[1].value, e[1].error);
+		Check(e[2].type == Z140_TRC_GET && e[2].value == 5 &&
+			  e[2].error == 0,
+			  "entry 2: type %u value %d error 0x%x",
+			  e[2].type, e[2].value, e[2].error);
+		Check(e[1].seq == e[0].seq + 1 && e[2].seq == e[1].seq + 1 &&
+			  e[1].tstamp >= e[0].tstamp && e[2].tstamp >= e[1].tstamp,
+			  "entries not in call order");
+	}
+	seq = (num > 0) ? e[num - 1].seq + 1 : 0;
+
+	/* overwrite */
+	for (n = 0; n < 2 * TRC_DEPTH + 4; n++)
+		M_getstat(path, Z140_PERSTAT_WIN, &val);
+
+	blk.size = sizeof(e);
+	M_getstat(path, Z140_BLK_TRACE, (int32*)&blk);
+	num = blk.size / sizeof(Z140_TRACE_ENTRY);
+	Check(num == TRC_DEPTH, "overwrite: %d entries, expected %d",
+		  num, TRC_DEPTH);
+	if (num > 0)
+		Check(e[0].seq == seq + TRC_DEPTH + 4,
+			  "overwrite: first seq %u, expected %u",
+			  e[0].seq, seq + TRC_DEPTH + 4);
+	for (n = 1; n < num; n++) {
+		if (e[n].seq != e[n - 1].seq + 1) {
+			Check(FALSE, "overwrite: gap at entry %d", n);
+			break;
+		}
+	}
+
+	/* drained */
+	blk.size = sizeof(e);
+	M_getstat(path, Z140_BLK_TRACE, (int32*)&blk);
+	Check(blk.size == 0, "drained: %d bytes left", blk.size);
+
+	Close(path);
+
+	printf("t_trace_npot\n");
+	path = M_open("t_trace_npot");
+	Check(path < 0, "TRACE_DEPTH 12 accepted");
+	if (path >= 0)
+		M_close(path);
+}
+
+/********************************* TestUio *********************************/
+/** Z140_UIO library against a mock file
+ *
+ *  The mock file holds the UIO maps like the UIO device: map N at offset
+ *  N * page size. The register window is at offset 0x100 of map 1.
+ */
+static void TestUio(void)
+{
+	Z140_UIO_HANDLE *hdl;
+	Z140_SNAPSHOT snap;
+	long pageSize = sysconf(_SC_PAGESIZE);
+	u_int32 *regs, per, fwd, bwd;
+	u_int8 *map;
+	FILE *fp;
+	int32 error;
+
+	printf("uio\n");
+
+	/* mock file */
+	if ((map = (u_int8*)calloc(2, pageSize)) == NULL) {
+		Check(FALSE, "calloc");
+		return;
+	}
+	regs = (u_int32*)(map + pageSize + 0x100);
+	regs[Z140R_PERIOD_A / 4]     = htole32(PER_NEW_VLD | 1234);
+	regs[Z140R_PERIOD_B / 4]     = htole32(PER_NEW_VLD | Z140_PER_LSTS | 555);
+	regs[Z140R_DISTANCE_FWD / 4] = htole32(0x10);
+	regs[Z140R_DISTANCE_BWD / 4] = htole32(0x20);
+	regs[Z140R_STATUS / 4]       = htole32(Z140_ST_ROLLING | Z140_ST_DIR_FWD);
+
+	fp = fopen(UIO_MOCK, "wb");
+	Check(fp && fwrite(map, pageSize, 2, fp) == 2, "write %s", UIO_MOCK);
+	if (fp)
+		fclose(fp);
+	free(map);
+
+	/* exclusive: periods */
+	error = Z140_UIO_Open(UIO_MOCK, 1, 0x100, Z140_UIO_EXCL, &hdl);
+	Check(error == 0, "Z140_UIO_Open: 0x%x", error);
+	if (!error) {
+		error = Z140_UIO_Period(hdl, 0, &per);
+		Check(!error && per == 1234, "period A: 0x%x %u", error, per);
+		error = Z140_UIO_Period(hdl, 1, &per);
+		Check(error == Z140_ERR_PH_VIOLATION && per == 555,
+			  "period B: 0x%x %u", error, per);
+		Z140_UIO_Distance(hdl, &fwd, &bwd);
+		Check(fwd == 0x10 && bwd == 0x20, "distance 0x%x 0x%x", fwd, bwd);
+		Check(Z140_UIO_Status(hdl) == (Z140_ST_ROLLING | Z140_ST_DIR_FWD),
+			  "status");
+		Z140_UIO_Snapshot(hdl, &snap);
+		Check(snap.periodA == (PER_NEW_VLD | 1234) && snap.distBwd == 0x20 &&
+			  snap.ageA == Z140_AGE_NONE &&
+			  snap.status == (Z140_ST_ROLLING | Z140_ST_DIR_FWD), "snapshot");
+		Check(Z140_UIO_Close(&hdl) == 0 && !hdl, "Z140_UIO_Close");
+	}
+
+	/* shared: no period access */
+	error = Z140_UIO_Open(UIO_MOCK, 1, 0x100, 0, &hdl);
+	Check(error == 0, "Z140_UIO_Open (shared): 0x%x", error);
+	if (!error) {
+		error = Z140_UIO_Period(hdl, 0, &per);
+		Check(error == Z140_UIO_ERR_NOT_EXCL, "period A (shared): 0x%x", error);
+		Z140_UIO_Snapshot(hdl, &snap);
+		Check(snap.periodA == 0 && snap.distFwd == 0x10, "snapshot (shared)");
+		Z140_UIO_Close(&hdl);
+	}
+
+	/* map beyond the mock file */
+	error = Z140_UIO_Open(UIO_MOCK, 2, 0, 0, &hdl);
+	Check(error == ERR_UOS_ILL_PARAM && !hdl, "Z140_UIO_Open (map 2): 0x%x",
+		  error);
+}
+
+/********************************* TestZrec ********************************/
+/** zrec codec round trip
+ *
+ *  Writes ZREC_NUM pseudo-random records with runs longer than
+ *  Z140_ZREC_RUN_MAX, period flag changes, 32-bit wrap of the distance
+ *  counters and varying (also negative) timestamp deltas. Reads them back
+ *  sequentially and after seeks to random records, sync points and the
+ *  records around them. Reads damaged copies (see ZrecDamaged()) with
+ *  ZREC_DAMAGE bytes of 0xff in the middle and with a varint running into
+ *  a sync record.
+ */
+static void TestZrec(void)
+{
+	Z140_ZREC_HANDLE *hdl;
+	Z140_SNAPSHOT *s, snap;
+	u_int32 n, run = 0, rec, bad = 0;
+	int64 dt = 1000000;
+	int32 error;
+	u_int8 *data;
+	long size = 0;
+	FILE *fp;
+
+	printf("zrec\n");
+
+	/*--------------------------+
+	|  generate records         |
+	+--------------------------*/
+	for (n = 0; n < ZREC_NUM; n++) {
+		s = &G_zrec[n];
+
+		/* equal record with equal timestamp delta */
+		if (run) {
+			*s = G_zrec[n - 1];
+			s->tstamp += dt;
+			run--;
+			continue;
+		}
+
+		if (n == 0) {
+			memset(s, 0, sizeof(*s));
+			s->version = Z140_SNAPSHOT_VER;
+			s->tstamp  = 5000000000ULL;
+			s->distFwd = 0xfffff000;
+			s->distBwd = 0xffffff80;
+			s->periodA = PER_NEW_VLD | 1000;
+			s->periodB = PER_NEW_VLD | 2000;
+		}
+		else
+			*s = G_zrec[n - 1];
+
+		/* timestamp delta: jitter, jumps and rare steps back */
+		switch (Rand(8)) {
+		case 0:	dt = Rand(100000000);						break;
+		case 1:	dt = -(int64)Rand(1000000);					break;
+		case 2:
+		case 3:	dt += (int64)Rand(2000) - 1000;				break;
+		default:											break;
+		}
+		s->tstamp += dt;
+
+		if (Rand(4))
+			s->distFwd += Rand(300);
+		if (!Rand(8))
+			s->distBwd += Rand(300);
+		if (Rand(2))
+			s->periodA = (s->periodA & ~Z140_PER_MASK) | Rand(Z140_PER_MASK + 1);
+		if (!Rand(4))
+			s->periodB = (s->periodB & ~Z140_PER_MASK) | Rand(2) * 100000;
+		if (!Rand(8))
+			s->periodA ^= Z140_PER_NEW | (Rand(2) ? Z140_PER_VLD : 0);
+		if (!Rand(16))
+			s->periodB ^= Z140_PER_LSTS;
+		if (!Rand(32))
+			s->status = Rand(0x100);
+
+		if (!Rand(16))
+			run = Rand(80) + 1;
+	}
+
+	Check(G_zrec[ZREC_NUM - 1].distFwd < G_zrec[0].distFwd &&
+		  G_zrec[ZREC_NUM - 1].distBwd < G_zrec[0].distBwd,
+		  "zrec: distance counters did not wrap");
+
+	/*--------------------------+
+	|  write                    |
+	+--------------------------*/
+	error = Z140_ZREC_Create(TRACE_ZREC, ZREC_SYNC, &hdl);
+	Check(error == 0, "Z140_ZREC_Create: 0x%x", error);
+	if (error)
+		return;
+	for (n = 0; n < ZREC_NUM && !error; n++)
+		error = Z140_ZREC_Write(hdl, &G_zrec[n]);
+	Check(error == 0, "Z140_ZREC_Write record %u: 0x%x", n - 1, error);
+	error = Z140_ZREC_Close(&hdl);
+	Check(error == 0 && !hdl, "Z140_ZREC_Close (write): 0x%x", error);
+
+	/*--------------------------+
+	|  read                     |
+	+--------------------------*/
+	error = Z140_ZREC_Open(TRACE_ZREC, &hdl);
+	Check(error == 0, "Z140_ZREC_Open: 0x%x", error);
+	if (error)
+		return;
+
+	for (n = 0; n < ZREC_NUM; n++) {
+		if ((error = Z140_ZREC_Read(hdl, &snap)))
+			break;
+		if (!SnapEqual(&snap, &G_zrec[n]) && !bad++)
+			Check(FALSE, "zrec: record %u differs", n);
+	}
+	Check(n == ZREC_NUM, "zrec: read %u records: 0x%x", n, error);
+	Check(!bad, "zrec: %u records differ", bad);
+	error = Z140_ZREC_Read(hdl, &snap);
+	Check(error == Z140_ZREC_END, "zrec: read after last record: 0x%x", error);
+
+	/*--------------------------+
+	|  seek                     |
+	+--------------------------*/
+	for (n = 0; n < ZREC_SEEKS + 6; n++) {
+		switch (n) {
+		case 0:	rec = 0;					break;
+		case 1:	rec = ZREC_SYNC - 1;		break;
+		case 2:	rec = ZREC_SYNC;			break;
+		case 3:	rec = ZREC_SYNC + 1;		break;
+		case 4:	rec = ZREC_NUM - ZREC_SYNC;	break;
+		case 5:	rec = ZREC_NUM - 1;			break;
+		default: rec = Rand(ZREC_NUM);		break;
+		}
+
+		error = Z140_ZREC_Seek(hdl, rec);
+		Check(error == 0, "Z140_ZREC_Seek(%u): 0x%x", rec, error);
+		if (error)
+			continue;
+
+		/* the record and its successor */
+		error = Z140_ZREC_Read(hdl, &snap);
+		Check(error == 0 && SnapEqual(&snap, &G_zrec[rec]),
+			  "zrec: record %u after seek: 0x%x", rec, error);
+		error = Z140_ZREC_Read(hdl, &snap);
+		if (rec + 1 < ZREC_NUM)
+			Check(error == 0 && SnapEqual(&snap, &G_zrec[rec + 1]),
+				  "zrec: record %u after seek to %u: 0x%x", rec + 1, rec,
+				  error);
+		else
+			Check(error == Z140_ZREC_END,
+				  "zrec: read after seek to last record: 0x%x", error);
+	}
+
+	error = Z140_ZREC_Seek(hdl, ZREC_NUM);
+	Check(error == Z140_ZREC_END, "Z140_ZREC_Seek(%u): 0x%x", ZREC_NUM, error);
+
+	error = Z140_ZREC_Close(&hdl);
+	Check(error == 0 && !hdl, "Z140_ZREC_Close (read): 0x%x", error);
+
+	/*--------------------------+
+	|  damaged file             |
+	+--------------------------*/
+	data = NULL;
+	if ((fp = fopen(TRACE_ZREC, "rb")) != NULL) {
+		fseek(fp, 0, SEEK_END);
+		size = ftell(fp);
+		rewind(fp);
+		if ((data = (u_int8*)malloc(size)) != NULL &&
+			fread(data, 1, size, fp) != (size_t)size) {
+			free(data);
+			data = NULL;
+		}
+		fclose(fp);
+	}
+	Check(data != NULL, "read %s", TRACE_ZREC);
+	if (!data)
+		return;
+
+	/*
+	 * varint running into a sync record: the first sync record after the
+	 * 16 byte file header which follows the last byte of a varint
+	 */
+	for (n = 17; n + 8 <= (u_int32)size; n++) {
+		rec = data[n + 4] | (data[n + 5] << 8) | (data[n + 6] << 16) |
+			((u_int32)data[n + 7] << 24);
+		if (data[n] == Z140_ZREC_SYNC && !memcmp(&data[n + 1], "ZSY", 3) &&
+			rec && rec % ZREC_SYNC == 0 && !(data[n - 1] & 0x80))
+			break;
+	}
+	Check(n + 8 <= (u_int32)size, "zrec: no sync record after varint");
+	if (n + 8 <= (u_int32)size) {
+		data[n - 1] |= 0x80;
+		ZrecDamaged(data, size, rec);
+		data[n - 1] &= 0x7f;
+	}
+
+	/* overwritten bytes */
+	memset(data + size / 2, 0xff, ZREC_DAMAGE);
+	ZrecDamaged(data, size, 0);
+
+	free(data);
+}
+
+/******************************* ZrecDamaged *******************************/
+/** Read damaged zrec file
+ *
+ *  Writes the file data to TRACE_ZREC_BAD and reads it until
+ *  Z140_ZREC_Read() fails with Z140_ZREC_ERR_FORMAT. After
+ *  Z140_ZREC_Resync(), the records from the sync point must be equal to
+ *  G_zrec.
+ *
+ *  \param data       \IN  file data
+ *  \param size       \IN  file size
+ *  \param sync       \IN  expected sync point (record index),
+ *                         0: the first after the damaged record
+ */
+static void ZrecDamaged(const u_int8 *data, long size, u_int32 sync)
+{
+	Z140_ZREC_HANDLE *hdl;
+	Z140_SNAPSHOT snap;
+	u_int32 n;
+	int32 error;
+	FILE *fp;
+
+	fp = fopen(TRACE_ZREC_BAD, "wb");
+	Check(fp && fwrite(data, 1, size, fp) == (size_t)size, "write %s",
+		  TRACE_ZREC_BAD);
+	if (fp)
+		fclose(fp);
+
+	error = Z140_ZREC_Open(TRACE_ZREC_BAD, &hdl);
+	Check(error == 0, "Z140_ZREC_Open (damaged): 0x%x", error);
+	if (error)
+		return;
+
+	/* up to the damage */
+	for (n = 0; n < ZREC_NUM; n++)
+		if ((error = Z140_ZREC_Read(hdl, &snap)))
+			break;
+	Check(error == Z140_ZREC_ERR_FORMAT && n > 0 && n < ZREC_NUM,
+		  "zrec: damaged record %u: 0x%x", n, error);
+	if (!sync)
+		sync = (n / ZREC_SYNC + 1) * ZREC_SYNC;
+
+	/* sync point and the records after it */
+	error = Z140_ZREC_Resync(hdl);
+	Check(error == 0, "Z140_ZREC_Resync: 0x%x", error);
+	for (n = sync; n < ZREC_NUM; n++) {
+		if ((error = Z140_ZREC_Read(hdl, &snap)))
+			break;
+		if (!SnapEqual(&snap, &G_zrec[n]))
+			break;
+	}
+	Check(n == ZREC_NUM, "zrec: resync to %u: record %u: 0x%x", sync, n,
+		  error);
+	error = Z140_ZREC_Read(hdl, &snap);
+	Check(error == Z140_ZREC_END, "zrec: read after resync: 0x%x", error);
+	error = Z140_ZREC_Resync(hdl);
+	Check(error == Z140_ZREC_END, "Z140_ZREC_Resync (end): 0x%x", error);
+
+	Z140_ZREC_Close(&hdl);
+}
+
+/********************************* HistIdx *********************************/
+/** Histogram bucket of a period
+ *
+ *  \param period     \IN  period [1/32us]
+ *
+ *  \return           bucket index
+ */
+static u_int32 HistIdx(u_int32 period)
+{
+	u_int32 idx;
+
+	for (idx = 0; idx < Z140_HIST_BUCKETS - 1; idx++)
+		if (period < Z140_HIST_LOW(idx + 1))
+			break;
+
+	return (idx);
+}
+
+/********************************* IirRef **********************************/
+/** Reference IIR output after a step
+ *
+ *  Same fixed-point calculation as the driver: the output starts with the
+ *  first period and is kept with FLT_IIR_FRAC fractional bits.
+ *
+ *  \param x0         \IN  period before the step (at least one)
+ *  \param x1         \IN  period after the step
+ *  \param steps      \IN  number of periods after the step
+ *
+ *  \return           rounded output [1/32us]
+ */
+static u_int32 IirRef(u_int32 x0, u_int32 x1, u_int32 steps)
+{
+	u_int64 y = (u_int64)x0 << FLT_IIR_FRAC;
+	u_int64 x = (u_int64)x1 << FLT_IIR_FRAC;
+
+	while (steps--)
+		y += (x - y) >> FLT_IIR_K;
+
+	return ((u_int32)((y + (1 << (FLT_IIR_FRAC - 1))) >> FLT_IIR_FRAC));
+}
+
+/********************************* CfgEqual ********************************/
+/** Compare two configurations
+ *
+ *  \param a          \IN  configuration
+ *  \param b          \IN  configuration
+ *
+ *  \return           TRUE if equal
+ */
+static int CfgEqual(const Z140_CONFIG *a, const Z140_CONFIG *b)
+{
+	return (a->debounceT == b->debounceT && a->measTout == b->measTout &&
+			a->rollingT == b->rollingT && a->standstillT == b->standstillT &&
+			a->dirdetTout == b->dirdetTout && a->tpattern == b->tpattern);
+}
+
+/********************************* SnapEqual *******************************/
+/** Compare a snapshot read from a zrec file with the written one
+ *
+ *  \param a          \IN  snapshot read (ages Z140_AGE_NONE)
+ *  \param b          \IN  snapshot written
+ *
+ *  \return           TRUE if equal
+ */
+static int SnapEqual(const Z140_SNAPSHOT *a, const Z140_SNAPSHOT *b)
+{
+	return (a->version == Z140_SNAPSHOT_VER &&
+			a->periodA == b->periodA && a->periodB == b->periodB &&
+			a->distFwd == b->distFwd && a->distBwd == b->distBwd &&
+			a->status  == b->status  && a->tstamp  == b->tstamp  &&
+			a->ageA == Z140_AGE_NONE && a->ageB == Z140_AGE_NONE);
+}
+
+/********************************* Rand ************************************/
+/** Reproducible pseudo-random number (LCG)
+ *
+ *  \param range      \IN  number of values
+ *
+ *  \return           0..range-1
+ */
+static u_int32 Rand(u_int32 range)
+{
+	G_rand = G_rand * 1103515245 + 12345;
+
+	return ((u_int32)(((u_int64)(G_rand >> 1) * range) >> 31));
+}
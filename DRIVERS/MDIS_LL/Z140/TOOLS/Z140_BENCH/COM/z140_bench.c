@@ -0,0 +1,689 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                    Z140_BENCH                      ************
+ ************                                                    ************
+ ****************************************************************************/
+/*!
+ *        \file  z140_bench.c
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  Latency and throughput benchmark for the Z140 driver
+ *
+ *               The tool measures the call latency of each getstat/setstat
+ *               code and of M_getblock() and the loop rate of the five-call measurement cycle
+ *               (period A/B, distance fwd/bwd, status) as used by
+ *               z140_simp. The cycle can be run by several threads or
+ *               processes on the same device to measure the contention.
+ *               The results are written as CSV.
+ *
+ *     Required: libraries: mdis_api, usr_oss, usr_utl, pthread
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*--------------------------------------+
+|  INCLUDES                             |
++--------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_api.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+#include <MEN/mdis_err.h>
+#include <MEN/z140_drv.h>
+
+static const char IdentString[]=MENT_XSTR(MAK_REVISION);
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define ERR_OK		0
+#define ERR_PARAM	1
+#define ERR_FUNC	2
+
+#define BENCH_WORKER_MAX	64		/**< max. number of threads/processes */
+
+#define BENCH_TRC_NUM		16		/**< trace entries per Z140_BLK_TRACE call */
+#define BENCH_SIG_NUM		SIGUSR1	/**< signal of Z140_SIG_SET (ignored) */
+
+/* code types */
+#define BENCH_G		0	/**< getstat */
+#define BENCH_BG	1	/**< block getstat */
+#define BENCH_RD	2	/**< M_getblock() of one Z140_SAMPLE */
+#define BENCH_S		3	/**< setstat, writes back the value of the getstat */
+#define BENCH_BS	4	/**< block setstat, writes back the data of the getstat */
+#define BENCH_SR	5	/**< setstat which resets driver state (value 0) */
+#define BENCH_SIG	6	/**< Z140_SIG_SET/CLR, each call paired with the other */
+
+/** code and its name */
+#define CODE(c)		c, #c
+
+/*--------------------------------------+
+|   TYPEDEFS                            |
++--------------------------------------*/
+/** benchmarked code */
+typedef struct {
+	int32	code;		/**< getstat/setstat code */
+	char	*name;		/**< name of the code */
+	int32	type;		/**< BENCH_xxx */
+	int32	size;		/**< buffer size for block codes */
+} BENCH_CODE;
+
+/** loop test state, shared between the workers */
+typedef struct {
+	volatile int32	go;			/**< start flag */
+	char			*device;	/**< device name */
+	u_int32			cycles;		/**< cycles per worker */
+	u_int32			errors[BENCH_WORKER_MAX];	/**< failed calls per worker (-1: open failed) */
+	u_int32			lat[1];		/**< cycle latencies [ns] (workers * cycles) */
+} BENCH_LOOP;
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static const BENCH_CODE G_code[] = {
+	{ CODE(Z140_DEBOUNCET),		BENCH_G,	0 },
+	{ CODE(Z140_MEAS_TOUT),		BENCH_G,	0 },
+	{ CODE(Z140_ROLLINGT),		BENCH_G,	0 },
+	{ CODE(Z140_STANDSTILLT),	BENCH_G,	0 },
+	{ CODE(Z140_DIRDET_TOUT),	BENCH_G,	0 },
+	{ CODE(Z140_TPATTERN),		BENCH_G,	0 },
+	{ CODE(Z140_PERIOD_A),		BENCH_G,	0 },
+	{ CODE(Z140_PERIOD_B),		BENCH_G,	0 },
+	{ CODE(Z140_DISTANCE_FWD),	BENCH_G,	0 },
+	{ CODE(Z140_DISTANCE_BWD),	BENCH_G,	0 },
+	{ CODE(Z140_STATUS),		BENCH_G,	0 },
+	{ CODE(Z140_RING_OVERRUN),	BENCH_G,	0 },
+	{ CODE(Z140_SIG_MASK),		BENCH_G,	0 },
+	{ CODE(Z140_SIG_EDGES),		BENCH_G,	0 },
+	{ CODE(Z140_PERSTAT_WIN),	BENCH_G,	0 },
+	{ CODE(Z140_SHADOW_CHK),	BENCH_G,	0 },
+	{ CODE(Z140_PROFILE),		BENCH_G,	0 },
+	{ CODE(Z140_PROFILE_NUM),	BENCH_G,	0 },
+	{ CODE(Z140_PERIOD_SEQ_A),	BENCH_G,	0 },
+	{ CODE(Z140_PERIOD_SEQ_B),	BENCH_G,	0 },
+	{ CODE(Z140_TRACE_MODE),	BENCH_G,	0 },
+	{ CODE(Z140_FILTER_A),		BENCH_G,	0 },
+	{ CODE(Z140_FILTER_B),		BENCH_G,	0 },
+	{ CODE(Z140_PERIOD_FLT_A),	BENCH_G,	0 },
+	{ CODE(Z140_PERIOD_FLT_B),	BENCH_G,	0 },
+	{ CODE(Z140_SPEED),			BENCH_G,	0 },
+	{ CODE(Z140_BLK_SNAPSHOT),	BENCH_BG,	sizeof(Z140_SNAPSHOT) },
+	{ CODE(Z140_BLK_DISTANCE64),BENCH_BG,	sizeof(Z140_DISTANCE64) },
+	{ CODE(Z140_BLK_PERSTAT),	BENCH_BG,	sizeof(Z140_PERSTAT) },
+	{ CODE(Z140_BLK_CONFIG),	BENCH_BG,	sizeof(Z140_CONFIG) },
+	{ CODE(Z140_BLK_PROFILES),	BENCH_BG,	sizeof(Z140_PROFILE_ENTRY) * Z140_PROFILE_MAX },
+	{ CODE(Z140_BLK_TSTAMP),	BENCH_BG,	sizeof(Z140_TSTAMP) },
+	{ CODE(Z140_BLK_HIST),		BENCH_BG,	sizeof(Z140_HIST) },
+	{ CODE(Z140_BLK_COUNTERS),	BENCH_BG,	sizeof(Z140_COUNTERS) },
+	{ CODE(Z140_BLK_SPEED),		BENCH_BG,	sizeof(Z140_SPEED_EST) },
+	{ CODE(Z140_BLK_VALUE),		BENCH_BG,	sizeof(Z140_VALUE) },
+	{ CODE(Z140_BLK_TRACE),		BENCH_BG,	sizeof(Z140_TRACE_ENTRY) * BENCH_TRC_NUM },
+	{ 0, "M_getblock",			BENCH_RD,	sizeof(Z140_SAMPLE) },
+	/* setstats (option -w) */
+	{ CODE(Z140_DEBOUNCET),		BENCH_S,	0 },
+	{ CODE(Z140_MEAS_TOUT),		BENCH_S,	0 },
+	{ CODE(Z140_ROLLINGT),		BENCH_S,	0 },
+	{ CODE(Z140_STANDSTILLT),	BENCH_S,	0 },
+	{ CODE(Z140_DIRDET_TOUT),	BENCH_S,	0 },
+	{ CODE(Z140_TPATTERN),		BENCH_S,	0 },
+	{ CODE(Z140_SIG_MASK),		BENCH_S,	0 },
+	{ CODE(Z140_PERSTAT_WIN),	BENCH_S,	0 },
+	{ CODE(Z140_TRACE_MODE),	BENCH_S,	0 },
+	{ CODE(Z140_FILTER_A),		BENCH_S,	0 },
+	{ CODE(Z140_FILTER_B),		BENCH_S,	0 },
+	{ CODE(Z140_PROFILE),		BENCH_S,	0 },
+	{ CODE(Z140_BLK_CONFIG),	BENCH_BS,	sizeof(Z140_CONFIG) },
+	{ CODE(Z140_DISTRST),		BENCH_SR,	0 },
+	{ CODE(Z140_PERSTAT_RST),	BENCH_SR,	0 },
+	{ CODE(Z140_HIST_RST),		BENCH_SR,	0 },
+	{ CODE(Z140_CNT_RST),		BENCH_SR,	0 },
+	{ CODE(Z140_RD_RELEASE),	BENCH_SR,	0 },
+	{ CODE(Z140_SIG_SET),		BENCH_SIG,	0 },
+	{ CODE(Z140_SIG_CLR),		BENCH_SIG,	0 },
+};
+
+/** five-call measurement cycle */
+static const int32 G_cycle[] = {
+	Z140_PERIOD_A, Z140_PERIOD_B, Z140_DISTANCE_FWD, Z140_DISTANCE_BWD, Z140_STATUS
+};
+
+static BENCH_LOOP *G_loop;
+
+/* buffer for block codes */
+static u_int8 G_blkBuf[sizeof(Z140_HIST) + sizeof(Z140_PROFILE_ENTRY) * Z140_PROFILE_MAX];
+
+/*--------------------------------------+
+|  PROTOTYPES                           |
++--------------------------------------*/
+static void usage(void);
+static int PrintError(char *info);
+static u_int64 TimeNs(void);
+static int CallFailed(int32 ret);
+static int CmpU32(const void *a, const void *b);
+static u_int32 Percentile(u_int32 *lat, u_int32 n, u_int32 permille);
+static void PrintResult(FILE *out, char *test, const BENCH_CODE *bc,
+						u_int32 workers, u_int32 calls, u_int32 errors,
+						u_int32 *lat, u_int64 wallNs);
+static void BenchCode(MDIS_PATH path, const BENCH_CODE *bc, u_int32 calls,
+					  u_int32 *lat, FILE *out);
+static void* LoopWorker(void *arg);
+static int BenchLoop(FILE *out, u_int32 workers, int proc);
+
+/********************************* usage ***********************************/
+/**  Print program usage
+ */
+static void usage(void)
+{
+	printf("Usage:    z140_bench <device> [<opts>]                                   \n");
+	printf("Function: Latency and throughput benchmark for the Z140 driver           \n");
+	printf("Options:                                                        [default]\n");
+	printf("    device     device name (e.g. freq_1)                                 \n");
+	printf("    -n=<n>     calls per getstat/setstat code (0=skip)..........[10000]  \n");
+	printf("    -l=<n>     five-call cycles per worker (0=skip).............[10000]  \n");
+	printf("    -t=<n>     run the cycles in n threads (max. 64)............[1]      \n");
+	printf("    -p=<n>     run the cycles in n processes (max. 64)..........[-]      \n");
+	printf("    -w         also benchmark setstat codes                              \n");
+	printf("    -o=<file>  write results to file............................[stdout] \n");
+	printf("\n");
+	printf("Notes:\n");
+	printf("- Output: one CSV line per test, lines starting with '#' are comments.\n");
+	printf("  Columns: test,code,name,workers,calls,errors,min_ns,p50_ns,p99_ns,\n");
+	printf("  p999_ns,max_ns,rate_hz\n");
+	printf("- Z140_ERR_xxx measurement results (e.g. no new period) are not counted\n");
+	printf("  as errors.\n");
+	printf("- M_getblock reads one sample record, the reader state is released\n");
+	printf("  afterwards. Z140_BLK_TRACE drains the call trace (see TRACE_MODE).\n");
+	printf("- With -w, the configuration setstats write back the current value,\n");
+	printf("  so the active profile is cleared. Z140_PROFILE re-applies the active\n");
+	printf("  profile and is skipped if none is active. Z140_DISTRST,\n");
+	printf("  Z140_PERSTAT_RST and Z140_HIST_RST reset the distance counters,\n");
+	printf("  statistics and histograms, Z140_RD_RELEASE the reader state.\n");
+	printf("  Z140_SIG_SET and Z140_SIG_CLR are called in pairs (SIGUSR1, ignored),\n");
+	printf("  only the named call is timed. They fail if another process has\n");
+	printf("  installed the signal.\n");
+	printf("- Each thread/process opens its own path to the device.\n");
+	printf("\n");
+	printf("Copyright 2016-2019, MEN Mikro Elektronik GmbH\n%s\n", IdentString);
+}
+
+/***************************************************************************/
+/** Program main function
+ *
+ *  \param argc       \IN  argument counter
+ *  \param argv       \IN  argument vector
+ *
+ *  \return           success (0) or error code
+ */
+int main(int argc, char *argv[])
+{
+	MDIS_PATH path;
+	char	*device, *str, *errstr, *outFile, buf[40];
+	int32	calls, cycles, threads, procs, setstats;
+	u_int32	*lat;
+	FILE	*out;
+	int		n;
+	int		ret = ERR_OK;
+
+	/*----------------------+
+	|  check arguments      |
+	+----------------------*/
+	if ((errstr = UTL_ILLIOPT("n=l=t=p=wo=?", buf))) {
+		printf("*** %s\n", errstr);
+		return ERR_PARAM;
+	}
+	if (UTL_TSTOPT("?")) {
+		usage();
+		return ERR_PARAM;
+	}
+
+	/*----------------------+
+	|  get arguments        |
+	+----------------------*/
+	for (device = NULL, n=1; n<argc; n++) {
+		if (*argv[n] != '-') {
+			device = argv[n];
+			break;
+		}
+	}
+	if (!device) {
+		usage();
+		return ERR_PARAM;
+	}
+
+	calls    = ((str = UTL_TSTOPT("n=")) ? atoi(str) : 10000);
+	cycles   = ((str = UTL_TSTOPT("l=")) ? atoi(str) : 10000);
+	threads  = ((str = UTL_TSTOPT("t=")) ? atoi(str) : -1);
+	procs    = ((str = UTL_TSTOPT("p=")) ? atoi(str) : -1);
+	setstats = (UTL_TSTOPT("w") ? 1 : 0);
+	outFile  = UTL_TSTOPT("o=");
+
+	/* further parameter checking */
+	if ((calls < 0) || (cycles < 0)) {
+		printf("*** error: -n=/-l= must not be negative\n");
+		return ERR_PARAM;
+	}
+	if ((threads != -1) && (procs != -1)) {
+		printf("*** error: -t= and -p= are mutually exclusive\n");
+		return ERR_PARAM;
+	}
+	if ((threads != -1 && !IN_RANGE(threads, 1, BENCH_WORKER_MAX)) ||
+		(procs != -1 && !IN_RANGE(procs, 1, BENCH_WORKER_MAX))) {
+		printf("*** error: -t=/-p= must be 1..%d\n", BENCH_WORKER_MAX);
+		return ERR_PARAM;
+	}
+
+	if (outFile) {
+		if ((out = fopen(outFile, "w")) == NULL) {
+			printf("*** can't open %s\n", outFile);
+			return ERR_FUNC;
+		}
+	}
+	else
+		out = stdout;
+
+	fprintf(out, "# z140_bench %s\n", IdentString);
+	fprintf(out, "# device=%s\n", device);
+	fprintf(out, "test,code,name,workers,calls,errors,"
+				 "min_ns,p50_ns,p99_ns,p999_ns,max_ns,rate_hz\n");
+
+	/*----------------------+
+	|  code latencies       |
+	+----------------------*/
+	if (calls) {
+		if ((lat = (u_int32*)malloc(calls * sizeof(u_int32))) == NULL) {
+			printf("*** can't alloc %d bytes\n", (int)(calls * sizeof(u_int32)));
+			ret = ERR_FUNC;
+			goto CLEANUP;
+		}
+
+		if ((path = M_open(device)) < 0) {
+			ret = PrintError("open");
+			free(lat);
+			goto CLEANUP;
+		}
+
+		for (n = 0; n < (int)(sizeof(G_code) / sizeof(BENCH_CODE)); n++) {
+			if ((G_code[n].type >= BENCH_S) && !setstats)
+				continue;
+			BenchCode(path, &G_code[n], calls, lat, out);
+		}
+
+		if (M_close(path) < 0)
+			ret = PrintError("close");
+		free(lat);
+	}
+
+	/*----------------------+
+	|  loop rate            |
+	+----------------------*/
+	if (cycles && (ret == ERR_OK)) {
+		G_loop = NULL;
+		n = (procs != -1) ? procs : (threads != -1) ? threads : 1;
+
+		/* shared with the worker processes */
+		if ((G_loop = (BENCH_LOOP*)mmap(NULL,
+				sizeof(BENCH_LOOP) + (size_t)n * cycles * sizeof(u_int32),
+				PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+				-1, 0)) == MAP_FAILED) {
+			printf("*** can't map loop buffer\n");
+			ret = ERR_FUNC;
+			goto CLEANUP;
+		}
+		G_loop->device = device;
+		G_loop->cycles = cycles;
+
+		ret = BenchLoop(out, n, procs != -1);
+
+		munmap(G_loop, sizeof(BENCH_LOOP) + (size_t)n * cycles * sizeof(u_int32));
+	}
+
+CLEANUP:
+	if (out != stdout)
+		fclose(out);
+
+	return ret;
+}
+
+/***************************************************************************/
+/** Benchmark one getstat/setstat code
+ *
+ *  \param path       \IN  device path
+ *  \param bc         \IN  code to benchmark
+ *  \param calls      \IN  number of calls
+ *  \param lat        \IN  buffer for the latencies (calls entries)
+ *  \param out        \IN  output file
+ */
+static void BenchCode(
+	MDIS_PATH			path,
+	const BENCH_CODE	*bc,
+	u_int32				calls,
+	u_int32				*lat,
+	FILE				*out)
+{
+	M_SG_BLOCK blk;
+	int32 val = 0, ret = 0;
+	u_int32 n, errors = 0;
+	u_int64 t0, t1, start;
+
+	blk.data = (void*)G_blkBuf;
+	blk.size = bc->size;
+
+	/* Z140_BLK_VALUE: read period A */
+	if (bc->code == Z140_BLK_VALUE)
+		((Z140_VALUE*)G_blkBuf)->code = Z140_PERIOD_A;
+
+	/* current value to write back */
+	if ((bc->type == BENCH_S) && (M_getstat(path, bc->code, &val) < 0)) {
+		PrintError("getstat (write back value)");
+		return;
+	}
+	if ((bc->code == Z140_PROFILE) && (val == Z140_PROFILE_NONE)) {
+		fprintf(out, "# %s skipped: no active profile\n", bc->name);
+		return;
+	}
+	if (bc->type == BENCH_SIG) {
+		signal(BENCH_SIG_NUM, SIG_IGN);
+		val = BENCH_SIG_NUM;
+	}
+	if ((bc->type == BENCH_BS) && (M_getstat(path, bc->code, (int32*)&blk) < 0)) {
+		PrintError("getstat (write back data)");
+		return;
+	}
+
+	start = TimeNs();
+	for (n = 0; n < calls; n++) {
+		blk.size = bc->size;
+
+		/* paired call of Z140_SIG_CLR, not timed */
+		if (bc->code == Z140_SIG_CLR)
+			M_setstat(path, Z140_SIG_SET, val);
+
+		t0 = TimeNs();
+		switch (bc->type) {
+		case BENCH_G:
+			ret = M_getstat(path, bc->code, &val);
+			break;
+		case BENCH_BG:
+			ret = M_getstat(path, bc->code, (int32*)&blk);
+			break;
+		case BENCH_RD:
+			ret = M_getblock(path, G_blkBuf, bc->size);
+			break;
+		case BENCH_S:
+		case BENCH_SR:
+		case BENCH_SIG:
+			ret = M_setstat(path, bc->code, val);
+			break;
+		case BENCH_BS:
+			ret = M_setstat(path, bc->code, (INT32_OR_64)&blk);
+			break;
+		}
+		t1 = TimeNs();
+
+		/* paired call of Z140_SIG_SET, not timed */
+		if (bc->code == Z140_SIG_SET)
+			M_setstat(path, Z140_SIG_CLR, 0);
+
+		lat[n] = (t1 - t0) > 0xffffffff ? 0xffffffff : (u_int32)(t1 - t0);
+		if (CallFailed(ret))
+			errors++;
+	}
+
+	/* don't stall the sample ring */
+	if (bc->type == BENCH_RD)
+		M_setstat(path, Z140_RD_RELEASE, 0);
+
+	PrintResult(out, bc->type >= BENCH_S ? "setstat" :
+				bc->type == BENCH_RD ? "getblock" : "getstat", bc,
+				1, calls, errors, lat, TimeNs() - start);
+}
+
+/***************************************************************************/
+/** Five-call measurement cycle of one worker (thread or process)
+ *
+ *  \param arg        \IN  worker index
+ *
+ *  \return           NULL
+ */
+static void* LoopWorker(void *arg)
+{
+	u_int32 w = (u_int32)(U_INT32_OR_64)arg;
+	u_int32 *lat = &G_loop->lat[w * G_loop->cycles];
+	u_int32 n, c;
+	u_int64 t0, t1;
+	int32 val;
+	MDIS_PATH path;
+
+	if ((path = M_open(G_loop->device)) < 0) {
+		PrintError("open");
+		G_loop->errors[w] = (u_int32)-1;
+		return NULL;
+	}
+
+	/* start all workers at once */
+	while (!G_loop->go)
+		sched_yield();
+
+	for (n = 0; n < G_loop->cycles; n++) {
+		t0 = TimeNs();
+		for (c = 0; c < sizeof(G_cycle) / sizeof(int32); c++) {
+			if (CallFailed(M_getstat(path, G_cycle[c], &val)))
+				G_loop->errors[w]++;
+		}
+		t1 = TimeNs();
+
+		lat[n] = (t1 - t0) > 0xffffffff ? 0xffffffff : (u_int32)(t1 - t0);
+	}
+
+	if (M_close(path) < 0)
+		PrintError("close");
+
+	return NULL;
+}
+
+/***************************************************************************/
+/** Run the five-call cycle in several workers and print the result
+ *
+ *  \param out        \IN  output file
+ *  \param workers    \IN  number of threads/processes
+ *  \param proc       \IN  0=threads, 1=processes
+ *
+ *  \return           success (0) or error code
+ */
+static int BenchLoop(
+	FILE	*out,
+	u_int32	workers,
+	int		proc)
+{
+	static const BENCH_CODE cycle = { 0, "cycle", 0, 0 };
+	pthread_t thread[BENCH_WORKER_MAX];
+	pid_t pid[BENCH_WORKER_MAX];
+	u_int32 w, started, errors = 0;
+	u_int64 start;
+	int ret = ERR_OK;
+
+	fflush(out);
+
+	/*----------------------+
+	|  start workers        |
+	+----------------------*/
+	for (started = 0; started < workers; started++) {
+		if (proc) {
+			if ((pid[started] = fork()) == 0) {
+				LoopWorker((void*)(U_INT32_OR_64)started);
+				_exit(0);
+			}
+			if (pid[started] < 0)
+				break;
+		}
+		else {
+			if (pthread_create(&thread[started], NULL, LoopWorker,
+							   (void*)(U_INT32_OR_64)started))
+				break;
+		}
+	}
+
+	if (started < workers) {
+		printf("*** can't start worker %d\n", started);
+		ret = ERR_FUNC;
+	}
+
+	start = TimeNs();
+	G_loop->go = 1;
+
+	/*----------------------+
+	|  wait for workers     |
+	+----------------------*/
+	for (w = 0; w < started; w++) {
+		if (proc)
+			waitpid(pid[w], NULL, 0);
+		else
+			pthread_join(thread[w], NULL);
+	}
+	start = TimeNs() - start;
+
+	for (w = 0; w < started; w++) {
+		if (G_loop->errors[w] == (u_int32)-1)
+			ret = ERR_FUNC;
+		else
+			errors += G_loop->errors[w];
+	}
+
+	if (ret == ERR_OK) {
+		PrintResult(out, proc ? "loop-proc" : "loop-thread", &cycle, workers,
+					workers * G_loop->cycles, errors, G_loop->lat, start);
+	}
+
+	return ret;
+}
+
+/***************************************************************************/
+/** Sort the latencies and print one CSV line
+ *
+ *  \param out        \IN  output file
+ *  \param test       \IN  test name
+ *  \param bc         \IN  benchmarked code
+ *  \param workers    \IN  number of workers
+ *  \param calls      \IN  number of calls (cycles)
+ *  \param errors     \IN  number of failed calls
+ *  \param lat        \IN  latencies [ns] (calls entries, sorted on return)
+ *  \param wallNs     \IN  duration of the test [ns]
+ */
+static void PrintResult(
+	FILE				*out,
+	char				*test,
+	const BENCH_CODE	*bc,
+	u_int32				workers,
+	u_int32				calls,
+	u_int32				errors,
+	u_int32				*lat,
+	u_int64				wallNs)
+{
+	qsort(lat, calls, sizeof(u_int32), CmpU32);
+
+	fprintf(out, "%s,0x%04x,%s,%u,%u,%u,%u,%u,%u,%u,%u,%.1f\n",
+		test, (unsigned)bc->code, bc->name, workers, calls, errors,
+		lat[0], Percentile(lat, calls, 500), Percentile(lat, calls, 990),
+		Percentile(lat, calls, 999), lat[calls - 1],
+		wallNs ? (double)calls * 1e9 / wallNs : 0.0);
+	fflush(out);
+}
+
+/***************************************************************************/
+/** Percentile of sorted values
+ *
+ *  \param lat        \IN  sorted values
+ *  \param n          \IN  number of values
+ *  \param permille   \IN  percentile in 1/1000 (e.g. 999 for p99.9)
+ *
+ *  \return           smallest value with at least permille/1000 of the
+ *                    values less or equal
+ */
+static u_int32 Percentile(u_int32 *lat, u_int32 n, u_int32 permille)
+{
+	u_int64 idx = ((u_int64)n * permille + 999) / 1000;
+
+	return lat[idx ? idx - 1 : 0];
+}
+
+/***************************************************************************/
+/** Compare function for qsort
+ */
+static int CmpU32(const void *a, const void *b)
+{
+	u_int32 va = *(const u_int32*)a, vb = *(const u_int32*)b;
+
+	return (va > vb) - (va < vb);
+}
+
+/***************************************************************************/
+/** Check if a getstat/setstat call failed
+ *
+ *  \param ret        \IN  return value of M_getstat/M_setstat
+ *
+ *  \return           1 if failed, 0 on success or Z140_ERR_xxx measurement
+ *                    result
+ */
+static int CallFailed(int32 ret)
+{
+	int32 err;
+
+	if (ret >= 0)
+		return 0;
+
+	err = UOS_ErrnoGet();
+	return !IN_RANGE(err, Z140_ERR_PER_INVALID, Z140_ERR_NO_DATA);
+}
+
+/***************************************************************************/
+/** Get monotonic time
+ *
+ *  \return           time [ns]
+ */
+static u_int64 TimeNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((u_int64)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+/***************************************************************************/
+/** Print MDIS error message
+ *
+ *  \param info       \IN  info string
+ *
+ *  \return           ERR_FUNC
+ */
+static int PrintError(char *info)
+{
+	printf("*** can't %s: %s\n", info, M_errstring (UOS_ErrnoGet()));
+	return ERR_FUNC;
+}
@@ -28,6 +28,7 @@ DEF_REVISION=MAK_REVISION=$(STAMPED_REVISION)
 MAK_SWITCH=$(SW_PREFIX)$(DEF_REVISION)
 
 MAK_LIBS=$(LIB_PREFIX)$(MEN_LIB_DIR)/mdis_api$(LIB_SUFFIX)	\
+		 $(LIB_PREFIX)$(MEN_LIB_DIR)/z140_zrec$(LIB_SUFFIX)	\
 		 $(LIB_PREFIX)$(MEN_LIB_DIR)/usr_oss$(LIB_SUFFIX)	\
          $(LIB_PREFIX)$(MEN_LIB_DIR)/usr_utl$(LIB_SUFFIX)
 
@@ -35,7 +36,8 @@ MAK_INCL=$(MEN_INC_DIR)/men_typs.h	\
          $(MEN_INC_DIR)/usr_utl.h	\
          $(MEN_INC_DIR)/mdis_api.h	\
          $(MEN_INC_DIR)/usr_oss.h	\
-         $(MEN_INC_DIR)/z140_drv.h
+         $(MEN_INC_DIR)/z140_drv.h	\
+         $(MEN_INC_DIR)/z140_zrec.h
 
 MAK_INP1=z140_ctrl$(INP_SUFFIX)
 
@@ -9,7 +9,7 @@
  *
  *       \brief  Tool to control the Z140 Frequency Counter
  *
- *     Required: libraries: mdis_api, usr_oss, usr_utl
+ *     Required: libraries: mdis_api, usr_oss, usr_utl, z140_zrec
  *    \switches  (none)
  */
  /*
@@ -37,12 +37,17 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
+#ifdef LINUX
+#include <time.h>
+#endif
 #include <MEN/men_typs.h>
 #include <MEN/mdis_api.h>
 #include <MEN/usr_oss.h>
 #include <MEN/usr_utl.h>
 #include <MEN/mdis_err.h>
 #include <MEN/z140_drv.h>
+#include <MEN/z140_zrec.h>
 
 static const char IdentString[]=MENT_XSTR(MAK_REVISION);
 
@@ -53,6 +58,32 @@ static const char IdentString[]=MENT_XSTR(MAK_REVISION);
 #define ERR_PARAM	1
 #define ERR_FUNC	2
 
+/* logging mode */
+#define LOG_CSV			0		/**< CSV lines */
+#define LOG_BIN			1		/**< binary Z140_SNAPSHOT records */
+#define LOG_ZREC		2		/**< compact recording (z140_zrec.h) */
+#define LOG_BUF_SIZE	(1024*1024)	/**< output buffer [bytes] */
+#define LOG_LINE_MAX	160			/**< max. size of a CSV line [bytes] */
+
+#define KEY_CHECK_NS	100000000	/**< keypress check interval [ns] */
+
+/* deadline loop */
+#define DL_HIST_NUM		18		/**< lateness buckets: <1us, 1..2us, ... >=65536us */
+
+/*--------------------------------------+
+|   TYPEDEFS                            |
++--------------------------------------*/
+/** loop on absolute deadlines */
+typedef struct {
+	u_int64	period;		/**< period [ns] */
+	u_int64	next;		/**< current deadline [ns] */
+	u_int32	cycles;		/**< number of waits */
+	u_int32	overruns;	/**< cycles which were not ready before the next deadline */
+	u_int32	missed;		/**< skipped deadlines */
+	u_int64	lateMax;	/**< max. wake-up lateness [ns] */
+	u_int32	hist[DL_HIST_NUM];	/**< wake-up lateness histogram */
+} DL_LOOP;
+
 /*--------------------------------------+
 |   GLOBALS                             |
 +--------------------------------------*/
@@ -62,7 +93,13 @@ static const char IdentString[]=MENT_XSTR(MAK_REVISION);
 +--------------------------------------*/
 static void usage(void);
 static int PrintError(char *info);
-static int MeasStat(char *info, char **statStr);
+static char* MeasStat(int32 err);
+static u_int64 TimeNs(void);
+static void DlInit(DL_LOOP *dl, u_int64 periodNs);
+static void DlWait(DL_LOOP *dl);
+static void DlPrint(DL_LOOP *dl, FILE *out);
+static int LogLoop(MDIS_PATH path, int32 format, int32 periodUs,
+				   int32 abort, char *outFile);
 
 /********************************* usage ***********************************/
 /**  Print program usage
@@ -79,21 +116,46 @@ static void usage(void)
 	printf("    -s=<ms>    standstill time period (10..[10]..2550ms)........[desc]   \n");
 	printf("    -d=<ms>    direction detection timeout (10..[10]..2550ms)...[desc]   \n");
 	printf("    -g         get used configuration parameters (listed above)          \n");
+	printf("               and descriptor profiles                                   \n");
+	printf("    -P=<n>     apply descriptor profile n                                \n");
 	printf("    -c         clear forward and backward distance counters              \n");
 	printf("    -p=0..3    configure pattern generator                               \n");
 	printf("               0: disable test pattern                                   \n");
 	printf("               1: clockwise pattern (forward movement)                   \n");
 	printf("               2: counterclockwise pattern (backward movement)           \n");
 	printf("               3: silence pattern (standstill)                           \n");
+	printf("    -f=<flt>   period filter of signal A and B (Z140_FLT_xxx)...[desc]   \n");
+	printf("               0: off, 0x1nn: median of nn periods,                      \n");
+	printf("               0x2kk: IIR y += (x - y) / 2^kk                            \n");
 	printf("    -M         get period A/B and distance impulse measurement           \n");
-	printf("    -S         get status                                                \n");
+	printf("               (consumes the new period values of this process)          \n");
+	printf("    -S         get status (without -M: period values are not consumed)   \n");
 	printf("    -L=<ms>    loop (-S/-M) all ms until keypress or specified cycles    \n");
-	printf("    -A=<n>     abort loop after n cycles (requires -L=<ms>)              \n");
+	printf("    -A=<n>     abort loop after n cycles (requires -L=<ms> or -F=)       \n");
+	printf("    -D         loop (-L=<ms>) on absolute deadlines and report the       \n");
+	printf("               wake-up lateness and overruns                             \n");
+	printf("    -F=<fmt>   log measurement and status records until keypress         \n");
+	printf("               or specified cycles                                       \n");
+	printf("               csv: CSV lines                                            \n");
+	printf("               bin: binary Z140_SNAPSHOT structures                      \n");
+	printf("               zrec: compact delta/varint recording (see z140_zrec.h)    \n");
+	printf("    -T=<us>    log period (0=as fast as possible)...............[1000]   \n");
+	printf("    -o=<file>  log file.........................................[stdout] \n");
 	printf("\n");
 	printf("Notes:\n");
 	printf("- [desc] default means to use descriptor key or driver default\n");
 	printf("- The driver resets the distance counters and disables the test pattern\n");
 	printf("  generator, when the last file handle to the device will be closed.\n");
+	printf("  With descriptor key KEEP_DISTANCE=1 the distance counters are kept.\n");
+	printf("- The options -b/-m/-r/-s/-d/-p are applied with one driver call, so an\n");
+	printf("  illegal value leaves the configuration unchanged.\n");
+	printf("- -M also shows the filtered periods of the signals with period filter.\n");
+	printf("- Logging mode (-F=) writes through a large buffer and reports the\n");
+	printf("  achieved rate, missed log periods and wake-up lateness at exit (to\n");
+	printf("  stderr if the log is written to stdout). It always waits for absolute\n");
+	printf("  deadlines. CSV columns: tstamp_ns,period_a_us,err_a,\n");
+	printf("  period_b_us,err_b,dist_fwd,dist_bwd,status,age_a_ns,age_b_ns\n");
+	printf("  (err: Z140_ERR_xxx or 0, age: -1 if none).\n");
 	printf("\n");
 	printf("Copyright 2016-2019, MEN Mikro Elektronik GmbH\n%s\n", IdentString);
 }
@@ -109,19 +171,27 @@ static void usage(void)
 int main(int argc, char *argv[])
 {
 	MDIS_PATH path;
-	char	*device, *str, *errstr, buf[40];
+	char	*device, *str, *errstr, buf[40], spdStr[24];
 	int32	debTime, measTout, rollTime, standTime, detTout, getCfg, clrCntr, pattern;
-	int32	getMeas, getStat, loopTime, abort;
-	int32   val, periodA, periodB, distFwd, distBwd;
-	u_int32	loopcnt;
+	int32	profile, getMeas, getStat, loopTime, abort, logFmt, logPeriod;
+	int32	deadline, filter, fltOn[2], err;
+	int32   val, periodA, periodB;
+	Z140_SNAPSHOT snap;
+	Z140_SPEED_EST spd;
+	Z140_CONFIG cfg;
+	Z140_PROFILE_ENTRY prof[Z140_PROFILE_MAX];
+	M_SG_BLOCK blk, spdBlk;
+	u_int32	loopcnt, spdAbs;
+	u_int64	keyCheck;
+	DL_LOOP	dl;
 	int		n;
 	int		ret;
-	char	*periodAStat, *periodBStat;
+	char	*periodAStat, *periodBStat, *logFile;
 
 	/*----------------------+
 	|  check arguments      |
 	+----------------------*/
-	if ((errstr = UTL_ILLIOPT("b=m=r=s=d=gcp=MSL=A=?", buf))) {
+	if ((errstr = UTL_ILLIOPT("b=m=r=s=d=gcp=P=f=MSL=A=DF=T=o=?", buf))) {
 		printf("*** %s\n", errstr);
 		return ERR_PARAM;
 	}
@@ -156,16 +226,47 @@ int main(int argc, char *argv[])
 	getCfg    = (UTL_TSTOPT("g") ? 1 : 0);
 	clrCntr   = (UTL_TSTOPT("c") ? 1 : 0);
 	pattern   = ((str = UTL_TSTOPT("p=")) ? atoi(str) : -1);
+	profile   = ((str = UTL_TSTOPT("P=")) ? atoi(str) : -1);
+	filter    = ((str = UTL_TSTOPT("f=")) ? strtol(str, NULL, 0) : -1);
 	getMeas   = (UTL_TSTOPT("M") ? 1 : 0);
 	getStat   = (UTL_TSTOPT("S") ? 1 : 0);
 	loopTime  = ((str = UTL_TSTOPT("L=")) ? atoi(str) : -1);
 	abort     = ((str = UTL_TSTOPT("A=")) ? atoi(str) : -1);
+	logPeriod = ((str = UTL_TSTOPT("T=")) ? atoi(str) : 1000);
+	logFile   = UTL_TSTOPT("o=");
+	deadline  = (UTL_TSTOPT("D") ? 1 : 0);
+
+	logFmt = -1;
+	if ((str = UTL_TSTOPT("F="))) {
+		if (!strcmp(str, "csv"))
+			logFmt = LOG_CSV;
+		else if (!strcmp(str, "bin"))
+			logFmt = LOG_BIN;
+		else if (!strcmp(str, "zrec"))
+			logFmt = LOG_ZREC;
+		else {
+			printf("*** error: -F= must be csv, bin or zrec\n");
+			return ERR_PARAM;
+		}
+	}
 
 	/* further parameter checking */
 	if ((loopTime != -1) && (!getMeas && !getStat)) {
 		printf("*** error: -L= requires option -M and/or -S\n");
 		return ERR_PARAM;
 	}
+	if (deadline && (loopTime == -1)) {
+		printf("*** error: -D requires option -L=<ms>\n");
+		return ERR_PARAM;
+	}
+	if ((logFmt != -1) && (loopTime != -1 || getMeas || getStat)) {
+		printf("*** error: -F= can't be combined with -L=/-M/-S\n");
+		return ERR_PARAM;
+	}
+	if (logPeriod < 0) {
+		printf("*** error: -T= must not be negative\n");
+		return ERR_PARAM;
+	}
 	
 	/*----------------------+
 	|  open path            |
@@ -175,76 +276,109 @@ int main(int argc, char *argv[])
 	}
 
 	/*----------------------+
-	|  set config           |
+	|  apply profile        |
 	+----------------------*/
-	if (debTime != -1) {
-		if ((M_setstat(path, Z140_DEBOUNCET, debTime)) < 0) {
-			ret = PrintError("setstat Z140_DEBOUNCET");
+	if (profile != -1) {
+		if ((M_setstat(path, Z140_PROFILE, profile)) < 0) {
+			ret = PrintError("setstat Z140_PROFILE");
 			goto ABORT;
 		}
 	}
 
-	if (measTout != -1) {
-		if ((M_setstat(path, Z140_MEAS_TOUT, measTout)) < 0) {
-			ret = PrintError("setstat Z140_MEAS_TOUT");
+	/*----------------------+
+	|  set config           |
+	+----------------------*/
+	blk.size = sizeof(cfg);
+	blk.data = (void*)&cfg;
+
+	if ((debTime != -1) || (measTout != -1) || (rollTime != -1) ||
+		(standTime != -1) || (detTout != -1) || (pattern != -1)) {
+		if ((M_getstat(path, Z140_BLK_CONFIG, (int32*)&blk)) < 0) {
+			ret = PrintError("getstat Z140_BLK_CONFIG");
 			goto ABORT;
 		}
-	}
 
-	if (rollTime != -1) {
-		if ((M_setstat(path, Z140_ROLLINGT, rollTime)) < 0) {
-			ret = PrintError("setstat Z140_ROLLINGT");
+		if (debTime != -1)
+			cfg.debounceT = debTime;
+		if (measTout != -1)
+			cfg.measTout = measTout;
+		if (rollTime != -1)
+			cfg.rollingT = rollTime;
+		if (standTime != -1)
+			cfg.standstillT = standTime;
+		if (detTout != -1)
+			cfg.dirdetTout = detTout;
+		if (pattern != -1)
+			cfg.tpattern = pattern;
+
+		if ((M_setstat(path, Z140_BLK_CONFIG, (INT32_OR_64)&blk)) < 0) {
+			ret = PrintError("setstat Z140_BLK_CONFIG");
 			goto ABORT;
 		}
 	}
 
-	if (standTime != -1) {
-		if ((M_setstat(path, Z140_STANDSTILLT, standTime)) < 0) {
-			ret = PrintError("setstat Z140_STANDSTILLT");
+	/*----------------------+
+	|  set period filter    |
+	+----------------------*/
+	if (filter != -1) {
+		if ((M_setstat(path, Z140_FILTER_A, filter)) < 0) {
+			ret = PrintError("setstat Z140_FILTER_A");
 			goto ABORT;
 		}
-	}
-
-	if (detTout != -1) {
-		if ((M_setstat(path, Z140_DIRDET_TOUT, detTout)) < 0) {
-			ret = PrintError("setstat Z140_DIRDET_TOUT");
+		if ((M_setstat(path, Z140_FILTER_B, filter)) < 0) {
+			ret = PrintError("setstat Z140_FILTER_B");
 			goto ABORT;
 		}
 	}
 
 	/*----------------------+
-	|  get config           |
+	|  get period filter    |
 	+----------------------*/
-	if (getCfg) {
-		if ((M_getstat(path, Z140_DEBOUNCET, &val)) < 0) {
-			ret = PrintError("getstat Z140_DEBOUNCET");
+	if (getCfg || getMeas) {
+		if ((M_getstat(path, Z140_FILTER_A, &fltOn[0])) < 0) {
+			ret = PrintError("getstat Z140_FILTER_A");
 			goto ABORT;
 		}
-		printf("Debounce time               : %dus\n", val);
-
-		if ((M_getstat(path, Z140_MEAS_TOUT, &val)) < 0) {
-			ret = PrintError("getstat Z140_MEAS_TOUT");
+		if ((M_getstat(path, Z140_FILTER_B, &fltOn[1])) < 0) {
+			ret = PrintError("getstat Z140_FILTER_B");
 			goto ABORT;
 		}
-		printf("Measurement timeout         : %dms\n", val);
+	}
 
-		if ((M_getstat(path, Z140_ROLLINGT, &val)) < 0) {
-			ret = PrintError("getstat Z140_ROLLINGT");
+	/*----------------------+
+	|  get config           |
+	+----------------------*/
+	if (getCfg) {
+		if ((M_getstat(path, Z140_BLK_CONFIG, (int32*)&blk)) < 0) {
+			ret = PrintError("getstat Z140_BLK_CONFIG");
 			goto ABORT;
 		}
-		printf("Rolling time period         : %dms\n", val);
-
-		if ((M_getstat(path, Z140_STANDSTILLT, &val)) < 0) {
-			ret = PrintError("getstat Z140_STANDSTILLT");
+		printf("Debounce time               : %dus\n", cfg.debounceT);
+		printf("Measurement timeout         : %dms\n", cfg.measTout);
+		printf("Rolling time period         : %dms\n", cfg.rollingT);
+		printf("Standstill time period      : %dms\n", cfg.standstillT);
+		printf("Direction detection timeout : %dms\n", cfg.dirdetTout);
+		printf("Test pattern                : %d\n", cfg.tpattern);
+		printf("Period filter A/B           : 0x%03x 0x%03x\n", fltOn[0], fltOn[1]);
+
+		if ((M_getstat(path, Z140_PROFILE, &val)) < 0) {
+			ret = PrintError("getstat Z140_PROFILE");
 			goto ABORT;
 		}
-		printf("Standstill time period      : %dms\n", val);
+		printf("Active profile              : %d\n", val);
 
-		if ((M_getstat(path, Z140_DIRDET_TOUT, &val)) < 0) {
-			ret = PrintError("getstat Z140_DIRDET_TOUT");
+		blk.size = sizeof(prof);
+		blk.data = (void*)prof;
+		if ((M_getstat(path, Z140_BLK_PROFILES, (int32*)&blk)) < 0) {
+			ret = PrintError("getstat Z140_BLK_PROFILES");
 			goto ABORT;
 		}
-		printf("Direction detection timeout : %dms\n", val);
+		for (n = 0; n < (int)(blk.size / sizeof(Z140_PROFILE_ENTRY)); n++) {
+			printf("Profile %d %-16s  : %dus %dms %dms %dms %dms tp=%d\n",
+				n, prof[n].name, prof[n].cfg.debounceT, prof[n].cfg.measTout,
+				prof[n].cfg.rollingT, prof[n].cfg.standstillT,
+				prof[n].cfg.dirdetTout, prof[n].cfg.tpattern);
+		}
 	}
 
 	/*----------------------+
@@ -258,90 +392,122 @@ int main(int argc, char *argv[])
 	}
 
 	/*----------------------+
-	|  config pattern gen   |
+	|  logging mode         |
 	+----------------------*/
-	if (pattern != -1) {
-		if ((M_setstat(path, Z140_TPATTERN, pattern)) < 0) {
-			ret = PrintError("setstat Z140_TPATTERN");
-			goto ABORT;
-		}
+	if (logFmt != -1) {
+		ret = LogLoop(path, logFmt, logPeriod, abort, logFile);
+		goto ABORT;
 	}
 
 	/*----------------------+
 	|  loop                 |
 	+----------------------*/
+	blk.size = sizeof(snap);
+	blk.data = (void*)&snap;
 	loopcnt = 1;
+	keyCheck = TimeNs();
+	DlInit(&dl, (u_int64)loopTime * 1000000);
 	while (getMeas || getStat){
 
 		if (loopTime != -1)
 			printf("#%d\n", loopcnt);
 
+		/*--------------------------+
+		|  get measurement results  |
+		|  and status               |
+		+--------------------------*/
 		if (getMeas) {
-			/*--------------------------+
-			|  get measurement results  |
-			+--------------------------*/
-			/* period measurement for signal A */
-			if ((M_getstat(path, Z140_PERIOD_A, &periodA)) < 0) {
-				if((ret = MeasStat("getstat Z140_PERIOD_A", &periodAStat)))
-					goto ABORT;
-			}
-			else {
-				periodAStat = "success";
-			}
-
-			/* period measurement for signal B */
-			if ((M_getstat(path, Z140_PERIOD_B, &periodB)) < 0) {
-				if ((ret = MeasStat("getstat Z140_PERIOD_B", &periodBStat)))
-					goto ABORT;
-			}
-			else {
-				periodBStat = "success";
-			}
-
-			/* sensor pulses */
-			if ((M_getstat(path, Z140_DISTANCE_FWD, &distFwd)) < 0) {
-				ret = PrintError("getstat Z140_DISTANCE_FWD");
+			if ((M_getstat(path, Z140_BLK_SNAPSHOT, (int32*)&blk)) < 0) {
+				ret = PrintError("getstat Z140_BLK_SNAPSHOT");
 				goto ABORT;
 			}
-
-			if ((M_getstat(path, Z140_DISTANCE_BWD, &distBwd)) < 0) {
-				ret = PrintError("getstat Z140_DISTANCE_BWD");
+		}
+		else {
+			/* status only: don't consume period values */
+			if ((M_getstat(path, Z140_STATUS, &val)) < 0) {
+				ret = PrintError("getstat Z140_STATUS");
 				goto ABORT;
 			}
+			snap.status = val;
+		}
+
+		if (getMeas) {
+			/* period measurement for signal A/B */
+			periodAStat = MeasStat(Z140_PER_ERR(snap.periodA));
+			periodBStat = MeasStat(Z140_PER_ERR(snap.periodB));
+			periodA = snap.periodA & Z140_PER_MASK;
+			periodB = snap.periodB & Z140_PER_MASK;
 
-			printf("period-A     :   %8d.%03.3dus (%s)\n",
+			printf("period-A     :   %8d.%03dus (%s)\n",
 				Z140_PER_US(periodA), Z140_PER_NS(periodA), periodAStat);
-			printf("period-B     :   %8d.%03.3dus (%s)\n",
+			printf("period-B     :   %8d.%03dus (%s)\n",
 				Z140_PER_US(periodB), Z140_PER_NS(periodB), periodBStat);
-			printf("dist-fwd     : %10d pulses\n", distFwd);
-			printf("dist-bwd     : %10d pulses\n", distBwd);
-		}
 
-		if (getStat) {
-			/*--------------------------+
-			|  get status               |
-			+--------------------------*/
-			if ((M_getstat(path, Z140_STATUS, &val)) < 0) {
-				ret = PrintError("getstat Z140_STATUS");
+			/* filtered periods */
+			for (n = 0; n < 2; n++) {
+				if (!fltOn[n])
+					continue;
+				err = 0;
+				if ((M_getstat(path, n ? Z140_PERIOD_FLT_B : Z140_PERIOD_FLT_A,
+							   &val)) < 0) {
+					err = UOS_ErrnoGet();
+					val = 0;
+					if (!IN_RANGE(err, Z140_ERR_PER_INVALID, Z140_ERR_NO_DATA)) {
+						ret = PrintError("getstat Z140_PERIOD_FLT_x");
+						goto ABORT;
+					}
+				}
+				printf("period-%c flt :   %8d.%03dus (%s)\n", 'A' + n,
+					Z140_PER_US(val), Z140_PER_NS(val), MeasStat(err));
+			}
+			printf("dist-fwd     : %10d pulses\n", snap.distFwd);
+			printf("dist-bwd     : %10d pulses\n", snap.distBwd);
+
+			/* speed estimate */
+			spdBlk.size = sizeof(spd);
+			spdBlk.data = (void*)&spd;
+			if ((M_getstat(path, Z140_BLK_SPEED, (int32*)&spdBlk)) < 0) {
+				ret = PrintError("getstat Z140_BLK_SPEED");
 				goto ABORT;
 			}
-			
+			spdAbs = (spd.pps < 0) ? -spd.pps : spd.pps;
+			sprintf(spdStr, "%s%u.%02u", (spd.pps < 0) ? "-" : "",
+				spdAbs >> Z140_SPEED_FRAC,
+				((spdAbs & ((1 << Z140_SPEED_FRAC) - 1)) * 100) >> Z140_SPEED_FRAC);
+			printf("speed        : %13s pulses/s (%s%s%s%s)\n", spdStr,
+				(spd.quality & Z140_SPD_VALID)       ? "valid" : "no data",
+				(spd.quality & Z140_SPD_STANDSTILL)  ? ", standstill" :
+				(spd.quality & Z140_SPD_COUNT)       ? ", count" : "",
+				(spd.quality & Z140_SPD_PERIOD)      ? ", period" : "",
+				(spd.quality & Z140_SPD_DIR_INVALID) ? ", invalid-dir" : "");
+		}
+
+		if (getStat) {
+			val = snap.status;
+
 			printf("status flags : ");
 			if (val & Z140_ST_DIR_INVALID) printf("invalid-dir ");
 			if (val & Z140_ST_DIR_BWD)     printf("backward-dir ");
 			if (val & Z140_ST_DIR_FWD)     printf("forward-dir ");
 			if (val & Z140_ST_STANDSTILL)  printf("standstill ");
 			if (val & Z140_ST_ROLLING)     printf("rolling ");
+			if (val & Z140_ST_TORN)        printf("(torn) ");
 			printf("\n");
 		}
 
 		/* loop? */
 		if (loopTime != -1){
-			UOS_Delay(loopTime);
-
-			/* repeat until keypress */
-			if (UOS_KeyPressed() != -1)
-				break;
+			if (deadline)
+				DlWait(&dl);
+			else
+				UOS_Delay(loopTime);
+
+			/* repeat until keypress, not more often than necessary */
+			if (TimeNs() - keyCheck >= KEY_CHECK_NS) {
+				keyCheck = TimeNs();
+				if (UOS_KeyPressed() != -1)
+					break;
+			}
 
 			/* abort after n cycles */
 			if (abort){
@@ -355,18 +521,293 @@ int main(int argc, char *argv[])
 	}
 
 	printf("\n");
+	if (deadline)
+		DlPrint(&dl, stdout);
 	ret = ERR_OK;
 
 ABORT:
 	/*----------------------+
 	|  close path           |
 	+----------------------*/
+	/* release period latch and stream cursor (driver has no close call) */
+	M_setstat(path, Z140_RD_RELEASE, 0);
+
 	if (M_close(path) < 0)
 		ret = PrintError("close");
 
 	return ret;
 }
 
+/***************************************************************************/
+/** Log snapshot records with a fixed period
+ *
+ *  The records are collected in a buffer of LOG_BUF_SIZE bytes, which is
+ *  only written when it is full, so the loop is not slowed down by the
+ *  output (except for the write of the full buffer). LOG_ZREC records
+ *  are written through the recording library instead. The loop waits
+ *  for absolute deadlines (see DlWait()).
+ *
+ *  \param path       \IN  device path
+ *  \param format     \IN  LOG_CSV, LOG_BIN or LOG_ZREC
+ *  \param periodUs   \IN  log period [us] (0=no wait)
+ *  \param abort      \IN  number of records (-1 or 0: until keypress)
+ *  \param outFile    \IN  output file (NULL: stdout)
+ *
+ *  \return           success (0) or error code
+ */
+static int LogLoop(
+	MDIS_PATH	path,
+	int32		format,
+	int32		periodUs,
+	int32		abort,
+	char		*outFile)
+{
+	Z140_SNAPSHOT snap;
+	M_SG_BLOCK blk;
+	FILE *out = NULL, *msg;
+	Z140_ZREC_HANDLE *zrec = NULL;
+	DL_LOOP dl;
+	u_int64 start, last, keyCheck;
+	u_int32 records = 0, fill = 0;
+	int32 per[2], err[2], error;
+	char *logBuf = NULL;
+	int ret = ERR_OK;
+
+	/* keep the log parseable */
+	msg = outFile ? stdout : stderr;
+
+	if (format == LOG_ZREC) {
+		if ((error = Z140_ZREC_Create(outFile ? outFile : "-", 0, &zrec))) {
+			printf("*** can't create %s: %s\n", outFile ? outFile : "stdout",
+				   error == Z140_ZREC_ERR_IO ? strerror(errno) :
+				   M_errstring(error));
+			return ERR_FUNC;
+		}
+	}
+	else if (!outFile)
+		out = stdout;
+	else if ((out = fopen(outFile, format == LOG_BIN ? "wb" : "w")) == NULL) {
+		printf("*** can't open %s\n", outFile);
+		return ERR_FUNC;
+	}
+
+	if (out && (logBuf = (char*)malloc(LOG_BUF_SIZE)) == NULL) {
+		fprintf(msg, "*** can't alloc %d bytes\n", LOG_BUF_SIZE);
+		ret = ERR_FUNC;
+		goto CLEANUP;
+	}
+
+	if (format == LOG_CSV)
+		fill = sprintf(logBuf, "tstamp_ns,period_a_us,err_a,period_b_us,err_b,"
+					   "dist_fwd,dist_bwd,status,age_a_ns,age_b_ns\n");
+
+	blk.size = sizeof(snap);
+	blk.data = (void*)&snap;
+	start = last = keyCheck = TimeNs();
+	DlInit(&dl, (u_int64)periodUs * 1000);
+
+	for (;;) {
+		if ((M_getstat(path, Z140_BLK_SNAPSHOT, (int32*)&blk)) < 0) {
+			fprintf(msg, "*** can't getstat Z140_BLK_SNAPSHOT: %s\n",
+					M_errstring(UOS_ErrnoGet()));
+			ret = ERR_FUNC;
+			break;
+		}
+		last = TimeNs();
+
+		if (format == LOG_ZREC) {
+			if (Z140_ZREC_Write(zrec, &snap)) {
+				fprintf(msg, "*** can't write log\n");
+				ret = ERR_FUNC;
+				break;
+			}
+		}
+		else if (format == LOG_BIN) {
+			memcpy(logBuf + fill, &snap, sizeof(snap));
+			fill += sizeof(snap);
+		}
+		else {
+			per[0] = snap.periodA & Z140_PER_MASK;
+			per[1] = snap.periodB & Z140_PER_MASK;
+			err[0] = Z140_PER_ERR(snap.periodA);
+			err[1] = Z140_PER_ERR(snap.periodB);
+
+			fill += sprintf(logBuf + fill,
+				"%llu,%d.%03d,0x%x,%d.%03d,0x%x,%u,%u,0x%x,%lld,%lld\n",
+				(unsigned long long)snap.tstamp,
+				Z140_PER_US(per[0]), Z140_PER_NS(per[0]), err[0],
+				Z140_PER_US(per[1]), Z140_PER_NS(per[1]), err[1],
+				snap.distFwd, snap.distBwd, snap.status,
+				snap.ageA == Z140_AGE_NONE ? -1LL : (long long)snap.ageA,
+				snap.ageB == Z140_AGE_NONE ? -1LL : (long long)snap.ageB);
+		}
+
+		/* write full buffer */
+		if (fill > LOG_BUF_SIZE - LOG_LINE_MAX) {
+			if (fwrite(logBuf, 1, fill, out) != fill) {
+				fprintf(msg, "*** can't write log\n");
+				ret = ERR_FUNC;
+				break;
+			}
+			fill = 0;
+		}
+
+		/* abort after n records */
+		if (++records == (u_int32)abort)
+			break;
+
+		if (periodUs)
+			DlWait(&dl);
+
+		/* repeat until keypress */
+		if (last - keyCheck >= KEY_CHECK_NS) {
+			keyCheck = last;
+			if (UOS_KeyPressed() != -1)
+				break;
+		}
+	}
+
+	if (fill && fwrite(logBuf, 1, fill, out) != fill) {
+		fprintf(msg, "*** can't write log\n");
+		ret = ERR_FUNC;
+	}
+	if (out)
+		fflush(out);
+
+	/* rate between first and last record */
+	last -= start;
+	fprintf(msg, "%u records in %.3fs: %.1f records/s\n",
+			records, (double)last / 1e9,
+			(records > 1 && last) ? (double)(records - 1) * 1e9 / last : 0.0);
+	if (periodUs)
+		DlPrint(&dl, msg);
+
+CLEANUP:
+	if (out && out != stdout)
+		fclose(out);
+	if (zrec && Z140_ZREC_Close(&zrec)) {
+		fprintf(msg, "*** can't write log\n");
+		ret = ERR_FUNC;
+	}
+	free(logBuf);
+
+	return ret;
+}
+
+/***************************************************************************/
+/** Start a loop on absolute deadlines
+ *
+ *  \param dl         \OUT loop state
+ *  \param periodNs   \IN  period [ns]
+ */
+static void DlInit(DL_LOOP *dl, u_int64 periodNs)
+{
+	memset(dl, 0, sizeof(*dl));
+	dl->period = periodNs;
+	dl->next   = TimeNs();
+}
+
+/***************************************************************************/
+/** Wait for the next deadline
+ *
+ *  The deadlines are multiples of the period since DlInit(), so the work
+ *  time does not add to the period. If the next deadline has already
+ *  passed, the cycle is counted as overrun and the passed deadlines are
+ *  skipped. The lateness of the wake-up is counted in a log2 histogram.
+ *  Without LINUX, the wait is a UOS_Delay() with ms resolution.
+ *
+ *  \param dl         \INOUT loop state
+ */
+static void DlWait(DL_LOOP *dl)
+{
+#ifdef LINUX
+	struct timespec ts;
+#endif
+	u_int64 now = TimeNs(), late, skip;
+	u_int32 b;
+
+	/* no period, don't wait */
+	if (!dl->period) {
+		dl->cycles++;
+		return;
+	}
+
+	dl->next += dl->period;
+	if (now >= dl->next) {
+		skip = (now - dl->next) / dl->period + 1;
+		dl->overruns++;
+		dl->missed += (u_int32)skip;
+		dl->next += skip * dl->period;
+	}
+
+#ifdef LINUX
+	ts.tv_sec  = dl->next / 1000000000;
+	ts.tv_nsec = dl->next % 1000000000;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+#else
+	/* no absolute sleep: relative delay to the deadline */
+	now = TimeNs();
+	if (dl->next > now)
+		UOS_Delay((u_int32)((dl->next - now + 999999) / 1000000));
+#endif
+
+	/* lateness bucket: 0 for <1us, n for 2^(n-1)..2^n-1 us */
+	late = TimeNs() - dl->next;
+	if (late > dl->lateMax)
+		dl->lateMax = late;
+	for (b = 0, late /= 1000; late && b < DL_HIST_NUM - 1; late >>= 1)
+		b++;
+
+	dl->hist[b]++;
+	dl->cycles++;
+}
+
+/***************************************************************************/
+/** Print lateness histogram and overruns of a deadline loop
+ *
+ *  \param dl         \IN  loop state
+ *  \param out        \IN  output file
+ */
+static void DlPrint(DL_LOOP *dl, FILE *out)
+{
+	u_int32 b;
+
+	fprintf(out, "deadline loop: %u cycles, %u overruns, %u missed periods, "
+			"max. lateness %.1fus\n", dl->cycles, dl->overruns, dl->missed,
+			(double)dl->lateMax / 1000.0);
+
+	for (b = 0; b < DL_HIST_NUM; b++) {
+		if (!dl->hist[b])
+			continue;
+		if (b == 0)
+			fprintf(out, "  lateness          <1us : %u\n", dl->hist[b]);
+		else if (b == DL_HIST_NUM - 1)
+			fprintf(out, "  lateness     >=%6uus : %u\n", 1U << (b - 1),
+					dl->hist[b]);
+		else
+			fprintf(out, "  lateness %6u..%6uus : %u\n", 1U << (b - 1),
+					(1U << b) - 1, dl->hist[b]);
+	}
+}
+
+/***************************************************************************/
+/** Get monotonic time
+ *
+ *  \return           time [ns] (ms resolution without LINUX)
+ */
+static u_int64 TimeNs(void)
+{
+#ifdef LINUX
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((u_int64)ts.tv_sec * 1000000000 + ts.tv_nsec);
+#else
+	return ((u_int64)UOS_MsecTimerGet() * 1000000);
+#endif
+}
+
 /***************************************************************************/
 /** Print MDIS error message
  *
@@ -383,28 +824,21 @@ static int PrintError(char *info)
 /***************************************************************************/
 /** Measurement status helper function
 *
-*  \param info       \IN  info string
-*  \param statStr    \IN  status string
+*  \param err        \IN  Z140_ERR_xxx code of period value (see Z140_PER_ERR)
 *
-*  \return           success (0) for device specific error or error code
+*  \return           status string
 */
-static int MeasStat(char *info, char **statStr)
+static char* MeasStat(int32 err)
 {
-	u_int32 stat;
 	static char *errStr[] = { "*** period-err", "*** phase-err", "*** no-new-data"};
 
-	stat = UOS_ErrnoGet();
-
-	switch (stat) {
-	case Z140_ERR_PER_INVALID:  *statStr = errStr[0]; break;
-	case Z140_ERR_PH_VIOLATION:	*statStr = errStr[1]; break;
-	case Z140_ERR_NO_DATA:		*statStr = errStr[2]; break;
-	default:
-		printf("*** can't %s: %s\n", info, M_errstring(stat));
-		return ERR_FUNC;
+	switch (err) {
+	case Z140_ERR_PER_INVALID:  return errStr[0];
+	case Z140_ERR_PH_VIOLATION:	return errStr[1];
+	case Z140_ERR_NO_DATA:		return errStr[2];
 	}
 
-	return ERR_OK;
+	return "success";
 }
 
  
@@ -0,0 +1,541 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                     Z140_REC                       ************
+ ************                                                    ************
+ ****************************************************************************/
+/*!
+ *        \file  z140_rec.c
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  Two-thread recorder for the Z140 driver
+ *
+ *               An acquisition thread reads the measurement snapshots
+ *               (Z140_BLK_SNAPSHOT) with a fixed period and pushes them
+ *               into a lock-free single-producer/single-consumer queue.
+ *               A writer thread takes the records in batches from the
+ *               queue and writes them to the file, so a blocking disk or
+ *               terminal does not delay the acquisition. If the queue is
+ *               full, the acquisition drops the record and counts it.
+ *
+ *     Required: libraries: mdis_api, usr_oss, usr_utl, pthread
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*--------------------------------------+
+|  INCLUDES                             |
++--------------------------------------*/
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE	/* pthread_setaffinity_np */
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_api.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+#include <MEN/mdis_err.h>
+#include <MEN/z140_drv.h>
+
+static const char IdentString[]=MENT_XSTR(MAK_REVISION);
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define ERR_OK		0
+#define ERR_PARAM	1
+#define ERR_FUNC	2
+
+#define REC_CSV			0		/**< CSV lines */
+#define REC_BIN			1		/**< binary Z140_SNAPSHOT records */
+
+#define REC_QUEUE_DEF	65536	/**< default queue size [records] */
+#define REC_BATCH_MAX	1024	/**< max. records per write */
+#define REC_WRITER_NS	1000000		/**< writer poll interval if queue is empty [ns] */
+#define KEY_CHECK_NS	100000000	/**< keypress check interval [ns] */
+
+/* queue index access between the threads */
+#define LOAD_ACQ(p)			__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE_REL(p, v)		__atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+/*--------------------------------------+
+|   TYPEDEFS                            |
++--------------------------------------*/
+/** lock-free single-producer/single-consumer queue
+ *
+ *  head is only written by the acquisition thread, tail only by the
+ *  writer thread. The indices run freely, the slot is index & mask.
+ *  Each index is in its own cache line to avoid false sharing.
+ */
+typedef struct {
+	u_int32			head;		/**< next slot to fill (producer) */
+	u_int8			pad1[60];
+	u_int32			tail;		/**< next slot to take (consumer) */
+	u_int8			pad2[60];
+	u_int32			mask;		/**< number of slots - 1 */
+	Z140_SNAPSHOT	*rec;		/**< slots */
+} REC_QUEUE;
+
+/** recorder state, shared between the threads */
+typedef struct {
+	MDIS_PATH	path;		/**< device path */
+	FILE		*out;		/**< output file */
+	int32		format;		/**< REC_CSV or REC_BIN */
+	u_int64		period;		/**< acquisition period [ns] (0=no wait) */
+	u_int32		maxRec;		/**< stop after n records (0=until keypress) */
+	int32		cpu;		/**< cpu of the acquisition thread (-1=any) */
+	int32		prio;		/**< SCHED_FIFO priority of the acquisition (0=normal) */
+	volatile int32 stop;	/**< stop request */
+	volatile int32 acqDone;	/**< acquisition thread finished */
+	REC_QUEUE	q;			/**< record queue */
+	/* acquisition thread */
+	u_int32		acquired;	/**< records read */
+	u_int32		dropped;	/**< records dropped (queue full) */
+	u_int32		highWater;	/**< max. queue fill [records] */
+	u_int32		overruns;	/**< missed acquisition deadlines */
+	int32		acqErr;		/**< MDIS error of the acquisition (0=ok) */
+	/* writer thread */
+	u_int32		written;	/**< records written */
+	u_int32		batches;	/**< write calls */
+	int32		wrErr;		/**< write failed */
+} REC_STATE;
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static REC_STATE G_rec;
+
+/*--------------------------------------+
+|  PROTOTYPES                           |
++--------------------------------------*/
+static void usage(void);
+static int PrintError(char *info);
+static u_int64 TimeNs(void);
+static void SleepUntil(u_int64 t);
+static void* AcqThread(void *arg);
+static void* WriterThread(void *arg);
+static int WriteBatch(REC_STATE *rs, Z140_SNAPSHOT *rec, u_int32 num);
+
+/********************************* usage ***********************************/
+/**  Print program usage
+ */
+static void usage(void)
+{
+	printf("Usage:    z140_rec <device> -o=<file> [<opts>]                           \n");
+	printf("Function: Two-thread recorder for the Z140 driver                        \n");
+	printf("Options:                                                        [default]\n");
+	printf("    device     device name (e.g. freq_1)                                 \n");
+	printf("    -o=<file>  output file (- for stdout)                                \n");
+	printf("    -F=<fmt>   output format....................................[bin]    \n");
+	printf("               csv: CSV lines (see z140_ctrl -F=csv)                     \n");
+	printf("               bin: binary Z140_SNAPSHOT structures                      \n");
+	printf("    -T=<us>    acquisition period (0=as fast as possible).......[1000]   \n");
+	printf("    -A=<n>     stop after n records.............................[keypress]\n");
+	printf("    -q=<n>     queue size in records (power of 2)...............[65536]  \n");
+	printf("    -c=<cpu>   pin the acquisition thread to cpu................[-]      \n");
+	printf("    -p=<prio>  run the acquisition thread with SCHED_FIFO prio..[-]      \n");
+	printf("\n");
+	printf("Notes:\n");
+	printf("- The acquisition thread only reads Z140_BLK_SNAPSHOT and pushes the\n");
+	printf("  record into a lock-free queue, the writer thread writes the records\n");
+	printf("  in batches. If the queue is full, the record is dropped.\n");
+	printf("- At exit, the number of acquired, written and dropped records, the\n");
+	printf("  queue high-water mark and the missed periods are printed (to stderr\n");
+	printf("  if the records are written to stdout).\n");
+	printf("\n");
+	printf("Copyright 2016-2019, MEN Mikro Elektronik GmbH\n%s\n", IdentString);
+}
+
+/***************************************************************************/
+/** Program main function
+ *
+ *  \param argc       \IN  argument counter
+ *  \param argv       \IN  argument vector
+ *
+ *  \return           success (0) or error code
+ */
+int main(int argc, char *argv[])
+{
+	REC_STATE *rs = &G_rec;
+	pthread_t acqThread, wrThread;
+	char	*device, *str, *errstr, *outFile, buf[40];
+	int32	periodUs, maxRec, qSize;
+	u_int64	start, keyCheck;
+	FILE	*msg;
+	int		n;
+	int		ret = ERR_OK;
+
+	/*----------------------+
+	|  check arguments      |
+	+----------------------*/
+	if ((errstr = UTL_ILLIOPT("o=F=T=A=q=c=p=?", buf))) {
+		printf("*** %s\n", errstr);
+		return ERR_PARAM;
+	}
+	if (UTL_TSTOPT("?")) {
+		usage();
+		return ERR_PARAM;
+	}
+
+	/*----------------------+
+	|  get arguments        |
+	+----------------------*/
+	for (device = NULL, n=1; n<argc; n++) {
+		if (*argv[n] != '-') {
+			device = argv[n];
+			break;
+		}
+	}
+	if (!device || !(outFile = UTL_TSTOPT("o="))) {
+		usage();
+		return ERR_PARAM;
+	}
+
+	memset(rs, 0, sizeof(*rs));
+	periodUs = ((str = UTL_TSTOPT("T=")) ? atoi(str) : 1000);
+	maxRec   = ((str = UTL_TSTOPT("A=")) ? atoi(str) : 0);
+	qSize    = ((str = UTL_TSTOPT("q=")) ? atoi(str) : REC_QUEUE_DEF);
+	rs->cpu  = ((str = UTL_TSTOPT("c=")) ? atoi(str) : -1);
+	rs->prio = ((str = UTL_TSTOPT("p=")) ? atoi(str) : 0);
+
+	rs->format = REC_BIN;
+	if ((str = UTL_TSTOPT("F="))) {
+		if (!strcmp(str, "csv"))
+			rs->format = REC_CSV;
+		else if (strcmp(str, "bin")) {
+			printf("*** error: -F= must be csv or bin\n");
+			return ERR_PARAM;
+		}
+	}
+
+	/* further parameter checking */
+	if ((periodUs < 0) || (maxRec < 0)) {
+		printf("*** error: -T=/-A= must not be negative\n");
+		return ERR_PARAM;
+	}
+	if ((qSize < 2) || (qSize & (qSize - 1))) {
+		printf("*** error: -q= must be a power of 2\n");
+		return ERR_PARAM;
+	}
+
+	rs->period = (u_int64)periodUs * 1000;
+	rs->maxRec = maxRec;
+	rs->q.mask = qSize - 1;
+
+	if ((rs->q.rec = (Z140_SNAPSHOT*)malloc(qSize * sizeof(Z140_SNAPSHOT))) == NULL) {
+		printf("*** can't alloc %d bytes\n", (int)(qSize * sizeof(Z140_SNAPSHOT)));
+		return ERR_FUNC;
+	}
+
+	if (!strcmp(outFile, "-"))
+		rs->out = stdout;
+	else if ((rs->out = fopen(outFile, rs->format == REC_BIN ? "wb" : "w")) == NULL) {
+		printf("*** can't open %s\n", outFile);
+		free(rs->q.rec);
+		return ERR_FUNC;
+	}
+
+	/* keep the records parseable */
+	msg = (rs->out == stdout) ? stderr : stdout;
+
+	/*----------------------+
+	|  open path            |
+	+----------------------*/
+	if ((rs->path = M_open(device)) < 0) {
+		ret = PrintError("open");
+		goto CLEANUP;
+	}
+
+	/*----------------------+
+	|  start threads        |
+	+----------------------*/
+	if (pthread_create(&wrThread, NULL, WriterThread, rs)) {
+		fprintf(msg, "*** can't start writer thread\n");
+		ret = ERR_FUNC;
+		goto CLOSE;
+	}
+	if (pthread_create(&acqThread, NULL, AcqThread, rs)) {
+		fprintf(msg, "*** can't start acquisition thread\n");
+		rs->stop = 1;
+		STORE_REL(&rs->acqDone, 1);
+		pthread_join(wrThread, NULL);
+		ret = ERR_FUNC;
+		goto CLOSE;
+	}
+
+	/*----------------------+
+	|  wait for end         |
+	+----------------------*/
+	start = keyCheck = TimeNs();
+	while (!LOAD_ACQ(&rs->acqDone)) {
+		keyCheck += KEY_CHECK_NS;
+		SleepUntil(keyCheck);
+		if (UOS_KeyPressed() != -1)
+			rs->stop = 1;
+	}
+
+	pthread_join(acqThread, NULL);
+	pthread_join(wrThread, NULL);
+	start = TimeNs() - start;
+
+	if (rs->acqErr) {
+		fprintf(msg, "*** can't getstat Z140_BLK_SNAPSHOT: %s\n",
+				M_errstring(rs->acqErr));
+		ret = ERR_FUNC;
+	}
+	if (rs->wrErr) {
+		fprintf(msg, "*** can't write %s\n", outFile);
+		ret = ERR_FUNC;
+	}
+
+	fprintf(msg, "%u records in %.3fs: %u written in %u batches, %u dropped\n",
+			rs->acquired, (double)start / 1e9, rs->written, rs->batches,
+			rs->dropped);
+	fprintf(msg, "queue high-water mark %u of %u records, %u missed periods\n",
+			rs->highWater, rs->q.mask + 1, rs->overruns);
+
+CLOSE:
+	if (M_close(rs->path) < 0)
+		ret = PrintError("close");
+
+CLEANUP:
+	if (rs->out != stdout)
+		fclose(rs->out);
+	free(rs->q.rec);
+
+	return ret;
+}
+
+/***************************************************************************/
+/** Acquisition thread (producer)
+ *
+ *  Reads a snapshot per period into the next free queue slot. Passed
+ *  deadlines are skipped and counted.
+ *
+ *  \param arg        \IN  recorder state
+ *
+ *  \return           NULL
+ */
+static void* AcqThread(void *arg)
+{
+	REC_STATE *rs = (REC_STATE*)arg;
+	REC_QUEUE *q = &rs->q;
+	Z140_SNAPSHOT dummy;
+	M_SG_BLOCK blk;
+	struct sched_param sp;
+	cpu_set_t cpus;
+	u_int64 next, now, skip;
+	u_int32 head, fill;
+
+	if (rs->cpu >= 0) {
+		CPU_ZERO(&cpus);
+		CPU_SET(rs->cpu, &cpus);
+		if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus))
+			fprintf(stderr, "*** can't pin acquisition thread to cpu %d\n",
+					rs->cpu);
+	}
+	if (rs->prio > 0) {
+		sp.sched_priority = rs->prio;
+		if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp))
+			fprintf(stderr, "*** can't set SCHED_FIFO prio %d\n", rs->prio);
+	}
+
+	next = TimeNs();
+
+	while (!rs->stop) {
+		head = q->head;
+		fill = head - LOAD_ACQ(&q->tail);
+
+		/* read into the free slot, or into a dummy if the queue is full */
+		blk.size = sizeof(Z140_SNAPSHOT);
+		blk.data = (fill <= q->mask) ? (void*)&q->rec[head & q->mask] :
+									   (void*)&dummy;
+
+		if (M_getstat(rs->path, Z140_BLK_SNAPSHOT, (int32*)&blk) < 0) {
+			rs->acqErr = UOS_ErrnoGet();
+			break;
+		}
+		rs->acquired++;
+
+		if (fill <= q->mask) {
+			STORE_REL(&q->head, head + 1);
+			if (fill + 1 > rs->highWater)
+				rs->highWater = fill + 1;
+		}
+		else
+			rs->dropped++;
+
+		if (rs->acquired == rs->maxRec)
+			break;
+
+		/* wait for next deadline */
+		if (rs->period) {
+			next += rs->period;
+			now = TimeNs();
+			if (now >= next) {
+				skip = (now - next) / rs->period + 1;
+				rs->overruns += (u_int32)skip;
+				next += skip * rs->period;
+			}
+			SleepUntil(next);
+		}
+	}
+
+	/* release the reader state of this thread in the driver */
+	M_setstat(rs->path, Z140_RD_RELEASE, 0);
+
+	rs->stop = 1;
+	/* publish the last queue head before the writer sees acqDone */
+	STORE_REL(&rs->acqDone, 1);
+	return NULL;
+}
+
+/***************************************************************************/
+/** Writer thread (consumer)
+ *
+ *  Writes the queued records in contiguous batches. If the queue is
+ *  empty, it waits REC_WRITER_NS. It drains the queue after the
+ *  acquisition has stopped.
+ *
+ *  \param arg        \IN  recorder state
+ *
+ *  \return           NULL
+ */
+static void* WriterThread(void *arg)
+{
+	REC_STATE *rs = (REC_STATE*)arg;
+	REC_QUEUE *q = &rs->q;
+	u_int32 tail, avail, idx, num;
+	int32 done;
+
+	for (;;) {
+		done = LOAD_ACQ(&rs->acqDone);
+		tail = q->tail;
+		avail = LOAD_ACQ(&q->head) - tail;
+
+		if (!avail) {
+			if (done)
+				break;
+			SleepUntil(TimeNs() + REC_WRITER_NS);
+			continue;
+		}
+
+		/* contiguous part up to the queue end */
+		idx = tail & q->mask;
+		num = q->mask + 1 - idx;
+		if (num > avail)
+			num = avail;
+		if (num > REC_BATCH_MAX)
+			num = REC_BATCH_MAX;
+
+		if (!rs->wrErr && WriteBatch(rs, &q->rec[idx], num))
+			rs->wrErr = 1;
+
+		STORE_REL(&q->tail, tail + num);
+		rs->written += rs->wrErr ? 0 : num;
+		rs->batches++;
+	}
+
+	fflush(rs->out);
+	return NULL;
+}
+
+/***************************************************************************/
+/** Write records to the output file
+ *
+ *  \param rs         \IN  recorder state
+ *  \param rec        \IN  records
+ *  \param num        \IN  number of records
+ *
+ *  \return           0 on success, -1 on write error
+ */
+static int WriteBatch(REC_STATE *rs, Z140_SNAPSHOT *rec, u_int32 num)
+{
+	int32 perA, perB;
+	u_int32 n;
+
+	if (rs->format == REC_BIN)
+		return (fwrite(rec, sizeof(Z140_SNAPSHOT), num, rs->out) == num) ? 0 : -1;
+
+	if (!rs->batches)
+		fprintf(rs->out, "tstamp_ns,period_a_us,err_a,period_b_us,err_b,"
+						 "dist_fwd,dist_bwd,status,age_a_ns,age_b_ns\n");
+
+	for (n = 0; n < num; n++, rec++) {
+		perA = rec->periodA & Z140_PER_MASK;
+		perB = rec->periodB & Z140_PER_MASK;
+
+		fprintf(rs->out, "%llu,%d.%03d,0x%x,%d.%03d,0x%x,%u,%u,0x%x,%lld,%lld\n",
+			(unsigned long long)rec->tstamp,
+			Z140_PER_US(perA), Z140_PER_NS(perA), Z140_PER_ERR(rec->periodA),
+			Z140_PER_US(perB), Z140_PER_NS(perB), Z140_PER_ERR(rec->periodB),
+			rec->distFwd, rec->distBwd, rec->status,
+			rec->ageA == Z140_AGE_NONE ? -1LL : (long long)rec->ageA,
+			rec->ageB == Z140_AGE_NONE ? -1LL : (long long)rec->ageB);
+	}
+
+	return ferror(rs->out) ? -1 : 0;
+}
+
+/***************************************************************************/
+/** Sleep until an absolute time
+ *
+ *  \param t          \IN  monotonic time [ns]
+ */
+static void SleepUntil(u_int64 t)
+{
+	struct timespec ts;
+
+	ts.tv_sec  = t / 1000000000;
+	ts.tv_nsec = t % 1000000000;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+}
+
+/***************************************************************************/
+/** Get monotonic time
+ *
+ *  \return           time [ns]
+ */
+static u_int64 TimeNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((u_int64)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+/***************************************************************************/
+/** Print MDIS error message
+ *
+ *  \param info       \IN  info string
+ *
+ *  \return           ERR_FUNC
+ */
+static int PrintError(char *info)
+{
+	printf("*** can't %s: %s\n", info, M_errstring (UOS_ErrnoGet()));
+	return ERR_FUNC;
+}
@@ -0,0 +1,388 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                    Z140_TRACE                      ************
+ ************                                                    ************
+ ****************************************************************************/
+/*!
+ *        \file  z140_trace.c
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  Drain and decode the call trace of the Z140 driver
+ *
+ *               The tool enables the call trace of the driver
+ *               (Z140_TRACE_MODE), drains the binary trace entries
+ *               (Z140_BLK_TRACE) and prints them as text. The raw entries
+ *               can be written to a file and decoded later.
+ *
+ *     Required: libraries: mdis_api, usr_oss, usr_utl
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*--------------------------------------+
+|  INCLUDES                             |
++--------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_api.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+#include <MEN/mdis_err.h>
+#include <MEN/z140_drv.h>
+
+static const char IdentString[]=MENT_XSTR(MAK_REVISION);
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define ERR_OK		0
+#define ERR_PARAM	1
+#define ERR_FUNC	2
+
+#define TRACE_BUF_ENTRIES	256		/**< entries per Z140_BLK_TRACE call */
+
+/** code and its name */
+#define CODE(c)		{ c, #c }
+
+/*--------------------------------------+
+|   TYPEDEFS                            |
++--------------------------------------*/
+/** code name */
+typedef struct {
+	int32	code;		/**< getstat/setstat code */
+	char	*name;		/**< name of the code */
+} TRACE_CODE;
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static const TRACE_CODE G_code[] = {
+	CODE(M_LL_DEBUG_LEVEL),
+	CODE(M_LL_IRQ_ENABLE),
+	CODE(M_LL_IRQ_COUNT),
+	CODE(M_LL_CH_NUMBER),
+	CODE(M_LL_CH_DIR),
+	CODE(M_LL_CH_LEN),
+	CODE(M_LL_CH_TYP),
+	CODE(M_MK_BLK_REV_ID),
+	CODE(Z140_DEBOUNCET),
+	CODE(Z140_MEAS_TOUT),
+	CODE(Z140_ROLLINGT),
+	CODE(Z140_STANDSTILLT),
+	CODE(Z140_DIRDET_TOUT),
+	CODE(Z140_DISTRST),
+	CODE(Z140_TPATTERN),
+	CODE(Z140_PERIOD_A),
+	CODE(Z140_PERIOD_B),
+	CODE(Z140_DISTANCE_FWD),
+	CODE(Z140_DISTANCE_BWD),
+	CODE(Z140_STATUS),
+	CODE(Z140_RING_OVERRUN),
+	CODE(Z140_SIG_SET),
+	CODE(Z140_SIG_CLR),
+	CODE(Z140_SIG_MASK),
+	CODE(Z140_SIG_EDGES),
+	CODE(Z140_PERSTAT_WIN),
+	CODE(Z140_PERSTAT_RST),
+	CODE(Z140_SHADOW_CHK),
+	CODE(Z140_PROFILE),
+	CODE(Z140_PROFILE_NUM),
+	CODE(Z140_PERIOD_SEQ_A),
+	CODE(Z140_PERIOD_SEQ_B),
+	CODE(Z140_HIST_RST),
+	CODE(Z140_CNT_RST),
+	CODE(Z140_TRACE_MODE),
+	CODE(Z140_FILTER_A),
+	CODE(Z140_FILTER_B),
+	CODE(Z140_PERIOD_FLT_A),
+	CODE(Z140_PERIOD_FLT_B),
+	CODE(Z140_SPEED),
+	CODE(Z140_RD_RELEASE),
+	CODE(Z140_BLK_SNAPSHOT),
+	CODE(Z140_BLK_DISTANCE64),
+	CODE(Z140_BLK_PERSTAT),
+	CODE(Z140_BLK_CONFIG),
+	CODE(Z140_BLK_PROFILES),
+	CODE(Z140_BLK_TSTAMP),
+	CODE(Z140_BLK_HIST),
+	CODE(Z140_BLK_COUNTERS),
+	CODE(Z140_BLK_SPEED),
+	CODE(Z140_BLK_VALUE),
+	{ 0, NULL }
+};
+
+static Z140_TRACE_ENTRY G_buf[TRACE_BUF_ENTRIES];
+
+/*--------------------------------------+
+|  PROTOTYPES                           |
++--------------------------------------*/
+static void usage(void);
+static int PrintError(char *info);
+static const char* CodeName(int32 code);
+static void PrintEntries(Z140_TRACE_ENTRY *e, u_int32 num, u_int32 *nextSeq);
+static int DecodeFile(char *inFile);
+
+/********************************* usage ***********************************/
+/**  Print program usage
+ */
+static void usage(void)
+{
+	printf("Usage:    z140_trace <device> [<opts>]                                   \n");
+	printf("          z140_trace -r=<file>                                           \n");
+	printf("Function: Drain and decode the call trace of the Z140 driver             \n");
+	printf("Options:                                                        [default]\n");
+	printf("    device     device name (e.g. freq_1)                                 \n");
+	printf("    -m=<mode>  set trace mode before draining                            \n");
+	printf("               (0=off, 1=getstat, 2=setstat, 3=both)                     \n");
+	printf("    -l         drain in a loop until keypress                            \n");
+	printf("    -d=<ms>    delay between loop cycles [ms]...................[100]    \n");
+	printf("    -q         don't print the entries                                   \n");
+	printf("    -o=<file>  write the raw entries to file                             \n");
+	printf("    -r=<file>  decode the raw entries of file                            \n");
+	printf("\n");
+	printf("Notes:\n");
+	printf("- Output columns: time [us] relative to the first entry, sequence\n");
+	printf("  number, channel, get/set, code, value (block codes: size), error.\n");
+	printf("- Entries overwritten by the driver before they were drained are\n");
+	printf("  reported as lost.\n");
+	printf("\n");
+	printf("Copyright 2016-2019, MEN Mikro Elektronik GmbH\n%s\n", IdentString);
+}
+
+/***************************************************************************/
+/** Program main function
+ *
+ *  \param argc       \IN  argument counter
+ *  \param argv       \IN  argument vector
+ *
+ *  \return           success (0) or error code
+ */
+int main(int argc, char *argv[])
+{
+	MDIS_PATH path;
+	M_SG_BLOCK blk;
+	char	*device, *str, *errstr, *outFile, *inFile, buf[40];
+	int32	mode, loop, delay, quiet;
+	u_int32	num, total = 0, nextSeq = 0;
+	FILE	*out = NULL;
+	int		n;
+	int		ret = ERR_OK;
+
+	/*----------------------+
+	|  check arguments      |
+	+----------------------*/
+	if ((errstr = UTL_ILLIOPT("m=ld=qo=r=?", buf))) {
+		printf("*** %s\n", errstr);
+		return ERR_PARAM;
+	}
+	if (UTL_TSTOPT("?")) {
+		usage();
+		return ERR_PARAM;
+	}
+
+	/* decode file */
+	if ((inFile = UTL_TSTOPT("r=")))
+		return DecodeFile(inFile);
+
+	/*----------------------+
+	|  get arguments        |
+	+----------------------*/
+	for (device = NULL, n=1; n<argc; n++) {
+		if (*argv[n] != '-') {
+			device = argv[n];
+			break;
+		}
+	}
+	if (!device) {
+		usage();
+		return ERR_PARAM;
+	}
+
+	mode    = ((str = UTL_TSTOPT("m=")) ? atoi(str) : -1);
+	loop    = (UTL_TSTOPT("l") ? 1 : 0);
+	delay   = ((str = UTL_TSTOPT("d=")) ? atoi(str) : 100);
+	quiet   = (UTL_TSTOPT("q") ? 1 : 0);
+	outFile = UTL_TSTOPT("o=");
+
+	/* further parameter checking */
+	if ((mode != -1) && !IN_RANGE(mode, 0, Z140_TRC_GET | Z140_TRC_SET)) {
+		printf("*** error: -m= must be 0..3\n");
+		return ERR_PARAM;
+	}
+	if (delay < 0) {
+		printf("*** error: -d= must not be negative\n");
+		return ERR_PARAM;
+	}
+
+	/*----------------------+
+	|  open path            |
+	+----------------------*/
+	if ((path = M_open(device)) < 0)
+		return PrintError("open");
+
+	if (mode != -1) {
+		if (M_setstat(path, Z140_TRACE_MODE, mode) < 0) {
+			ret = PrintError("setstat Z140_TRACE_MODE");
+			goto CLEANUP;
+		}
+	}
+
+	if (outFile && ((out = fopen(outFile, "wb")) == NULL)) {
+		printf("*** can't open %s\n", outFile);
+		ret = ERR_FUNC;
+		goto CLEANUP;
+	}
+
+	/*----------------------+
+	|  drain                |
+	+----------------------*/
+	do {
+		do {
+			blk.data = (void*)G_buf;
+			blk.size = sizeof(G_buf);
+			if (M_getstat(path, Z140_BLK_TRACE, (int32*)&blk) < 0) {
+				ret = PrintError("getstat Z140_BLK_TRACE");
+				goto CLEANUP;
+			}
+			num = blk.size / sizeof(Z140_TRACE_ENTRY);
+
+			if (out && (fwrite(G_buf, sizeof(Z140_TRACE_ENTRY), num, out) != num)) {
+				printf("*** can't write %s\n", outFile);
+				ret = ERR_FUNC;
+				goto CLEANUP;
+			}
+			if (!quiet)
+				PrintEntries(G_buf, num, &nextSeq);
+			total += num;
+		} while (num == TRACE_BUF_ENTRIES);
+
+		if (loop)
+			UOS_Delay(delay);
+	} while (loop && (UOS_KeyPressed() == -1));
+
+	printf("%u entries\n", total);
+
+CLEANUP:
+	if (out)
+		fclose(out);
+
+	if (M_close(path) < 0)
+		ret = PrintError("close");
+
+	return ret;
+}
+
+/***************************************************************************/
+/** Decode the raw entries of a file
+ *
+ *  \param inFile     \IN  file name
+ *
+ *  \return           success (0) or error code
+ */
+static int DecodeFile(char *inFile)
+{
+	FILE *in;
+	u_int32 num, total = 0, nextSeq = 0;
+
+	if ((in = fopen(inFile, "rb")) == NULL) {
+		printf("*** can't open %s\n", inFile);
+		return ERR_FUNC;
+	}
+
+	while ((num = (u_int32)fread(G_buf, sizeof(Z140_TRACE_ENTRY),
+								 TRACE_BUF_ENTRIES, in)) > 0) {
+		PrintEntries(G_buf, num, &nextSeq);
+		total += num;
+	}
+
+	fclose(in);
+	printf("%u entries\n", total);
+
+	return ERR_OK;
+}
+
+/***************************************************************************/
+/** Print trace entries
+ *
+ *  \param e          \IN    trace entries
+ *  \param num        \IN    number of entries
+ *  \param nextSeq    \INOUT expected sequence number (0 before first entry)
+ */
+static void PrintEntries(
+	Z140_TRACE_ENTRY	*e,
+	u_int32				num,
+	u_int32				*nextSeq)
+{
+	static u_int64 t0;
+	static int first = 1;
+	u_int32 n;
+
+	for (n = 0; n < num; n++, e++) {
+		if (first) {
+			t0 = e->tstamp;
+			first = 0;
+		}
+		else if (e->seq != *nextSeq)
+			printf("--- %u entries lost\n", e->seq - *nextSeq);
+		*nextSeq = e->seq + 1;
+
+		printf("%12.3f %8u ch%-2u %s %-20s 0x%08x %s\n",
+			   (double)(e->tstamp - t0) / 1000.0, e->seq, e->ch,
+			   e->type == Z140_TRC_SET ? "set" : "get", CodeName(e->code),
+			   (unsigned)e->value,
+			   e->error ? M_errstring(e->error) : "ok");
+	}
+}
+
+/***************************************************************************/
+/** Get the name of a getstat/setstat code
+ *
+ *  \param code       \IN  getstat/setstat code
+ *
+ *  \return           name or hex code
+ */
+static const char* CodeName(int32 code)
+{
+	static char hex[12];
+	const TRACE_CODE *c;
+
+	for (c = G_code; c->name; c++) {
+		if (c->code == code)
+			return c->name;
+	}
+
+	sprintf(hex, "0x%04x", (unsigned)code);
+	return hex;
+}
+
+/***************************************************************************/
+/** Print MDIS error message
+ *
+ *  \param info       \IN  info string
+ *
+ *  \return           ERR_FUNC
+ */
+static int PrintError(char *info)
+{
+	printf("*** can't %s: %s\n", info, M_errstring (UOS_ErrnoGet()));
+	return ERR_FUNC;
+}
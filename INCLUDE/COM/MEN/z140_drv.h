@@ -56,6 +56,44 @@
 #define Z140_DISTANCE_FWD 	M_DEV_OF+0x09	/**< G  : Number of "sensor pulses" in forward direction */
 #define Z140_DISTANCE_BWD 	M_DEV_OF+0x0a	/**< G  : Number of "sensor pulses" in backward direction */
 #define Z140_STATUS			M_DEV_OF+0x0b	/**< G  : STATUS flags (STATUS register of the Z140 IP core) */
+#define Z140_RING_OVERRUN	M_DEV_OF+0x0c	/**< G  : Number of sample ring overruns (records dropped or overwritten unread) */
+#define Z140_SIG_SET		M_DEV_OF+0x0d	/**<   S: Install signal for status transitions (value=signal number) */
+#define Z140_SIG_CLR		M_DEV_OF+0x0e	/**<   S: Remove signal for status transitions */
+#define Z140_SIG_MASK		M_DEV_OF+0x0f	/**< G,S: Z140_ST_xxx flags whose transitions send the signal (default: all except Z140_ST_ROLLING) */
+#define Z140_SIG_EDGES		M_DEV_OF+0x10	/**< G  : Z140_ST_xxx flags changed since last call (cleared on read) */
+#define Z140_PERSTAT_WIN	M_DEV_OF+0x11	/**< G,S: Period statistics window in valid periods (0=until reset, max. 65536) */
+#define Z140_PERSTAT_RST	M_DEV_OF+0x12	/**<   S: Reset period statistics */
+#define Z140_SHADOW_CHK		M_DEV_OF+0x13	/**< G  : Compare configuration shadow with hardware (Z140_SHD_xxx flags of differing registers) */
+#define Z140_PROFILE		M_DEV_OF+0x14	/**< G,S: Apply descriptor profile 0..n-1 / get active profile (Z140_PROFILE_NONE if none) */
+#define Z140_PROFILE_NUM	M_DEV_OF+0x15	/**< G  : Number of descriptor profiles */
+#define Z140_PERIOD_SEQ_A	M_DEV_OF+0x16	/**< G  : Sequence number of the last new period of signal A */
+#define Z140_PERIOD_SEQ_B	M_DEV_OF+0x17	/**< G  : Sequence number of the last new period of signal B */
+#define Z140_HIST_RST		M_DEV_OF+0x18	/**<   S: Reset period histograms */
+#define Z140_CNT_RST		M_DEV_OF+0x19	/**<   S: Reset driver counters */
+#define Z140_TRACE_MODE		M_DEV_OF+0x1a	/**< G,S: Z140_TRC_xxx flags of the traced calls (0=off) */
+#define Z140_FILTER_A		M_DEV_OF+0x1b	/**< G,S: Period filter of signal A (Z140_FLT_xxx type | parameter) */
+#define Z140_FILTER_B		M_DEV_OF+0x1c	/**< G,S: Period filter of signal B (Z140_FLT_xxx type | parameter) */
+#define Z140_PERIOD_FLT_A	M_DEV_OF+0x1d	/**< G  : Filtered period time in 1/32us for signal A */
+#define Z140_PERIOD_FLT_B	M_DEV_OF+0x1e	/**< G  : Filtered period time in 1/32us for signal B */
+#define Z140_SPEED		M_DEV_OF+0x1f	/**< G  : Speed estimate in pulses/s with Z140_SPEED_FRAC fractional bits, negative if backward (see Z140_SPEED_EST) */
+#define Z140_RD_RELEASE		M_DEV_OF+0x20	/**<   S: Release the reader state (period latch, stream cursor) of the calling process */
+/**@}*/
+
+/** \name Z140 specific Getstat/Setstat block codes
+*  \anchor getstat_setstat_blk_codes
+*/
+/**@{*/
+#define Z140_BLK_SNAPSHOT	M_DEV_BLK_OF+0x00	/**< G  : Measurement snapshot of all measurement registers (see Z140_SNAPSHOT) */
+#define Z140_BLK_DISTANCE64	M_DEV_BLK_OF+0x01	/**< G  : 64-bit forward and backward distance counters (see Z140_DISTANCE64) */
+#define Z140_BLK_PERSTAT	M_DEV_BLK_OF+0x02	/**< G  : Period statistics of signal A and B (see Z140_PERSTAT) */
+#define Z140_BLK_CONFIG		M_DEV_BLK_OF+0x03	/**< G,S: Complete configuration, validated and applied at once (see Z140_CONFIG) */
+#define Z140_BLK_PROFILES	M_DEV_BLK_OF+0x04	/**< G  : Descriptor profiles (array of Z140_PROFILE_ENTRY) */
+#define Z140_BLK_TSTAMP		M_DEV_BLK_OF+0x05	/**< G  : Capture time of the last measurement getstat on the device (see Z140_TSTAMP) */
+#define Z140_BLK_HIST		M_DEV_BLK_OF+0x06	/**< G  : Period histograms of signal A and B (see Z140_HIST) */
+#define Z140_BLK_COUNTERS	M_DEV_BLK_OF+0x07	/**< G  : Driver call and register access counters (see Z140_COUNTERS) */
+#define Z140_BLK_TRACE		M_DEV_BLK_OF+0x08	/**< G  : Drain the call trace ring (array of Z140_TRACE_ENTRY) */
+#define Z140_BLK_SPEED		M_DEV_BLK_OF+0x09	/**< G  : Speed estimate with quality flags (see Z140_SPEED_EST) */
+#define Z140_BLK_VALUE		M_DEV_BLK_OF+0x0a	/**< G  : Single measurement value with its capture time (see Z140_VALUE) */
 /**@}*/
 
 /* Z140_TPATTERN configuration */
@@ -64,22 +102,332 @@
 #define Z140_TP_BWD			2		/**< Counterclockwise pattern (backward movement) */
 #define Z140_TP_STANDSTILL	3		/**< Silence pattern (standstill) */
 
+/* Z140_SHADOW_CHK flags */
+#define Z140_SHD_DEBOUNCET		0x01	/**< debounce time differs */
+#define Z140_SHD_MEAS_TOUT		0x02	/**< measurement timeout differs */
+#define Z140_SHD_ROLLINGT		0x04	/**< rolling time period differs */
+#define Z140_SHD_STANDSTILLT	0x08	/**< standstill time period differs */
+#define Z140_SHD_DIRDET_TOUT	0x10	/**< direction detection timeout differs */
+#define Z140_SHD_TPATTERN		0x20	/**< test pattern configuration differs */
+
+/* descriptor profiles */
+#define Z140_PROFILE_NONE		-1		/**< no profile active (configuration modified) */
+#define Z140_PROFILE_MAX		8		/**< max. number of descriptor profiles */
+#define Z140_PROFILE_NAMELEN	16		/**< max. profile name length (incl. termination) */
+
+/* Z140_FILTER_A/B configuration: type | parameter */
+#define Z140_FLT_OFF		0x000	/**< no filter: last valid period */
+#define Z140_FLT_MEDIAN		0x100	/**< median of the last n valid periods (parameter n) */
+#define Z140_FLT_IIR		0x200	/**< first-order IIR y += (x - y) / 2^k (parameter k) */
+#define Z140_FLT_TYPE_MASK	0xf00	/**< filter type */
+#define Z140_FLT_PARAM_MASK	0x0ff	/**< filter parameter */
+#define Z140_FLT_MEDIAN_MAX	15		/**< max. median length n */
+#define Z140_FLT_IIR_MAX	15		/**< max. IIR shift k */
+
+/* speed estimate */
+#define Z140_SPEED_FRAC		8		/**< fractional bits of the speed [pulses/s] */
+#define Z140_SPD_VALID		0x01	/**< speed valid */
+#define Z140_SPD_PERIOD		0x02	/**< period measurement contributes */
+#define Z140_SPD_COUNT		0x04	/**< distance counters contribute */
+#define Z140_SPD_STANDSTILL	0x08	/**< standstill, speed is 0 */
+#define Z140_SPD_DIR_INVALID	0x10	/**< direction unknown, speed is positive */
+
+/* OVERFLOW_POLICY descriptor key */
+#define Z140_OVF_DROP_OLDEST	0	/**< full sample ring: overwrite oldest record */
+#define Z140_OVF_DROP_NEWEST	1	/**< full sample ring: discard new record */
+
 /* Z140_PERIOD_A/B macros */
 #define Z140_PER_US(read)			((read) >> 5) 					 /**< period time in us */
 #define Z140_PER_NS(read)			((((read) & 0x1F) * 3125) / 100) /**< period time in ns */
 
+/* Z140_PERIOD_A/B raw register flags (see Z140_SNAPSHOT) */
+#define Z140_PER_MASK		0x1FFFFFFF	/**< Period value */
+#define Z140_PER_VLD		0x20000000	/**< Period valid */
+#define Z140_PER_LSTS		0x40000000	/**< Phase length validation failed */
+#define Z140_PER_NEW		0x80000000	/**< New period value since last read */
+
+/** Z140_ERR_xxx code (or 0) for a raw period value, same priority as Z140_PERIOD_A/B */
+#define Z140_PER_ERR(raw)	(!((raw) & Z140_PER_NEW)  ? Z140_ERR_NO_DATA :		\
+							  ((raw) & Z140_PER_LSTS) ? Z140_ERR_PH_VIOLATION :	\
+							 !((raw) & Z140_PER_VLD)  ? Z140_ERR_PER_INVALID : 0)
+
 /* Z140_STATUS flags */
 #define Z140_ST_ROLLING		0x01	/**< Any edge on any input signal */
 #define Z140_ST_STANDSTILL	0x02	/**< No edge within Standstill Time Period */
 #define Z140_ST_DIR_FWD		0x04	/**< Direction is forward */
 #define Z140_ST_DIR_BWD		0x08	/**< Direction is backward */
 #define Z140_ST_DIR_INVALID	0x10	/**< No direction determined within Direction Detection Timeout */
+#define Z140_ST_TORN		0x80	/**< Driver flag (Z140_SNAPSHOT only): distance counters changed during all re-reads */
 
-/* Z140_PERIOD_A/B error codes */
+/* Z140_PERIOD_A/B error codes (ERR_DEV+0x80.. are used by the Z140 libraries) */
 #define Z140_ERR_PER_INVALID	(ERR_DEV+1) /**< signal period invalid */
 #define Z140_ERR_PH_VIOLATION	(ERR_DEV+2) /**< signal phase length violation */
 #define Z140_ERR_NO_DATA		(ERR_DEV+3) /**< no new period value since last read */
 
+/* Z140_SNAPSHOT structure version */
+#define Z140_SNAPSHOT_VER	2
+
+/* period histogram: 16 linear sub-buckets per power of two */
+#define Z140_HIST_SUB_BITS	4		/**< sub-bucket bits (max. relative bucket width 1/16) */
+#define Z140_HIST_BUCKETS	416		/**< number of buckets for 29-bit period values */
+
+/** lowest period value [1/32us] of histogram bucket idx */
+#define Z140_HIST_LOW(idx)	((idx) < 16 ? (u_int32)(idx) : \
+							 (u_int32)(16 + ((idx) & 15)) << (((idx) >> 4) - 1))
+
+/* driver counters: one slot per getstat/setstat code */
+#define Z140_CNT_STD		0x30	/**< slots of codes M_DEV_OF+0x00..0x2f */
+#define Z140_CNT_BLK		0x10	/**< slots of codes M_DEV_BLK_OF+0x00..0x0f */
+#define Z140_CNT_CODES		(Z140_CNT_STD + Z140_CNT_BLK + 1)	/**< number of slots (last: all other codes) */
+
+/** counter slot of a getstat/setstat code */
+#define Z140_CNT_IDX(code)	\
+	((code) >= M_DEV_OF && (code) < M_DEV_OF + Z140_CNT_STD ? (code) - M_DEV_OF : \
+	 (code) >= M_DEV_BLK_OF && (code) < M_DEV_BLK_OF + Z140_CNT_BLK ? \
+	 Z140_CNT_STD + (code) - M_DEV_BLK_OF : Z140_CNT_CODES - 1)
+
+/* unit of the call costs */
+#define Z140_COST_CYCLES	0		/**< cpu cycle counter (Linux get_cycles()) */
+#define Z140_COST_NS		1		/**< ns of the OSS tick counter */
+
+/* Z140_TRACE_MODE flags / Z140_TRACE_ENTRY types */
+#define Z140_TRC_GET		0x01	/**< getstat calls */
+#define Z140_TRC_SET		0x02	/**< setstat calls */
+
+/* age of a period value which was never new */
+#define Z140_AGE_NONE		((u_int64)-1)
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/** Measurement snapshot (Z140_BLK_SNAPSHOT)
+ *
+ *  All measurement registers are read within one driver call. The distance
+ *  counters and the status are re-read until they are consistent, so they
+ *  belong to the same instant. If the counters still changed after the last
+ *  re-read, the driver sets Z140_ST_TORN in the status and the distance
+ *  values may be from different instants. The period values are returned as raw
+ *  register values including the Z140_PER_NEW/VLD/LSTS flags.
+ *
+ *  The age of a period is the time since the driver read the value with
+ *  NEW flag for the first time (Z140_AGE_NONE if it never did).
+ */
+typedef struct {
+	u_int32	version;	/**< structure version (Z140_SNAPSHOT_VER) */
+	u_int32	periodA;	/**< raw period of signal A (1/32us and Z140_PER_xxx flags) */
+	u_int32	periodB;	/**< raw period of signal B (1/32us and Z140_PER_xxx flags) */
+	u_int32	distFwd;	/**< number of "sensor pulses" in forward direction */
+	u_int32	distBwd;	/**< number of "sensor pulses" in backward direction */
+	u_int32	status;		/**< STATUS flags (Z140_ST_xxx) */
+	u_int64	tstamp;		/**< capture time [ns] */
+	u_int64	ageA;		/**< age of period A at tstamp [ns] */
+	u_int64	ageB;		/**< age of period B at tstamp [ns] */
+} Z140_SNAPSHOT;
+
+/** 64-bit distance counters (Z140_BLK_DISTANCE64)
+ *
+ *  The driver extends the 32-bit distance registers of the IP core to 64-bit
+ *  on each access and sampler call. Z140_DISTRST resets the counters.
+ *  The capture time is omitted for buffers without space for it.
+ */
+typedef struct {
+	u_int64	distFwd;	/**< number of "sensor pulses" in forward direction */
+	u_int64	distBwd;	/**< number of "sensor pulses" in backward direction */
+	u_int64	tstamp;		/**< capture time [ns] */
+} Z140_DISTANCE64;
+
+/** Configuration of the frequency counter (Z140_BLK_CONFIG)
+ *
+ *  On setstat, all values are checked before any register is written, so
+ *  an illegal value leaves the configuration unchanged. The value ranges
+ *  are the same as for the single setstat codes.
+ */
+typedef struct {
+	u_int32	debounceT;		/**< debounce time [us] (Z140_DEBOUNCET) */
+	u_int32	measTout;		/**< measurement timeout [ms] (Z140_MEAS_TOUT) */
+	u_int32	rollingT;		/**< rolling time period [ms] (Z140_ROLLINGT) */
+	u_int32	standstillT;	/**< standstill time period [ms] (Z140_STANDSTILLT) */
+	u_int32	dirdetTout;		/**< direction detection timeout [ms] (Z140_DIRDET_TOUT) */
+	u_int32	tpattern;		/**< test pattern (Z140_TP_xxx) */
+} Z140_CONFIG;
+
+/** Descriptor profile (Z140_BLK_PROFILES) */
+typedef struct Z140_PROFILE_ENTRY {
+	char		name[Z140_PROFILE_NAMELEN];	/**< profile name (PROFILE_n/NAME) */
+	Z140_CONFIG	cfg;						/**< profile configuration */
+} Z140_PROFILE_ENTRY;
+
+/** Statistics over valid periods of one signal */
+typedef struct {
+	u_int32	count;		/**< number of valid periods */
+	u_int32	min;		/**< min. period [1/32us] */
+	u_int32	max;		/**< max. period [1/32us] */
+	u_int32	mean;		/**< mean period [1/32us] */
+	u_int64	m2;			/**< sum of squared deviations from mean [(1/32us)^2] */
+} Z140_PERSTAT_SIG;
+
+/** Variance of the periods [(1/32us)^2] (see Z140_PERSTAT_SIG) */
+#define Z140_PERSTAT_VAR(sig)	((sig).count > 1 ? (sig).m2 / ((sig).count - 1) : 0)
+
+/** Period statistics (Z140_BLK_PERSTAT)
+ *
+ *  The driver updates the statistics with each new valid period value
+ *  (NEW and VLD set, LSTS not set). When the window (Z140_PERSTAT_WIN) is
+ *  complete, the results are moved to last[] and a new window is started.
+ *  The windows of both signals complete independently. Without window,
+ *  the count is halved at 2^28 periods (mean and variance are kept).
+ */
+typedef struct {
+	u_int32	window;				/**< window size (0=until reset) */
+	u_int32	windows[2];			/**< number of completed windows of signal A/B */
+	u_int32	reserved;			/**< reserved */
+	Z140_PERSTAT_SIG	cur[2];		/**< current window of signal A/B */
+	Z140_PERSTAT_SIG	last[2];	/**< last completed window of signal A/B */
+} Z140_PERSTAT;
+
+/** Period histogram of one signal */
+typedef struct {
+	u_int64	count;		/**< number of valid periods */
+	u_int32	saturated;	/**< periods not counted, because the bucket was full */
+	u_int32	reserved;	/**< reserved */
+	u_int32	bucket[Z140_HIST_BUCKETS];	/**< number of periods from Z140_HIST_LOW(idx) to Z140_HIST_LOW(idx+1)-1 */
+} Z140_HIST_SIG;
+
+/** Period histograms (Z140_BLK_HIST)
+ *
+ *  The driver counts each new valid period in a log-scaled bucket, with 16
+ *  linear sub-buckets per power of two. Up to 15 (1/32us) each value has
+ *  its own bucket, above the bucket width is at most 1/16 of the value.
+ *  Z140_HIST_RST resets the histograms.
+ */
+typedef struct Z140_HIST {
+	u_int64			since;	/**< time of the last reset [ns] (see Z140_SNAPSHOT.tstamp) */
+	Z140_HIST_SIG	sig[2];	/**< histogram of signal A/B */
+} Z140_HIST;
+
+/** Call counters of one getstat/setstat code */
+typedef struct {
+	u_int32	calls;		/**< number of calls */
+	u_int32	errors;		/**< calls returning an error */
+	u_int32	costMin;	/**< min. cost of a call (0 if no calls) */
+	u_int32	costMax;	/**< max. cost of a call */
+	u_int64	costSum;	/**< sum of the costs of all calls */
+} Z140_CNT_CALL;
+
+/** Driver counters (Z140_BLK_COUNTERS)
+ *
+ *  The driver counts the getstat/setstat calls per code with their cost
+ *  (time from entry to return of the driver function, see costUnit), the
+ *  register accesses and the period errors returned by Z140_PERIOD_A/B.
+ *  The counters are always active and cheap enough for production use, so
+ *  they can be read instead of raising DEBUG_LEVEL. Z140_CNT_RST resets
+ *  them.
+ *
+ *  A call is counted when it returns, so calls in progress in other
+ *  processes are not included yet.
+ */
+typedef struct Z140_COUNTERS {
+	u_int64	since;			/**< time of the last reset [ns] (see Z140_SNAPSHOT.tstamp) */
+	u_int32	costUnit;		/**< unit of the costs (Z140_COST_xxx) */
+	u_int32	reserved;		/**< reserved */
+	u_int64	mmioRead;		/**< register reads */
+	u_int64	mmioWrite;		/**< register writes */
+	u_int32	errNoData;		/**< Z140_ERR_NO_DATA returned */
+	u_int32	errPhViolation;	/**< Z140_ERR_PH_VIOLATION returned */
+	u_int32	errPerInvalid;	/**< Z140_ERR_PER_INVALID returned */
+	u_int32	reserved2;		/**< reserved */
+	Z140_CNT_CALL	getStat[Z140_CNT_CODES];	/**< getstat calls per slot (see Z140_CNT_IDX) */
+	Z140_CNT_CALL	setStat[Z140_CNT_CODES];	/**< setstat calls per slot (see Z140_CNT_IDX) */
+} Z140_COUNTERS;
+
+/** Call trace entry (Z140_BLK_TRACE)
+ *
+ *  With Z140_TRACE_MODE (or descriptor key TRACE_MODE), the driver records
+ *  each getstat/setstat call as fixed-size binary entry into a ring of
+ *  TRACE_DEPTH entries, overwriting the oldest entry when it is full.
+ *  Z140_BLK_TRACE returns and removes as many entries as fit into the
+ *  buffer, gaps in the sequence numbers show overwritten entries.
+ *  Z140_BLK_TRACE calls are not traced.
+ */
+typedef struct Z140_TRACE_ENTRY {
+	u_int64	tstamp;		/**< time of the return [ns] (see Z140_SNAPSHOT.tstamp) */
+	u_int32	seq;		/**< entry sequence number */
+	u_int16	type;		/**< Z140_TRC_GET or Z140_TRC_SET */
+	u_int16	ch;			/**< channel of the path */
+	u_int32	code;		/**< getstat/setstat code */
+	int32	value;		/**< value set or returned (block codes: block size) */
+	int32	error;		/**< returned error code */
+	u_int32	reserved;	/**< reserved */
+} Z140_TRACE_ENTRY;
+
+/** Measurement record of the sample stream (M_getblock)
+ *
+ *  Each M_getblock() call returns as many records as fit into the buffer.
+ *  The sequence number is incremented for each acquired record, so gaps
+ *  show records which were lost before they have been read.
+ */
+typedef struct Z140_SAMPLE {
+	u_int64	tstamp;		/**< capture time [ns] */
+	u_int32	seq;		/**< record sequence number */
+	u_int32	periodA;	/**< raw period of signal A (1/32us and Z140_PER_xxx flags) */
+	u_int32	periodB;	/**< raw period of signal B (1/32us and Z140_PER_xxx flags) */
+	u_int32	distFwd;	/**< number of "sensor pulses" in forward direction */
+	u_int32	distBwd;	/**< number of "sensor pulses" in backward direction */
+	u_int32	status;		/**< STATUS flags (Z140_ST_xxx) */
+	u_int64	ageA;		/**< age of period A at tstamp [ns] (see Z140_SNAPSHOT) */
+	u_int64	ageB;		/**< age of period B at tstamp [ns] (see Z140_SNAPSHOT) */
+} Z140_SAMPLE;
+
+/** Capture time of a single measurement value (Z140_BLK_TSTAMP)
+ *
+ *  The driver keeps the capture time of the last Z140_PERIOD_A/B,
+ *  Z140_DISTANCE_FWD/BWD or Z140_STATUS getstat on the device, from any
+ *  path or process.
+ */
+typedef struct {
+	u_int32	code;		/**< getstat code of the value (0=none yet) */
+	u_int32	reserved;	/**< reserved */
+	u_int64	tstamp;		/**< capture time [ns] */
+	u_int64	age;		/**< age of the period at tstamp [ns] (Z140_AGE_NONE for other codes) */
+} Z140_TSTAMP;
+
+/** Single measurement value with capture time (Z140_BLK_VALUE)
+ *
+ *  The caller sets the code to Z140_PERIOD_A/B, Z140_DISTANCE_FWD/BWD or
+ *  Z140_STATUS. The driver reads the value like the getstat of this code
+ *  and returns it together with its capture time, so the timestamp belongs
+ *  to this call even if other threads use the same path. The error code of
+ *  the value (e.g. Z140_ERR_NO_DATA) is returned in the structure, the block
+ *  getstat itself succeeds.
+ */
+typedef struct {
+	u_int32	code;		/**< getstat code of the value (IN) */
+	int32	value;		/**< value as returned by the getstat of code */
+	int32	error;		/**< error code of the getstat of code (0=success) */
+	u_int32	reserved;	/**< reserved */
+	u_int64	tstamp;		/**< capture time [ns] (see Z140_SNAPSHOT.tstamp) */
+	u_int64	age;		/**< age of the period at tstamp [ns] (Z140_AGE_NONE for other codes) */
+} Z140_VALUE;
+
+/** Speed estimate (Z140_BLK_SPEED)
+ *
+ *  The driver blends the speed from the last valid period (1 / period) and
+ *  from the distance counter delta over the estimation interval (pulses /
+ *  interval): the count estimate is weighted with the number of pulses in
+ *  the interval and used alone from 16 pulses on, below the period
+ *  estimate dominates. The interval grows up to 1s until it holds 16
+ *  pulses. The sign is taken from the Z140_ST_DIR_xxx flags.
+ *  The estimate is updated with the acquired records, at most once per
+ *  sample period (SAMPLE_RATE_HZ).
+ */
+typedef struct {
+	int32	pps;		/**< speed [pulses/s] with Z140_SPEED_FRAC fractional bits, negative if backward */
+	u_int32	quality;	/**< Z140_SPD_xxx flags */
+	u_int32	pulses;		/**< distance pulses in the estimation interval */
+	u_int32	interval;	/**< estimation interval [ns] (0=none) */
+	u_int64	tstamp;		/**< time of the estimate [ns] (see Z140_SNAPSHOT.tstamp) */
+} Z140_SPEED_EST;
+
 #ifndef  Z140_VARIANT
   #define Z140_VARIANT    Z140
 #endif
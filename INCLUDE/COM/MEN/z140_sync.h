@@ -0,0 +1,85 @@
+/***********************  I n c l u d e  -  F i l e  ************************/
+/*!
+ *        \file  z140_sync.h
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  Header file for the Z140 synchronized sampling library
+ *
+ *               The library captures a group of Z140 devices (e.g. one
+ *               per axle) within a bounded time window.
+ *               Requires men_typs.h, mdis_err.h and z140_drv.h.
+ *
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _Z140_SYNC_H
+#define _Z140_SYNC_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+#define Z140_SYNC_MAX			16		/**< max. number of devices per group */
+#define Z140_SYNC_ATTEMPTS		8		/**< max. capture attempts per Z140_SYNC_Capture() */
+
+/* error codes (above the driver error codes Z140_ERR_xxx) */
+#define Z140_SYNC_ERR_BASE		(ERR_DEV+0x80)	/**< error code base of the library */
+#define Z140_SYNC_ERR_WINDOW	(Z140_SYNC_ERR_BASE+0x01) /**< capture spread exceeded the window in all attempts */
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/** group handle (opaque) */
+typedef struct Z140_SYNC_HANDLE Z140_SYNC_HANDLE;
+
+/** Record of one device of the group */
+typedef struct {
+	int32			err;		/**< error code of the device (0=success) */
+	int32			offsNs;		/**< capture time relative to Z140_SYNC_INFO.tstamp [ns] */
+	Z140_SNAPSHOT	snap;		/**< measurement snapshot (see Z140_BLK_SNAPSHOT) */
+} Z140_SYNC_REC;
+
+/** Capture information of the group */
+typedef struct {
+	u_int64		tstamp;		/**< shared timestamp (middle of the capture) [ns] */
+	u_int32		spreadNs;	/**< capture spread: start of first to end of last read [ns] */
+	u_int32		attempts;	/**< number of capture attempts */
+} Z140_SYNC_INFO;
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+int32 Z140_SYNC_Open(char **devices, u_int32 num, u_int32 windowNs,
+					 Z140_SYNC_HANDLE **grpP);
+int32 Z140_SYNC_Capture(Z140_SYNC_HANDLE *grp, Z140_SYNC_REC *rec,
+						Z140_SYNC_INFO *info);
+int32 Z140_SYNC_Close(Z140_SYNC_HANDLE **grpP);
+char* Z140_SYNC_Ident(void);
+
+#ifdef __cplusplus
+	}
+#endif
+
+#endif /* _Z140_SYNC_H */
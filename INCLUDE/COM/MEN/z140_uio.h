@@ -0,0 +1,80 @@
+/***********************  I n c l u d e  -  F i l e  ************************/
+/*!
+ *        \file  z140_uio.h
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  Header file for the Z140 direct register access library
+ *
+ *               The library maps the 16Z140 register window read-only
+ *               (e.g. through UIO) and decodes the registers like the
+ *               driver's getstat codes.
+ *               Requires men_typs.h, mdis_err.h and z140_drv.h.
+ *
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _Z140_UIO_H
+#define _Z140_UIO_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+#define Z140_UIO_SIZE		0x2C	/**< size of the register window */
+
+/* Z140_UIO_Open() flags */
+#define Z140_UIO_EXCL		0x01	/**< exclusive use of the period registers:
+										 the driver does not read them (no
+										 IRQ_ENABLE, SAMPLE_RATE_HZ or period
+										 getstats), so they may be read here */
+
+/* error codes (above the driver error codes Z140_ERR_xxx) */
+#define Z140_UIO_ERR_BASE		(ERR_DEV+0x90)	/**< error code base of the library */
+#define Z140_UIO_ERR_NOT_EXCL	(Z140_UIO_ERR_BASE+0x01) /**< period access without Z140_UIO_EXCL */
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/** mapping handle (opaque) */
+typedef struct Z140_UIO_HANDLE Z140_UIO_HANDLE;
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+int32 Z140_UIO_Open(char *file, u_int32 mapIdx, u_int32 offs, u_int32 flags,
+					 Z140_UIO_HANDLE **hdlP);
+int32 Z140_UIO_Close(Z140_UIO_HANDLE **hdlP);
+u_int32 Z140_UIO_ReadReg(Z140_UIO_HANDLE *hdl, u_int32 reg);
+int32 Z140_UIO_Period(Z140_UIO_HANDLE *hdl, u_int32 sig, u_int32 *periodP);
+void Z140_UIO_Distance(Z140_UIO_HANDLE *hdl, u_int32 *fwdP, u_int32 *bwdP);
+u_int32 Z140_UIO_Status(Z140_UIO_HANDLE *hdl);
+void Z140_UIO_Snapshot(Z140_UIO_HANDLE *hdl, Z140_SNAPSHOT *snap);
+char* Z140_UIO_Ident(void);
+
+#ifdef __cplusplus
+	}
+#endif
+
+#endif /* _Z140_UIO_H */
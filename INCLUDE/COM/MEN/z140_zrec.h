@@ -0,0 +1,144 @@
+/***********************  I n c l u d e  -  F i l e  ************************/
+/*!
+ *        \file  z140_zrec.h
+ *
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  Header file for the Z140 compact recording library
+ *
+ *               The library writes and reads series of measurement
+ *               snapshots (Z140_SNAPSHOT) in a compact, streamable file
+ *               format with periodic sync points.
+ *               Requires men_typs.h, mdis_err.h and z140_drv.h.
+ *
+ *               File format (version 1, all values little endian):
+ *
+ *               File header (16 bytes):
+ *               - "Z140ZREC" magic (8 bytes)
+ *               - u_int16 version (Z140_ZREC_VERSION)
+ *               - u_int16 header size (16)
+ *               - u_int32 sync interval [records]
+ *
+ *               followed by records, each starting with a tag byte:
+ *
+ *               Sync record (tag 0xA5, 37 bytes), written for the first
+ *               record and every sync interval records:
+ *               - 0xA5 'Z' 'S' 'Y' marker (4 bytes)
+ *               - u_int32 record index
+ *               - u_int64 timestamp [ns]
+ *               - u_int32 raw period A, raw period B, distance forward,
+ *                 distance backward, status
+ *               - u_int8 checksum: the sum of the 32 bytes after the
+ *                 marker and the checksum is 0 (mod 256)
+ *
+ *               A sync record holds the complete values, so a reader can
+ *               start decoding at any sync point. The previous timestamp
+ *               delta is reset to 0. After Z140_ZREC_ERR_FORMAT from a
+ *               damaged record, Z140_ZREC_Resync() continues at the next
+ *               valid sync record.
+ *
+ *               Delta record (tag 0x00..0x3F), bit n of the tag is set if
+ *               the field is present, fields in this order:
+ *               - always: zigzag varint of the change of the timestamp
+ *                 delta (dt - previous dt)
+ *               - Z140_ZREC_PER_A: zigzag varint of the change of the
+ *                 period A value (Z140_PER_MASK bits)
+ *               - Z140_ZREC_PER_B: same for period B
+ *               - Z140_ZREC_FWD: zigzag varint of the change of the
+ *                 forward distance counter (32-bit wrap)
+ *               - Z140_ZREC_BWD: same for the backward distance counter
+ *               - Z140_ZREC_STATUS: varint of the new status
+ *               - Z140_ZREC_FLAGS: varint of the new period flags, bits 0..2
+ *                 period A, bits 3..5 period B (Z140_PER_VLD/LSTS/NEW
+ *                 shifted down by 29 bits)
+ *               Absent fields are unchanged.
+ *
+ *               Run record (tag 0x80..0x9F): (tag & 0x1F) + 1 records
+ *               equal to the previous record with the same timestamp
+ *               delta (e.g. standstill with a fixed sample period).
+ *
+ *               Varints store 7 bits per byte, least significant group
+ *               first, bit 7 set if more bytes follow. Zigzag maps signed
+ *               to unsigned values: 0,-1,1,-2.. to 0,1,2,3..
+ *
+ *               The period ages (Z140_SNAPSHOT.ageA/B) are not stored,
+ *               the reader returns Z140_AGE_NONE.
+ *
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _Z140_ZREC_H
+#define _Z140_ZREC_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+#define Z140_ZREC_VERSION	1		/**< file format version */
+#define Z140_ZREC_SYNC_DEF	1000	/**< default sync interval [records] */
+
+/* Z140_ZREC_Read() result */
+#define Z140_ZREC_END		1		/**< no more records */
+
+/* error codes (above the Z140_UIO library error codes) */
+#define Z140_ZREC_ERR_BASE		(ERR_DEV+0xA0)	/**< error code base of the library */
+#define Z140_ZREC_ERR_IO		(Z140_ZREC_ERR_BASE+0x01) /**< file access failed (see errno) */
+#define Z140_ZREC_ERR_FORMAT	(Z140_ZREC_ERR_BASE+0x02) /**< no zrec file or damaged record */
+
+/* delta record tag bits */
+#define Z140_ZREC_PER_A		0x01	/**< period A value changed */
+#define Z140_ZREC_PER_B		0x02	/**< period B value changed */
+#define Z140_ZREC_FWD		0x04	/**< forward distance changed */
+#define Z140_ZREC_BWD		0x08	/**< backward distance changed */
+#define Z140_ZREC_STATUS	0x10	/**< status changed */
+#define Z140_ZREC_FLAGS		0x20	/**< period flags changed */
+
+/* other record tags */
+#define Z140_ZREC_RUN		0x80	/**< run of (tag & 0x1F) + 1 equal records */
+#define Z140_ZREC_RUN_MAX	32		/**< max. records per run record */
+#define Z140_ZREC_SYNC		0xA5	/**< sync record */
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/** recording handle (opaque) */
+typedef struct Z140_ZREC_HANDLE Z140_ZREC_HANDLE;
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+int32 Z140_ZREC_Create(char *file, u_int32 syncInterval, Z140_ZREC_HANDLE **hdlP);
+int32 Z140_ZREC_Write(Z140_ZREC_HANDLE *hdl, const Z140_SNAPSHOT *snap);
+int32 Z140_ZREC_Open(char *file, Z140_ZREC_HANDLE **hdlP);
+int32 Z140_ZREC_Read(Z140_ZREC_HANDLE *hdl, Z140_SNAPSHOT *snap);
+int32 Z140_ZREC_Seek(Z140_ZREC_HANDLE *hdl, u_int32 rec);
+int32 Z140_ZREC_Resync(Z140_ZREC_HANDLE *hdl);
+int32 Z140_ZREC_Close(Z140_ZREC_HANDLE **hdlP);
+char* Z140_ZREC_Ident(void);
+
+#ifdef __cplusplus
+	}
+#endif
+
+#endif /* _Z140_ZREC_H */
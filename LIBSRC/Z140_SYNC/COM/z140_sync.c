@@ -0,0 +1,288 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                    Z140_SYNC                       ************
+ ************                                                    ************
+ ****************************************************************************/
+/*!
+ *        \file  z140_sync.c
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  Synchronized sampling of several Z140 devices
+ *
+ *               Several 16Z140 instances (e.g. one per axle) are opened as
+ *               a group. Z140_SYNC_Capture() reads the measurement snapshot
+ *               of all instances back-to-back and repeats the capture if
+ *               the spread between the first and the last read exceeds the
+ *               configured window (e.g. because the task was preempted).
+ *
+ *     Required: libraries: mdis_api, usr_oss
+ *    \switches  LINUX
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*--------------------------------------+
+|  INCLUDES                             |
++--------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#ifdef LINUX
+#include <time.h>
+#endif
+#include <MEN/men_typs.h>
+#include <MEN/mdis_api.h>
+#include <MEN/mdis_err.h>
+#include <MEN/usr_oss.h>
+#include <MEN/z140_drv.h>
+#include <MEN/z140_sync.h>
+
+static const char IdentString[]=MENT_XSTR(MAK_REVISION);
+
+/*--------------------------------------+
+|   TYPEDEFS                            |
++--------------------------------------*/
+/** group handle */
+struct Z140_SYNC_HANDLE {
+	u_int32		num;						/**< number of devices */
+	u_int32		windowNs;					/**< capture window [ns] */
+	MDIS_PATH	path[Z140_SYNC_MAX];		/**< device paths */
+	u_int64		tBefore[Z140_SYNC_MAX];		/**< time before read [ns] */
+	u_int64		tAfter[Z140_SYNC_MAX];		/**< time after read [ns] */
+	Z140_SNAPSHOT	keep[Z140_SYNC_MAX];	/**< snapshot with new periods of an earlier attempt */
+};
+
+/*--------------------------------------+
+|  PROTOTYPES                           |
++--------------------------------------*/
+static u_int64 TimeNs(void);
+static void KeepPeriod(u_int32 *perP, u_int64 *ageP, u_int64 tstamp,
+					   u_int32 keepPer, u_int64 keepAge, u_int64 keepTs);
+
+/***************************** Z140_SYNC_Ident ****************************/
+/** Return ident string
+ *
+ *  \return           pointer to ident string
+ */
+char* Z140_SYNC_Ident(void)
+{
+	return ((char*)IdentString);
+}
+
+/***************************** Z140_SYNC_Open *****************************/
+/** Open a group of Z140 devices
+ *
+ *  \param devices    \IN  device names (e.g. freq_1)
+ *  \param num        \IN  number of devices (1..Z140_SYNC_MAX)
+ *  \param windowNs   \IN  max. capture spread [ns]
+ *  \param grpP       \OUT group handle
+ *
+ *  \return           \c 0 on success or error code
+ */
+int32 Z140_SYNC_Open(
+	char				**devices,
+	u_int32				num,
+	u_int32				windowNs,
+	Z140_SYNC_HANDLE	**grpP
+)
+{
+	Z140_SYNC_HANDLE *grp;
+	u_int32 n;
+	int32 error;
+
+	*grpP = NULL;
+
+	if (!IN_RANGE(num, 1, Z140_SYNC_MAX))
+		return ERR_UOS_ILL_PARAM;
+
+	if ((grp = (Z140_SYNC_HANDLE*)malloc(sizeof(*grp))) == NULL)
+		return ERR_UOS_MEM_ALLOC;
+
+	memset(grp, 0, sizeof(*grp));
+	grp->windowNs = windowNs;
+
+	for (n = 0; n < num; n++) {
+		if ((grp->path[n] = M_open(devices[n])) < 0) {
+			error = UOS_ErrnoGet();
+			Z140_SYNC_Close(&grp);
+			return error;
+		}
+		grp->num++;
+	}
+
+	*grpP = grp;
+	return ERR_SUCCESS;
+}
+
+/***************************** Z140_SYNC_Capture **************************/
+/** Capture the measurement snapshots of all devices of the group
+ *
+ *  The snapshots are read back-to-back. If the spread between the start of
+ *  the first and the end of the last read exceeds the window, the capture
+ *  is repeated up to Z140_SYNC_ATTEMPTS times. The records and the info of
+ *  the last attempt are returned in any case.
+ *
+ *  Each read returns the NEW flag of a period only once (per reader, see
+ *  Z140_BLK_SNAPSHOT). A repeated capture therefore only re-aligns the
+ *  counters and timestamps: If a device returned a new period in an earlier
+ *  attempt but not in the last one, the earlier period is returned (with
+ *  its age adjusted to the timestamp of the last attempt).
+ *
+ *  \param grp        \IN  group handle
+ *  \param rec        \OUT array of records (one per device, in open order)
+ *  \param info       \OUT capture information
+ *
+ *  \return           \c 0 on success, Z140_SYNC_ERR_WINDOW if the window
+ *                    was exceeded in all attempts or error code of the
+ *                    first failed device
+ */
+int32 Z140_SYNC_Capture(
+	Z140_SYNC_HANDLE	*grp,
+	Z140_SYNC_REC		*rec,
+	Z140_SYNC_INFO		*info
+)
+{
+	M_SG_BLOCK blk;
+	u_int64 spread;
+	u_int32 n, last = grp->num - 1;
+	int32 error;
+
+	for (info->attempts = 1; ; info->attempts++) {
+
+		/* read all devices back-to-back */
+		for (n = 0; n < grp->num; n++) {
+			blk.size = sizeof(Z140_SNAPSHOT);
+			blk.data = (void*)&rec[n].snap;
+
+			grp->tBefore[n] = TimeNs();
+			rec[n].err = M_getstat(grp->path[n], Z140_BLK_SNAPSHOT,
+								   (int32*)&blk) < 0 ? UOS_ErrnoGet() : 0;
+			grp->tAfter[n] = TimeNs();
+		}
+
+		/* don't lose new periods of the previous attempts */
+		for (n = 0; n < grp->num; n++) {
+			if (rec[n].err) {
+				grp->keep[n].periodA = grp->keep[n].periodB = 0;
+				continue;
+			}
+			if (info->attempts > 1) {
+				KeepPeriod(&rec[n].snap.periodA, &rec[n].snap.ageA,
+						   rec[n].snap.tstamp, grp->keep[n].periodA,
+						   grp->keep[n].ageA, grp->keep[n].tstamp);
+				KeepPeriod(&rec[n].snap.periodB, &rec[n].snap.ageB,
+						   rec[n].snap.tstamp, grp->keep[n].periodB,
+						   grp->keep[n].ageB, grp->keep[n].tstamp);
+			}
+			grp->keep[n] = rec[n].snap;
+		}
+
+		spread = grp->tAfter[last] - grp->tBefore[0];
+		if (spread <= grp->windowNs || info->attempts == Z140_SYNC_ATTEMPTS)
+			break;
+	}
+
+	/* shared timestamp in the middle of the capture */
+	info->tstamp = grp->tBefore[0] + spread / 2;
+	info->spreadNs = spread > 0xffffffff ? 0xffffffff : (u_int32)spread;
+
+	for (error = ERR_SUCCESS, n = 0; n < grp->num; n++) {
+		rec[n].offsNs = (int32)((int64)(grp->tBefore[n] +
+			(grp->tAfter[n] - grp->tBefore[n]) / 2 - info->tstamp));
+		if (rec[n].err && !error)
+			error = rec[n].err;
+	}
+
+	if (!error && spread > grp->windowNs)
+		error = Z140_SYNC_ERR_WINDOW;
+
+	return error;
+}
+
+/***************************** Z140_SYNC_Close ****************************/
+/** Close a group of Z140 devices
+ *
+ *  \param grpP       \IN  group handle
+ *                    \OUT NULL
+ *
+ *  \return           \c 0 on success or error code of the first failed close
+ */
+int32 Z140_SYNC_Close(
+	Z140_SYNC_HANDLE	**grpP
+)
+{
+	Z140_SYNC_HANDLE *grp = *grpP;
+	u_int32 n;
+	int32 error = ERR_SUCCESS;
+
+	if (!grp)
+		return ERR_SUCCESS;
+
+	for (n = 0; n < grp->num; n++) {
+		if (M_close(grp->path[n]) < 0 && !error)
+			error = UOS_ErrnoGet();
+	}
+
+	free(grp);
+	*grpP = NULL;
+
+	return error;
+}
+
+/******************************** KeepPeriod ******************************/
+/** Keep the new period of an earlier capture attempt
+ *
+ *  \param perP       \INOUT raw period of the current attempt
+ *  \param ageP       \INOUT age of the period at tstamp [ns]
+ *  \param tstamp     \IN    driver timestamp of the current attempt [ns]
+ *  \param keepPer    \IN    raw period of the earlier attempt
+ *  \param keepAge    \IN    age of the earlier period [ns]
+ *  \param keepTs     \IN    driver timestamp of the earlier attempt [ns]
+ */
+static void KeepPeriod(
+	u_int32	*perP,
+	u_int64	*ageP,
+	u_int64	tstamp,
+	u_int32	keepPer,
+	u_int64	keepAge,
+	u_int64	keepTs)
+{
+	if ((*perP & Z140_PER_NEW) || !(keepPer & Z140_PER_NEW))
+		return;
+
+	*perP = keepPer;
+	*ageP = (keepAge == Z140_AGE_NONE) ? Z140_AGE_NONE :
+			keepAge + (tstamp - keepTs);
+}
+
+/********************************** TimeNs ********************************/
+/** Get monotonic time
+ *
+ *  \return           time [ns] (ms resolution without LINUX)
+ */
+static u_int64 TimeNs(void)
+{
+#ifdef LINUX
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((u_int64)ts.tv_sec * 1000000000 + ts.tv_nsec);
+#else
+	return ((u_int64)UOS_MsecTimerGet() * 1000000);
+#endif
+}
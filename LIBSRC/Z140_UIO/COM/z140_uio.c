@@ -0,0 +1,344 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                     Z140_UIO                       ************
+ ************                                                    ************
+ ****************************************************************************/
+/*!
+ *        \file  z140_uio.c
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  Direct read-only register access to the 16Z140 IP core
+ *
+ *               The register window is mapped into user space, e.g. from
+ *               the UIO device of the FPGA (/dev/uioN), so the registers
+ *               are read without an MDIS call. The mapping is read-only,
+ *               the configuration remains with the driver.
+ *
+ *               Reading a period register clears its NEW flag. Therefore
+ *               the period registers are only read if the mapping was
+ *               opened with Z140_UIO_EXCL, i.e. if the application
+ *               guarantees that the driver does not read them.
+ *
+ *               For tests without hardware, any regular file containing
+ *               the register values (32-bit little endian, see z140_reg.h)
+ *               can be mapped instead of the UIO device. The file is
+ *               organized like the UIO device: map N starts at offset
+ *               N * page size.
+ *
+ *               \warning Reading a period register clears its NEW flag
+ *               in the IP core. Do not use Z140_UIO_Period() or
+ *               Z140_UIO_Snapshot() while periods are also read through
+ *               the driver (period getstats, sampler or interrupt),
+ *               otherwise both sides miss new period values.
+ *
+ *     Required: -
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*--------------------------------------+
+|  INCLUDES                             |
++--------------------------------------*/
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <endian.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_api.h>
+#include <MEN/mdis_err.h>
+#include <MEN/z140_reg.h>
+#include <MEN/z140_drv.h>
+#include <MEN/z140_uio.h>
+
+static const char IdentString[]=MENT_XSTR(MAK_REVISION);
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define SNAP_RETRY_MAX	3	/**< max. retries for consistent counters */
+
+/** read register */
+#define REG_RD(hdl, reg) \
+	le32toh(*(volatile u_int32*)((hdl)->regs + (reg)))
+
+/*--------------------------------------+
+|   TYPEDEFS                            |
++--------------------------------------*/
+/** mapping handle */
+struct Z140_UIO_HANDLE {
+	int			fd;			/**< file descriptor */
+	void		*map;		/**< mapping (page aligned) */
+	size_t		mapSize;	/**< size of the mapping */
+	u_int8		*regs;		/**< register window */
+	u_int32		flags;		/**< Z140_UIO_xxx open flags */
+};
+
+/***************************** Z140_UIO_Ident *****************************/
+/** Return ident string
+ *
+ *  \return           pointer to ident string
+ */
+char* Z140_UIO_Ident(void)
+{
+	return ((char*)IdentString);
+}
+
+/***************************** Z140_UIO_Open ******************************/
+/** Map the register window read-only
+ *
+ *  A UIO device selects its memory map N with the mmap offset N * page
+ *  size. The map starts at the page aligned address of the region (see
+ *  /sys/class/uio/uioX/maps/mapN), so the register window is at offs
+ *  within the mapping.
+ *
+ *  \param file       \IN  UIO device (e.g. /dev/uio0) or mock file
+ *  \param mapIdx     \IN  UIO map index (e.g. map of the FPGA BAR)
+ *  \param offs       \IN  offset of the register window within the map
+ *                         (e.g. offset of the 16Z140 in the FPGA BAR)
+ *  \param flags      \IN  Z140_UIO_EXCL or 0
+ *  \param hdlP       \OUT mapping handle
+ *
+ *  \return           \c 0 on success or error code
+ */
+int32 Z140_UIO_Open(
+	char				*file,
+	u_int32				mapIdx,
+	u_int32				offs,
+	u_int32				flags,
+	Z140_UIO_HANDLE		**hdlP
+)
+{
+	Z140_UIO_HANDLE *hdl;
+	struct stat st;
+	long pageSize = sysconf(_SC_PAGESIZE);
+	off_t mapOffs = (off_t)mapIdx * pageSize;
+	int32 error;
+
+	*hdlP = NULL;
+
+	if ((hdl = (Z140_UIO_HANDLE*)malloc(sizeof(*hdl))) == NULL)
+		return ERR_UOS_MEM_ALLOC;
+
+	hdl->map = MAP_FAILED;
+	hdl->mapSize = (offs + Z140_UIO_SIZE + pageSize - 1) & ~(pageSize - 1);
+	hdl->flags = flags;
+
+	if ((hdl->fd = open(file, O_RDONLY)) < 0)
+		goto ERR_EXIT;
+
+	/* mock file must contain the whole register window */
+	if (fstat(hdl->fd, &st) < 0)
+		goto ERR_EXIT;
+	if (S_ISREG(st.st_mode) &&
+		st.st_size < mapOffs + (off_t)offs + Z140_UIO_SIZE) {
+		Z140_UIO_Close(&hdl);
+		return ERR_UOS_ILL_PARAM;
+	}
+
+	if ((hdl->map = mmap(NULL, hdl->mapSize, PROT_READ, MAP_SHARED,
+						 hdl->fd, mapOffs)) == MAP_FAILED)
+		goto ERR_EXIT;
+
+	hdl->regs = (u_int8*)hdl->map + offs;
+	*hdlP = hdl;
+	return ERR_SUCCESS;
+
+ERR_EXIT:
+	error = errno;
+	Z140_UIO_Close(&hdl);
+	return error;
+}
+
+/***************************** Z140_UIO_Close *****************************/
+/** Unmap the register window
+ *
+ *  \param hdlP       \IN  mapping handle
+ *                    \OUT NULL
+ *
+ *  \return           \c 0 on success or error code
+ */
+int32 Z140_UIO_Close(
+	Z140_UIO_HANDLE		**hdlP
+)
+{
+	Z140_UIO_HANDLE *hdl = *hdlP;
+	int32 error = ERR_SUCCESS;
+
+	if (!hdl)
+		return ERR_SUCCESS;
+
+	if (hdl->map != MAP_FAILED && munmap(hdl->map, hdl->mapSize) < 0)
+		error = errno;
+	if (hdl->fd >= 0 && close(hdl->fd) < 0 && !error)
+		error = errno;
+
+	free(hdl);
+	*hdlP = NULL;
+
+	return error;
+}
+
+/***************************** Z140_UIO_ReadReg ***************************/
+/** Read a register
+ *
+ *  The period registers read as 0 (no NEW flag) without Z140_UIO_EXCL.
+ *
+ *  \param hdl        \IN  mapping handle
+ *  \param reg        \IN  register offset (Z140R_xxx)
+ *
+ *  \return           register value
+ */
+u_int32 Z140_UIO_ReadReg(
+	Z140_UIO_HANDLE		*hdl,
+	u_int32				reg
+)
+{
+	if ((reg == Z140R_PERIOD_A || reg == Z140R_PERIOD_B) &&
+		!(hdl->flags & Z140_UIO_EXCL))
+		return 0;
+
+	return REG_RD(hdl, reg);
+}
+
+/***************************** Z140_UIO_Period ****************************/
+/** Read the period of signal A or B
+ *
+ *  Same as the Z140_PERIOD_A/B getstat: The period value is returned
+ *  always, the return value reports its state.
+ *
+ *  \param hdl        \IN  mapping handle
+ *  \param sig        \IN  0=signal A, 1=signal B
+ *  \param periodP    \OUT period [1/32us]
+ *
+ *  \return           \c 0 on success, Z140_UIO_ERR_NOT_EXCL if the mapping
+ *                    was opened without Z140_UIO_EXCL or Z140_ERR_xxx code
+ */
+int32 Z140_UIO_Period(
+	Z140_UIO_HANDLE		*hdl,
+	u_int32				sig,
+	u_int32				*periodP
+)
+{
+	u_int32 read;
+
+	*periodP = 0;
+
+	/* reading the register would clear NEW for the driver */
+	if (!(hdl->flags & Z140_UIO_EXCL))
+		return Z140_UIO_ERR_NOT_EXCL;
+
+	read = REG_RD(hdl, sig ? Z140R_PERIOD_B : Z140R_PERIOD_A);
+
+	*periodP = read & Z140R_PERIOD_MASK;
+
+	return Z140_PER_ERR(read);
+}
+
+/***************************** Z140_UIO_Distance **************************/
+/** Read the distance counters
+ *
+ *  The counters are re-read if one changed in between, so both belong
+ *  to the same instant.
+ *
+ *  \param hdl        \IN  mapping handle
+ *  \param fwdP       \OUT number of "sensor pulses" in forward direction
+ *  \param bwdP       \OUT number of "sensor pulses" in backward direction
+ */
+void Z140_UIO_Distance(
+	Z140_UIO_HANDLE		*hdl,
+	u_int32				*fwdP,
+	u_int32				*bwdP
+)
+{
+	u_int32 retry;
+
+	for (retry = 0; retry < SNAP_RETRY_MAX; retry++) {
+		*fwdP = REG_RD(hdl, Z140R_DISTANCE_FWD);
+		*bwdP = REG_RD(hdl, Z140R_DISTANCE_BWD);
+
+		if ((REG_RD(hdl, Z140R_DISTANCE_FWD) == *fwdP) &&
+			(REG_RD(hdl, Z140R_DISTANCE_BWD) == *bwdP))
+			break;
+	}
+}
+
+/***************************** Z140_UIO_Status ****************************/
+/** Read the status
+ *
+ *  \param hdl        \IN  mapping handle
+ *
+ *  \return           Z140_ST_xxx flags
+ */
+u_int32 Z140_UIO_Status(
+	Z140_UIO_HANDLE		*hdl
+)
+{
+	return REG_RD(hdl, Z140R_STATUS);
+}
+
+/***************************** Z140_UIO_Snapshot **************************/
+/** Read all measurement registers
+ *
+ *  Same as the Z140_BLK_SNAPSHOT getstat without the driver's latching of
+ *  the period values, including Z140_ST_TORN if the distance counters
+ *  still changed after SNAP_RETRY_MAX reads. The capture time is taken
+ *  from CLOCK_MONOTONIC like in the driver, the period ages are unknown
+ *  (Z140_AGE_NONE). Without Z140_UIO_EXCL, the period registers are not
+ *  read and the periods are returned as 0 (no NEW flag).
+ *
+ *  \param hdl        \IN  mapping handle
+ *  \param snap       \OUT measurement snapshot
+ */
+void Z140_UIO_Snapshot(
+	Z140_UIO_HANDLE		*hdl,
+	Z140_SNAPSHOT		*snap
+)
+{
+	struct timespec ts;
+	u_int32 retry;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	snap->version = Z140_SNAPSHOT_VER;
+	snap->tstamp  = (u_int64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+	snap->ageA    = Z140_AGE_NONE;
+	snap->ageB    = Z140_AGE_NONE;
+	snap->periodA = Z140_UIO_ReadReg(hdl, Z140R_PERIOD_A);
+	snap->periodB = Z140_UIO_ReadReg(hdl, Z140R_PERIOD_B);
+
+	for (retry = 0; retry < SNAP_RETRY_MAX; retry++) {
+		snap->distFwd = REG_RD(hdl, Z140R_DISTANCE_FWD);
+		snap->distBwd = REG_RD(hdl, Z140R_DISTANCE_BWD);
+		snap->status  = REG_RD(hdl, Z140R_STATUS);
+
+		/* counters unchanged while status was read? */
+		if ((REG_RD(hdl, Z140R_DISTANCE_FWD) == snap->distFwd) &&
+			(REG_RD(hdl, Z140R_DISTANCE_BWD) == snap->distBwd))
+			break;
+	}
+
+	/* counters still moving: signal torn snapshot */
+	if (retry == SNAP_RETRY_MAX)
+		snap->status |= Z140_ST_TORN;
+}
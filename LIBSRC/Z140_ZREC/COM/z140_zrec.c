@@ -0,0 +1,775 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                    Z140_ZREC                       ************
+ ************                                                    ************
+ ****************************************************************************/
+/*!
+ *        \file  z140_zrec.c
+ *      \author  dieter.pfeuffer@men.de
+ *
+ *       \brief  Compact recording format for Z140 measurement snapshots
+ *
+ *               Writes and reads series of Z140_SNAPSHOT records in the
+ *               delta/varint format described in z140_zrec.h. Consecutive
+ *               snapshots mostly differ in a few counts only, so a record
+ *               typically needs 2..8 bytes instead of 48, and unchanged
+ *               records at a fixed sample period are run-length encoded.
+ *
+ *               The writer only appends, so the output can be a pipe.
+ *               Z140_ZREC_Seek() and Z140_ZREC_Resync() require a regular
+ *               file, Z140_ZREC_Seek() locates the sync points by binary
+ *               search over the file offset.
+ *
+ *               Errors are returned as ERR_UOS_MEM_ALLOC, ERR_UOS_ILL_PARAM
+ *               (handle opened in the other direction) or the library
+ *               error codes Z140_ZREC_ERR_xxx.
+ *
+ *     Required: -
+ *    \switches  (none)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2016-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*--------------------------------------+
+|  INCLUDES                             |
++--------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_err.h>
+#include <MEN/z140_drv.h>
+#include <MEN/z140_zrec.h>
+
+static const char IdentString[]=MENT_XSTR(MAK_REVISION);
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define HDR_SIZE		16			/**< file header size */
+#define SYNC_MARKER		0xA55A5359	/**< 0xA5 'Z' 'S' 'Y' in read order */
+#define SYNC_PAYLOAD	32			/**< sync bytes after marker without checksum */
+#define FLAGS_SHIFT		29			/**< Z140_PER_VLD/LSTS/NEW to bit 0..2 */
+#define SEEK_LINEAR		8192		/**< linear sync search below [bytes] */
+#define WR_BUF_SIZE		65536		/**< stdio buffer of the writer */
+
+/*--------------------------------------+
+|   TYPEDEFS                            |
++--------------------------------------*/
+/** recording handle */
+struct Z140_ZREC_HANDLE {
+	FILE			*fp;		/**< file */
+	int				write;		/**< opened for writing */
+	u_int32			syncInt;	/**< sync interval [records] */
+	u_int32			rec;		/**< index of the next record */
+	u_int32			run;		/**< writer: pending run, reader: remaining run */
+	int64			prevDt;		/**< previous timestamp delta [ns] */
+	Z140_SNAPSHOT	prev;		/**< previous record */
+	char			*buf;		/**< stdio buffer of the writer */
+};
+
+/*--------------------------------------+
+|  PROTOTYPES                           |
++--------------------------------------*/
+static void PutVarint(FILE *fp, u_int64 v);
+static int GetVarint(FILE *fp, u_int64 *vP);
+static void PutLe(FILE *fp, u_int64 v, int bytes);
+static u_int64 GetLe(u_int8 *p, int bytes);
+static int32 ReadFail(Z140_ZREC_HANDLE *hdl);
+static void FlushRun(Z140_ZREC_HANDLE *hdl);
+static void WriteSync(Z140_ZREC_HANDLE *hdl, const Z140_SNAPSHOT *snap);
+static int ParseSync(u_int8 *p, u_int32 *idxP, Z140_SNAPSHOT *snap);
+static int FindSync(Z140_ZREC_HANDLE *hdl, off_t from, off_t *offP, u_int32 *idxP);
+
+/** zigzag encoding of signed values */
+#define ZIGZAG(v)		(((u_int64)(v) << 1) ^ (u_int64)((int64)(v) >> 63))
+#define UNZIGZAG(u)		((int64)((u) >> 1) ^ -(int64)((u) & 1))
+
+/***************************** Z140_ZREC_Ident ****************************/
+/** Return ident string
+ *
+ *  \return           pointer to ident string
+ */
+char* Z140_ZREC_Ident(void)
+{
+	return ((char*)IdentString);
+}
+
+/***************************** Z140_ZREC_Create ***************************/
+/** Create a recording file
+ *
+ *  \param file         \IN  file name ("-" for stdout)
+ *  \param syncInterval \IN  records between sync points
+ *                           (0: Z140_ZREC_SYNC_DEF)
+ *  \param hdlP         \OUT recording handle
+ *
+ *  \return             \c 0 on success, Z140_ZREC_ERR_IO if the file
+ *                      can't be created or error code
+ */
+int32 Z140_ZREC_Create(
+	char				*file,
+	u_int32				syncInterval,
+	Z140_ZREC_HANDLE	**hdlP
+)
+{
+	Z140_ZREC_HANDLE *hdl;
+
+	*hdlP = NULL;
+
+	if ((hdl = (Z140_ZREC_HANDLE*)calloc(1, sizeof(*hdl))) == NULL)
+		return ERR_UOS_MEM_ALLOC;
+
+	hdl->write = 1;
+	hdl->syncInt = syncInterval ? syncInterval : Z140_ZREC_SYNC_DEF;
+
+	if (!strcmp(file, "-"))
+		hdl->fp = stdout;
+	else if ((hdl->fp = fopen(file, "wb")) == NULL) {
+		free(hdl);
+		return Z140_ZREC_ERR_IO;
+	}
+	else if ((hdl->buf = (char*)malloc(WR_BUF_SIZE)) != NULL)
+		setvbuf(hdl->fp, hdl->buf, _IOFBF, WR_BUF_SIZE);
+
+	/* file header */
+	fwrite("Z140ZREC", 1, 8, hdl->fp);
+	PutLe(hdl->fp, Z140_ZREC_VERSION, 2);
+	PutLe(hdl->fp, HDR_SIZE, 2);
+	PutLe(hdl->fp, hdl->syncInt, 4);
+
+	*hdlP = hdl;
+	return ERR_SUCCESS;
+}
+
+/***************************** Z140_ZREC_Write ****************************/
+/** Append a snapshot to the recording
+ *
+ *  \param hdl        \IN  recording handle (Z140_ZREC_Create)
+ *  \param snap       \IN  snapshot
+ *
+ *  \return           \c 0 on success, Z140_ZREC_ERR_IO on a write error
+ *                    or error code
+ */
+int32 Z140_ZREC_Write(
+	Z140_ZREC_HANDLE	*hdl,
+	const Z140_SNAPSHOT	*snap
+)
+{
+	const Z140_SNAPSHOT *prev = &hdl->prev;
+	int64 dt, dPerA, dPerB;
+	int32 dFwd, dBwd;
+	u_int32 flags, prevFlags;
+	u_int8 tag = 0;
+
+	if (!hdl->write)
+		return ERR_UOS_ILL_PARAM;
+
+	/* sync point */
+	if (hdl->rec % hdl->syncInt == 0) {
+		FlushRun(hdl);
+		WriteSync(hdl, snap);
+		goto DONE;
+	}
+
+	dt    = (int64)(snap->tstamp - prev->tstamp);
+	dPerA = (int64)(snap->periodA & Z140_PER_MASK) - (prev->periodA & Z140_PER_MASK);
+	dPerB = (int64)(snap->periodB & Z140_PER_MASK) - (prev->periodB & Z140_PER_MASK);
+	dFwd  = (int32)(snap->distFwd - prev->distFwd);
+	dBwd  = (int32)(snap->distBwd - prev->distBwd);
+	flags = (snap->periodA >> FLAGS_SHIFT) | ((snap->periodB >> FLAGS_SHIFT) << 3);
+	prevFlags = (prev->periodA >> FLAGS_SHIFT) | ((prev->periodB >> FLAGS_SHIFT) << 3);
+
+	if (dPerA)
+		tag |= Z140_ZREC_PER_A;
+	if (dPerB)
+		tag |= Z140_ZREC_PER_B;
+	if (dFwd)
+		tag |= Z140_ZREC_FWD;
+	if (dBwd)
+		tag |= Z140_ZREC_BWD;
+	if (snap->status != prev->status)
+		tag |= Z140_ZREC_STATUS;
+	if (flags != prevFlags)
+		tag |= Z140_ZREC_FLAGS;
+
+	/* equal record with equal timestamp delta: extend run */
+	if (!tag && dt == hdl->prevDt) {
+		if (++hdl->run == Z140_ZREC_RUN_MAX)
+			FlushRun(hdl);
+		goto DONE;
+	}
+
+	FlushRun(hdl);
+
+	putc(tag, hdl->fp);
+	PutVarint(hdl->fp, ZIGZAG(dt - hdl->prevDt));
+	if (tag & Z140_ZREC_PER_A)
+		PutVarint(hdl->fp, ZIGZAG(dPerA));
+	if (tag & Z140_ZREC_PER_B)
+		PutVarint(hdl->fp, ZIGZAG(dPerB));
+	if (tag & Z140_ZREC_FWD)
+		PutVarint(hdl->fp, ZIGZAG(dFwd));
+	if (tag & Z140_ZREC_BWD)
+		PutVarint(hdl->fp, ZIGZAG(dBwd));
+	if (tag & Z140_ZREC_STATUS)
+		PutVarint(hdl->fp, snap->status);
+	if (tag & Z140_ZREC_FLAGS)
+		PutVarint(hdl->fp, flags);
+
+	hdl->prevDt = dt;
+
+DONE:
+	hdl->prev = *snap;
+	hdl->rec++;
+
+	return ferror(hdl->fp) ? Z140_ZREC_ERR_IO : ERR_SUCCESS;
+}
+
+/***************************** Z140_ZREC_Open *****************************/
+/** Open a recording file for reading
+ *
+ *  \param file       \IN  file name ("-" for stdin, no Z140_ZREC_Seek()
+ *                         and Z140_ZREC_Resync())
+ *  \param hdlP       \OUT recording handle
+ *
+ *  \return           \c 0 on success, Z140_ZREC_ERR_IO if the file
+ *                    can't be opened, Z140_ZREC_ERR_FORMAT if it is no
+ *                    zrec file or error code
+ */
+int32 Z140_ZREC_Open(
+	char				*file,
+	Z140_ZREC_HANDLE	**hdlP
+)
+{
+	Z140_ZREC_HANDLE *hdl;
+	u_int8 hdr[HDR_SIZE];
+
+	*hdlP = NULL;
+
+	if ((hdl = (Z140_ZREC_HANDLE*)calloc(1, sizeof(*hdl))) == NULL)
+		return ERR_UOS_MEM_ALLOC;
+
+	if (!strcmp(file, "-"))
+		hdl->fp = stdin;
+	else if ((hdl->fp = fopen(file, "rb")) == NULL) {
+		free(hdl);
+		return Z140_ZREC_ERR_IO;
+	}
+
+	/* check file header */
+	if (fread(hdr, 1, HDR_SIZE, hdl->fp) != HDR_SIZE ||
+		memcmp(hdr, "Z140ZREC", 8) ||
+		GetLe(&hdr[8], 2) != Z140_ZREC_VERSION ||
+		GetLe(&hdr[10], 2) < HDR_SIZE) {
+		Z140_ZREC_Close(&hdl);
+		return Z140_ZREC_ERR_FORMAT;
+	}
+	hdl->syncInt = (u_int32)GetLe(&hdr[12], 4);
+
+	/* skip header extension of later versions */
+	if (GetLe(&hdr[10], 2) > HDR_SIZE)
+		fseeko(hdl->fp, (off_t)GetLe(&hdr[10], 2), SEEK_SET);
+
+	*hdlP = hdl;
+	return ERR_SUCCESS;
+}
+
+/***************************** Z140_ZREC_Read *****************************/
+/** Read the next snapshot from the recording
+ *
+ *  The period ages are returned as Z140_AGE_NONE.
+ *
+ *  \param hdl        \IN  recording handle (Z140_ZREC_Open)
+ *  \param snap       \OUT snapshot
+ *
+ *  \return           \c 0 on success, Z140_ZREC_END at the end of the
+ *                    recording (also for a truncated last record),
+ *                    Z140_ZREC_ERR_FORMAT for a damaged record (see
+ *                    Z140_ZREC_Resync()), Z140_ZREC_ERR_IO on a read error
+ *                    or error code
+ */
+int32 Z140_ZREC_Read(
+	Z140_ZREC_HANDLE	*hdl,
+	Z140_SNAPSHOT		*snap
+)
+{
+	Z140_SNAPSHOT *prev = &hdl->prev;
+	u_int8 sync[4 + SYNC_PAYLOAD + 1];
+	u_int64 v;
+	u_int32 idx, flags;
+	int c;
+
+	if (hdl->write)
+		return ERR_UOS_ILL_PARAM;
+
+	/* continue run */
+	if (hdl->run) {
+		hdl->run--;
+		prev->tstamp += hdl->prevDt;
+		goto DONE;
+	}
+
+	if ((c = getc(hdl->fp)) == EOF)
+		return ReadFail(hdl);
+
+	/* sync record */
+	if (c == Z140_ZREC_SYNC) {
+		sync[0] = (u_int8)c;
+		if (fread(&sync[1], 1, sizeof(sync) - 1, hdl->fp) != sizeof(sync) - 1)
+			return ReadFail(hdl);
+		if (ParseSync(sync, &idx, prev))
+			return Z140_ZREC_ERR_FORMAT;
+		hdl->rec = idx;
+		hdl->prevDt = 0;
+		goto DONE;
+	}
+
+	/* run record */
+	if ((c & 0xE0) == Z140_ZREC_RUN) {
+		hdl->run = c & 0x1F;
+		prev->tstamp += hdl->prevDt;
+		goto DONE;
+	}
+
+	/* delta record */
+	if (c & ~0x3F)
+		return Z140_ZREC_ERR_FORMAT;
+
+	if (GetVarint(hdl->fp, &v))
+		return ReadFail(hdl);
+	hdl->prevDt += UNZIGZAG(v);
+	prev->tstamp += hdl->prevDt;
+
+	if (c & Z140_ZREC_PER_A) {
+		if (GetVarint(hdl->fp, &v))
+			return ReadFail(hdl);
+		prev->periodA += (u_int32)UNZIGZAG(v);
+	}
+	if (c & Z140_ZREC_PER_B) {
+		if (GetVarint(hdl->fp, &v))
+			return ReadFail(hdl);
+		prev->periodB += (u_int32)UNZIGZAG(v);
+	}
+	if (c & Z140_ZREC_FWD) {
+		if (GetVarint(hdl->fp, &v))
+			return ReadFail(hdl);
+		prev->distFwd += (u_int32)UNZIGZAG(v);
+	}
+	if (c & Z140_ZREC_BWD) {
+		if (GetVarint(hdl->fp, &v))
+			return ReadFail(hdl);
+		prev->distBwd += (u_int32)UNZIGZAG(v);
+	}
+	if (c & Z140_ZREC_STATUS) {
+		if (GetVarint(hdl->fp, &v))
+			return ReadFail(hdl);
+		prev->status = (u_int32)v;
+	}
+	if (c & Z140_ZREC_FLAGS) {
+		if (GetVarint(hdl->fp, &v))
+			return ReadFail(hdl);
+		flags = (u_int32)v;
+		prev->periodA = (prev->periodA & Z140_PER_MASK) | ((flags & 7) << FLAGS_SHIFT);
+		prev->periodB = (prev->periodB & Z140_PER_MASK) | (((flags >> 3) & 7) << FLAGS_SHIFT);
+	}
+
+DONE:
+	*snap = *prev;
+	snap->version = Z140_SNAPSHOT_VER;
+	snap->ageA = Z140_AGE_NONE;
+	snap->ageB = Z140_AGE_NONE;
+	hdl->rec++;
+
+	return ERR_SUCCESS;
+}
+
+/***************************** Z140_ZREC_Seek *****************************/
+/** Position the reader at a record
+ *
+ *  Locates the last sync point before the record by binary search over
+ *  the file offset and decodes the records from there.
+ *
+ *  \param hdl        \IN  recording handle (Z140_ZREC_Open, regular file)
+ *  \param rec        \IN  index of the record returned by the next
+ *                         Z140_ZREC_Read()
+ *
+ *  \return           \c 0 on success, Z140_ZREC_END if the recording
+ *                    has less records, Z140_ZREC_ERR_IO if the file is
+ *                    not seekable or error code
+ */
+int32 Z140_ZREC_Seek(
+	Z140_ZREC_HANDLE	*hdl,
+	u_int32				rec
+)
+{
+	Z140_SNAPSHOT snap;
+	off_t lo, hi, mid, off, best;
+	u_int32 idx;
+	int32 error;
+
+	if (hdl->write)
+		return ERR_UOS_ILL_PARAM;
+
+	if (fseeko(hdl->fp, 0, SEEK_END) || (hi = ftello(hdl->fp)) < 0)
+		return Z140_ZREC_ERR_IO;
+
+	/* the first record is a sync point */
+	lo = best = HDR_SIZE;
+
+	/* binary search down to a small range */
+	while (hi - lo > SEEK_LINEAR) {
+		mid = lo + (hi - lo) / 2;
+		if (!FindSync(hdl, mid, &off, &idx) && off < hi && idx <= rec)
+			lo = best = off;
+		else
+			hi = mid;
+	}
+
+	/* last sync point before the record in the range */
+	off = best;
+	while (!FindSync(hdl, off + 1, &off, &idx) && idx <= rec)
+		best = off;
+
+	/* decode up to the record */
+	if (fseeko(hdl->fp, best, SEEK_SET))
+		return Z140_ZREC_ERR_IO;
+	hdl->run = 0;
+	hdl->rec = 0;
+
+	do {
+		if ((error = Z140_ZREC_Read(hdl, &snap)))
+			return error;
+	} while (hdl->rec <= rec);
+
+	/* return the record again with the next read */
+	hdl->rec--;
+	hdl->run++;
+	hdl->prev.tstamp -= hdl->prevDt;
+
+	return ERR_SUCCESS;
+}
+
+/***************************** Z140_ZREC_Resync ***************************/
+/** Continue reading at the next sync point
+ *
+ *  Skips to the next valid sync record that was not read yet, e.g. after
+ *  Z140_ZREC_Read() returned Z140_ZREC_ERR_FORMAT. The search starts one
+ *  sync record before the read position, so a sync record is also found
+ *  if the damaged record ran into it. The next Z140_ZREC_Read() returns
+ *  the record of the sync point, the records before are lost.
+ *
+ *  \param hdl        \IN  recording handle (Z140_ZREC_Open, regular file)
+ *
+ *  \return           \c 0 on success, Z140_ZREC_END if there is no
+ *                    further sync point, Z140_ZREC_ERR_IO if the file is
+ *                    not seekable or error code
+ */
+int32 Z140_ZREC_Resync(
+	Z140_ZREC_HANDLE	*hdl
+)
+{
+	off_t off;
+	u_int32 idx;
+
+	if (hdl->write)
+		return ERR_UOS_ILL_PARAM;
+
+	if ((off = ftello(hdl->fp)) < 0)
+		return Z140_ZREC_ERR_IO;
+
+	/* skips the sync record read last, finds one the damage ran into */
+	off -= 4 + SYNC_PAYLOAD;
+	if (off < HDR_SIZE)
+		off = HDR_SIZE;
+
+	if (FindSync(hdl, off, &off, &idx))
+		return Z140_ZREC_END;
+	if (fseeko(hdl->fp, off, SEEK_SET))
+		return Z140_ZREC_ERR_IO;
+
+	hdl->run = 0;
+	return ERR_SUCCESS;
+}
+
+/***************************** Z140_ZREC_Close ****************************/
+/** Close the recording
+ *
+ *  \param hdlP       \IN  recording handle
+ *                    \OUT NULL
+ *
+ *  \return           \c 0 on success or Z140_ZREC_ERR_IO (e.g. write
+ *                    error)
+ */
+int32 Z140_ZREC_Close(
+	Z140_ZREC_HANDLE	**hdlP
+)
+{
+	Z140_ZREC_HANDLE *hdl = *hdlP;
+	int32 error = ERR_SUCCESS;
+
+	if (!hdl)
+		return ERR_SUCCESS;
+
+	if (hdl->write) {
+		FlushRun(hdl);
+		if (fflush(hdl->fp) || ferror(hdl->fp))
+			error = Z140_ZREC_ERR_IO;
+	}
+
+	if (hdl->fp != stdout && hdl->fp != stdin && fclose(hdl->fp))
+		error = Z140_ZREC_ERR_IO;
+
+	free(hdl->buf);
+	free(hdl);
+	*hdlP = NULL;
+
+	return error;
+}
+
+/***************************************************************************/
+/** Error code of an incomplete record
+ *
+ *  \param hdl        \IN  recording handle
+ *
+ *  \return           Z140_ZREC_END at the end of the file,
+ *                    Z140_ZREC_ERR_IO on a read error,
+ *                    Z140_ZREC_ERR_FORMAT for a too long varint
+ */
+static int32 ReadFail(Z140_ZREC_HANDLE *hdl)
+{
+	if (ferror(hdl->fp))
+		return Z140_ZREC_ERR_IO;
+
+	return feof(hdl->fp) ? Z140_ZREC_END : Z140_ZREC_ERR_FORMAT;
+}
+
+/***************************************************************************/
+/** Write pending run record
+ *
+ *  \param hdl        \IN  recording handle
+ */
+static void FlushRun(Z140_ZREC_HANDLE *hdl)
+{
+	if (hdl->run) {
+		putc(Z140_ZREC_RUN | (hdl->run - 1), hdl->fp);
+		hdl->run = 0;
+	}
+}
+
+/***************************************************************************/
+/** Write sync record
+ *
+ *  \param hdl        \IN  recording handle
+ *  \param snap       \IN  snapshot
+ */
+static void WriteSync(Z140_ZREC_HANDLE *hdl, const Z140_SNAPSHOT *snap)
+{
+	u_int8 p[4 + SYNC_PAYLOAD + 1], sum = 0;
+	u_int32 n, val[5];
+
+	p[0] = Z140_ZREC_SYNC;
+	p[1] = 'Z';
+	p[2] = 'S';
+	p[3] = 'Y';
+
+	val[0] = snap->periodA;
+	val[1] = snap->periodB;
+	val[2] = snap->distFwd;
+	val[3] = snap->distBwd;
+	val[4] = snap->status;
+
+	for (n = 0; n < 4; n++)
+		p[4 + n] = (u_int8)(hdl->rec >> (8 * n));
+	for (n = 0; n < 8; n++)
+		p[8 + n] = (u_int8)(snap->tstamp >> (8 * n));
+	for (n = 0; n < 20; n++)
+		p[16 + n] = (u_int8)(val[n / 4] >> (8 * (n % 4)));
+
+	for (n = 4; n < 4 + SYNC_PAYLOAD; n++)
+		sum += p[n];
+	p[4 + SYNC_PAYLOAD] = (u_int8)-sum;
+
+	fwrite(p, 1, sizeof(p), hdl->fp);
+	hdl->prevDt = 0;
+}
+
+/***************************************************************************/
+/** Check and decode sync record
+ *
+ *  \param p          \IN  sync record (marker, payload, checksum)
+ *  \param idxP       \OUT record index
+ *  \param snap       \OUT snapshot (NULL: only check)
+ *
+ *  \return           0 if valid, -1 if not
+ */
+static int ParseSync(u_int8 *p, u_int32 *idxP, Z140_SNAPSHOT *snap)
+{
+	u_int8 sum = 0;
+	int n;
+
+	if (GetLe(p, 4) != 0x59535AA5)		/* 0xA5 'Z' 'S' 'Y' */
+		return -1;
+
+	for (n = 4; n < 4 + SYNC_PAYLOAD + 1; n++)
+		sum += p[n];
+	if (sum)
+		return -1;
+
+	*idxP = (u_int32)GetLe(&p[4], 4);
+
+	if (snap) {
+		snap->tstamp  = GetLe(&p[8], 8);
+		snap->periodA = (u_int32)GetLe(&p[16], 4);
+		snap->periodB = (u_int32)GetLe(&p[20], 4);
+		snap->distFwd = (u_int32)GetLe(&p[24], 4);
+		snap->distBwd = (u_int32)GetLe(&p[28], 4);
+		snap->status  = (u_int32)GetLe(&p[32], 4);
+	}
+
+	return 0;
+}
+
+/***************************************************************************/
+/** Find the next valid sync record
+ *
+ *  \param hdl        \IN  recording handle
+ *  \param from       \IN  file offset to start the search
+ *  \param offP       \OUT file offset of the sync record
+ *  \param idxP       \OUT record index of the sync record
+ *
+ *  \return           0 if found, -1 if not
+ */
+static int FindSync(
+	Z140_ZREC_HANDLE	*hdl,
+	off_t				from,
+	off_t				*offP,
+	u_int32				*idxP
+)
+{
+	u_int8 p[4 + SYNC_PAYLOAD + 1];
+	u_int32 win = 0;
+	off_t off = from;
+	int c;
+
+	if (fseeko(hdl->fp, from, SEEK_SET))
+		return -1;
+
+	while ((c = getc(hdl->fp)) != EOF) {
+		win = (win << 8) | (u_int32)c;
+		off++;
+
+		if (win != SYNC_MARKER || off - from < 4)
+			continue;
+
+		/* candidate: check payload and checksum */
+		p[0] = Z140_ZREC_SYNC;
+		p[1] = 'Z';
+		p[2] = 'S';
+		p[3] = 'Y';
+		if (fread(&p[4], 1, SYNC_PAYLOAD + 1, hdl->fp) != SYNC_PAYLOAD + 1)
+			return -1;
+		if (!ParseSync(p, idxP, NULL)) {
+			*offP = off - 4;
+			return 0;
+		}
+
+		/* marker within record data */
+		if (fseeko(hdl->fp, off, SEEK_SET))
+			return -1;
+		win = 0;
+	}
+
+	return -1;
+}
+
+/***************************************************************************/
+/** Write varint
+ *
+ *  \param fp         \IN  file
+ *  \param v          \IN  value
+ */
+static void PutVarint(FILE *fp, u_int64 v)
+{
+	while (v >= 0x80) {
+		putc((int)(v & 0x7F) | 0x80, fp);
+		v >>= 7;
+	}
+	putc((int)v, fp);
+}
+
+/***************************************************************************/
+/** Read varint
+ *
+ *  \param fp         \IN  file
+ *  \param vP         \OUT value
+ *
+ *  \return           0 on success, -1 at end of file or for a varint
+ *                    longer than 64 bits
+ */
+static int GetVarint(FILE *fp, u_int64 *vP)
+{
+	u_int64 v = 0;
+	int c, shift;
+
+	for (shift = 0; shift < 64; shift += 7) {
+		if ((c = getc(fp)) == EOF)
+			return -1;
+		v |= (u_int64)(c & 0x7F) << shift;
+		if (!(c & 0x80)) {
+			*vP = v;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+/***************************************************************************/
+/** Write little endian value
+ *
+ *  \param fp         \IN  file
+ *  \param v          \IN  value
+ *  \param bytes      \IN  number of bytes
+ */
+static void PutLe(FILE *fp, u_int64 v, int bytes)
+{
+	while (bytes--) {
+		putc((int)(v & 0xFF), fp);
+		v >>= 8;
+	}
+}
+
+/***************************************************************************/
+/** Get little endian value
+ *
+ *  \param p          \IN  bytes
+ *  \param bytes      \IN  number of bytes
+ *
+ *  \return           value
+ */
+static u_int64 GetLe(u_int8 *p, int bytes)
+{
+	u_int64 v = 0;
+
+	while (bytes--)
+		v = (v << 8) | p[bytes];
+
+	return v;
+}